@@ -6,21 +6,34 @@ out vec4 color;
 
 // Texture samplers
 uniform sampler2D tex;
-uniform sampler2D alphaTex;
+// the alpha mask is stored as viscom::SparseAlphaMask.
+uniform sampler2D alphaTileTable;
+uniform sampler2D alphaTileAtlas;
+uniform vec2 alphaMaskSize;
+uniform float alphaTileSize;
+
+vec4 SampleAlphaMask(vec2 maskCoords)
+{
+    ivec2 tile = clamp(ivec2(maskCoords / alphaTileSize), ivec2(0), textureSize(alphaTileTable, 0) - 1);
+    vec4 entry = texelFetch(alphaTileTable, tile, 0);
+    // constant tiles hold their value, all others their position in the atlas (tiles there have a border of one texel).
+    if (entry.a < 0.0) return vec4(entry.rgb, 1.0);
+
+    vec2 inTile = clamp(maskCoords, vec2(0.0), alphaMaskSize) - vec2(tile) * alphaTileSize;
+    vec2 atlasCoords = entry.xy * (alphaTileSize + 2.0) + 1.0 + inTile;
+    return texture(alphaTileAtlas, atlasCoords / vec2(textureSize(alphaTileAtlas, 0)));
+}
 
 void main()
 {
     const float gamma = 1.0/2.2;
 
     vec2 coord = vec2(v_TexCoord.s / v_TexCoord.p, v_TexCoord.t / v_TexCoord.p);
-    vec2 screenSize = vec2(textureSize(alphaTex, 0));
-    vec2 screenCoords = gl_FragCoord.xy / screenSize;
 
     vec4 colorTexture = texture(tex, coord);
-    vec4 alpha = texture(alphaTex, screenCoords);
+    vec4 alpha = SampleAlphaMask(gl_FragCoord.xy);
 
     alpha = vec4(vec3(pow(alpha.r, gamma)), 1.0f);
 
     color = vec4(colorTexture * alpha);
 }
-
@@ -0,0 +1,33 @@
+// Per draw data written by viscom::IndirectDrawList, needs to be included directly after the #version line.
+// gl_DrawIDARB is only available in vertex shaders, other stages need to get the data passed on.
+#extension GL_ARB_shader_draw_parameters : enable
+
+struct DrawData
+{
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    uint materialIndex;
+    // negative if the bumpMultiplier uniform is used.
+    float bumpMultiplier;
+};
+
+layout(std430, binding = 0) readonly buffer DrawDataBuffer
+{
+    DrawData drawData[];
+};
+
+uniform int drawDataOffset;
+#ifndef GL_ARB_shader_draw_parameters
+// without the extension, the index of the draw comes from an instanced attribute (the base instance of each command is its index).
+// the location is IndirectDrawBuffer::DRAW_ID_ATTRIBUTE, so it does not collide with the attributes of the meshes.
+layout(location = 15) in uint drawId;
+#endif
+
+DrawData GetDrawData()
+{
+#ifdef GL_ARB_shader_draw_parameters
+    return drawData[drawDataOffset + gl_DrawIDARB];
+#else
+    return drawData[drawId];
+#endif
+}
@@ -0,0 +1,36 @@
+// Material textures packed by viscom::TexturePacker, the diffuse and bump textures are texture arrays.
+// The block is bound with UniformBuffers::BindUniformBlocks, the material index comes from the draw block or the draw data.
+
+struct MaterialTextureData
+{
+    vec4 diffuseScaleOffset;
+    vec4 bumpScaleOffset;
+    // diffuse layer (x), bump layer (y).
+    vec4 layers;
+};
+
+layout(std140) uniform MaterialTextureBlock
+{
+    MaterialTextureData materialTextures[256];
+};
+
+uniform sampler2DArray diffuseTexture;
+uniform sampler2DArray bumpTexture;
+
+// texture coordinates are clamped as the textures may be one of many in an atlas page.
+vec3 PackedTextureCoordinates(vec2 uv, vec4 scaleOffset, float layer)
+{
+    return vec3(clamp(uv, 0.0, 1.0) * scaleOffset.xy + scaleOffset.zw, layer);
+}
+
+vec4 SamplePackedDiffuse(uint materialIndex, vec2 uv)
+{
+    MaterialTextureData data = materialTextures[materialIndex];
+    return texture(diffuseTexture, PackedTextureCoordinates(uv, data.diffuseScaleOffset, data.layers.x));
+}
+
+vec4 SamplePackedBump(uint materialIndex, vec2 uv)
+{
+    MaterialTextureData data = materialTextures[materialIndex];
+    return texture(bumpTexture, PackedTextureCoordinates(uv, data.bumpScaleOffset, data.layers.y));
+}
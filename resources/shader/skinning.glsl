@@ -0,0 +1,56 @@
+// Decoding of the skinning palettes written by viscom::SkinningBuffer.
+
+uniform samplerBuffer skinningPalette;
+uniform int skinningOffset;
+// 0: 4x4 matrices, 1: 3x4 affine matrices, 2: dual quaternions.
+uniform int skinningEncoding;
+
+mat4 GetBoneMatrix(uint bone)
+{
+    if (skinningEncoding == 0) {
+        int base = skinningOffset + 4 * int(bone);
+        return mat4(texelFetch(skinningPalette, base), texelFetch(skinningPalette, base + 1),
+            texelFetch(skinningPalette, base + 2), texelFetch(skinningPalette, base + 3));
+    }
+    int base = skinningOffset + 3 * int(bone);
+    vec4 r0 = texelFetch(skinningPalette, base);
+    vec4 r1 = texelFetch(skinningPalette, base + 1);
+    vec4 r2 = texelFetch(skinningPalette, base + 2);
+    return mat4(vec4(r0.x, r1.x, r2.x, 0.0), vec4(r0.y, r1.y, r2.y, 0.0),
+        vec4(r0.z, r1.z, r2.z, 0.0), vec4(r0.w, r1.w, r2.w, 1.0));
+}
+
+mat4 DualQuaternionToMatrix(vec4 real, vec4 dual)
+{
+    float len = length(real);
+    real /= len;
+    dual /= len;
+    vec3 t = 2.0 * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz));
+
+    float x = real.x, y = real.y, z = real.z, w = real.w;
+    return mat4(vec4(1.0 - 2.0 * (y * y + z * z), 2.0 * (x * y + w * z), 2.0 * (x * z - w * y), 0.0),
+        vec4(2.0 * (x * y - w * z), 1.0 - 2.0 * (x * x + z * z), 2.0 * (y * z + w * x), 0.0),
+        vec4(2.0 * (x * z + w * y), 2.0 * (y * z - w * x), 1.0 - 2.0 * (x * x + y * y), 0.0),
+        vec4(t, 1.0));
+}
+
+mat4 GetSkinningMatrix(uvec4 boneIndices, vec4 boneWeights)
+{
+    if (skinningEncoding == 2) {
+        // dual quaternion linear blending, all quaternions are moved to the hemisphere of the first one.
+        int base = skinningOffset + 2 * int(boneIndices[0]);
+        vec4 real0 = texelFetch(skinningPalette, base);
+        vec4 real = vec4(0.0), dual = vec4(0.0);
+        for (int i = 0; i < 4; ++i) {
+            base = skinningOffset + 2 * int(boneIndices[i]);
+            vec4 r = texelFetch(skinningPalette, base);
+            float w = dot(r, real0) < 0.0 ? -boneWeights[i] : boneWeights[i];
+            real += w * r;
+            dual += w * texelFetch(skinningPalette, base + 1);
+        }
+        return DualQuaternionToMatrix(real, dual);
+    }
+
+    return boneWeights[0] * GetBoneMatrix(boneIndices[0]) + boneWeights[1] * GetBoneMatrix(boneIndices[1])
+        + boneWeights[2] * GetBoneMatrix(boneIndices[2]) + boneWeights[3] * GetBoneMatrix(boneIndices[3]);
+}
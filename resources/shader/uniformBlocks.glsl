@@ -0,0 +1,36 @@
+// Uniform blocks written by viscom::UniformBuffers, the blocks are bound with UniformBuffers::BindUniformBlocks.
+
+layout(std140) uniform FrameBlock
+{
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    mat4 viewProjectionMatrix;
+    vec4 cameraPosition;
+} frame;
+
+struct MaterialData
+{
+    vec4 ambientAlpha;
+    vec4 diffuseExponent;
+    vec4 specularRefraction;
+    vec4 bumpMultiplier;
+};
+
+layout(std140) uniform MaterialBlock
+{
+    MaterialData materials[256];
+};
+
+layout(std140) uniform DrawBlock
+{
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    uint materialIndex;
+    // negative if the bumpMultiplier uniform is used.
+    float bumpMultiplier;
+} draw;
+
+MaterialData GetMaterial()
+{
+    return materials[draw.materialIndex];
+}
@@ -0,0 +1,53 @@
+// Sampling and feedback functions for viscom::VirtualTexture, the uniforms are set by VirtualTexture::SetUniforms.
+// Texture coordinates are in [0, 1] over the image, the pyramid is padded to a square of tiles.
+
+uniform usampler2D vtPageTable;
+uniform sampler2D vtPhysicalTexture;
+// size of the image relative to the padded pyramid.
+uniform vec2 vtImageScale;
+// size of the padded pyramid in texels.
+uniform float vtVirtualSize;
+uniform int vtNumLevels;
+// tile size, border size, tile size with border (in texels).
+uniform vec3 vtTileParameters;
+// size of the physical texture in texels.
+uniform float vtPhysicalSize;
+// compensates the lower resolution of the feedback buffer.
+uniform float vtFeedbackLodBias;
+
+float VirtualTextureMipLevel(vec2 virtualUV)
+{
+    vec2 texelCoords = virtualUV * vtVirtualSize;
+    vec2 dx = dFdx(texelCoords);
+    vec2 dy = dFdy(texelCoords);
+    return 0.5 * log2(max(dot(dx, dx), dot(dy, dy)));
+}
+
+ivec2 VirtualTextureTile(vec2 virtualUV, int level)
+{
+    float tilesPerSide = exp2(float(vtNumLevels - 1 - level));
+    return ivec2(min(floor(virtualUV * tilesPerSide), vec2(tilesPerSide - 1.0)));
+}
+
+vec4 SampleVirtualTexture(vec2 uv)
+{
+    vec2 virtualUV = clamp(uv, 0.0, 1.0) * vtImageScale;
+    int level = clamp(int(VirtualTextureMipLevel(virtualUV)), 0, vtNumLevels - 1);
+    uvec4 page = texelFetch(vtPageTable, VirtualTextureTile(virtualUV, level), level);
+
+    // the page may point to a coarser resident tile.
+    float residentTilesPerSide = exp2(float(vtNumLevels - 1) - float(page.z));
+    vec2 tileCoords = virtualUV * residentTilesPerSide;
+    vec2 inTile = tileCoords - min(floor(tileCoords), vec2(residentTilesPerSide - 1.0));
+    vec2 physicalCoords = vec2(page.xy) * vtTileParameters.z + vtTileParameters.y + inTile * vtTileParameters.x;
+    return textureLod(vtPhysicalTexture, physicalCoords / vtPhysicalSize, 0.0);
+}
+
+// Write the result to a uint output of the feedback pass (see VirtualTexture::BeginFeedback).
+uint VirtualTextureFeedback(vec2 uv)
+{
+    vec2 virtualUV = clamp(uv, 0.0, 1.0) * vtImageScale;
+    int level = clamp(int(VirtualTextureMipLevel(virtualUV) + vtFeedbackLodBias), 0, vtNumLevels - 1);
+    uvec2 tile = uvec2(VirtualTextureTile(virtualUV, level));
+    return ((uint(level) << 26u) | (tile.y << 13u) | tile.x) + 1u;
+}
@@ -32,6 +32,9 @@ namespace viscom {
             else if (str == "PROGRAM_PROPERTIES=") ifs >> config.programProperties_;
             else if (str == "SGCT_CONFIG=") ifs >> config.sgctConfig_;
             else if (str == "PROJECTOR_DATA=") ifs >> config.projectorData_;
+            else if (str == "ALPHA_MASK_8BIT=") ifs >> config.alphaMask8Bit_;
+            else if (str == "TEXTURE_MEMORY_BUDGET=") ifs >> config.textureMemoryBudget_;
+            else if (str == "SIMULATE_TEXTURE_MEMORY_BUDGET=") ifs >> config.simulateTextureMemoryBudget_;
             else if (str == "LOCAL=") ifs >> config.sgctLocal_;
             else if (str == "--slave") config.sgctWorker_ = true;
             else if (str == "TUIO_PORT=") ifs >> config.tuioPort_;
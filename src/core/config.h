@@ -46,6 +46,12 @@ namespace viscom {
         std::string sgctConfig_;
         /** The path to the projector data file. */
         std::string projectorData_;
+        /** Stores the non constant tiles of the calibration alpha masks with dithered 8 bit instead of 16 bit precision. */
+        bool alphaMask8Bit_ = false;
+        /** The video memory budget for textures in megabytes (0 for no budget). */
+        std::size_t textureMemoryBudget_ = 0;
+        /** Only simulates the texture memory budget without dropping mip levels. */
+        bool simulateTextureMemoryBudget_ = false;
         /** Index to node to use settings from. */
         std::string sgctLocal_;
         /** Defines if the node is a worker or coordinator. */
@@ -0,0 +1,161 @@
+/**
+ * @file   FloatConversion.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.26
+ *
+ * @brief  Implementation of helper functions for converting float images to half and packed float formats.
+ */
+
+#include "FloatConversion.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// MSVC has no switch for F16C, it is available with /arch:AVX2 (see VISCOM_ENABLE_F16C).
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#include <immintrin.h>
+#endif
+
+namespace viscom {
+
+    namespace {
+        /** The smallest normal half float, errors of smaller values are relative to it. */
+        constexpr float MIN_NORMAL_HALF = 6.103515625e-05f;
+        /** The largest half float. */
+        constexpr float MAX_HALF = 65504.0f;
+
+        /**
+         *  Converts a non-negative float to a float with a 5 bit exponent and the given number of mantissa bits,
+         *  rounding to the nearest value (ties to even) and clamping to the largest finite value.
+         *  @param bits the bits of the float (without sign).
+         *  @param mantissaBits the number of mantissa bits of the result.
+         */
+        std::uint32_t FloatBitsToSmallFloat(std::uint32_t bits, unsigned int mantissaBits) noexcept
+        {
+            auto maxValue = (31U << mantissaBits) - 1U;
+            auto round = [](std::uint32_t value, std::uint32_t shift) {
+                auto result = value >> shift;
+                auto remainder = value & ((1U << shift) - 1U);
+                auto halfway = 1U << (shift - 1U);
+                if (remainder > halfway || (remainder == halfway && (result & 1U) != 0)) ++result;
+                return result;
+            };
+
+            // smaller than the smallest normal value with a 5 bit exponent (2^-14).
+            if (bits < 0x38800000U) {
+                auto shift = 136U - mantissaBits - (bits >> 23U);
+                if (shift > 24U) return 0;
+                return round((bits & 0x7FFFFFU) | 0x800000U, shift);
+            }
+            if (bits >= 0x7F800000U) return maxValue;
+            return std::min(round(bits - 0x38000000U, 23U - mantissaBits), maxValue);
+        }
+
+        /**
+         *  Converts a float with a 5 bit exponent and the given number of mantissa bits to a float.
+         *  @param value the small float (without sign).
+         *  @param mantissaBits the number of mantissa bits.
+         */
+        float SmallFloatToFloat(std::uint32_t value, unsigned int mantissaBits) noexcept
+        {
+            auto exponent = value >> mantissaBits;
+            auto mantissa = value & ((1U << mantissaBits) - 1U);
+            if (exponent == 0) return std::ldexp(static_cast<float>(mantissa), -14 - static_cast<int>(mantissaBits));
+
+            auto bits = exponent == 31 ? 0x7F800000U | (mantissa << (23U - mantissaBits)) : ((exponent + 112U) << 23U) | (mantissa << (23U - mantissaBits));
+            float result;
+            memcpy(&result, &bits, sizeof(float));
+            return result;
+        }
+
+        /** Returns the error of a converted value relative to the original. */
+        float RelativeError(float original, float converted) noexcept
+        {
+            return std::abs(original - converted) / std::max(std::abs(original), MIN_NORMAL_HALF);
+        }
+    }
+
+    std::uint16_t FloatToHalf(float value) noexcept
+    {
+        if (std::isnan(value)) return 0;
+
+        std::uint32_t bits;
+        memcpy(&bits, &value, sizeof(float));
+        return static_cast<std::uint16_t>(((bits >> 16U) & 0x8000U) | FloatBitsToSmallFloat(bits & 0x7FFFFFFFU, 10));
+    }
+
+    float HalfToFloat(std::uint16_t value) noexcept
+    {
+        auto result = SmallFloatToFloat(value & 0x7FFFU, 10);
+        return (value & 0x8000U) != 0 ? -result : result;
+    }
+
+    FloatConversionStatistics ConvertToHalfFloat(const float* src, std::uint16_t* dst, std::size_t count)
+    {
+        FloatConversionStatistics statistics;
+        std::size_t i = 0;
+
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+        const auto maxHalf = _mm256_set1_ps(MAX_HALF);
+        const auto minHalf = _mm256_set1_ps(-MAX_HALF);
+        const auto minNormal = _mm256_set1_ps(MIN_NORMAL_HALF);
+        const auto absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+        auto maxError = _mm256_setzero_ps();
+        // all values of a block are loaded before it is stored, which allows converting in place.
+        for (; i + 8 <= count; i += 8) {
+            auto values = _mm256_loadu_ps(src + i);
+            values = _mm256_and_ps(values, _mm256_cmp_ps(values, values, _CMP_ORD_Q));
+            auto clampedMask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_and_ps(values, absMask), maxHalf, _CMP_GT_OQ));
+            for (; clampedMask != 0; clampedMask &= clampedMask - 1) ++statistics.clampedValues_;
+            values = _mm256_min_ps(_mm256_max_ps(values, minHalf), maxHalf);
+
+            auto halfs = _mm256_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), halfs);
+
+            auto difference = _mm256_and_ps(_mm256_sub_ps(values, _mm256_cvtph_ps(halfs)), absMask);
+            maxError = _mm256_max_ps(maxError, _mm256_div_ps(difference, _mm256_max_ps(_mm256_and_ps(values, absMask), minNormal)));
+        }
+
+        alignas(32) float maxErrors[8];
+        _mm256_store_ps(maxErrors, maxError);
+        statistics.maxRelativeError_ = *std::max_element(maxErrors, maxErrors + 8);
+#endif
+
+        for (; i < count; ++i) {
+            auto value = std::isnan(src[i]) ? 0.0f : src[i];
+            if (std::abs(value) > MAX_HALF) ++statistics.clampedValues_;
+            value = std::clamp(value, -MAX_HALF, MAX_HALF);
+
+            dst[i] = FloatToHalf(value);
+            statistics.maxRelativeError_ = std::max(statistics.maxRelativeError_, RelativeError(value, HalfToFloat(dst[i])));
+        }
+        return statistics;
+    }
+
+    FloatConversionStatistics ConvertToPackedFloat(const float* src, std::uint32_t* dst, std::size_t numPixels, unsigned int channels)
+    {
+        constexpr unsigned int mantissaBits[] = { 6, 6, 5 };
+        constexpr float maxValues[] = { 65024.0f, 65024.0f, 64512.0f };
+
+        FloatConversionStatistics statistics;
+        for (std::size_t i = 0; i < numPixels; ++i) {
+            // the pixel is read completely before it is stored, which allows converting in place.
+            float rgb[3] = { src[i * channels], src[i * channels + 1], src[i * channels + 2] };
+
+            std::uint32_t packed = 0;
+            for (unsigned int c = 0; c < 3; ++c) {
+                auto value = std::isnan(rgb[c]) ? 0.0f : rgb[c];
+                if (value < 0.0f || value > maxValues[c]) ++statistics.clampedValues_;
+                value = std::clamp(value, 0.0f, maxValues[c]);
+
+                std::uint32_t bits;
+                memcpy(&bits, &value, sizeof(float));
+                auto smallFloat = FloatBitsToSmallFloat(bits, mantissaBits[c]);
+                statistics.maxRelativeError_ = std::max(statistics.maxRelativeError_, RelativeError(value, SmallFloatToFloat(smallFloat, mantissaBits[c])));
+                packed |= smallFloat << (11U * c);
+            }
+            dst[i] = packed;
+        }
+        return statistics;
+    }
+}
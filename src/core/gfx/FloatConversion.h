@@ -0,0 +1,56 @@
+/**
+ * @file   FloatConversion.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.26
+ *
+ * @brief  Declaration of helper functions for converting float images to half and packed float formats.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace viscom {
+
+    /** Describes the precision lost by a conversion. */
+    struct FloatConversionStatistics
+    {
+        /** The largest error relative to the converted value (values below the smallest normal half are compared to it). */
+        float maxRelativeError_ = 0.0f;
+        /** The number of values out of the range of the format (clamped to its largest value or to zero). */
+        std::size_t clampedValues_ = 0;
+    };
+
+    /**
+     *  Converts a float to a half float, rounding to the nearest value. Values out of range are clamped, NaNs become zero.
+     *  @param value the float value.
+     */
+    std::uint16_t FloatToHalf(float value) noexcept;
+    /**
+     *  Converts a half float to a float.
+     *  @param value the half float value.
+     */
+    float HalfToFloat(std::uint16_t value) noexcept;
+
+    /**
+     *  Converts floats to half floats, using F16C instructions if the compiler targets them (VISCOM_ENABLE_F16C).
+     *  Can convert in place, i.e., the destination may alias the source.
+     *  @param src the floats.
+     *  @param dst the half floats.
+     *  @param count the number of values.
+     *  @return the precision lost.
+     */
+    FloatConversionStatistics ConvertToHalfFloat(const float* src, std::uint16_t* dst, std::size_t count);
+    /**
+     *  Converts float pixels to the packed GL_R11F_G11F_B10F format (the format of GL_UNSIGNED_INT_10F_11F_11F_REV).
+     *  Negative values are clamped to zero, further channels are dropped.
+     *  Can convert in place, i.e., the destination may alias the source.
+     *  @param src the pixels.
+     *  @param dst the packed pixels.
+     *  @param numPixels the number of pixels.
+     *  @param channels the number of channels of the source pixels (at least 3).
+     *  @return the precision lost.
+     */
+    FloatConversionStatistics ConvertToPackedFloat(const float* src, std::uint32_t* dst, std::size_t numPixels, unsigned int channels);
+}
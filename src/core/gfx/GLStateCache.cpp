@@ -0,0 +1,99 @@
+/**
+ * @file   GLStateCache.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.10
+ *
+ * @brief  Implementation of a cache for OpenGL state that skips redundant state changes.
+ */
+
+#include "GLStateCache.h"
+#include "core/open_gl.h"
+#include <cstring>
+
+namespace viscom {
+
+    GLStateCache::GLStateCache()
+    {
+        Invalidate();
+    }
+
+    void GLStateCache::Invalidate()
+    {
+        program_ = UNKNOWN;
+        vao_ = UNKNOWN;
+        activeTextureUnit_ = UNKNOWN;
+        textures_.fill(UNKNOWN);
+        uniforms_.clear();
+    }
+
+    void GLStateCache::UseProgram(GLuint program)
+    {
+        if (program_ == program) {
+            ++statistics_.skippedCalls_;
+            return;
+        }
+        glUseProgram(program);
+        program_ = program;
+        ++statistics_.issuedCalls_;
+    }
+
+    void GLStateCache::BindVertexArray(GLuint vao)
+    {
+        if (vao_ == vao) {
+            ++statistics_.skippedCalls_;
+            return;
+        }
+        glBindVertexArray(vao);
+        vao_ = vao;
+        ++statistics_.issuedCalls_;
+    }
+
+    void GLStateCache::BindTexture(unsigned int unit, GLuint texture, bool textureArray)
+    {
+        if (unit < MAX_TEXTURE_UNITS && textures_[unit] == texture) {
+            ++statistics_.skippedCalls_;
+            return;
+        }
+
+        if (activeTextureUnit_ != unit) {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            activeTextureUnit_ = unit;
+            ++statistics_.issuedCalls_;
+        }
+        else ++statistics_.skippedCalls_;
+        glBindTexture(textureArray ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, texture);
+        if (unit < MAX_TEXTURE_UNITS) textures_[unit] = texture;
+        ++statistics_.issuedCalls_;
+    }
+
+    void GLStateCache::Uniform(GLint location, GLint value)
+    {
+        if (location < 0) return;
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        if (IsUniformCurrent(location, bits)) return;
+        glUniform1i(location, value);
+    }
+
+    void GLStateCache::Uniform(GLint location, GLfloat value)
+    {
+        if (location < 0) return;
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        if (IsUniformCurrent(location, bits)) return;
+        glUniform1f(location, value);
+    }
+
+    bool GLStateCache::IsUniformCurrent(GLint location, std::uint32_t bits)
+    {
+        auto key = (static_cast<std::uint64_t>(program_) << 32) | static_cast<std::uint32_t>(location);
+        auto it = uniforms_.find(key);
+        if (it != uniforms_.end() && it->second == bits) {
+            ++statistics_.skippedCalls_;
+            return true;
+        }
+        uniforms_[key] = bits;
+        ++statistics_.issuedCalls_;
+        return false;
+    }
+}
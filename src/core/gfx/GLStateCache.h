@@ -0,0 +1,108 @@
+/**
+ * @file   GLStateCache.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.10
+ *
+ * @brief  Declaration of a cache for OpenGL state that skips redundant state changes.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "core/open_gl_fwd.h"
+
+#include <array>
+#include <unordered_map>
+
+namespace viscom {
+
+    /** Counters of the OpenGL calls passed through a state cache. */
+    struct GLCallStatistics
+    {
+        /** The number of calls forwarded to OpenGL. */
+        std::size_t issuedCalls_ = 0;
+        /** The number of calls skipped because the state was already set. */
+        std::size_t skippedCalls_ = 0;
+    };
+
+    /**
+     *  Tracks bound programs, vertex arrays, textures and simple uniforms and only calls OpenGL if they change.
+     *  Other code changing the OpenGL state directly invalidates the cache, so Invalidate() needs to be called
+     *  (e.g. once per frame and after drawing things that do not use the cache).
+     */
+    class GLStateCache final
+    {
+    public:
+        /** Number of texture units tracked by the cache. */
+        static constexpr std::size_t MAX_TEXTURE_UNITS = 16;
+
+        GLStateCache();
+
+        /** Forgets all cached state, the next calls will be forwarded to OpenGL. */
+        void Invalidate();
+
+        /**
+         *  Sets the current program.
+         *  @param program the program.
+         */
+        void UseProgram(GLuint program);
+        /**
+         *  Binds a vertex array object.
+         *  @param vao the vertex array object.
+         */
+        void BindVertexArray(GLuint vao);
+        /**
+         *  Binds a 2D texture or 2D texture array to a texture unit.
+         *  @param unit the texture unit (starting at 0).
+         *  @param texture the texture.
+         *  @param textureArray whether the texture is a 2D texture array.
+         */
+        void BindTexture(unsigned int unit, GLuint texture, bool textureArray = false);
+        /**
+         *  Sets an integer uniform of the current program.
+         *  @param location the uniform location.
+         *  @param value the value to set.
+         */
+        void Uniform(GLint location, GLint value);
+        /**
+         *  Sets a float uniform of the current program.
+         *  @param location the uniform location.
+         *  @param value the value to set.
+         */
+        void Uniform(GLint location, GLfloat value);
+        /**
+         *  Counts a call that is always forwarded (e.g. matrix uniforms or draw calls).
+         *  @param count the number of calls.
+         */
+        void CountIssuedCalls(std::size_t count = 1) noexcept { statistics_.issuedCalls_ += count; }
+
+        /** Returns the call statistics accumulated since the last reset. */
+        const GLCallStatistics& GetStatistics() const noexcept { return statistics_; }
+        /** Resets the call statistics, this should be called once per frame. */
+        void ResetStatistics() noexcept { statistics_ = GLCallStatistics{}; }
+
+    private:
+        /**
+         *  Checks if a uniform value is already set in the current program and stores it otherwise.
+         *  @param location the uniform location.
+         *  @param bits the bit pattern of the value.
+         */
+        bool IsUniformCurrent(GLint location, std::uint32_t bits);
+
+        /** Value marking unknown state. */
+        static constexpr GLuint UNKNOWN = static_cast<GLuint>(-1);
+
+        /** Holds the current program. */
+        GLuint program_ = 0;
+        /** Holds the current vertex array object. */
+        GLuint vao_ = 0;
+        /** Holds the active texture unit. */
+        unsigned int activeTextureUnit_ = 0;
+        /** Holds the texture bound to each texture unit (names are unique over all targets). */
+        std::array<GLuint, MAX_TEXTURE_UNITS> textures_;
+        /** Holds the uniform values set per program and location. */
+        std::unordered_map<std::uint64_t, std::uint32_t> uniforms_;
+        /** Holds the call statistics. */
+        GLCallStatistics statistics_;
+    };
+}
@@ -9,6 +9,7 @@
 #pragma once
 
 #include "core/main.h"
+#include "core/open_gl_fwd.h"
 
 namespace viscom {
 
@@ -33,6 +34,17 @@ namespace viscom {
         float bumpMultiplier = 1.f;
     };
 
+    /** Holds where a texture was placed by the TexturePacker. */
+    struct PackedTextureReference final
+    {
+        /** Holds the texture array (0 if the texture is not packed). */
+        GLuint textureArray = 0;
+        /** Holds the layer in the texture array. */
+        unsigned int layer = 0;
+        /** Holds the scale (xy) and offset (zw) of the texture coordinates in the layer. */
+        glm::vec4 uvScaleOffset = glm::vec4{ 1.0f, 1.0f, 0.0f, 0.0f };
+    };
+
     /** Holds the materials diffuse and bump texture. */
     struct MaterialTextures final
     {
@@ -40,5 +52,9 @@ namespace viscom {
         std::shared_ptr<const Texture> diffuseTex;
         /** Holds the materials bump texture. */
         std::shared_ptr<const Texture> bumpTex;
+        /** Holds the packed diffuse texture (used instead of diffuseTex if set). */
+        PackedTextureReference diffusePacked;
+        /** Holds the packed bump texture (used instead of bumpTex if set). */
+        PackedTextureReference bumpPacked;
     };
 }
@@ -0,0 +1,129 @@
+/**
+ * @file   MipmapGenerator.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.20
+ *
+ * @brief  Implementation of helper functions for generating mip maps on the CPU.
+ */
+
+#include "MipmapGenerator.h"
+#include "core/utils/ThreadPool.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+namespace viscom {
+
+    namespace {
+        /** The minimum number of rows filtered by a single task. */
+        constexpr std::size_t MIN_ROWS_PER_TASK = 16;
+        /** The number of entries in the table converting linear values to sRGB. */
+        constexpr std::size_t LINEAR_TO_SRGB_TABLE_SIZE = 4096;
+
+        float SRGBToLinear(float c) { return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f); }
+        float LinearToSRGB(float c) { return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f; }
+
+        const std::array<float, 256>& GetSRGBToLinearTable()
+        {
+            static const auto table = []() {
+                std::array<float, 256> result;
+                for (std::size_t i = 0; i < result.size(); ++i) result[i] = SRGBToLinear(static_cast<float>(i) / 255.0f);
+                return result;
+            }();
+            return table;
+        }
+
+        const std::array<std::uint8_t, LINEAR_TO_SRGB_TABLE_SIZE>& GetLinearToSRGBTable()
+        {
+            static const auto table = []() {
+                std::array<std::uint8_t, LINEAR_TO_SRGB_TABLE_SIZE> result;
+                for (std::size_t i = 0; i < result.size(); ++i) {
+                    auto linear = static_cast<float>(i) / static_cast<float>(LINEAR_TO_SRGB_TABLE_SIZE - 1);
+                    result[i] = static_cast<std::uint8_t>(std::lround(LinearToSRGB(linear) * 255.0f));
+                }
+                return result;
+            }();
+            return table;
+        }
+
+        /** Averages a 2x2 block of float pixels. */
+        void FilterRowsFloat(const float* src, unsigned int srcWidth, unsigned int srcHeight, float* dst, unsigned int dstWidth,
+            unsigned int channels, std::size_t rowBegin, std::size_t rowEnd)
+        {
+            for (auto y = rowBegin; y < rowEnd; ++y) {
+                auto row0 = src + std::min<std::size_t>(2 * y, srcHeight - 1) * srcWidth * channels;
+                auto row1 = src + std::min<std::size_t>(2 * y + 1, srcHeight - 1) * srcWidth * channels;
+                auto dstRow = dst + y * dstWidth * channels;
+                for (std::size_t x = 0; x < dstWidth; ++x) {
+                    auto x0 = std::min<std::size_t>(2 * x, srcWidth - 1) * channels;
+                    auto x1 = std::min<std::size_t>(2 * x + 1, srcWidth - 1) * channels;
+                    for (std::size_t c = 0; c < channels; ++c) {
+                        dstRow[x * channels + c] = 0.25f * (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]);
+                    }
+                }
+            }
+        }
+
+        /** Averages a 2x2 block of 8 bit pixels, sRGB color channels are converted to linear space first. */
+        void FilterRowsLDR(const std::uint8_t* src, unsigned int srcWidth, unsigned int srcHeight, std::uint8_t* dst, unsigned int dstWidth,
+            unsigned int channels, bool sRGB, std::size_t rowBegin, std::size_t rowEnd)
+        {
+            const auto& toLinear = GetSRGBToLinearTable();
+            const auto& toSRGB = GetLinearToSRGBTable();
+            // only rgb(a) images are stored as sRGB, the fourth channel is alpha.
+            auto numColorChannels = sRGB && channels >= 3 ? 3U : 0U;
+
+            for (auto y = rowBegin; y < rowEnd; ++y) {
+                auto row0 = src + std::min<std::size_t>(2 * y, srcHeight - 1) * srcWidth * channels;
+                auto row1 = src + std::min<std::size_t>(2 * y + 1, srcHeight - 1) * srcWidth * channels;
+                auto dstRow = dst + y * dstWidth * channels;
+                for (std::size_t x = 0; x < dstWidth; ++x) {
+                    auto x0 = std::min<std::size_t>(2 * x, srcWidth - 1) * channels;
+                    auto x1 = std::min<std::size_t>(2 * x + 1, srcWidth - 1) * channels;
+                    for (std::size_t c = 0; c < numColorChannels; ++c) {
+                        auto linear = 0.25f * (toLinear[row0[x0 + c]] + toLinear[row0[x1 + c]] + toLinear[row1[x0 + c]] + toLinear[row1[x1 + c]]);
+                        dstRow[x * channels + c] = toSRGB[static_cast<std::size_t>(linear * static_cast<float>(LINEAR_TO_SRGB_TABLE_SIZE - 1) + 0.5f)];
+                    }
+                    for (std::size_t c = numColorChannels; c < channels; ++c) {
+                        unsigned int sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+                        dstRow[x * channels + c] = static_cast<std::uint8_t>((sum + 2) / 4);
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<MipLevel> GenerateMipLevels(const void* data, unsigned int width, unsigned int height, unsigned int channels,
+        bool isFloat, bool sRGB, ThreadPool* threadPool)
+    {
+        auto& pool = threadPool != nullptr ? *threadPool : ThreadPool::GetDefault();
+        std::size_t bytesPerPixel = channels * (isFloat ? sizeof(float) : sizeof(std::uint8_t));
+
+        std::vector<MipLevel> levels;
+        auto src = reinterpret_cast<const std::uint8_t*>(data);
+        auto srcWidth = width;
+        auto srcHeight = height;
+        while (srcWidth > 1 || srcHeight > 1) {
+            MipLevel level;
+            level.width_ = std::max(srcWidth / 2, 1U);
+            level.height_ = std::max(srcHeight / 2, 1U);
+            level.data_.resize(static_cast<std::size_t>(level.width_) * level.height_ * bytesPerPixel);
+
+            auto dst = level.data_.data();
+            auto filterRows = [&](std::size_t rowBegin, std::size_t rowEnd) {
+                if (isFloat) FilterRowsFloat(reinterpret_cast<const float*>(src), srcWidth, srcHeight, reinterpret_cast<float*>(dst), level.width_, channels, rowBegin, rowEnd);
+                else FilterRowsLDR(src, srcWidth, srcHeight, dst, level.width_, channels, sRGB, rowBegin, rowEnd);
+            };
+            // textures decoded on the pool (e.g. by the texture manager) are already loaded in parallel, so the rows are filtered serially.
+            if (pool.IsWorkerThread()) filterRows(0, level.height_);
+            else pool.ParallelFor(0, level.height_, filterRows, MIN_ROWS_PER_TASK);
+
+            levels.emplace_back(std::move(level));
+            src = levels.back().data_.data();
+            srcWidth = levels.back().width_;
+            srcHeight = levels.back().height_;
+        }
+        return levels;
+    }
+}
@@ -0,0 +1,44 @@
+/**
+ * @file   MipmapGenerator.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.20
+ *
+ * @brief  Declaration of helper functions for generating mip maps on the CPU.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace viscom {
+
+    class ThreadPool;
+
+    /** A single mip level of an image. */
+    struct MipLevel
+    {
+        /** The width of the level. */
+        unsigned int width_ = 0;
+        /** The height of the level. */
+        unsigned int height_ = 0;
+        /** The pixel data of the level (tightly packed rows). */
+        std::vector<std::uint8_t> data_;
+    };
+
+    /**
+     *  Generates all mip levels below the base level of an image with a 2x2 box filter.
+     *  Each level is filtered from the previous one, the rows of a level are distributed over a thread pool.
+     *  8 bit color channels of sRGB images are averaged in linear space, alpha is always averaged directly.
+     *  @param data the pixel data of the base level (8 bit unsigned or 32 bit float channels, tightly packed).
+     *  @param width the width of the base level.
+     *  @param height the height of the base level.
+     *  @param channels the number of channels per pixel (1 to 4).
+     *  @param isFloat whether the channels are floats instead of 8 bit unsigned values.
+     *  @param sRGB whether the color channels are sRGB encoded (ignored for floats).
+     *  @param threadPool the thread pool to use (nullptr uses the default pool), called from one of its workers the rows are filtered serially.
+     *  @return the mip levels starting with level 1.
+     */
+    std::vector<MipLevel> GenerateMipLevels(const void* data, unsigned int width, unsigned int height, unsigned int channels,
+        bool isFloat, bool sRGB, ThreadPool* threadPool = nullptr);
+}
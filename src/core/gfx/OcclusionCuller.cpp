@@ -0,0 +1,175 @@
+/**
+ * @file   OcclusionCuller.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.18
+ *
+ * @brief  Implementation of an occlusion culler using a CPU software depth rasterizer.
+ */
+
+#include "OcclusionCuller.h"
+#include "core/gfx/mesh/Mesh.h"
+#include "core/gfx/mesh/SceneMeshNode.h"
+#include <algorithm>
+#include <chrono>
+
+namespace viscom {
+
+    namespace {
+        /** Vertices with a smaller w are treated as crossing the near plane. */
+        constexpr float MIN_CLIP_W = 1e-5f;
+
+        double ElapsedMilliseconds(std::chrono::steady_clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+
+    OcclusionCuller::OcclusionCuller(unsigned int width, unsigned int height) :
+        width_{ width },
+        height_{ height },
+        depthBuffer_(static_cast<std::size_t>(width) * height, 1.0f)
+    {
+    }
+
+    void OcclusionCuller::BeginFrame(const glm::mat4& viewProjection)
+    {
+        viewProjection_ = viewProjection;
+        std::fill(depthBuffer_.begin(), depthBuffer_.end(), 1.0f);
+        statistics_ = OcclusionStatistics{};
+    }
+
+    void OcclusionCuller::AddOccluder(const Mesh& mesh, const glm::mat4& modelMatrix)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        // nodes are in depth first order, so parents are handled before their children.
+        const auto& nodes = mesh.GetNodes();
+        std::vector<glm::mat4> nodeMVPs(nodes.size());
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            auto parentMVP = viewProjection_ * modelMatrix;
+            if (nodes[i]->GetParent()) parentMVP = nodeMVPs[nodes[i]->GetParent()->GetNodeIndex()];
+            nodeMVPs[i] = parentMVP * nodes[i]->GetLocalTransform();
+        }
+
+        const auto& vertices = mesh.GetVertices();
+        const auto& indices = mesh.GetIndices();
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            for (std::size_t j = 0; j < nodes[i]->GetNumberOfSubMeshes(); ++j) {
+                const auto& subMesh = mesh.GetSubMeshes()[nodes[i]->GetSubMeshID(j)];
+                auto end = subMesh.GetIndexOffset() + subMesh.GetNumberOfIndices() / 3 * 3;
+                for (auto idx = subMesh.GetIndexOffset(); idx < end; idx += 3) {
+                    RasterizeTriangle(nodeMVPs[i] * glm::vec4(vertices[indices[idx]], 1.0f), nodeMVPs[i] * glm::vec4(vertices[indices[idx + 1]], 1.0f),
+                        nodeMVPs[i] * glm::vec4(vertices[indices[idx + 2]], 1.0f));
+                }
+            }
+        }
+
+        statistics_.rasterizationTime_ += ElapsedMilliseconds(start);
+    }
+
+    void OcclusionCuller::AddOccluder(const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& indices, const glm::mat4& modelMatrix)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        auto mvp = viewProjection_ * modelMatrix;
+        for (std::size_t idx = 0; idx + 2 < indices.size(); idx += 3) {
+            RasterizeTriangle(mvp * glm::vec4(vertices[indices[idx]], 1.0f), mvp * glm::vec4(vertices[indices[idx + 1]], 1.0f),
+                mvp * glm::vec4(vertices[indices[idx + 2]], 1.0f));
+        }
+
+        statistics_.rasterizationTime_ += ElapsedMilliseconds(start);
+    }
+
+    void OcclusionCuller::RasterizeTriangle(const glm::vec4& clip0, const glm::vec4& clip1, const glm::vec4& clip2)
+    {
+        if (clip0.w < MIN_CLIP_W || clip1.w < MIN_CLIP_W || clip2.w < MIN_CLIP_W) return;
+
+        auto toScreen = [this](const glm::vec4& clip) {
+            auto ndc = glm::vec3(clip) / clip.w;
+            return glm::vec3{ (ndc.x * 0.5f + 0.5f) * static_cast<float>(width_), (ndc.y * 0.5f + 0.5f) * static_cast<float>(height_), ndc.z * 0.5f + 0.5f };
+        };
+        auto v0 = toScreen(clip0);
+        auto v1 = toScreen(clip1);
+        auto v2 = toScreen(clip2);
+
+        // the farthest depth keeps the occluder conservative without interpolating depth.
+        auto depth = std::max(v0.z, std::max(v1.z, v2.z));
+        if (depth >= 1.0f) return;
+
+        auto area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+        if (area == 0.0f) return;
+        if (area < 0.0f) std::swap(v1, v2);
+
+        auto minX = std::max(0, static_cast<int>(std::floor(std::min(v0.x, std::min(v1.x, v2.x)))));
+        auto maxX = std::min(static_cast<int>(width_) - 1, static_cast<int>(std::ceil(std::max(v0.x, std::max(v1.x, v2.x)))));
+        auto minY = std::max(0, static_cast<int>(std::floor(std::min(v0.y, std::min(v1.y, v2.y)))));
+        auto maxY = std::min(static_cast<int>(height_) - 1, static_cast<int>(std::ceil(std::max(v0.y, std::max(v1.y, v2.y)))));
+        if (minX > maxX || minY > maxY) return;
+        ++statistics_.rasterizedTriangles_;
+
+        // edge functions are evaluated at pixel centers and stepped incrementally.
+        // a pixel is only written if it is covered completely (inner coverage), so the edge functions at the center need
+        // to be at least their minimum over the pixel, which is half a step in x and y away.
+        auto edge = [](const glm::vec3& a, const glm::vec3& b, float x, float y) { return (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x); };
+        auto startX = static_cast<float>(minX) + 0.5f;
+        auto startY = static_cast<float>(minY) + 0.5f;
+        glm::vec3 rowEdges{ edge(v1, v2, startX, startY), edge(v2, v0, startX, startY), edge(v0, v1, startX, startY) };
+        glm::vec3 stepX{ v1.y - v2.y, v2.y - v0.y, v0.y - v1.y };
+        glm::vec3 stepY{ v2.x - v1.x, v0.x - v2.x, v1.x - v0.x };
+        auto innerOffset = 0.5f * (glm::abs(stepX) + glm::abs(stepY));
+
+        for (auto y = minY; y <= maxY; ++y) {
+            auto edges = rowEdges;
+            auto row = depthBuffer_.data() + static_cast<std::size_t>(y) * width_;
+            for (auto x = minX; x <= maxX; ++x) {
+                if (edges.x >= innerOffset.x && edges.y >= innerOffset.y && edges.z >= innerOffset.z) row[x] = std::min(row[x], depth);
+                edges += stepX;
+            }
+            rowEdges += stepY;
+        }
+    }
+
+    bool OcclusionCuller::IsVisible(const math::AABB3<float>& box, const glm::mat4& modelMatrix) const
+    {
+        auto start = std::chrono::steady_clock::now();
+        ++statistics_.testedBoxes_;
+
+        auto mvp = viewProjection_ * modelMatrix;
+        glm::vec2 screenMin{ std::numeric_limits<float>::max() };
+        glm::vec2 screenMax{ std::numeric_limits<float>::lowest() };
+        auto nearestDepth = std::numeric_limits<float>::max();
+        for (unsigned int i = 0; i < 8; ++i) {
+            glm::vec4 corner{ box.minmax_[i & 1].x, box.minmax_[(i >> 1) & 1].y, box.minmax_[(i >> 2) & 1].z, 1.0f };
+            auto clip = mvp * corner;
+            if (clip.w < MIN_CLIP_W) {
+                statistics_.testTime_ += ElapsedMilliseconds(start);
+                return true;
+            }
+            auto ndc = glm::vec3(clip) / clip.w;
+            screenMin = glm::min(screenMin, glm::vec2(ndc));
+            screenMax = glm::max(screenMax, glm::vec2(ndc));
+            nearestDepth = std::min(nearestDepth, ndc.z * 0.5f + 0.5f);
+        }
+
+        auto minX = std::max(0, static_cast<int>(std::floor((screenMin.x * 0.5f + 0.5f) * static_cast<float>(width_))));
+        auto maxX = std::min(static_cast<int>(width_) - 1, static_cast<int>(std::floor((screenMax.x * 0.5f + 0.5f) * static_cast<float>(width_))));
+        auto minY = std::max(0, static_cast<int>(std::floor((screenMin.y * 0.5f + 0.5f) * static_cast<float>(height_))));
+        auto maxY = std::min(static_cast<int>(height_) - 1, static_cast<int>(std::floor((screenMax.y * 0.5f + 0.5f) * static_cast<float>(height_))));
+
+        // boxes outside the screen are left to frustum culling.
+        auto visible = minX > maxX || minY > maxY;
+        for (auto y = minY; y <= maxY && !visible; ++y) {
+            auto row = depthBuffer_.data() + static_cast<std::size_t>(y) * width_;
+            for (auto x = minX; x <= maxX; ++x) {
+                if (row[x] > nearestDepth) {
+                    visible = true;
+                    break;
+                }
+            }
+        }
+
+        if (!visible) ++statistics_.occludedBoxes_;
+        statistics_.testTime_ += ElapsedMilliseconds(start);
+        return visible;
+    }
+}
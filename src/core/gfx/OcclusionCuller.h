@@ -0,0 +1,110 @@
+/**
+ * @file   OcclusionCuller.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.18
+ *
+ * @brief  Declaration of an occlusion culler using a CPU software depth rasterizer.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "core/math/aabb.h"
+
+namespace viscom {
+
+    class Mesh;
+
+    /** Counters and timings of the occlusion culler for a frame. */
+    struct OcclusionStatistics
+    {
+        /** The number of occluder triangles rasterized. */
+        std::size_t rasterizedTriangles_ = 0;
+        /** The number of boxes tested. */
+        std::size_t testedBoxes_ = 0;
+        /** The number of boxes found to be occluded. */
+        std::size_t occludedBoxes_ = 0;
+        /** The time spent rasterizing occluders in milliseconds. */
+        double rasterizationTime_ = 0.0;
+        /** The time spent testing boxes in milliseconds. */
+        double testTime_ = 0.0;
+    };
+
+    /**
+     *  Rasterizes occluder triangles into a low resolution depth buffer on the CPU and tests bounding boxes against it.
+     *  Each occluder triangle writes its farthest depth only to pixels it covers completely and each box is tested
+     *  with its nearest depth over all pixels it touches, so boxes are only reported as occluded if they are hidden
+     *  for sure. Occluders thinner than a pixel do not occlude anything. Triangles and boxes crossing the near plane
+     *  are not rasterized or culled. Does not need OpenGL.
+     */
+    class OcclusionCuller final
+    {
+    public:
+        /**
+         *  Constructor, creates the depth buffer.
+         *  @param width the width of the depth buffer.
+         *  @param height the height of the depth buffer.
+         */
+        explicit OcclusionCuller(unsigned int width = 256, unsigned int height = 128);
+
+        /**
+         *  Clears the depth buffer and statistics for a new frame.
+         *  @param viewProjection the view projection matrix (e.g. CameraHelper::GetViewPerspectiveMatrix).
+         */
+        void BeginFrame(const glm::mat4& viewProjection);
+        /**
+         *  Rasterizes all triangles of a mesh as occluders.
+         *  @param mesh the occluder mesh.
+         *  @param modelMatrix the model matrix of the mesh.
+         */
+        void AddOccluder(const Mesh& mesh, const glm::mat4& modelMatrix);
+        /**
+         *  Rasterizes indexed triangles as occluders (e.g. simplified occluder geometry).
+         *  @param vertices the vertices.
+         *  @param indices the indices, three per triangle.
+         *  @param modelMatrix the model matrix of the vertices.
+         */
+        void AddOccluder(const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& indices, const glm::mat4& modelMatrix);
+
+        /**
+         *  Tests if a box may be visible.
+         *  @param box the box in world space.
+         */
+        bool IsVisible(const math::AABB3<float>& box) const { return IsVisible(box, glm::mat4{ 1.0f }); }
+        /**
+         *  Tests if a box may be visible.
+         *  @param box the box in model space.
+         *  @param modelMatrix the model matrix of the box.
+         */
+        bool IsVisible(const math::AABB3<float>& box, const glm::mat4& modelMatrix) const;
+
+        /** Returns the statistics of the current frame. */
+        const OcclusionStatistics& GetStatistics() const noexcept { return statistics_; }
+        /** Returns the depth buffer (row major, depth in [0, 1]). */
+        const std::vector<float>& GetDepthBuffer() const noexcept { return depthBuffer_; }
+        /** Returns the width of the depth buffer. */
+        unsigned int GetWidth() const noexcept { return width_; }
+        /** Returns the height of the depth buffer. */
+        unsigned int GetHeight() const noexcept { return height_; }
+
+    private:
+        /**
+         *  Rasterizes a single triangle with a constant depth.
+         *  @param clip0 the first vertex in clip space.
+         *  @param clip1 the second vertex in clip space.
+         *  @param clip2 the third vertex in clip space.
+         */
+        void RasterizeTriangle(const glm::vec4& clip0, const glm::vec4& clip1, const glm::vec4& clip2);
+
+        /** Holds the width of the depth buffer. */
+        unsigned int width_;
+        /** Holds the height of the depth buffer. */
+        unsigned int height_;
+        /** Holds the depth buffer. */
+        std::vector<float> depthBuffer_;
+        /** Holds the view projection matrix. */
+        glm::mat4 viewProjection_ = glm::mat4{ 1.0f };
+        /** Holds the statistics of the current frame. */
+        mutable OcclusionStatistics statistics_;
+    };
+}
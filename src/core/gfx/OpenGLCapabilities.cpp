@@ -0,0 +1,35 @@
+/**
+ * @file   OpenGLCapabilities.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.05
+ *
+ * @brief  Implementation of helper functions for querying the capabilities of the OpenGL context.
+ */
+
+#include "OpenGLCapabilities.h"
+#include "core/open_gl.h"
+#include <utility>
+
+namespace viscom {
+
+    bool IsOpenGLVersionSupported(int major, int minor)
+    {
+        static const auto contextVersion = []() {
+            GLint contextMajor = 0, contextMinor = 0;
+            glGetIntegerv(GL_MAJOR_VERSION, &contextMajor);
+            glGetIntegerv(GL_MINOR_VERSION, &contextMinor);
+            return std::make_pair(contextMajor, contextMinor);
+        }();
+        return contextVersion >= std::make_pair(major, minor);
+    }
+
+    float GetMaxTextureAnisotropy()
+    {
+        static const auto maxAnisotropy = []() {
+            GLfloat result = 1.0f;
+            if (GLEW_EXT_texture_filter_anisotropic) glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &result);
+            return result;
+        }();
+        return maxAnisotropy;
+    }
+}
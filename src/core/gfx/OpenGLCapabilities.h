@@ -0,0 +1,26 @@
+/**
+ * @file   OpenGLCapabilities.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.05
+ *
+ * @brief  Declaration of helper functions for querying the capabilities of the OpenGL context.
+ */
+
+#pragma once
+
+namespace viscom {
+
+    /**
+     *  Checks if the current OpenGL context supports at least a given version.
+     *  Needs a current context, the version is queried once and cached afterwards.
+     *  @param major the major version needed.
+     *  @param minor the minor version needed.
+     */
+    bool IsOpenGLVersionSupported(int major, int minor);
+
+    /**
+     *  Returns the maximum anisotropy supported for texture filtering (1 if anisotropic filtering is not supported).
+     *  Needs a current context, the value is queried once and cached afterwards.
+     */
+    float GetMaxTextureAnisotropy();
+}
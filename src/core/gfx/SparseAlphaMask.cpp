@@ -0,0 +1,120 @@
+/**
+ * @file   SparseAlphaMask.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.27
+ *
+ * @brief  Implementation of blend masks storing only the tiles that are not constant.
+ */
+
+#include "SparseAlphaMask.h"
+#include "core/open_gl.h"
+#include <algorithm>
+#include <cmath>
+
+namespace viscom {
+
+    SparseAlphaMask::SparseAlphaMask(const float* data, const glm::uvec2& size, unsigned int channels, bool use8Bit, unsigned int tileSize) :
+        size_{ size },
+        tileSize_{ tileSize }
+    {
+        // a 4x4 Bayer matrix, the dither pattern follows the mask texels so borders match their neighbouring tiles.
+        constexpr float bayer[16] = { 0.0f, 8.0f, 2.0f, 10.0f, 12.0f, 4.0f, 14.0f, 6.0f, 3.0f, 11.0f, 1.0f, 9.0f, 15.0f, 7.0f, 13.0f, 5.0f };
+        auto texel = [data, &size, channels](int x, int y, unsigned int c) {
+            auto cx = static_cast<std::size_t>(std::clamp(x, 0, static_cast<int>(size.x) - 1));
+            auto cy = static_cast<std::size_t>(std::clamp(y, 0, static_cast<int>(size.y) - 1));
+            return data[(cy * size.x + cx) * channels + c];
+        };
+
+        glm::uvec2 numTiles{ (size.x + tileSize - 1) / tileSize, (size.y + tileSize - 1) / tileSize };
+        std::vector<glm::vec4> table(static_cast<std::size_t>(numTiles.x) * numTiles.y);
+        std::vector<glm::uvec2> detailTiles;
+        for (unsigned int ty = 0; ty < numTiles.y; ++ty) {
+            for (unsigned int tx = 0; tx < numTiles.x; ++tx) {
+                auto x0 = static_cast<int>(tx * tileSize), y0 = static_cast<int>(ty * tileSize);
+                auto x1 = std::min(x0 + static_cast<int>(tileSize), static_cast<int>(size.x)), y1 = std::min(y0 + static_cast<int>(tileSize), static_cast<int>(size.y));
+
+                glm::vec4 value{ 0.0f, 0.0f, 0.0f, -1.0f };
+                for (unsigned int c = 0; c < 3; ++c) value[static_cast<int>(c)] = texel(x0, y0, std::min(c, channels - 1));
+                auto isConstant = true;
+                for (auto y = y0 - 1; isConstant && y <= y1; ++y) {
+                    for (auto x = x0 - 1; isConstant && x <= x1; ++x) {
+                        for (unsigned int c = 0; isConstant && c < channels; ++c) isConstant = texel(x, y, c) == value[static_cast<int>(c)];
+                    }
+                }
+
+                if (isConstant) statistics_.constantTiles_ += 1;
+                else {
+                    value = glm::vec4{ 0.0f, 0.0f, 0.0f, 1.0f };
+                    detailTiles.emplace_back(tx, ty);
+                }
+                table[static_cast<std::size_t>(ty) * numTiles.x + tx] = value;
+            }
+        }
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        auto atlasTileSize = tileSize + 2;
+        auto bytesPerChannel = use8Bit ? 1U : 2U;
+        if (!detailTiles.empty()) {
+            glm::uvec2 atlasTiles{ static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<float>(detailTiles.size())))), 0 };
+            atlasTiles.y = static_cast<unsigned int>((detailTiles.size() + atlasTiles.x - 1) / atlasTiles.x);
+            auto atlasSize = atlasTiles * atlasTileSize;
+            auto maxValue = use8Bit ? 255.0f : 65535.0f;
+
+            std::vector<std::uint8_t> atlas(static_cast<std::size_t>(atlasSize.x) * atlasSize.y * channels * bytesPerChannel, 0);
+            for (std::size_t i = 0; i < detailTiles.size(); ++i) {
+                glm::uvec2 atlasTile{ static_cast<unsigned int>(i) % atlasTiles.x, static_cast<unsigned int>(i) / atlasTiles.x };
+                auto& entry = table[static_cast<std::size_t>(detailTiles[i].y) * numTiles.x + detailTiles[i].x];
+                entry.x = static_cast<float>(atlasTile.x);
+                entry.y = static_cast<float>(atlasTile.y);
+
+                for (unsigned int y = 0; y < atlasTileSize; ++y) {
+                    auto my = static_cast<int>(detailTiles[i].y * tileSize + y) - 1;
+                    for (unsigned int x = 0; x < atlasTileSize; ++x) {
+                        auto mx = static_cast<int>(detailTiles[i].x * tileSize + x) - 1;
+                        auto dither = use8Bit ? (bayer[((my & 3) << 2) | (mx & 3)] + 0.5f) / 16.0f : 0.5f;
+                        auto atlasIndex = (static_cast<std::size_t>(atlasTile.y * atlasTileSize + y) * atlasSize.x + atlasTile.x * atlasTileSize + x) * channels;
+                        for (unsigned int c = 0; c < channels; ++c) {
+                            auto quantized = std::clamp(std::floor(std::clamp(texel(mx, my, c), 0.0f, 1.0f) * maxValue + dither), 0.0f, maxValue);
+                            if (use8Bit) atlas[atlasIndex + c] = static_cast<std::uint8_t>(quantized);
+                            else reinterpret_cast<std::uint16_t*>(atlas.data())[atlasIndex + c] = static_cast<std::uint16_t>(quantized);
+                        }
+                    }
+                }
+            }
+
+            GLint internalFormat = channels == 1 ? (use8Bit ? GL_R8 : GL_R16) : (use8Bit ? GL_RGB8 : GL_RGB16);
+            glGenTextures(1, &tileAtlas_);
+            glBindTexture(GL_TEXTURE_2D, tileAtlas_);
+            glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, static_cast<GLsizei>(atlasSize.x), static_cast<GLsizei>(atlasSize.y), 0,
+                channels == 1 ? GL_RED : GL_RGB, use8Bit ? GL_UNSIGNED_BYTE : GL_UNSIGNED_SHORT, atlas.data());
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            statistics_.textureBytes_ += atlas.size();
+        }
+
+        glGenTextures(1, &tileTable_);
+        glBindTexture(GL_TEXTURE_2D, tileTable_);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, static_cast<GLsizei>(numTiles.x), static_cast<GLsizei>(numTiles.y), 0, GL_RGBA, GL_FLOAT, table.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        statistics_.tiles_ = table.size();
+        statistics_.textureBytes_ += table.size() * sizeof(glm::vec4);
+        statistics_.fullTextureBytes_ = static_cast<std::size_t>(size.x) * size.y * channels * sizeof(float);
+    }
+
+    SparseAlphaMask::~SparseAlphaMask()
+    {
+        if (tileTable_ != 0) glDeleteTextures(1, &tileTable_);
+        tileTable_ = 0;
+        if (tileAtlas_ != 0) glDeleteTextures(1, &tileAtlas_);
+        tileAtlas_ = 0;
+    }
+}
@@ -0,0 +1,76 @@
+/**
+ * @file   SparseAlphaMask.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.27
+ *
+ * @brief  Declaration of blend masks storing only the tiles that are not constant.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "core/open_gl_fwd.h"
+
+namespace viscom {
+
+    /** Counters of a sparse alpha mask. */
+    struct SparseAlphaMaskStatistics
+    {
+        /** The number of tiles of the mask. */
+        std::size_t tiles_ = 0;
+        /** The number of constant tiles that are stored in the tile table only. */
+        std::size_t constantTiles_ = 0;
+        /** The number of bytes of the tile table and the tile atlas. */
+        std::size_t textureBytes_ = 0;
+        /** The number of bytes a full resolution 32 bit float texture would use. */
+        std::size_t fullTextureBytes_ = 0;
+    };
+
+    /**
+     *  A blend mask (e.g., the alpha mask of a projector) that is mostly constant. The mask is split into tiles on the CPU,
+     *  a tile table holds the value of each constant tile or the position of the tile in an atlas holding all other
+     *  tiles at 16 bit (or dithered 8 bit) precision. Atlas tiles have a border of one texel for bilinear filtering,
+     *  tiles are constant only if their border is, too. Shaders sample the mask with SampleAlphaMask in
+     *  calibrationRendering.frag.
+     */
+    class SparseAlphaMask final
+    {
+    public:
+        /**
+         *  Constructor, analyses the mask and uploads the tile table and atlas.
+         *  @param data the mask values (rows from bottom to top, channels interleaved).
+         *  @param size the size of the mask.
+         *  @param channels the number of channels of the mask (1 or 3).
+         *  @param use8Bit stores the tiles with 8 bit precision and ordered dithering instead of 16 bit.
+         *  @param tileSize the size of a tile in texels.
+         */
+        SparseAlphaMask(const float* data, const glm::uvec2& size, unsigned int channels, bool use8Bit = false, unsigned int tileSize = 32);
+        SparseAlphaMask(const SparseAlphaMask&) = delete;
+        SparseAlphaMask& operator=(const SparseAlphaMask&) = delete;
+        /** Destructor, deletes the textures. */
+        ~SparseAlphaMask();
+
+        /** Returns the tile table texture (RGBA32F, the value of constant tiles with alpha -1 or the atlas tile position with alpha 1). */
+        GLuint GetTileTable() const noexcept { return tileTable_; }
+        /** Returns the tile atlas texture (0 if all tiles are constant). */
+        GLuint GetTileAtlas() const noexcept { return tileAtlas_; }
+        /** Returns the size of a tile in texels. */
+        unsigned int GetTileSize() const noexcept { return tileSize_; }
+        /** Returns the size of the mask. */
+        const glm::uvec2& GetSize() const noexcept { return size_; }
+        /** Returns the statistics. */
+        const SparseAlphaMaskStatistics& GetStatistics() const noexcept { return statistics_; }
+
+    private:
+        /** Holds the size of the mask. */
+        glm::uvec2 size_;
+        /** Holds the size of a tile in texels. */
+        unsigned int tileSize_;
+        /** Holds the tile table texture. */
+        GLuint tileTable_ = 0;
+        /** Holds the tile atlas texture. */
+        GLuint tileAtlas_ = 0;
+        /** Holds the statistics. */
+        SparseAlphaMaskStatistics statistics_;
+    };
+}
@@ -0,0 +1,148 @@
+/**
+ * @file   StreamingBuffer.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.05
+ *
+ * @brief  Implementation of a ring buffer for streaming per frame data to the GPU.
+ */
+
+#include "StreamingBuffer.h"
+#include "OpenGLCapabilities.h"
+#include "core/open_gl.h"
+
+namespace viscom {
+
+    StreamingBuffer::StreamingBuffer(GLenum target, std::size_t frameSize, std::size_t numFrames) :
+        target_{ target },
+        frameSize_{ frameSize },
+        numFrames_{ numFrames },
+        fences_(numFrames, nullptr)
+    {
+        glGenBuffers(1, &buffer_);
+        glBindBuffer(target_, buffer_);
+        if (IsOpenGLVersionSupported(4, 4)) {
+            constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(target_, static_cast<GLsizeiptr>(GetSize()), nullptr, flags);
+            persistentData_ = static_cast<std::uint8_t*>(glMapBufferRange(target_, 0, static_cast<GLsizeiptr>(GetSize()), flags));
+        }
+        else {
+            glBufferData(target_, static_cast<GLsizeiptr>(GetSize()), nullptr, GL_STREAM_DRAW);
+            stagingData_.resize(frameSize_);
+        }
+        glBindBuffer(target_, 0);
+    }
+
+    StreamingBuffer::StreamingBuffer(StreamingBuffer&& rhs) noexcept :
+        buffer_{ rhs.buffer_ },
+        target_{ rhs.target_ },
+        frameSize_{ rhs.frameSize_ },
+        numFrames_{ rhs.numFrames_ },
+        currentFrame_{ rhs.currentFrame_ },
+        frameOffset_{ rhs.frameOffset_ },
+        persistentData_{ rhs.persistentData_ },
+        frameData_{ rhs.frameData_ },
+        stagingData_{ std::move(rhs.stagingData_) },
+        flushedOffset_{ rhs.flushedOffset_ },
+        hasFrameStarted_{ rhs.hasFrameStarted_ },
+        fences_{ std::move(rhs.fences_) }
+    {
+        rhs.buffer_ = 0;
+        rhs.persistentData_ = nullptr;
+        rhs.frameData_ = nullptr;
+    }
+
+    StreamingBuffer& StreamingBuffer::operator=(StreamingBuffer&& rhs) noexcept
+    {
+        if (this != &rhs) {
+            this->~StreamingBuffer();
+            buffer_ = rhs.buffer_;
+            target_ = rhs.target_;
+            frameSize_ = rhs.frameSize_;
+            numFrames_ = rhs.numFrames_;
+            currentFrame_ = rhs.currentFrame_;
+            frameOffset_ = rhs.frameOffset_;
+            persistentData_ = rhs.persistentData_;
+            frameData_ = rhs.frameData_;
+            stagingData_ = std::move(rhs.stagingData_);
+            flushedOffset_ = rhs.flushedOffset_;
+            hasFrameStarted_ = rhs.hasFrameStarted_;
+            fences_ = std::move(rhs.fences_);
+            rhs.buffer_ = 0;
+            rhs.persistentData_ = nullptr;
+            rhs.frameData_ = nullptr;
+        }
+        return *this;
+    }
+
+    StreamingBuffer::~StreamingBuffer()
+    {
+        for (auto& fence : fences_) {
+            if (fence != nullptr) glDeleteSync(fence);
+            fence = nullptr;
+        }
+        if (buffer_ != 0) {
+            if (persistentData_ != nullptr) {
+                glBindBuffer(target_, buffer_);
+                glUnmapBuffer(target_);
+                glBindBuffer(target_, 0);
+            }
+            glDeleteBuffers(1, &buffer_);
+        }
+        buffer_ = 0;
+        persistentData_ = nullptr;
+        frameData_ = nullptr;
+    }
+
+    void StreamingBuffer::BeginFrame()
+    {
+        // all draw calls of the last frame are issued now, so the fence protects everything reading its region.
+        if (hasFrameStarted_) fences_[currentFrame_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        hasFrameStarted_ = true;
+        currentFrame_ = (currentFrame_ + 1) % numFrames_;
+        frameOffset_ = 0;
+        flushedOffset_ = 0;
+
+        auto& fence = fences_[currentFrame_];
+        if (fence != nullptr) {
+            // wait until the GPU is done with the frame that used this region last.
+            auto waitResult = glClientWaitSync(fence, 0, 0);
+            while (waitResult == GL_TIMEOUT_EXPIRED) waitResult = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+
+        frameData_ = persistentData_ != nullptr ? persistentData_ + currentFrame_ * frameSize_ : stagingData_.data();
+    }
+
+    StreamingBuffer::Allocation StreamingBuffer::Allocate(std::size_t size, std::size_t alignment)
+    {
+        Allocation result;
+        auto regionStart = currentFrame_ * frameSize_;
+        auto alignedOffset = ((regionStart + frameOffset_ + alignment - 1) / alignment) * alignment - regionStart;
+        if (frameData_ == nullptr || alignedOffset + size > frameSize_) return result;
+
+        result.data_ = frameData_ + alignedOffset;
+        result.offset_ = regionStart + alignedOffset;
+        result.size_ = size;
+        frameOffset_ = alignedOffset + size;
+        return result;
+    }
+
+    void StreamingBuffer::Flush()
+    {
+        // persistently mapped memory is coherent, so only the CPU copy needs to be uploaded.
+        if (persistentData_ != nullptr || frameData_ == nullptr || frameOffset_ <= flushedOffset_) return;
+
+        glBindBuffer(target_, buffer_);
+        glBufferSubData(target_, static_cast<GLintptr>(currentFrame_ * frameSize_ + flushedOffset_), static_cast<GLsizeiptr>(frameOffset_ - flushedOffset_),
+            stagingData_.data() + flushedOffset_);
+        glBindBuffer(target_, 0);
+        flushedOffset_ = frameOffset_;
+    }
+
+    void StreamingBuffer::EndFrame()
+    {
+        Flush();
+        frameData_ = nullptr;
+    }
+}
@@ -0,0 +1,103 @@
+/**
+ * @file   StreamingBuffer.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.05
+ *
+ * @brief  Declaration of a ring buffer for streaming per frame data to the GPU.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "core/open_gl_fwd.h"
+
+namespace viscom {
+
+    /**
+     *  A GPU buffer split into one region per frame in flight that is written by the CPU each frame.
+     *  If the context supports OpenGL 4.4 the buffer is mapped persistently once, otherwise the data of a frame is
+     *  written to CPU memory and uploaded with glBufferSubData on Flush or EndFrame, so the buffer is never mapped
+     *  while draw calls read from it. Fences make sure a region is not overwritten while the GPU still reads from it.
+     */
+    class StreamingBuffer final
+    {
+    public:
+        /** Describes an allocation in the streaming buffer. */
+        struct Allocation
+        {
+            /** Pointer to the mapped memory to write to. */
+            void* data_ = nullptr;
+            /** The offset in bytes from the start of the buffer. */
+            std::size_t offset_ = 0;
+            /** The size of the allocation in bytes. */
+            std::size_t size_ = 0;
+        };
+
+        /**
+         *  Constructor, creates the buffer.
+         *  @param target the default buffer target the buffer is bound to.
+         *  @param frameSize the size in bytes available per frame.
+         *  @param numFrames the number of frames in flight.
+         */
+        StreamingBuffer(GLenum target, std::size_t frameSize, std::size_t numFrames = 3);
+        StreamingBuffer(const StreamingBuffer&) = delete;
+        StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+        StreamingBuffer(StreamingBuffer&&) noexcept;
+        StreamingBuffer& operator=(StreamingBuffer&&) noexcept;
+        ~StreamingBuffer();
+
+        /**
+         *  Starts writing to the next region, waits for the GPU if it still uses the region.
+         *  All draw calls using the data of the last frame need to be issued before.
+         */
+        void BeginFrame();
+        /**
+         *  Allocates memory in the current region.
+         *  @param size the size of the allocation in bytes.
+         *  @param alignment the alignment of the allocations offset (relative to the buffer start).
+         *  @return the allocation, its data_ is nullptr if the region is full.
+         */
+        Allocation Allocate(std::size_t size, std::size_t alignment = 16);
+        /** Uploads the data written since the last flush, draw calls can use all allocations made before afterwards. */
+        void Flush();
+        /** Finishes writing to the current region, all allocations of this frame can be used by draw calls afterwards. */
+        void EndFrame();
+
+        /** Returns the OpenGL buffer id. */
+        GLuint GetBuffer() const noexcept { return buffer_; }
+        /** Returns the size of the whole buffer in bytes. */
+        std::size_t GetSize() const noexcept { return frameSize_ * numFrames_; }
+        /** Returns the size of a single region in bytes. */
+        std::size_t GetFrameSize() const noexcept { return frameSize_; }
+        /** Returns the number of bytes used in the current region. */
+        std::size_t GetUsedSize() const noexcept { return frameOffset_; }
+        /** Checks if the buffer is mapped persistently. */
+        bool IsPersistent() const noexcept { return persistentData_ != nullptr; }
+
+    private:
+        /** Holds the OpenGL buffer. */
+        GLuint buffer_ = 0;
+        /** Holds the buffer target. */
+        GLenum target_;
+        /** Holds the size of a single region. */
+        std::size_t frameSize_;
+        /** Holds the number of regions. */
+        std::size_t numFrames_;
+        /** Holds the current region. */
+        std::size_t currentFrame_ = 0;
+        /** Holds the current offset inside the current region. */
+        std::size_t frameOffset_ = 0;
+        /** Holds the persistently mapped memory (or nullptr). */
+        std::uint8_t* persistentData_ = nullptr;
+        /** Holds the memory of the current region. */
+        std::uint8_t* frameData_ = nullptr;
+        /** Holds the CPU copy of the current region if the buffer is not mapped persistently. */
+        std::vector<std::uint8_t> stagingData_;
+        /** Holds the offset inside the current region up to which the data was uploaded. */
+        std::size_t flushedOffset_ = 0;
+        /** Flag whether a frame was started before. */
+        bool hasFrameStarted_ = false;
+        /** Holds a fence for each region. */
+        std::vector<GLsync> fences_;
+    };
+}
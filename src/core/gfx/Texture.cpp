@@ -24,9 +24,55 @@
 
 #include "core/resources/ResourceManager.h"
 #include "core/open_gl.h"
+#include "FloatConversion.h"
+#include "MipmapGenerator.h"
+#include "OpenGLCapabilities.h"
+#include "TextureCompression.h"
+#include <filesystem>
+#include <fstream>
 
 namespace viscom {
 
+    namespace {
+        /** The number of bytes of the decoded base level kept to compare textures with the same content hash. */
+        constexpr std::size_t CONTENT_PREFIX_SIZE = 1024;
+
+        /** Reads a whole image file into memory. */
+        std::vector<std::uint8_t> ReadImageFile(const std::string& filename)
+        {
+            std::ifstream ifs{ filename, std::ios::binary | std::ios::ate };
+            if (!ifs.is_open()) {
+                spdlog::warn("Failed to load texture ({}).", filename);
+                throw resource_loading_error(filename, "Failed to open texture file.");
+            }
+
+            std::vector<std::uint8_t> fileData(static_cast<std::size_t>(ifs.tellg()));
+            ifs.seekg(0);
+            ifs.read(reinterpret_cast<char*>(fileData.data()), static_cast<std::streamsize>(fileData.size()));
+            return fileData;
+        }
+    }
+
+    struct Texture::DecodedImage
+    {
+        DecodedImage() = default;
+        DecodedImage(const DecodedImage&) = delete;
+        DecodedImage& operator=(const DecodedImage&) = delete;
+        ~DecodedImage() { if (pixels_ != nullptr) stbi_image_free(pixels_); }
+
+        /** Returns the data of the base level. */
+        const void* GetBaseData() const noexcept { return pixels_ != nullptr ? pixels_ : compressedBase_.data(); }
+
+        /** Holds the pixels decoded by stb_image (nullptr for compressed images). */
+        void* pixels_ = nullptr;
+        /** Holds the base level of a compressed image. */
+        std::vector<std::uint8_t> compressedBase_;
+        /** Holds the size of the base level in bytes. */
+        std::size_t size_ = 0;
+        /** Holds the mip levels filtered on the CPU or read from a compressed file. */
+        std::vector<MipLevel> mipLevels_;
+    };
+
     /**
      *  Constructor, creates a texture from file.
      *  @param texFilename the filename of the texture file.
@@ -41,14 +87,7 @@ namespace viscom {
         height_{ 0 },
         sRGB_{ true }
     {
-        // Bind Texture and Set Filtering Levels
-        glGenTextures(1, &textureId_);
-        glBindTexture(GL_TEXTURE_2D, textureId_);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        textureId_ = CreateTextureObject();
     }
 
     /** Destructor. */
@@ -61,31 +100,76 @@ namespace viscom {
         }
     }
 
-    void Texture::Initialize(bool useSRGB, bool flipTexture)
+    void Texture::Initialize(bool useSRGB, bool flipTexture, const TextureOptions& options)
     {
         sRGB_ = useSRGB;
         flipTexture_ = flipTexture;
+        options_ = options;
         InitializeFinished();
     }
 
-    void Texture::Load(std::optional<std::vector<std::uint8_t>>& data)
+    void Texture::DecodeImage()
     {
         auto fullFilename = FindResourceLocation(GetId());
 
-        if (flipTexture_) stbi_set_flip_vertically_on_load(1);
-        else stbi_set_flip_vertically_on_load(0);
+        auto decodedImage = std::make_unique<DecodedImage>();
+        auto compressedImage = LoadCompressedImage(fullFilename);
+        if (compressedImage.has_value()) {
+            decodedImage->compressedBase_ = std::move(compressedImage->levels_[0].data_);
+            decodedImage->size_ = decodedImage->compressedBase_.size();
+            decodedImage->mipLevels_.assign(std::make_move_iterator(compressedImage->levels_.begin() + 1), std::make_move_iterator(compressedImage->levels_.end()));
+        }
+        else {
+            // the file is read once, all stb_image calls decode from memory.
+            auto fileData = ReadImageFile(fullFilename);
+            std::pair<void*, std::size_t> image;
+            if (stbi_is_hdr_from_memory(fileData.data(), static_cast<int>(fileData.size())) != 0) image = LoadImageHDR(fullFilename, fileData);
+            else image = LoadImageLDR(fullFilename, fileData, sRGB_);
+            std::tie(decodedImage->pixels_, decodedImage->size_) = image;
+            // stb_image keeps its flip flag globally, so images are flipped here to allow decoding on other threads.
+            if (flipTexture_) utils::flipImageVertically(image.first, image.second / height_, height_);
+
+            if (options_.mipmaps_ == TextureMipmaps::CPU) {
+                auto isFloat = descriptor_.type_ == GL_FLOAT;
+                auto channels = descriptor_.bytesPP_ / static_cast<unsigned int>(isFloat ? sizeof(float) : sizeof(std::uint8_t));
+                decodedImage->mipLevels_ = GenerateMipLevels(image.first, width_, height_, channels, isFloat, sRGB_);
+            }
+            // mip levels are filtered before, as the filter needs 32 bit floats.
+            if (descriptor_.type_ == GL_FLOAT && options_.hdrFormat_ != TextureHDRFormat::Float) ConvertImageHDR(fullFilename, *decodedImage);
+        }
+
+        // the format and options are part of the hash, as identical pixels with different sampling cannot share a texture.
+        std::uint64_t formatKey[] = { static_cast<std::uint64_t>(descriptor_.internalFormat_), descriptor_.format_, descriptor_.type_, width_, height_,
+            static_cast<std::uint64_t>(options_.mipmaps_), static_cast<std::uint64_t>(options_.maxAnisotropy_ * 256.0f) };
+        contentHash_ = utils::hashData(decodedImage->GetBaseData(), decodedImage->size_, utils::hashData(formatKey, sizeof(formatKey)));
+        contentSize_ = decodedImage->size_;
+        auto baseData = reinterpret_cast<const std::uint8_t*>(decodedImage->GetBaseData());
+        contentPrefix_.assign(baseData, baseData + std::min(decodedImage->size_, CONTENT_PREFIX_SIZE));
+        for (const auto& level : decodedImage->mipLevels_) {
+            contentHash_ = utils::hashData(level.data_.data(), level.data_.size(), contentHash_);
+            contentSize_ += level.data_.size();
+        }
+        decodedImage_ = std::move(decodedImage);
+    }
 
-        std::pair<void*, std::size_t> image = std::make_pair(nullptr, 0);
-        if (stbi_is_hdr(fullFilename.c_str()) != 0) image = LoadImageHDR(fullFilename);
-        else image = LoadImageLDR(fullFilename, sRGB_);
+    void Texture::Load(std::optional<std::vector<std::uint8_t>>& data)
+    {
+        if (!decodedImage_) DecodeImage();
+        auto decodedImage = std::move(decodedImage_);
+        auto image = std::make_pair(decodedImage->GetBaseData(), decodedImage->size_);
+        const auto& mipLevels = decodedImage->mipLevels_;
 
+        // a copy dropping levels (see CreateUnloadedCopy) skips them, levels generated on the GPU cannot be skipped.
+        droppedMipLevels_ = std::min(droppedMipLevels_, static_cast<unsigned int>(mipLevels.size()));
         glBindTexture(GL_TEXTURE_2D, textureId_);
-        glTexImage2D(GL_TEXTURE_2D, 0, descriptor_.internalFormat_, static_cast<GLsizei>(width_),
-                     static_cast<GLsizei>(height_), 0, descriptor_.format_, descriptor_.type_, image.first);
+        numMipLevels_ = UploadLevels(image.first, image.second, mipLevels, droppedMipLevels_);
 
         if (data.has_value()) {
+            auto mipLevelsSize = sizeof(std::size_t);
+            for (const auto& level : mipLevels) mipLevelsSize += 2 * sizeof(unsigned int) + sizeof(std::size_t) + level.data_.size();
+
             data->clear();
-            data->resize(sizeof(TextureDescriptor) + 2 * sizeof(unsigned int) + sizeof(bool) + image.second);
+            data->resize(sizeof(TextureDescriptor) + 2 * sizeof(unsigned int) + sizeof(bool) + sizeof(std::size_t) + image.second + mipLevelsSize);
             auto dataptr = data->data();
             memcpy(dataptr, &descriptor_, sizeof(TextureDescriptor));
             dataptr += sizeof(TextureDescriptor);
@@ -95,10 +179,27 @@ namespace viscom {
             dataptr += sizeof(unsigned int);
             memcpy(dataptr, &sRGB_, sizeof(bool));
             dataptr += sizeof(bool);
+            memcpy(dataptr, &image.second, sizeof(std::size_t));
+            dataptr += sizeof(std::size_t);
             utils::memcpyfaster(dataptr, image.first, image.second);
+            dataptr += image.second;
+
+            auto numMipLevels = mipLevels.size();
+            memcpy(dataptr, &numMipLevels, sizeof(std::size_t));
+            dataptr += sizeof(std::size_t);
+            for (const auto& level : mipLevels) {
+                auto levelSize = level.data_.size();
+                memcpy(dataptr, &level.width_, sizeof(unsigned int));
+                dataptr += sizeof(unsigned int);
+                memcpy(dataptr, &level.height_, sizeof(unsigned int));
+                dataptr += sizeof(unsigned int);
+                memcpy(dataptr, &levelSize, sizeof(std::size_t));
+                dataptr += sizeof(std::size_t);
+                utils::memcpyfaster(dataptr, level.data_.data(), levelSize);
+                dataptr += levelSize;
+            }
         }
 
-        stbi_image_free(image.first);
         glBindTexture(GL_TEXTURE_2D, 0);
     }
 
@@ -114,19 +215,240 @@ namespace viscom {
         dataptr += sizeof(unsigned int);
         sRGB_ = *reinterpret_cast<const bool*>(dataptr);
         dataptr += sizeof(bool);
+        std::size_t baseSize = 0;
+        memcpy(&baseSize, dataptr, sizeof(std::size_t));
+        dataptr += sizeof(std::size_t);
+        auto baseData = dataptr;
+        dataptr += baseSize;
+
+        // mip levels filtered on the CPU or read from a compressed file are transferred with the texture.
+        std::size_t numMipLevels = 0;
+        memcpy(&numMipLevels, dataptr, sizeof(std::size_t));
+        dataptr += sizeof(std::size_t);
+        std::vector<MipLevel> mipLevels(numMipLevels);
+        for (auto& level : mipLevels) {
+            std::size_t levelSize = 0;
+            memcpy(&level.width_, dataptr, sizeof(unsigned int));
+            dataptr += sizeof(unsigned int);
+            memcpy(&level.height_, dataptr, sizeof(unsigned int));
+            dataptr += sizeof(unsigned int);
+            memcpy(&levelSize, dataptr, sizeof(std::size_t));
+            dataptr += sizeof(std::size_t);
+            level.data_.assign(dataptr, dataptr + levelSize);
+            dataptr += levelSize;
+        }
 
         glBindTexture(GL_TEXTURE_2D, textureId_);
-        glTexImage2D(GL_TEXTURE_2D, 0, descriptor_.internalFormat_, static_cast<GLsizei>(width_),
-                     static_cast<GLsizei>(height_), 0, descriptor_.format_, descriptor_.type_, dataptr);
+        numMipLevels_ = UploadLevels(baseData, baseSize, mipLevels);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    bool Texture::HasSameContent(const Texture& other) const noexcept
+    {
+        return contentHash_ != 0 && contentHash_ == other.contentHash_ && contentSize_ == other.contentSize_ && contentPrefix_ == other.contentPrefix_;
+    }
+
+    std::shared_ptr<Texture> Texture::CreateUnloadedCopy(unsigned int droppedMipLevels)
+    {
+        auto copy = std::make_shared<Texture>(GetId(), GetAppNode(), false);
+        copy->Initialize(sRGB_, flipTexture_, options_);
+        copy->droppedMipLevels_ = droppedMipLevels;
+        return copy;
+    }
+
+    bool Texture::DropMipLevels(unsigned int numLevels)
+    {
+        auto residentLevels = numMipLevels_ - droppedMipLevels_;
+        numLevels = std::min(numLevels, residentLevels - 1);
+        if (numLevels == 0) return true;
+
+        // OpenGL cannot free single levels, so the remaining ones are copied on the GPU to a new texture object.
+        // compressed textures cannot be attached to framebuffers, so they can only be copied with glCopyImageSubData.
+        auto useCopyImage = IsOpenGLVersionSupported(4, 3) || (GLEW_ARB_copy_image != 0 && GLEW_ARB_texture_storage != 0);
+        if (!useCopyImage && IsCompressed()) return false;
+
+        auto remainingLevels = residentLevels - numLevels;
+        auto firstLevel = droppedMipLevels_ + numLevels;
+        auto reducedTexture = CreateTextureObject();
+        glBindTexture(GL_TEXTURE_2D, reducedTexture);
+        if (useCopyImage) {
+            glTexStorage2D(GL_TEXTURE_2D, static_cast<GLsizei>(remainingLevels), static_cast<GLenum>(descriptor_.internalFormat_),
+                           static_cast<GLsizei>(std::max(width_ >> firstLevel, 1U)), static_cast<GLsizei>(std::max(height_ >> firstLevel, 1U)));
+        }
+        else {
+            for (auto i = 0U; i < remainingLevels; ++i) {
+                glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), descriptor_.internalFormat_, static_cast<GLsizei>(std::max(width_ >> (firstLevel + i), 1U)),
+                             static_cast<GLsizei>(std::max(height_ >> (firstLevel + i), 1U)), 0, descriptor_.format_, descriptor_.type_, nullptr);
+            }
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(remainingLevels - 1));
+        SetSamplerState(remainingLevels > 1);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        if (!CopyLevels(reducedTexture, numLevels, remainingLevels, useCopyImage)) {
+            glDeleteTextures(1, &reducedTexture);
+            return false;
+        }
+
+        glDeleteTextures(1, &textureId_);
+        textureId_ = reducedTexture;
+        droppedMipLevels_ += numLevels;
+        return true;
+    }
+
+    bool Texture::CopyLevels(GLuint targetTexture, unsigned int sourceLevel, unsigned int numLevels, bool useCopyImage) const
+    {
+        auto firstLevel = droppedMipLevels_ + sourceLevel;
+        if (useCopyImage) {
+            for (auto i = 0U; i < numLevels; ++i) {
+                auto levelWidth = static_cast<GLsizei>(std::max(width_ >> (firstLevel + i), 1U));
+                auto levelHeight = static_cast<GLsizei>(std::max(height_ >> (firstLevel + i), 1U));
+                glCopyImageSubData(textureId_, GL_TEXTURE_2D, static_cast<GLint>(sourceLevel + i), 0, 0, 0,
+                                   targetTexture, GL_TEXTURE_2D, static_cast<GLint>(i), 0, 0, 0, levelWidth, levelHeight, 1);
+            }
+            return true;
+        }
+
+        GLint readFramebuffer = 0, drawFramebuffer = 0;
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer);
+        auto framebufferSRGB = glIsEnabled(GL_FRAMEBUFFER_SRGB);
+        // sRGB texels are copied as stored.
+        glDisable(GL_FRAMEBUFFER_SRGB);
+
+        std::array<GLuint, 2> framebuffers{ 0, 0 };
+        glGenFramebuffers(2, framebuffers.data());
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers[0]);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[1]);
+        auto copied = true;
+        for (auto i = 0U; i < numLevels && copied; ++i) {
+            glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureId_, static_cast<GLint>(sourceLevel + i));
+            glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, targetTexture, static_cast<GLint>(i));
+            copied = glCheckFramebufferStatus(GL_READ_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE && glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+            if (!copied) break;
+
+            auto levelWidth = static_cast<GLint>(std::max(width_ >> (firstLevel + i), 1U));
+            auto levelHeight = static_cast<GLint>(std::max(height_ >> (firstLevel + i), 1U));
+            glBlitFramebuffer(0, 0, levelWidth, levelHeight, 0, 0, levelWidth, levelHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        }
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(readFramebuffer));
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, static_cast<GLuint>(drawFramebuffer));
+        glDeleteFramebuffers(2, framebuffers.data());
+        if (framebufferSRGB == GL_TRUE) glEnable(GL_FRAMEBUFFER_SRGB);
+        return copied;
+    }
+
+    void Texture::SwapTextureObject(Texture& other) noexcept
+    {
+        std::swap(textureId_, other.textureId_);
+        std::swap(numMipLevels_, other.numMipLevels_);
+        std::swap(droppedMipLevels_, other.droppedMipLevels_);
+    }
+
+    GLuint Texture::CreateTextureObject()
+    {
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+
+    void Texture::SetSamplerState(bool hasMipmaps) const
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, hasMipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        if (options_.maxAnisotropy_ > 1.0f && GetMaxTextureAnisotropy() > 1.0f) {
+            glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::min(options_.maxAnisotropy_, GetMaxTextureAnisotropy()));
+        }
     }
 
-    std::pair<void*, std::size_t> Texture::LoadImageLDR(const std::string& filename, bool useSRGB)
+    std::optional<CompressedImage> Texture::LoadCompressedImage(const std::string& filename)
+    {
+        namespace fs = std::filesystem;
+        auto ddsFilename = filename;
+        if (fs::path{ filename }.extension() != ".dds") {
+            // a cache file older than its source is ignored, so edited textures are not hidden by stale caches.
+            ddsFilename = GetCompressedCacheFilename(filename, flipTexture_);
+            std::error_code ec;
+            if (!fs::exists(ddsFilename, ec) || fs::last_write_time(ddsFilename, ec) < fs::last_write_time(filename, ec)) return std::nullopt;
+        }
+
+        auto image = ReadDDS(ddsFilename);
+        if (!image.has_value()) return std::nullopt;
+        if (!IsCompressedFormatSupported(image->format_)) {
+            spdlog::info("Compressed texture format is not supported, loading uncompressed texture ({}).", filename);
+            return std::nullopt;
+        }
+
+        width_ = image->levels_[0].width_;
+        height_ = image->levels_[0].height_;
+        descriptor_ = TextureDescriptor{ 0, static_cast<GLint>(GetCompressedInternalFormat(image->format_, sRGB_)), GL_RGBA, GL_UNSIGNED_BYTE };
+        return image;
+    }
+
+    unsigned int Texture::UploadLevels(const void* baseData, std::size_t baseSize, const std::vector<MipLevel>& mipLevels, unsigned int firstLevel) const
+    {
+        auto compressed = IsCompressed();
+        auto baseWidth = width_;
+        auto baseHeight = height_;
+        if (firstLevel > 0) {
+            const auto& level = mipLevels[firstLevel - 1];
+            baseData = level.data_.data();
+            baseSize = level.data_.size();
+            baseWidth = level.width_;
+            baseHeight = level.height_;
+        }
+
+        // rows are tightly packed, which does not align them to 4 bytes for small levels and 1 or 2 byte texels.
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        if (compressed) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLenum>(descriptor_.internalFormat_), static_cast<GLsizei>(baseWidth),
+                                   static_cast<GLsizei>(baseHeight), 0, static_cast<GLsizei>(baseSize), baseData);
+        }
+        else {
+            glTexImage2D(GL_TEXTURE_2D, 0, descriptor_.internalFormat_, static_cast<GLsizei>(baseWidth),
+                         static_cast<GLsizei>(baseHeight), 0, descriptor_.format_, descriptor_.type_, baseData);
+        }
+
+        // compressed textures cannot generate mip maps, so only the levels stored with them are used.
+        auto numLevels = 1U;
+        if (!compressed && options_.mipmaps_ == TextureMipmaps::GPU) {
+            glGenerateMipmap(GL_TEXTURE_2D);
+            for (auto size = std::max(width_, height_); size > 1; size /= 2) ++numLevels;
+        }
+        else if (!mipLevels.empty()) {
+            for (std::size_t i = firstLevel; i < mipLevels.size(); ++i) {
+                const auto& level = mipLevels[i];
+                auto glLevel = static_cast<GLint>(i + 1 - firstLevel);
+                if (compressed) {
+                    glCompressedTexImage2D(GL_TEXTURE_2D, glLevel, static_cast<GLenum>(descriptor_.internalFormat_), static_cast<GLsizei>(level.width_),
+                                           static_cast<GLsizei>(level.height_), 0, static_cast<GLsizei>(level.data_.size()), level.data_.data());
+                }
+                else {
+                    glTexImage2D(GL_TEXTURE_2D, glLevel, descriptor_.internalFormat_, static_cast<GLsizei>(level.width_),
+                                 static_cast<GLsizei>(level.height_), 0, descriptor_.format_, descriptor_.type_, level.data_.data());
+                }
+            }
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(mipLevels.size() - firstLevel));
+            numLevels += static_cast<unsigned int>(mipLevels.size());
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        SetSamplerState(numLevels - firstLevel > 1);
+        return numLevels;
+    }
+
+    std::pair<void*, std::size_t> Texture::LoadImageLDR(const std::string& filename, const std::vector<std::uint8_t>& fileData, bool useSRGB)
     {
         auto imgWidth = 0, imgHeight = 0, imgChannels = 0, imgForceChannels = 0;
-        stbi_info(filename.c_str(), &imgWidth, &imgHeight, &imgChannels);
+        stbi_info_from_memory(fileData.data(), static_cast<int>(fileData.size()), &imgWidth, &imgHeight, &imgChannels);
         if (imgChannels == 3) imgForceChannels = 4;
-        auto image = stbi_load(filename.c_str(), &imgWidth, &imgHeight, &imgChannels, imgForceChannels);
+        auto image = stbi_load_from_memory(fileData.data(), static_cast<int>(fileData.size()), &imgWidth, &imgHeight, &imgChannels, imgForceChannels);
         if (imgForceChannels != 0) imgChannels = imgForceChannels;
         if (!image) {
             spdlog::warn("Failed to load texture ({}).", filename);
@@ -140,12 +462,12 @@ namespace viscom {
         return std::make_pair(image, imgWidth * imgHeight * imgChannels);
     }
 
-    std::pair<void*, std::size_t> Texture::LoadImageHDR(const std::string& filename)
+    std::pair<void*, std::size_t> Texture::LoadImageHDR(const std::string& filename, const std::vector<std::uint8_t>& fileData)
     {
         auto imgWidth = 0, imgHeight = 0, imgChannels = 0, imgForceChannels = 0;
-        stbi_info(filename.c_str(), &imgWidth, &imgHeight, &imgChannels);
+        stbi_info_from_memory(fileData.data(), static_cast<int>(fileData.size()), &imgWidth, &imgHeight, &imgChannels);
         if (imgChannels == 3) imgForceChannels = 4;
-        auto image = stbi_loadf(filename.c_str(), &imgWidth, &imgHeight, &imgChannels, imgForceChannels);
+        auto image = stbi_loadf_from_memory(fileData.data(), static_cast<int>(fileData.size()), &imgWidth, &imgHeight, &imgChannels, imgForceChannels);
         if (imgForceChannels != 0) imgChannels = imgForceChannels;
         if (!image) {
             spdlog::warn("Failed to load texture ({}).", filename);
@@ -156,7 +478,7 @@ namespace viscom {
         height_ = static_cast<unsigned int>(imgHeight);
         descriptor_.type_ = GL_FLOAT;
         std::tie(descriptor_.bytesPP_, descriptor_.internalFormat_, descriptor_.format_) = FindFormatHDR(filename, imgChannels);
-        return std::make_pair(image, imgWidth * imgHeight * imgChannels);
+        return std::make_pair(image, imgWidth * imgHeight * imgChannels * sizeof(float));
     }
 
     std::tuple<unsigned int, int, int> Texture::FindFormatLDR(const std::string& filename, int imgChannels, bool useSRGB) const
@@ -193,4 +515,41 @@ namespace viscom {
         return std::make_tuple(bytesPP, internalFmt, fmt);
     }
 
+    void Texture::ConvertImageHDR(const std::string& filename, DecodedImage& image)
+    {
+        auto channels = descriptor_.bytesPP_ / static_cast<unsigned int>(sizeof(float));
+        auto baseData = reinterpret_cast<float*>(image.pixels_);
+        auto numBaseValues = image.size_ / sizeof(float);
+
+        // alpha is dropped only if the image is opaque (which includes the alpha channel added to RGB images).
+        auto usePackedFloat = options_.hdrFormat_ == TextureHDRFormat::PackedFloat && channels >= 3;
+        for (std::size_t i = 3; usePackedFloat && channels == 4 && i < numBaseValues; i += 4) usePackedFloat = baseData[i] == 1.0f;
+
+        FloatConversionStatistics statistics;
+        auto convertLevel = [&statistics, usePackedFloat, channels](void* data, std::size_t numValues) {
+            auto levelStatistics = usePackedFloat
+                ? ConvertToPackedFloat(reinterpret_cast<float*>(data), reinterpret_cast<std::uint32_t*>(data), numValues / channels, channels)
+                : ConvertToHalfFloat(reinterpret_cast<float*>(data), reinterpret_cast<std::uint16_t*>(data), numValues);
+            statistics.maxRelativeError_ = std::max(statistics.maxRelativeError_, levelStatistics.maxRelativeError_);
+            statistics.clampedValues_ += levelStatistics.clampedValues_;
+            return usePackedFloat ? numValues / channels * sizeof(std::uint32_t) : numValues * sizeof(std::uint16_t);
+        };
+
+        image.size_ = convertLevel(image.pixels_, numBaseValues);
+        for (auto& level : image.mipLevels_) level.data_.resize(convertLevel(level.data_.data(), level.data_.size() / sizeof(float)));
+
+        const char* formatName = "GL_R11F_G11F_B10F";
+        if (usePackedFloat) descriptor_ = TextureDescriptor{ 4U, GL_R11F_G11F_B10F, GL_RGB, GL_UNSIGNED_INT_10F_11F_11F_REV };
+        else {
+            switch (channels) {
+            case 1: descriptor_ = TextureDescriptor{ 2U, GL_R16F, GL_RED, GL_HALF_FLOAT }; formatName = "GL_R16F"; break;
+            case 2: descriptor_ = TextureDescriptor{ 4U, GL_RG16F, GL_RG, GL_HALF_FLOAT }; formatName = "GL_RG16F"; break;
+            case 3: descriptor_ = TextureDescriptor{ 6U, GL_RGB16F, GL_RGB, GL_HALF_FLOAT }; formatName = "GL_RGB16F"; break;
+            default: descriptor_ = TextureDescriptor{ 8U, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT }; formatName = "GL_RGBA16F"; break;
+            }
+        }
+        spdlog::info("Converted HDR texture to {} ({}), max. relative error: {:.3e}, values clamped: {}.", formatName, filename,
+            statistics.maxRelativeError_, statistics.clampedValues_);
+    }
+
 }
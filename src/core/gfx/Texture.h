@@ -11,10 +11,13 @@
 #include "core/main.h"
 #include "core/open_gl_fwd.h"
 #include "core/resources/Resource.h"
+#include <atomic>
 
 namespace viscom {
 
     class FrameworkInternal;
+    struct MipLevel;
+    struct CompressedImage;
 
     /** Describes the format of a texture. */
     struct TextureDescriptor
@@ -28,7 +31,7 @@ namespace viscom {
          */
         TextureDescriptor(unsigned int btsPP, GLint intFmt, GLenum fmt, GLenum tp) noexcept : bytesPP_(btsPP), internalFormat_(intFmt), format_(fmt), type_(tp) {};
 
-        /** Holds the bytes per pixel of the format. */
+        /** Holds the bytes per pixel of the format (0 for block compressed formats). */
         unsigned int bytesPP_;
         /** Holds the internal format. */
         GLint internalFormat_;
@@ -38,6 +41,39 @@ namespace viscom {
         GLenum type_;
     };
 
+    /** The ways mip maps of a texture can be generated. */
+    enum class TextureMipmaps
+    {
+        /** No mip maps, the texture is sampled bilinearly. */
+        None,
+        /** Mip maps are generated by the driver with glGenerateMipmap. */
+        GPU,
+        /** Mip maps are filtered on the CPU (gamma correct for sRGB textures) and kept with the texture data. */
+        CPU
+    };
+
+    /** The formats high dynamic range images can be stored in. */
+    enum class TextureHDRFormat
+    {
+        /** 32 bit float channels (GL_R32F to GL_RGBA32F). */
+        Float,
+        /** 16 bit float channels (GL_R16F to GL_RGBA16F). */
+        HalfFloat,
+        /** Packed unsigned floats without alpha (GL_R11F_G11F_B10F), images with alpha or less than 3 channels use half floats. */
+        PackedFloat
+    };
+
+    /** Options for mip map generation and sampling of a texture. */
+    struct TextureOptions
+    {
+        /** How mip maps are generated, textures with mip maps are sampled trilinearly. */
+        TextureMipmaps mipmaps_ = TextureMipmaps::None;
+        /** The maximum anisotropy (1 disables anisotropic filtering, larger values are clamped to GetMaxTextureAnisotropy). */
+        float maxAnisotropy_ = 1.0f;
+        /** The format high dynamic range images are converted to (ignored for low dynamic range images). */
+        TextureHDRFormat hdrFormat_ = TextureHDRFormat::Float;
+    };
+
     /**
      * Helper class for loading an OpenGL texture from file.
      */
@@ -55,15 +91,65 @@ namespace viscom {
          *  Initializes the Texture.
          *  @param useSRGB defines if the texture uses the standard RGB color space.
          *  @param flipTexture flips the texture on load.
+         *  @param options the mip map and sampling options.
          */
-        void Initialize(bool useSRGB = true, bool flipTexture = true);
+        void Initialize(bool useSRGB = true, bool flipTexture = true, const TextureOptions& options = TextureOptions{});
+        /**
+         *  Reads and decodes the image (including mip maps filtered on the CPU) without using OpenGL.
+         *  Can be called from a worker thread after Initialize, loading the texture then only uploads the decoded image.
+         */
+        void DecodeImage();
 
         /** Returns the size of the texture. */
         glm::uvec2 getDimensions() const noexcept { return glm::uvec2(width_, height_); }
-        /** Returns the OpenGL texture id. */
+        /**
+         *  Returns the OpenGL texture id. Dropping or restoring mip levels (TextureManager::UpdateResidency) replaces the
+         *  texture object, so the id should be requested each frame and a GLStateCache needs to be invalidated afterwards.
+         */
         GLuint getTextureId() const noexcept { return textureId_; }
+        /** Marks the texture as used for the residency tracking, renderers call it when they bind the texture. */
+        void MarkUsed() const noexcept { useCount_.fetch_add(1, std::memory_order_relaxed); }
         /** Returns the texture descriptor. */
         const TextureDescriptor& getDescriptor() const { return descriptor_; }
+        /** Checks whether the texture uses a block compressed format. */
+        bool IsCompressed() const noexcept { return descriptor_.bytesPP_ == 0; }
+        /** Returns the mip map and sampling options. */
+        const TextureOptions& GetOptions() const noexcept { return options_; }
+        /** Returns the hash of the decoded image data and format (0 if the image was not decoded from file). */
+        std::uint64_t GetContentHash() const noexcept { return contentHash_; }
+        /** Returns the size of the decoded image data of all levels in bytes (0 if the image was not decoded from file). */
+        std::size_t GetContentSize() const noexcept { return contentSize_; }
+        /**
+         *  Checks whether another texture was decoded from the same image, comparing the hash, the size and the first bytes of the data.
+         *  @param other the other texture.
+         */
+        bool HasSameContent(const Texture& other) const noexcept;
+        /** Returns how often the texture was marked as used. */
+        std::uint64_t GetUseCount() const noexcept { return useCount_.load(std::memory_order_relaxed); }
+        /** Returns the number of mip levels the texture was loaded with (including the base level). */
+        unsigned int GetNumMipLevels() const noexcept { return numMipLevels_; }
+        /** Returns the number of top mip levels that are currently dropped. */
+        unsigned int GetDroppedMipLevels() const noexcept { return droppedMipLevels_; }
+
+        /**
+         *  Drops top mip levels to free video memory, at least one level is kept. The remaining levels are copied on the
+         *  GPU to a new texture object (glCopyImageSubData or a framebuffer blit), so the texture id changes.
+         *  @param numLevels the number of levels to drop.
+         *  @return whether the levels were dropped, fails if the format cannot be copied on the GPU in this context
+         *      (e.g. compressed textures without OpenGL 4.3 or ARB_copy_image).
+         */
+        bool DropMipLevels(unsigned int numLevels);
+        /**
+         *  Creates an unsynchronized texture with the same file and options that is not loaded yet.
+         *  It can be decoded on a worker thread to restore dropped mip levels or to drop levels by uploading it again.
+         *  @param droppedMipLevels the number of top levels the copy skips when it is loaded (only levels decoded with the image can be skipped).
+         */
+        std::shared_ptr<Texture> CreateUnloadedCopy(unsigned int droppedMipLevels = 0);
+        /**
+         *  Swaps the OpenGL texture object and its levels with another texture of the same image.
+         *  @param other the other texture.
+         */
+        void SwapTextureObject(Texture& other) noexcept;
 
     protected:
         /**
@@ -79,17 +165,22 @@ namespace viscom {
         virtual void LoadFromMemory(const void* data, std::size_t size) override;
 
     private:
+        /** An image decoded by DecodeImage that waits for the upload. */
+        struct DecodedImage;
+
         /**
-         *  Loads a low dynamic range image from file.
+         *  Decodes a low dynamic range image.
          *  @param filename the path to the image file.
+         *  @param fileData the contents of the image file.
          *  @param useSRGB defines if the texture uses the standard RGB color space.
          */
-        std::pair<void*, std::size_t> LoadImageLDR(const std::string& filename, bool useSRGB);
+        std::pair<void*, std::size_t> LoadImageLDR(const std::string& filename, const std::vector<std::uint8_t>& fileData, bool useSRGB);
         /**
-         *  Loads a high dynamic range image from file.
+         *  Decodes a high dynamic range image.
          *  @param filename the path to the image file.
+         *  @param fileData the contents of the image file.
          */
-        std::pair<void*, std::size_t> LoadImageHDR(const std::string& filename);
+        std::pair<void*, std::size_t> LoadImageHDR(const std::string& filename, const std::vector<std::uint8_t>& fileData);
         /**
          *  Finds the appropriate format, internal format and number of bytes per pixel for a low dynamic range image.
          *  @param filename the path to the image file.
@@ -103,6 +194,44 @@ namespace viscom {
          *  @param imgChannels the number of channels the image uses.
          */
         std::tuple<unsigned int, int, int> FindFormatHDR(const std::string& filename, int imgChannels) const;
+        /**
+         *  Converts a decoded high dynamic range image (including its mip levels) to the format of the options in place.
+         *  @param filename the path to the image file.
+         *  @param image the decoded image.
+         */
+        void ConvertImageHDR(const std::string& filename, DecodedImage& image);
+        /**
+         *  Reads the compressed version of a texture (the file itself if it is a DDS file, the cache file otherwise).
+         *  Compressed blocks are uploaded as stored, DDS files are never flipped.
+         *  @param filename the path to the image file.
+         *  @return the compressed image or an empty optional if there is no usable compressed version.
+         */
+        std::optional<CompressedImage> LoadCompressedImage(const std::string& filename);
+        /**
+         *  Uploads all levels to the bound texture and sets the sampler state.
+         *  @param baseData the data of the base level.
+         *  @param baseSize the size of the base level data in bytes.
+         *  @param mipLevels the mip levels filtered on the CPU or read from a compressed file.
+         *  @param firstLevel the first level to upload as level 0 (needs at least as many mip levels).
+         *  @return the number of levels of the texture (including the skipped ones).
+         */
+        unsigned int UploadLevels(const void* baseData, std::size_t baseSize, const std::vector<MipLevel>& mipLevels, unsigned int firstLevel = 0) const;
+        /**
+         *  Copies levels of the texture to the levels of another texture object on the GPU.
+         *  @param targetTexture the texture object with the levels allocated.
+         *  @param sourceLevel the level of this texture copied to level 0.
+         *  @param numLevels the number of levels to copy.
+         *  @param useCopyImage uses glCopyImageSubData instead of blitting between framebuffers.
+         *  @return whether the levels were copied, blitting fails for formats that cannot be attached to a framebuffer.
+         */
+        bool CopyLevels(GLuint targetTexture, unsigned int sourceLevel, unsigned int numLevels, bool useCopyImage) const;
+        /**
+         *  Sets the minification filter and anisotropy of the bound texture.
+         *  @param hasMipmaps defines if the texture has more than one level.
+         */
+        void SetSamplerState(bool hasMipmaps) const;
+        /** Creates a texture object with the default sampler state. */
+        static GLuint CreateTextureObject();
 
         /** Holds the OpenGL texture id. */
         GLuint textureId_;
@@ -117,5 +246,21 @@ namespace viscom {
         bool sRGB_;
         /** Flip the texture on load. */
         bool flipTexture_ = true;
+        /** Holds the mip map and sampling options. */
+        TextureOptions options_;
+        /** Holds the image decoded before loading. */
+        std::unique_ptr<DecodedImage> decodedImage_;
+        /** Holds the hash of the decoded image data and format. */
+        std::uint64_t contentHash_ = 0;
+        /** Holds the size of the decoded image data of all levels. */
+        std::size_t contentSize_ = 0;
+        /** Holds the first bytes of the decoded base level, so equal hashes of different images are detected. */
+        std::vector<std::uint8_t> contentPrefix_;
+        /** Holds the number of mip levels including the base level. */
+        unsigned int numMipLevels_ = 1;
+        /** Holds the number of dropped top mip levels. */
+        unsigned int droppedMipLevels_ = 0;
+        /** Holds how often the texture was marked as used. */
+        mutable std::atomic<std::uint64_t> useCount_{ 0 };
     };
 }
@@ -0,0 +1,671 @@
+/**
+ * @file   TextureCompression.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.21
+ *
+ * @brief  Implementation of block compression encoders, DDS containers and a background texture compressor.
+ */
+
+#include "TextureCompression.h"
+#include "core/open_gl.h"
+#include "OpenGLCapabilities.h"
+
+#ifdef __APPLE_CC__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#endif
+#include <stb_image.h>
+#ifdef __APPLE_CC__
+#pragma clang diagnostic pop
+#endif
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+
+namespace viscom {
+
+    namespace {
+        /** The minimum number of block rows compressed by a single task. */
+        constexpr std::size_t MIN_BLOCK_ROWS_PER_TASK = 4;
+        /** The interpolation weights of BC7 blocks with 4 bit indices. */
+        constexpr std::array<int, 16> BC7_WEIGHTS = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+        /** The pixels of a 4x4 block. */
+        using Block = std::array<glm::vec4, 16>;
+
+        void LoadBlock(const std::uint8_t* rgba, unsigned int width, unsigned int height, unsigned int blockX, unsigned int blockY, Block& block)
+        {
+            for (unsigned int y = 0; y < 4; ++y) {
+                auto sy = std::min(blockY * 4 + y, height - 1);
+                for (unsigned int x = 0; x < 4; ++x) {
+                    auto sx = std::min(blockX * 4 + x, width - 1);
+                    auto pixel = rgba + (static_cast<std::size_t>(sy) * width + sx) * 4;
+                    block[y * 4 + x] = glm::vec4{ pixel[0], pixel[1], pixel[2], pixel[3] };
+                }
+            }
+        }
+
+        /** Computes the principal axis of a point set with power iterations on its covariance matrix. */
+        template<int N> glm::vec<N, float> ComputePrincipalAxis(const std::array<glm::vec<N, float>, 16>& points, const glm::vec<N, float>& mean, int iterations)
+        {
+            glm::mat<N, N, float> covariance{ 0.0f };
+            glm::vec<N, float> minPoint{ std::numeric_limits<float>::max() };
+            glm::vec<N, float> maxPoint{ std::numeric_limits<float>::lowest() };
+            for (const auto& point : points) {
+                auto d = point - mean;
+                for (int c = 0; c < N; ++c) covariance[c] += d[c] * d;
+                minPoint = glm::min(minPoint, point);
+                maxPoint = glm::max(maxPoint, point);
+            }
+
+            auto axis = maxPoint - minPoint;
+            if (glm::dot(axis, axis) < 1e-6f) return axis;
+            for (int i = 0; i < iterations; ++i) {
+                auto next = covariance * axis;
+                if (glm::dot(next, next) < 1e-12f) break;
+                axis = next / glm::length(next);
+            }
+            return glm::normalize(axis);
+        }
+
+        /** Finds the endpoints of a point set at the extremes along its principal axis. */
+        template<int N> void FindAxisEndpoints(const std::array<glm::vec<N, float>, 16>& points, int iterations,
+            glm::vec<N, float>& endpoint0, glm::vec<N, float>& endpoint1)
+        {
+            glm::vec<N, float> mean{ 0.0f };
+            for (const auto& point : points) mean += point;
+            mean /= 16.0f;
+
+            auto axis = ComputePrincipalAxis<N>(points, mean, iterations);
+            auto minProjection = std::numeric_limits<float>::max();
+            auto maxProjection = std::numeric_limits<float>::lowest();
+            for (const auto& point : points) {
+                auto projection = glm::dot(point - mean, axis);
+                minProjection = std::min(minProjection, projection);
+                maxProjection = std::max(maxProjection, projection);
+            }
+            endpoint0 = glm::clamp(mean + maxProjection * axis, 0.0f, 255.0f);
+            endpoint1 = glm::clamp(mean + minProjection * axis, 0.0f, 255.0f);
+        }
+
+        /** Fits both endpoints with least squares to points and their interpolation weights towards endpoint 1. */
+        template<int N> bool FitEndpoints(const std::array<glm::vec<N, float>, 16>& points, const std::array<float, 16>& weights,
+            glm::vec<N, float>& endpoint0, glm::vec<N, float>& endpoint1)
+        {
+            float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+            glm::vec<N, float> ax{ 0.0f }, bx{ 0.0f };
+            for (std::size_t i = 0; i < 16; ++i) {
+                auto a = 1.0f - weights[i];
+                auto b = weights[i];
+                aa += a * a;
+                ab += a * b;
+                bb += b * b;
+                ax += a * points[i];
+                bx += b * points[i];
+            }
+            auto det = aa * bb - ab * ab;
+            if (std::abs(det) < 1e-6f) return false;
+            endpoint0 = glm::clamp((ax * bb - bx * ab) / det, 0.0f, 255.0f);
+            endpoint1 = glm::clamp((bx * aa - ax * ab) / det, 0.0f, 255.0f);
+            return true;
+        }
+
+        std::uint16_t ToRGB565(const glm::vec3& color)
+        {
+            auto r = static_cast<std::uint16_t>(std::lround(color.x * 31.0f / 255.0f));
+            auto g = static_cast<std::uint16_t>(std::lround(color.y * 63.0f / 255.0f));
+            auto b = static_cast<std::uint16_t>(std::lround(color.z * 31.0f / 255.0f));
+            return static_cast<std::uint16_t>((r << 11) | (g << 5) | b);
+        }
+
+        glm::vec3 FromRGB565(std::uint16_t color)
+        {
+            auto r = (color >> 11) & 31;
+            auto g = (color >> 5) & 63;
+            auto b = color & 31;
+            return glm::vec3{ (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2) };
+        }
+
+        /** Chooses the nearest of the 4 palette colors for each pixel and returns the squared error. */
+        float FindColorIndices(const std::array<glm::vec3, 16>& pixels, std::uint16_t color0, std::uint16_t color1, std::uint32_t& indices)
+        {
+            std::array<glm::vec3, 4> palette;
+            palette[0] = FromRGB565(color0);
+            palette[1] = FromRGB565(color1);
+            palette[2] = (2.0f * palette[0] + palette[1]) / 3.0f;
+            palette[3] = (palette[0] + 2.0f * palette[1]) / 3.0f;
+
+            indices = 0;
+            auto error = 0.0f;
+            for (std::uint32_t i = 0; i < 16; ++i) {
+                std::uint32_t bestIndex = 0;
+                auto bestError = std::numeric_limits<float>::max();
+                for (std::uint32_t p = 0; p < 4; ++p) {
+                    auto d = pixels[i] - palette[p];
+                    auto pixelError = glm::dot(d, d);
+                    if (pixelError < bestError) {
+                        bestError = pixelError;
+                        bestIndex = p;
+                    }
+                }
+                indices |= bestIndex << (2 * i);
+                error += bestError;
+            }
+            return error;
+        }
+
+        /** Encodes the color of a block in 4 color mode (the alpha channel is ignored). */
+        void EncodeColorBlock(const Block& block, CompressionQuality quality, std::uint8_t* out)
+        {
+            std::array<glm::vec3, 16> pixels;
+            for (std::size_t i = 0; i < 16; ++i) pixels[i] = glm::vec3(block[i]);
+
+            glm::vec3 endpoint0, endpoint1;
+            FindAxisEndpoints<3>(pixels, quality == CompressionQuality::High ? 8 : 2, endpoint0, endpoint1);
+
+            auto color0 = ToRGB565(endpoint0);
+            auto color1 = ToRGB565(endpoint1);
+            if (color0 < color1) std::swap(color0, color1);
+            std::uint32_t indices = 0;
+            auto error = color0 == color1 ? 0.0f : FindColorIndices(pixels, color0, color1, indices);
+
+            if (quality == CompressionQuality::High && color0 != color1) {
+                // the palette weights of the indices 0 to 3 towards color 1.
+                constexpr std::array<float, 4> indexWeights = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+                for (int iteration = 0; iteration < 2; ++iteration) {
+                    std::array<float, 16> weights;
+                    for (std::size_t i = 0; i < 16; ++i) weights[i] = indexWeights[(indices >> (2 * i)) & 3];
+                    if (!FitEndpoints<3>(pixels, weights, endpoint0, endpoint1)) break;
+
+                    auto refinedColor0 = ToRGB565(endpoint0);
+                    auto refinedColor1 = ToRGB565(endpoint1);
+                    if (refinedColor0 < refinedColor1) std::swap(refinedColor0, refinedColor1);
+                    if (refinedColor0 == refinedColor1) break;
+                    std::uint32_t refinedIndices = 0;
+                    auto refinedError = FindColorIndices(pixels, refinedColor0, refinedColor1, refinedIndices);
+                    if (refinedError >= error) break;
+                    color0 = refinedColor0;
+                    color1 = refinedColor1;
+                    indices = refinedIndices;
+                    error = refinedError;
+                }
+            }
+
+            // equal colors select 3 color mode, where index 0 still is color 0.
+            if (color0 == color1) indices = 0;
+            out[0] = static_cast<std::uint8_t>(color0 & 0xff);
+            out[1] = static_cast<std::uint8_t>(color0 >> 8);
+            out[2] = static_cast<std::uint8_t>(color1 & 0xff);
+            out[3] = static_cast<std::uint8_t>(color1 >> 8);
+            for (std::size_t i = 0; i < 4; ++i) out[4 + i] = static_cast<std::uint8_t>((indices >> (8 * i)) & 0xff);
+        }
+
+        /** Chooses the nearest of the 8 interpolated values for each pixel and returns the squared error. */
+        float FindSingleChannelIndices(const std::array<float, 16>& values, int value0, int value1, std::uint64_t& indices)
+        {
+            std::array<float, 8> palette;
+            palette[0] = static_cast<float>(value0);
+            palette[1] = static_cast<float>(value1);
+            for (int i = 2; i < 8; ++i) palette[i] = static_cast<float>((8 - i) * value0 + (i - 1) * value1) / 7.0f;
+
+            indices = 0;
+            auto error = 0.0f;
+            for (std::uint64_t i = 0; i < 16; ++i) {
+                std::uint64_t bestIndex = 0;
+                auto bestError = std::numeric_limits<float>::max();
+                for (std::uint64_t p = 0; p < 8; ++p) {
+                    auto d = values[i] - palette[p];
+                    if (d * d < bestError) {
+                        bestError = d * d;
+                        bestIndex = p;
+                    }
+                }
+                indices |= bestIndex << (3 * i);
+                error += bestError;
+            }
+            return error;
+        }
+
+        /** Encodes a single channel of a block in 8 value mode. */
+        void EncodeSingleChannelBlock(const Block& block, int channel, CompressionQuality quality, std::uint8_t* out)
+        {
+            std::array<float, 16> values;
+            for (std::size_t i = 0; i < 16; ++i) values[i] = block[i][channel];
+            auto minValue = static_cast<int>(*std::min_element(values.begin(), values.end()) + 0.5f);
+            auto maxValue = static_cast<int>(*std::max_element(values.begin(), values.end()) + 0.5f);
+
+            auto value0 = maxValue;
+            auto value1 = minValue;
+            std::uint64_t indices = 0;
+            if (maxValue > minValue) {
+                auto error = FindSingleChannelIndices(values, value0, value1, indices);
+                // moving the endpoints inwards can place the interpolated values closer to clustered pixels.
+                constexpr int searchRadius = 3;
+                for (int d0 = 0; quality == CompressionQuality::High && d0 <= searchRadius; ++d0) {
+                    for (int d1 = 0; d1 <= searchRadius; ++d1) {
+                        if ((d0 == 0 && d1 == 0) || maxValue - d0 <= minValue + d1) continue;
+                        std::uint64_t candidateIndices = 0;
+                        auto candidateError = FindSingleChannelIndices(values, maxValue - d0, minValue + d1, candidateIndices);
+                        if (candidateError < error) {
+                            error = candidateError;
+                            value0 = maxValue - d0;
+                            value1 = minValue + d1;
+                            indices = candidateIndices;
+                        }
+                    }
+                }
+            }
+
+            out[0] = static_cast<std::uint8_t>(value0);
+            out[1] = static_cast<std::uint8_t>(value1);
+            for (std::size_t i = 0; i < 6; ++i) out[2 + i] = static_cast<std::uint8_t>((indices >> (8 * i)) & 0xff);
+        }
+
+        /** Writes bits to a 16 byte block, starting with the least significant bit. */
+        class BlockBitWriter
+        {
+        public:
+            explicit BlockBitWriter(std::uint8_t* out) : out_{ out } { std::fill(out_, out_ + 16, std::uint8_t{ 0 }); }
+
+            void Write(std::uint32_t value, unsigned int numBits)
+            {
+                for (unsigned int i = 0; i < numBits; ++i, ++position_) {
+                    if ((value >> i) & 1) out_[position_ / 8] |= static_cast<std::uint8_t>(1 << (position_ % 8));
+                }
+            }
+
+        private:
+            std::uint8_t* out_;
+            unsigned int position_ = 0;
+        };
+
+        /** Quantizes a BC7 mode 6 endpoint to 7 bits per channel and a shared p-bit. */
+        glm::ivec4 QuantizeBC7Endpoint(const glm::vec4& endpoint, int pBit)
+        {
+            auto quantized = glm::clamp(glm::round((endpoint - static_cast<float>(pBit)) / 2.0f), 0.0f, 127.0f);
+            return glm::ivec4(quantized);
+        }
+
+        /** Chooses the nearest of the 16 palette colors of a BC7 mode 6 block for each pixel and returns the squared error. */
+        float FindBC7Indices(const Block& block, const glm::ivec4& endpoint0, const glm::ivec4& endpoint1, std::array<std::uint32_t, 16>& indices)
+        {
+            std::array<glm::vec4, 16> palette;
+            for (std::size_t i = 0; i < 16; ++i) {
+                palette[i] = glm::floor(glm::vec4((64 - BC7_WEIGHTS[i]) * endpoint0 + BC7_WEIGHTS[i] * endpoint1 + 32) / 64.0f);
+            }
+
+            auto error = 0.0f;
+            for (std::size_t i = 0; i < 16; ++i) {
+                auto bestError = std::numeric_limits<float>::max();
+                for (std::uint32_t p = 0; p < 16; ++p) {
+                    auto d = block[i] - palette[p];
+                    auto pixelError = glm::dot(d, d);
+                    if (pixelError < bestError) {
+                        bestError = pixelError;
+                        indices[i] = p;
+                    }
+                }
+                error += bestError;
+            }
+            return error;
+        }
+
+        /** Encodes a block in BC7 mode 6 (a single RGBA subset with 7 bit endpoints, p-bits and 4 bit indices). */
+        void EncodeBC7Block(const Block& block, CompressionQuality quality, std::uint8_t* out)
+        {
+            glm::vec4 endpoint0, endpoint1;
+            FindAxisEndpoints<4>(block, quality == CompressionQuality::High ? 8 : 2, endpoint0, endpoint1);
+
+            auto bestError = std::numeric_limits<float>::max();
+            glm::ivec4 bestEndpoints[2];
+            int bestPBits[2] = { 0, 0 };
+            std::array<std::uint32_t, 16> bestIndices;
+            auto evaluate = [&](const glm::vec4& e0, const glm::vec4& e1) {
+                // the fast preset only tries equal p-bits, the high preset all combinations.
+                for (int p0 = 0; p0 < 2; ++p0) {
+                    for (int p1 = 0; p1 < 2; ++p1) {
+                        if (quality == CompressionQuality::Fast && p0 != p1) continue;
+                        auto q0 = QuantizeBC7Endpoint(e0, p0);
+                        auto q1 = QuantizeBC7Endpoint(e1, p1);
+                        std::array<std::uint32_t, 16> indices;
+                        auto error = FindBC7Indices(block, q0 * 2 + p0, q1 * 2 + p1, indices);
+                        if (error < bestError) {
+                            bestError = error;
+                            bestEndpoints[0] = q0;
+                            bestEndpoints[1] = q1;
+                            bestPBits[0] = p0;
+                            bestPBits[1] = p1;
+                            bestIndices = indices;
+                        }
+                    }
+                }
+            };
+            evaluate(endpoint0, endpoint1);
+
+            if (quality == CompressionQuality::High) {
+                std::array<float, 16> weights;
+                for (std::size_t i = 0; i < 16; ++i) weights[i] = static_cast<float>(BC7_WEIGHTS[bestIndices[i]]) / 64.0f;
+                if (FitEndpoints<4>(block, weights, endpoint0, endpoint1)) evaluate(endpoint0, endpoint1);
+            }
+
+            // the most significant bit of the first index is implicitly 0, so the endpoints are swapped if needed.
+            if (bestIndices[0] >= 8) {
+                std::swap(bestEndpoints[0], bestEndpoints[1]);
+                std::swap(bestPBits[0], bestPBits[1]);
+                for (auto& index : bestIndices) index = 15 - index;
+            }
+
+            BlockBitWriter writer{ out };
+            writer.Write(1 << 6, 7);
+            for (int c = 0; c < 4; ++c) {
+                writer.Write(static_cast<std::uint32_t>(bestEndpoints[0][c]), 7);
+                writer.Write(static_cast<std::uint32_t>(bestEndpoints[1][c]), 7);
+            }
+            writer.Write(static_cast<std::uint32_t>(bestPBits[0]), 1);
+            writer.Write(static_cast<std::uint32_t>(bestPBits[1]), 1);
+            writer.Write(bestIndices[0], 3);
+            for (std::size_t i = 1; i < 16; ++i) writer.Write(bestIndices[i], 4);
+        }
+
+        void EncodeBlock(const Block& block, BlockCompression format, CompressionQuality quality, std::uint8_t* out)
+        {
+            switch (format) {
+            case BlockCompression::BC1: EncodeColorBlock(block, quality, out); break;
+            case BlockCompression::BC3:
+                EncodeSingleChannelBlock(block, 3, quality, out);
+                EncodeColorBlock(block, quality, out + 8);
+                break;
+            case BlockCompression::BC4: EncodeSingleChannelBlock(block, 0, quality, out); break;
+            case BlockCompression::BC5:
+                EncodeSingleChannelBlock(block, 0, quality, out);
+                EncodeSingleChannelBlock(block, 1, quality, out + 8);
+                break;
+            case BlockCompression::BC7: EncodeBC7Block(block, quality, out); break;
+            }
+        }
+
+        constexpr std::uint32_t MakeFourCC(char c0, char c1, char c2, char c3)
+        {
+            return static_cast<std::uint32_t>(c0) | (static_cast<std::uint32_t>(c1) << 8) | (static_cast<std::uint32_t>(c2) << 16) | (static_cast<std::uint32_t>(c3) << 24);
+        }
+
+        /** The magic number at the start of each DDS file. */
+        constexpr std::uint32_t DDS_MAGIC = MakeFourCC('D', 'D', 'S', ' ');
+        constexpr std::uint32_t DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PIXELFORMAT = 0x1000;
+        constexpr std::uint32_t DDSD_MIPMAPCOUNT = 0x20000, DDSD_LINEARSIZE = 0x80000;
+        constexpr std::uint32_t DDPF_FOURCC = 0x4;
+        constexpr std::uint32_t DDSCAPS_COMPLEX = 0x8, DDSCAPS_TEXTURE = 0x1000, DDSCAPS_MIPMAP = 0x400000;
+        constexpr std::uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+        /** The pixel format part of the DDS header. */
+        struct DDSPixelFormat
+        {
+            std::uint32_t size_, flags_, fourCC_, rgbBitCount_, rBitMask_, gBitMask_, bBitMask_, aBitMask_;
+        };
+
+        /** The DDS file header. */
+        struct DDSHeader
+        {
+            std::uint32_t size_, flags_, height_, width_, pitchOrLinearSize_, depth_, mipMapCount_;
+            std::uint32_t reserved1_[11];
+            DDSPixelFormat pixelFormat_;
+            std::uint32_t caps_, caps2_, caps3_, caps4_, reserved2_;
+        };
+
+        /** The DX10 extension of the DDS header. */
+        struct DDSHeaderDX10
+        {
+            std::uint32_t dxgiFormat_, resourceDimension_, miscFlag_, arraySize_, miscFlags2_;
+        };
+
+        static_assert(sizeof(DDSHeader) == 124, "The DDS header needs to be 124 bytes.");
+
+        /** Maps the DXGI formats to the supported compression formats. */
+        struct DXGIFormatMapping
+        {
+            std::uint32_t dxgiFormat_;
+            BlockCompression format_;
+            bool sRGB_;
+        };
+
+        constexpr std::array<DXGIFormatMapping, 9> DXGI_FORMATS = { {
+            { 71, BlockCompression::BC1, false }, { 72, BlockCompression::BC1, true },
+            { 77, BlockCompression::BC3, false }, { 78, BlockCompression::BC3, true },
+            { 80, BlockCompression::BC4, false }, { 83, BlockCompression::BC5, false },
+            { 98, BlockCompression::BC7, false }, { 99, BlockCompression::BC7, true },
+            // typeless BC1 is treated as unorm.
+            { 70, BlockCompression::BC1, false } } };
+    }
+
+    std::size_t GetBlockSize(BlockCompression format) noexcept
+    {
+        return format == BlockCompression::BC1 || format == BlockCompression::BC4 ? 8 : 16;
+    }
+
+    std::size_t GetCompressedSize(BlockCompression format, unsigned int width, unsigned int height) noexcept
+    {
+        return static_cast<std::size_t>(std::max((width + 3) / 4, 1U)) * std::max((height + 3) / 4, 1U) * GetBlockSize(format);
+    }
+
+    GLenum GetCompressedInternalFormat(BlockCompression format, bool sRGB) noexcept
+    {
+        switch (format) {
+        case BlockCompression::BC1: return sRGB ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        case BlockCompression::BC3: return sRGB ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BlockCompression::BC4: return GL_COMPRESSED_RED_RGTC1;
+        case BlockCompression::BC5: return GL_COMPRESSED_RG_RGTC2;
+        case BlockCompression::BC7: return sRGB ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+        }
+        return GL_NONE;
+    }
+
+    bool IsCompressedFormatSupported(BlockCompression format)
+    {
+        switch (format) {
+        case BlockCompression::BC1:
+        case BlockCompression::BC3: return GLEW_EXT_texture_compression_s3tc != 0;
+        case BlockCompression::BC4:
+        case BlockCompression::BC5: return IsOpenGLVersionSupported(3, 0) || GLEW_ARB_texture_compression_rgtc != 0;
+        case BlockCompression::BC7: return IsOpenGLVersionSupported(4, 2) || GLEW_ARB_texture_compression_bptc != 0;
+        }
+        return false;
+    }
+
+    std::vector<std::uint8_t> CompressImage(const std::uint8_t* rgba, unsigned int width, unsigned int height, BlockCompression format,
+        CompressionQuality quality, ThreadPool* threadPool)
+    {
+        auto& pool = threadPool != nullptr ? *threadPool : ThreadPool::GetDefault();
+        auto blocksX = std::max((width + 3) / 4, 1U);
+        auto blocksY = std::max((height + 3) / 4, 1U);
+        auto blockSize = GetBlockSize(format);
+
+        std::vector<std::uint8_t> result(GetCompressedSize(format, width, height));
+        pool.ParallelFor(0, blocksY, [&](std::size_t rowBegin, std::size_t rowEnd) {
+            Block block;
+            for (auto by = rowBegin; by < rowEnd; ++by) {
+                for (unsigned int bx = 0; bx < blocksX; ++bx) {
+                    LoadBlock(rgba, width, height, bx, static_cast<unsigned int>(by), block);
+                    EncodeBlock(block, format, quality, result.data() + (by * blocksX + bx) * blockSize);
+                }
+            }
+        }, MIN_BLOCK_ROWS_PER_TASK);
+        return result;
+    }
+
+    std::optional<CompressedImage> ReadDDS(const std::string& filename)
+    {
+        std::ifstream ifs{ filename, std::ios::binary };
+        if (!ifs.is_open()) return std::nullopt;
+
+        std::uint32_t magic = 0;
+        DDSHeader header;
+        ifs.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+        ifs.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!ifs || magic != DDS_MAGIC || header.size_ != sizeof(DDSHeader) || (header.pixelFormat_.flags_ & DDPF_FOURCC) == 0) {
+            spdlog::warn("Unsupported DDS file ({}).", filename);
+            return std::nullopt;
+        }
+
+        CompressedImage image;
+        auto fourCC = header.pixelFormat_.fourCC_;
+        if (fourCC == MakeFourCC('D', 'X', '1', '0')) {
+            DDSHeaderDX10 headerDX10;
+            ifs.read(reinterpret_cast<char*>(&headerDX10), sizeof(headerDX10));
+            auto mapping = std::find_if(DXGI_FORMATS.begin(), DXGI_FORMATS.end(),
+                [&headerDX10](const DXGIFormatMapping& m) { return m.dxgiFormat_ == headerDX10.dxgiFormat_; });
+            if (!ifs || mapping == DXGI_FORMATS.end() || headerDX10.resourceDimension_ != DDS_DIMENSION_TEXTURE2D) {
+                spdlog::warn("Unsupported DDS format ({}).", filename);
+                return std::nullopt;
+            }
+            image.format_ = mapping->format_;
+            image.sRGB_ = mapping->sRGB_;
+        }
+        else if (fourCC == MakeFourCC('D', 'X', 'T', '1')) image.format_ = BlockCompression::BC1;
+        else if (fourCC == MakeFourCC('D', 'X', 'T', '5')) image.format_ = BlockCompression::BC3;
+        else if (fourCC == MakeFourCC('A', 'T', 'I', '1') || fourCC == MakeFourCC('B', 'C', '4', 'U')) image.format_ = BlockCompression::BC4;
+        else if (fourCC == MakeFourCC('A', 'T', 'I', '2') || fourCC == MakeFourCC('B', 'C', '5', 'U')) image.format_ = BlockCompression::BC5;
+        else {
+            spdlog::warn("Unsupported DDS format ({}).", filename);
+            return std::nullopt;
+        }
+
+        if (header.width_ == 0 || header.height_ == 0) {
+            spdlog::warn("DDS file has no size ({}).", filename);
+            return std::nullopt;
+        }
+
+        // the header is not trusted: the mip count is limited to a full chain and no level may be larger than the rest of the file.
+        auto maxLevels = 1U;
+        for (auto size = std::max(header.width_, header.height_); size > 1; size /= 2) ++maxLevels;
+        auto numLevels = (header.flags_ & DDSD_MIPMAPCOUNT) != 0 ? std::clamp(header.mipMapCount_, 1U, maxLevels) : 1U;
+
+        auto dataStart = ifs.tellg();
+        ifs.seekg(0, std::ios::end);
+        auto remainingSize = static_cast<std::size_t>(ifs.tellg() - dataStart);
+        ifs.seekg(dataStart);
+
+        auto width = header.width_;
+        auto height = header.height_;
+        image.levels_.resize(numLevels);
+        for (auto& level : image.levels_) {
+            auto levelSize = GetCompressedSize(image.format_, width, height);
+            if (levelSize > remainingSize) {
+                spdlog::warn("DDS file is truncated ({}).", filename);
+                return std::nullopt;
+            }
+            remainingSize -= levelSize;
+
+            level.width_ = width;
+            level.height_ = height;
+            level.data_.resize(levelSize);
+            ifs.read(reinterpret_cast<char*>(level.data_.data()), static_cast<std::streamsize>(level.data_.size()));
+            width = std::max(width / 2, 1U);
+            height = std::max(height / 2, 1U);
+        }
+
+        if (!ifs) {
+            spdlog::warn("DDS file is truncated ({}).", filename);
+            return std::nullopt;
+        }
+        return image;
+    }
+
+    bool WriteDDS(const std::string& filename, const CompressedImage& image)
+    {
+        if (image.levels_.empty()) return false;
+
+        auto mapping = std::find_if(DXGI_FORMATS.begin(), DXGI_FORMATS.end(),
+            [&image](const DXGIFormatMapping& m) { return m.format_ == image.format_ && m.sRGB_ == image.sRGB_; });
+        if (mapping == DXGI_FORMATS.end()) mapping = std::find_if(DXGI_FORMATS.begin(), DXGI_FORMATS.end(),
+            [&image](const DXGIFormatMapping& m) { return m.format_ == image.format_; });
+
+        DDSHeader header{};
+        header.size_ = sizeof(DDSHeader);
+        header.flags_ = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE;
+        header.height_ = image.levels_[0].height_;
+        header.width_ = image.levels_[0].width_;
+        header.pitchOrLinearSize_ = static_cast<std::uint32_t>(image.levels_[0].data_.size());
+        header.mipMapCount_ = static_cast<std::uint32_t>(image.levels_.size());
+        header.pixelFormat_.size_ = sizeof(DDSPixelFormat);
+        header.pixelFormat_.flags_ = DDPF_FOURCC;
+        header.pixelFormat_.fourCC_ = MakeFourCC('D', 'X', '1', '0');
+        header.caps_ = DDSCAPS_TEXTURE;
+        if (image.levels_.size() > 1) {
+            header.flags_ |= DDSD_MIPMAPCOUNT;
+            header.caps_ |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+        }
+
+        DDSHeaderDX10 headerDX10{};
+        headerDX10.dxgiFormat_ = mapping->dxgiFormat_;
+        headerDX10.resourceDimension_ = DDS_DIMENSION_TEXTURE2D;
+        headerDX10.arraySize_ = 1;
+
+        std::ofstream ofs{ filename, std::ios::binary };
+        if (!ofs.is_open()) {
+            spdlog::warn("Could not open DDS file for writing ({}).", filename);
+            return false;
+        }
+        ofs.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        ofs.write(reinterpret_cast<const char*>(&headerDX10), sizeof(headerDX10));
+        for (const auto& level : image.levels_) ofs.write(reinterpret_cast<const char*>(level.data_.data()), static_cast<std::streamsize>(level.data_.size()));
+        return static_cast<bool>(ofs);
+    }
+
+    std::string GetCompressedCacheFilename(const std::string& filename, bool flipTexture)
+    {
+        return filename + (flipTexture ? ".flipped.dds" : ".dds");
+    }
+
+    TextureCompressor::TextureCompressor() :
+        backgroundThread_{ 1 }
+    {
+    }
+
+    std::future<bool> TextureCompressor::CompressAsync(const std::string& filename, BlockCompression format, CompressionQuality quality,
+        bool useSRGB, bool flipTexture, bool generateMipmaps)
+    {
+        auto result = std::make_shared<std::promise<bool>>();
+        auto future = result->get_future();
+
+        auto imgWidth = 0, imgHeight = 0, imgChannels = 0;
+        auto image = stbi_load(filename.c_str(), &imgWidth, &imgHeight, &imgChannels, 4);
+        if (!image) {
+            spdlog::warn("Failed to load texture for compression ({}).", filename);
+            result->set_value(false);
+            return future;
+        }
+        std::vector<std::uint8_t> rgba(image, image + static_cast<std::size_t>(imgWidth) * imgHeight * 4);
+        stbi_image_free(image);
+        if (flipTexture) utils::flipImageVertically(rgba.data(), static_cast<std::size_t>(imgWidth) * 4, static_cast<std::size_t>(imgHeight));
+
+        backgroundThread_.Enqueue([result, filename, format, quality, useSRGB, flipTexture, generateMipmaps,
+            rgba = std::move(rgba), width = static_cast<unsigned int>(imgWidth), height = static_cast<unsigned int>(imgHeight)]() {
+            CompressedImage compressed;
+            compressed.format_ = format;
+            compressed.sRGB_ = useSRGB && (format == BlockCompression::BC1 || format == BlockCompression::BC3 || format == BlockCompression::BC7);
+            compressed.levels_.push_back(MipLevel{ width, height, CompressImage(rgba.data(), width, height, format, quality) });
+            if (generateMipmaps) {
+                for (const auto& level : GenerateMipLevels(rgba.data(), width, height, 4, false, compressed.sRGB_)) {
+                    compressed.levels_.push_back(MipLevel{ level.width_, level.height_, CompressImage(level.data_.data(), level.width_, level.height_, format, quality) });
+                }
+            }
+
+            // the file is written under a temporary name, so textures never load a partially written cache.
+            auto cacheFilename = GetCompressedCacheFilename(filename, flipTexture);
+            auto tmpFilename = cacheFilename + ".tmp";
+            auto success = WriteDDS(tmpFilename, compressed);
+            if (success) {
+                std::error_code ec;
+                std::filesystem::rename(tmpFilename, cacheFilename, ec);
+                success = !ec;
+            }
+            if (!success) spdlog::warn("Failed to write compressed texture ({}).", cacheFilename);
+            result->set_value(success);
+        });
+        return future;
+    }
+}
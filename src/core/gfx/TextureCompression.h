@@ -0,0 +1,142 @@
+/**
+ * @file   TextureCompression.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.21
+ *
+ * @brief  Declaration of block compression encoders, DDS containers and a background texture compressor.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "core/open_gl_fwd.h"
+#include "core/gfx/MipmapGenerator.h"
+#include "core/utils/ThreadPool.h"
+#include <future>
+#include <optional>
+
+namespace viscom {
+
+    /** The supported block compression formats. */
+    enum class BlockCompression
+    {
+        /** RGB with 1 bit alpha, 8 bytes per block. */
+        BC1,
+        /** RGBA with interpolated alpha, 16 bytes per block. */
+        BC3,
+        /** Single channel, 8 bytes per block. */
+        BC4,
+        /** Two channels (e.g. normal maps), 16 bytes per block. */
+        BC5,
+        /** High quality RGBA, 16 bytes per block (needs OpenGL 4.2 or ARB_texture_compression_bptc). */
+        BC7
+    };
+
+    /** The quality presets of the block compression encoders. */
+    enum class CompressionQuality
+    {
+        /** Endpoints at the extremes along an approximate principal axis of each block. */
+        Fast,
+        /** Endpoints along the principal axis of each block, refined with least squares and an endpoint search. */
+        High
+    };
+
+    /** A block compressed image with all of its mip levels. */
+    struct CompressedImage
+    {
+        /** The compression format. */
+        BlockCompression format_ = BlockCompression::BC1;
+        /** Whether the color channels are sRGB encoded. */
+        bool sRGB_ = false;
+        /** The levels starting with the base level, each holding the compressed blocks. */
+        std::vector<MipLevel> levels_;
+    };
+
+    /**
+     *  Returns the size of a compressed block in bytes.
+     *  @param format the compression format.
+     */
+    std::size_t GetBlockSize(BlockCompression format) noexcept;
+    /**
+     *  Returns the size of an image in bytes after compression.
+     *  @param format the compression format.
+     *  @param width the width of the image.
+     *  @param height the height of the image.
+     */
+    std::size_t GetCompressedSize(BlockCompression format, unsigned int width, unsigned int height) noexcept;
+    /**
+     *  Returns the OpenGL internal format of a compression format.
+     *  @param format the compression format.
+     *  @param sRGB whether to use the sRGB variant (if one exists).
+     */
+    GLenum GetCompressedInternalFormat(BlockCompression format, bool sRGB) noexcept;
+    /**
+     *  Checks if the current OpenGL context can sample a compression format.
+     *  @param format the compression format.
+     */
+    bool IsCompressedFormatSupported(BlockCompression format);
+
+    /**
+     *  Compresses an RGBA8 image, rows of blocks are distributed over a thread pool.
+     *  Images whose size is not a multiple of 4 repeat their last row and column in the border blocks.
+     *  @param rgba the pixel data (4 bytes per pixel, tightly packed).
+     *  @param width the width of the image.
+     *  @param height the height of the image.
+     *  @param format the compression format.
+     *  @param quality the quality preset.
+     *  @param threadPool the thread pool to use (nullptr uses the default pool).
+     *  @return the compressed blocks in row major block order.
+     */
+    std::vector<std::uint8_t> CompressImage(const std::uint8_t* rgba, unsigned int width, unsigned int height, BlockCompression format,
+        CompressionQuality quality, ThreadPool* threadPool = nullptr);
+
+    /**
+     *  Reads a block compressed image from a DDS file (DX10 or legacy DXT1/DXT5/ATI1/ATI2 headers).
+     *  @param filename the DDS file.
+     *  @return the image or an empty optional if the file does not exist or has an unsupported format.
+     */
+    std::optional<CompressedImage> ReadDDS(const std::string& filename);
+    /**
+     *  Writes a block compressed image to a DDS file with a DX10 header.
+     *  @param filename the DDS file.
+     *  @param image the image to write.
+     */
+    bool WriteDDS(const std::string& filename, const CompressedImage& image);
+
+    /**
+     *  Returns the filename of the compressed cache file for a texture.
+     *  The orientation is part of the name as the blocks are stored in the order they are uploaded.
+     *  @param filename the texture file.
+     *  @param flipTexture whether the texture is flipped on load.
+     */
+    std::string GetCompressedCacheFilename(const std::string& filename, bool flipTexture);
+
+    /**
+     *  Encodes textures into block compressed DDS cache files on a background thread.
+     *  Texture loads the cache file instead of the source image if it is newer than the source.
+     */
+    class TextureCompressor final
+    {
+    public:
+        /** Constructor, starts the background thread. */
+        TextureCompressor();
+
+        /**
+         *  Loads an image and encodes it in the background into its compressed cache file (see GetCompressedCacheFilename).
+         *  The image is decoded on the calling thread, only the encoding runs in the background.
+         *  @param filename the texture file.
+         *  @param format the compression format.
+         *  @param quality the quality preset.
+         *  @param useSRGB whether the texture is sRGB encoded.
+         *  @param flipTexture whether the texture is flipped on load.
+         *  @param generateMipmaps whether mip levels are generated and compressed as well.
+         *  @return a future that becomes true when the cache file was written.
+         */
+        std::future<bool> CompressAsync(const std::string& filename, BlockCompression format, CompressionQuality quality = CompressionQuality::High,
+            bool useSRGB = true, bool flipTexture = true, bool generateMipmaps = true);
+
+    private:
+        /** Holds the background thread (block rows are still encoded on the default pool). */
+        ThreadPool backgroundThread_;
+    };
+}
@@ -0,0 +1,329 @@
+/**
+ * @file   TexturePacker.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.25
+ *
+ * @brief  Implementation of packing material textures into texture arrays and atlases.
+ */
+
+#include "TexturePacker.h"
+#include "core/open_gl.h"
+#include "OpenGLCapabilities.h"
+#include "Texture.h"
+#include "core/gfx/mesh/Mesh.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+namespace viscom {
+
+    SkylinePacker::SkylinePacker(unsigned int width, unsigned int height) :
+        width_{ width },
+        height_{ height },
+        skyline_{ Segment{ 0, 0, width } }
+    {
+    }
+
+    std::optional<glm::uvec2> SkylinePacker::Insert(unsigned int width, unsigned int height)
+    {
+        // the lowest position wins, ties are broken by the narrowest segment to keep wide segments for wide rectangles.
+        auto bestIndex = skyline_.size();
+        auto bestY = height_;
+        auto bestWidth = width_ + 1;
+        for (std::size_t i = 0; i < skyline_.size(); ++i) {
+            if (skyline_[i].x_ + width > width_) break;
+
+            unsigned int y = 0;
+            auto remaining = static_cast<int>(width);
+            for (auto j = i; remaining > 0; ++j) {
+                y = std::max(y, skyline_[j].y_);
+                remaining -= static_cast<int>(skyline_[j].width_);
+            }
+            if (y + height > height_) continue;
+            if (y < bestY || (y == bestY && skyline_[i].width_ < bestWidth)) {
+                bestIndex = i;
+                bestY = y;
+                bestWidth = skyline_[i].width_;
+            }
+        }
+        if (bestIndex == skyline_.size()) return std::nullopt;
+
+        auto x = skyline_[bestIndex].x_;
+        skyline_.insert(skyline_.begin() + static_cast<std::ptrdiff_t>(bestIndex), Segment{ x, bestY + height, width });
+        // the segments below the new one are shortened or removed.
+        for (auto i = bestIndex + 1; i < skyline_.size();) {
+            auto previousEnd = skyline_[i - 1].x_ + skyline_[i - 1].width_;
+            if (skyline_[i].x_ >= previousEnd) break;
+            auto shrink = previousEnd - skyline_[i].x_;
+            if (skyline_[i].width_ <= shrink) {
+                skyline_.erase(skyline_.begin() + static_cast<std::ptrdiff_t>(i));
+                continue;
+            }
+            skyline_[i].x_ += shrink;
+            skyline_[i].width_ -= shrink;
+            break;
+        }
+        for (std::size_t i = 1; i < skyline_.size();) {
+            if (skyline_[i - 1].y_ == skyline_[i].y_) {
+                skyline_[i - 1].width_ += skyline_[i].width_;
+                skyline_.erase(skyline_.begin() + static_cast<std::ptrdiff_t>(i));
+            }
+            else ++i;
+        }
+        return glm::uvec2{ x, bestY };
+    }
+
+    TexturePacker::TexturePacker(unsigned int atlasSize, unsigned int border) :
+        atlasSize_{ atlasSize },
+        border_{ border }
+    {
+    }
+
+    TexturePacker::~TexturePacker()
+    {
+        if (!textureArrays_.empty()) glDeleteTextures(static_cast<GLsizei>(textureArrays_.size()), textureArrays_.data());
+    }
+
+    void TexturePacker::AddMesh(Mesh* mesh)
+    {
+        meshes_.push_back(mesh);
+        for (std::size_t i = 0; i < mesh->GetNumMaterials(); ++i) {
+            const auto* matTex = mesh->GetMaterialTexture(i);
+            for (const auto& texture : { matTex->diffuseTex, matTex->bumpTex }) {
+                if (texture && std::find(textures_.begin(), textures_.end(), texture) == textures_.end()) textures_.push_back(texture);
+            }
+        }
+    }
+
+    void TexturePacker::Pack()
+    {
+        // textures of the same format and size share an array.
+        std::map<std::tuple<GLint, unsigned int, unsigned int>, std::vector<std::shared_ptr<const Texture>>> sameSizeGroups;
+        for (const auto& texture : textures_) {
+            if (references_.find(texture.get()) != references_.end()) continue;
+            auto dimensions = texture->getDimensions();
+            sameSizeGroups[std::make_tuple(texture->getDescriptor().internalFormat_, dimensions.x, dimensions.y)].push_back(texture);
+        }
+
+        std::map<GLint, std::vector<SourceTexture>> atlasGroups;
+        for (const auto& group : sameSizeGroups) {
+            if (group.second.size() == 1 && !group.second[0]->IsCompressed()) {
+                atlasGroups[std::get<0>(group.first)].push_back(ReadTexture(group.second[0]));
+                continue;
+            }
+
+            std::vector<SourceTexture> sources;
+            for (const auto& texture : group.second) sources.push_back(ReadTexture(texture));
+            CreateTextureArray(sources);
+        }
+        for (auto& group : atlasGroups) {
+            auto unpacked = CreateAtlasArray(std::move(group.second));
+            for (auto& texture : unpacked) CreateTextureArray({ std::move(texture) });
+        }
+
+        for (auto mesh : meshes_) {
+            for (std::size_t i = 0; i < mesh->GetNumMaterials(); ++i) {
+                auto matTex = mesh->GetMaterialTexture(i);
+                if (matTex->diffuseTex) matTex->diffusePacked = GetReference(matTex->diffuseTex.get());
+                if (matTex->bumpTex) matTex->bumpPacked = GetReference(matTex->bumpTex.get());
+            }
+            mesh->UpdateMaterialTextureBuffer();
+        }
+
+        spdlog::info("Packed {} textures into {} texture arrays and {} atlas arrays with {} pages.", statistics_.packedTextures_,
+            statistics_.textureArrays_, statistics_.atlasArrays_, statistics_.atlasPages_);
+    }
+
+    PackedTextureReference TexturePacker::GetReference(const Texture* texture) const
+    {
+        auto it = references_.find(texture);
+        return it != references_.end() ? it->second : PackedTextureReference{};
+    }
+
+    TexturePacker::SourceTexture TexturePacker::ReadTexture(const std::shared_ptr<const Texture>& texture)
+    {
+        SourceTexture source;
+        source.texture_ = texture;
+        glBindTexture(GL_TEXTURE_2D, texture->getTextureId());
+
+        GLint maxLevel = 0;
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+        for (; static_cast<GLint>(source.numLevels_) <= maxLevel; ++source.numLevels_) {
+            GLint levelWidth = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, static_cast<GLint>(source.numLevels_), GL_TEXTURE_WIDTH, &levelWidth);
+            if (levelWidth == 0) break;
+        }
+
+        // uncompressed textures generate their mip maps again, compressed ones need all levels.
+        const auto& descriptor = texture->getDescriptor();
+        auto dimensions = texture->getDimensions();
+        source.levels_.resize(texture->IsCompressed() ? source.numLevels_ : 1);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        for (std::size_t l = 0; l < source.levels_.size(); ++l) {
+            if (texture->IsCompressed()) {
+                GLint levelSize = 0;
+                glGetTexLevelParameteriv(GL_TEXTURE_2D, static_cast<GLint>(l), GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &levelSize);
+                source.levels_[l].resize(static_cast<std::size_t>(levelSize));
+                glGetCompressedTexImage(GL_TEXTURE_2D, static_cast<GLint>(l), source.levels_[l].data());
+            }
+            else {
+                source.levels_[l].resize(static_cast<std::size_t>(dimensions.x) * dimensions.y * descriptor.bytesPP_);
+                glGetTexImage(GL_TEXTURE_2D, static_cast<GLint>(l), descriptor.format_, descriptor.type_, source.levels_[l].data());
+            }
+        }
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return source;
+    }
+
+    void TexturePacker::CreateTextureArray(const std::vector<SourceTexture>& textures)
+    {
+        const auto& first = *textures[0].texture_;
+        const auto& descriptor = first.getDescriptor();
+        auto dimensions = first.getDimensions();
+        auto numLayers = static_cast<GLsizei>(textures.size());
+        auto numLevels = std::min_element(textures.begin(), textures.end(), [](const SourceTexture& lhs, const SourceTexture& rhs) {
+            return lhs.numLevels_ < rhs.numLevels_; })->numLevels_;
+        auto maxAnisotropy = 1.0f;
+        for (const auto& texture : textures) maxAnisotropy = std::max(maxAnisotropy, texture.texture_->GetOptions().maxAnisotropy_);
+
+        GLuint textureArray = 0;
+        glGenTextures(1, &textureArray);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        if (first.IsCompressed()) {
+            for (unsigned int l = 0; l < numLevels; ++l) {
+                auto levelWidth = static_cast<GLsizei>(std::max(dimensions.x >> l, 1U));
+                auto levelHeight = static_cast<GLsizei>(std::max(dimensions.y >> l, 1U));
+                auto levelSize = static_cast<GLsizei>(textures[0].levels_[l].size());
+                glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(l), static_cast<GLenum>(descriptor.internalFormat_), levelWidth, levelHeight,
+                    numLayers, 0, levelSize * numLayers, nullptr);
+                for (GLsizei layer = 0; layer < numLayers; ++layer) {
+                    glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(l), 0, 0, layer, levelWidth, levelHeight, 1,
+                        static_cast<GLenum>(descriptor.internalFormat_), levelSize, textures[static_cast<std::size_t>(layer)].levels_[l].data());
+                }
+            }
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(numLevels - 1));
+        }
+        else {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, descriptor.internalFormat_, static_cast<GLsizei>(dimensions.x), static_cast<GLsizei>(dimensions.y),
+                numLayers, 0, descriptor.format_, descriptor.type_, nullptr);
+            for (GLsizei layer = 0; layer < numLayers; ++layer) {
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, static_cast<GLsizei>(dimensions.x), static_cast<GLsizei>(dimensions.y), 1,
+                    descriptor.format_, descriptor.type_, textures[static_cast<std::size_t>(layer)].levels_[0].data());
+            }
+            if (numLevels > 1) glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, numLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        if (maxAnisotropy > 1.0f && GetMaxTextureAnisotropy() > 1.0f) {
+            glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::min(maxAnisotropy, GetMaxTextureAnisotropy()));
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        textureArrays_.push_back(textureArray);
+        for (std::size_t layer = 0; layer < textures.size(); ++layer) {
+            references_[textures[layer].texture_.get()] = PackedTextureReference{ textureArray, static_cast<unsigned int>(layer), glm::vec4{ 1.0f, 1.0f, 0.0f, 0.0f } };
+        }
+        statistics_.packedTextures_ += textures.size();
+        statistics_.textureArrays_ += 1;
+    }
+
+    std::vector<TexturePacker::SourceTexture> TexturePacker::CreateAtlasArray(std::vector<SourceTexture> textures)
+    {
+        // texture borders stay aligned to texels down to the last mip level, which still has a border of one texel.
+        unsigned int alignment = 1;
+        while (alignment * 2 <= border_) alignment *= 2;
+        auto alignSize = [alignment](unsigned int size) { return (size + alignment - 1) / alignment * alignment; };
+
+        std::sort(textures.begin(), textures.end(), [](const SourceTexture& lhs, const SourceTexture& rhs) {
+            return lhs.texture_->getDimensions().y > rhs.texture_->getDimensions().y; });
+
+        const auto& descriptor = textures[0].texture_->getDescriptor();
+        auto bytesPP = static_cast<std::size_t>(descriptor.bytesPP_);
+        std::vector<SourceTexture> unpacked;
+        std::vector<SkylinePacker> pages;
+        std::vector<std::vector<std::uint8_t>> pageData;
+        std::vector<std::pair<const Texture*, glm::uvec3>> placements;
+        auto hasMipmaps = false;
+        auto maxAnisotropy = 1.0f;
+        for (auto& texture : textures) {
+            auto dimensions = texture.texture_->getDimensions();
+            auto paddedSize = glm::uvec2{ alignSize(dimensions.x + 2 * border_), alignSize(dimensions.y + 2 * border_) };
+            if (paddedSize.x > atlasSize_ || paddedSize.y > atlasSize_) {
+                unpacked.emplace_back(std::move(texture));
+                continue;
+            }
+
+            std::optional<glm::uvec2> position;
+            std::size_t page = 0;
+            for (; page < pages.size() && !position.has_value(); ++page) position = pages[page].Insert(paddedSize.x, paddedSize.y);
+            if (position.has_value()) --page;
+            else {
+                pages.emplace_back(atlasSize_, atlasSize_);
+                pageData.emplace_back(static_cast<std::size_t>(atlasSize_) * atlasSize_ * bytesPP, 0);
+                position = pages.back().Insert(paddedSize.x, paddedSize.y);
+            }
+
+            // the border repeats the edges of the texture, like clamping does.
+            const auto& pixels = texture.levels_[0];
+            auto& atlas = pageData[page];
+            for (unsigned int py = 0; py < paddedSize.y; ++py) {
+                auto sy = static_cast<std::size_t>(std::clamp(static_cast<int>(py) - static_cast<int>(border_), 0, static_cast<int>(dimensions.y) - 1));
+                auto srcRow = &pixels[sy * dimensions.x * bytesPP];
+                auto dstRow = &atlas[((static_cast<std::size_t>(position->y) + py) * atlasSize_ + position->x) * bytesPP];
+                for (unsigned int px = 0; px < paddedSize.x; ++px) {
+                    auto sx = static_cast<std::size_t>(std::clamp(static_cast<int>(px) - static_cast<int>(border_), 0, static_cast<int>(dimensions.x) - 1));
+                    memcpy(&dstRow[px * bytesPP], &srcRow[sx * bytesPP], bytesPP);
+                }
+            }
+            placements.emplace_back(texture.texture_.get(), glm::uvec3{ *position + glm::uvec2{ border_ }, static_cast<unsigned int>(page) });
+            hasMipmaps = hasMipmaps || texture.numLevels_ > 1;
+            maxAnisotropy = std::max(maxAnisotropy, texture.texture_->GetOptions().maxAnisotropy_);
+        }
+        if (pages.empty()) return unpacked;
+
+        GLuint textureArray = 0;
+        auto numLevels = 1;
+        while ((1U << numLevels) <= alignment) ++numLevels;
+        glGenTextures(1, &textureArray);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, descriptor.internalFormat_, static_cast<GLsizei>(atlasSize_), static_cast<GLsizei>(atlasSize_),
+            static_cast<GLsizei>(pages.size()), 0, descriptor.format_, descriptor.type_, nullptr);
+        for (std::size_t page = 0; page < pages.size(); ++page) {
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<GLint>(page), static_cast<GLsizei>(atlasSize_), static_cast<GLsizei>(atlasSize_), 1,
+                descriptor.format_, descriptor.type_, pageData[page].data());
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        if (hasMipmaps && numLevels > 1) {
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, numLevels - 1);
+            glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        }
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, hasMipmaps && numLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        if (maxAnisotropy > 1.0f && GetMaxTextureAnisotropy() > 1.0f) {
+            glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::min(maxAnisotropy, GetMaxTextureAnisotropy()));
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        textureArrays_.push_back(textureArray);
+        auto atlasScale = 1.0f / static_cast<float>(atlasSize_);
+        for (const auto& placement : placements) {
+            auto dimensions = placement.first->getDimensions();
+            references_[placement.first] = PackedTextureReference{ textureArray, placement.second.z,
+                glm::vec4{ static_cast<float>(dimensions.x) * atlasScale, static_cast<float>(dimensions.y) * atlasScale,
+                    static_cast<float>(placement.second.x) * atlasScale, static_cast<float>(placement.second.y) * atlasScale } };
+        }
+        statistics_.packedTextures_ += placements.size();
+        statistics_.atlasArrays_ += 1;
+        statistics_.atlasPages_ += pages.size();
+        return unpacked;
+    }
+}
@@ -0,0 +1,161 @@
+/**
+ * @file   TexturePacker.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.25
+ *
+ * @brief  Declaration of packing material textures into texture arrays and atlases.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "core/open_gl_fwd.h"
+#include "core/gfx/Material.h"
+#include <optional>
+#include <unordered_map>
+
+namespace viscom {
+
+    class Mesh;
+    class Texture;
+
+    /**
+     *  Packs rectangles into a fixed size area using the skyline bottom left heuristic.
+     *  Does not need OpenGL.
+     */
+    class SkylinePacker final
+    {
+    public:
+        /**
+         *  Constructor.
+         *  @param width the width of the area.
+         *  @param height the height of the area.
+         */
+        SkylinePacker(unsigned int width, unsigned int height);
+
+        /**
+         *  Finds a place for a rectangle.
+         *  @param width the width of the rectangle.
+         *  @param height the height of the rectangle.
+         *  @return the lower left corner of the rectangle or an empty optional if it does not fit.
+         */
+        std::optional<glm::uvec2> Insert(unsigned int width, unsigned int height);
+
+    private:
+        /** A horizontal segment of the skyline. */
+        struct Segment
+        {
+            /** The left end of the segment. */
+            unsigned int x_;
+            /** The height of the skyline along the segment. */
+            unsigned int y_;
+            /** The width of the segment. */
+            unsigned int width_;
+        };
+
+        /** Holds the width of the area. */
+        unsigned int width_;
+        /** Holds the height of the area. */
+        unsigned int height_;
+        /** Holds the skyline segments from left to right. */
+        std::vector<Segment> skyline_;
+    };
+
+    /** Counters of the texture packer. */
+    struct TexturePackingStatistics
+    {
+        /** The number of textures packed. */
+        std::size_t packedTextures_ = 0;
+        /** The number of texture arrays holding same size textures. */
+        std::size_t textureArrays_ = 0;
+        /** The number of texture arrays holding atlas pages. */
+        std::size_t atlasArrays_ = 0;
+        /** The number of atlas pages. */
+        std::size_t atlasPages_ = 0;
+    };
+
+    /**
+     *  Packs the diffuse and bump textures of meshes into texture arrays, so draws of different materials do not need
+     *  texture binds and can be batched. Textures with the same format and size share an array with one layer each,
+     *  other uncompressed textures are packed into the pages of an atlas array per format (with a border repeating
+     *  their edges, mip maps are limited so the borders do not bleed). All other textures get an array of their own.
+     *  The material textures of the meshes are rewritten to reference the arrays, shaders sample them with the
+     *  functions in packedTextures.glsl. The arrays are owned by the packer, so it needs to live as long as the meshes
+     *  are drawn. Texture contents are read back from the GPU, so this is meant for load time.
+     */
+    class TexturePacker final
+    {
+    public:
+        /**
+         *  Constructor.
+         *  @param atlasSize the size of the atlas pages.
+         *  @param border the border around each texture in an atlas (limits the mip levels to log2(border) + 1).
+         */
+        explicit TexturePacker(unsigned int atlasSize = 2048, unsigned int border = 8);
+        TexturePacker(const TexturePacker&) = delete;
+        TexturePacker& operator=(const TexturePacker&) = delete;
+        /** Destructor, deletes the texture arrays. */
+        ~TexturePacker();
+
+        /**
+         *  Adds the textures of all materials of a mesh.
+         *  @param mesh the mesh whose material textures are rewritten by Pack.
+         */
+        void AddMesh(Mesh* mesh);
+        /** Creates the texture arrays for all added textures and rewrites the material textures of the added meshes. */
+        void Pack();
+
+        /**
+         *  Returns where a texture was packed.
+         *  @param texture the texture.
+         *  @return the reference or an empty reference if the texture was not packed.
+         */
+        PackedTextureReference GetReference(const Texture* texture) const;
+        /** Returns the statistics. */
+        const TexturePackingStatistics& GetStatistics() const noexcept { return statistics_; }
+
+    private:
+        /** A texture read back from the GPU. */
+        struct SourceTexture
+        {
+            /** The texture. */
+            std::shared_ptr<const Texture> texture_;
+            /** The levels (only the base level for uncompressed textures). */
+            std::vector<std::vector<std::uint8_t>> levels_;
+            /** The number of mip levels of the texture. */
+            unsigned int numLevels_ = 1;
+        };
+
+        /**
+         *  Reads a texture back from the GPU.
+         *  @param texture the texture.
+         */
+        static SourceTexture ReadTexture(const std::shared_ptr<const Texture>& texture);
+        /**
+         *  Creates an array with one layer per texture (all with the same format and size).
+         *  @param textures the textures.
+         */
+        void CreateTextureArray(const std::vector<SourceTexture>& textures);
+        /**
+         *  Packs textures with the same uncompressed format into the pages of an atlas array.
+         *  @param textures the textures.
+         *  @return the textures that are too large for a page.
+         */
+        std::vector<SourceTexture> CreateAtlasArray(std::vector<SourceTexture> textures);
+
+        /** Holds the size of the atlas pages. */
+        unsigned int atlasSize_;
+        /** Holds the border around each texture in an atlas. */
+        unsigned int border_;
+        /** Holds the meshes whose material textures are rewritten. */
+        std::vector<Mesh*> meshes_;
+        /** Holds the textures to pack. */
+        std::vector<std::shared_ptr<const Texture>> textures_;
+        /** Holds the references of the packed textures. */
+        std::unordered_map<const Texture*, PackedTextureReference> references_;
+        /** Holds the texture arrays. */
+        std::vector<GLuint> textureArrays_;
+        /** Holds the statistics. */
+        TexturePackingStatistics statistics_;
+    };
+}
@@ -0,0 +1,279 @@
+/**
+ * @file   TextureStreamer.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.23
+ *
+ * @brief  Implementation of asynchronous texture uploads through pixel buffer objects.
+ */
+
+#include "TextureStreamer.h"
+#include "OpenGLCapabilities.h"
+#include "core/open_gl.h"
+#include "core/utils/ThreadPool.h"
+
+#ifdef __APPLE_CC__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#endif
+#include <stb_image.h>
+#ifdef __APPLE_CC__
+#pragma clang diagnostic pop
+#endif
+
+#include <algorithm>
+#include <fstream>
+
+namespace viscom {
+
+    StreamedTexture::~StreamedTexture()
+    {
+        if (textureId_ != 0) glDeleteTextures(1, &textureId_);
+        textureId_ = 0;
+    }
+
+    TextureStreamer::UploadRequest::~UploadRequest()
+    {
+        if (pixels_ != nullptr) stbi_image_free(pixels_);
+        pixels_ = nullptr;
+    }
+
+    TextureStreamer::TextureStreamer(std::size_t stagingBufferSize, std::size_t numStagingBuffers, ThreadPool* threadPool) :
+        threadPool_{ threadPool != nullptr ? threadPool : &ThreadPool::GetDefault() },
+        stagingBufferSize_{ stagingBufferSize },
+        persistent_{ IsOpenGLVersionSupported(4, 4) }
+    {
+        for (std::size_t i = 0; i < numStagingBuffers; ++i) {
+            auto staging = std::make_unique<StagingBuffer>();
+            glGenBuffers(1, &staging->buffer_);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging->buffer_);
+            if (persistent_) {
+                constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+                glBufferStorage(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(stagingBufferSize_), nullptr, flags);
+                staging->data_ = static_cast<std::uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(stagingBufferSize_), flags));
+            }
+            else glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(stagingBufferSize_), nullptr, GL_STREAM_DRAW);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            MapStagingBuffer(*staging);
+            stagingBuffers_.emplace_back(std::move(staging));
+        }
+    }
+
+    TextureStreamer::~TextureStreamer()
+    {
+        for (auto& task : tasks_) task.wait();
+
+        for (auto& staging : stagingBuffers_) {
+            if (staging->fence_ != nullptr) glDeleteSync(staging->fence_);
+            if (staging->data_ != nullptr) {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging->buffer_);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            }
+            glDeleteBuffers(1, &staging->buffer_);
+        }
+    }
+
+    std::shared_ptr<StreamedTexture> TextureStreamer::LoadAsync(const std::string& filename, bool useSRGB, bool flipTexture, const TextureOptions& options)
+    {
+        auto request = std::make_shared<UploadRequest>();
+        request->texture_ = std::make_shared<StreamedTexture>(filename);
+        request->sRGB_ = useSRGB;
+        request->flip_ = flipTexture;
+        request->options_ = options;
+        requests_.push_back(request);
+
+        tasks_.emplace_back(threadPool_->Enqueue([request]() { DecodeImage(*request); }));
+        return request->texture_;
+    }
+
+    void TextureStreamer::Update(std::size_t maxUploadBytes)
+    {
+        RecycleStagingBuffers();
+        UploadFilledStagingBuffers();
+        FillStagingBuffers(maxUploadBytes);
+
+        for (auto& request : requests_) {
+            if (request->state_ == RequestState::Failed) request->texture_->state_ = StreamedTexture::State::Failed;
+        }
+        requests_.erase(std::remove_if(requests_.begin(), requests_.end(), [](const std::shared_ptr<UploadRequest>& request) {
+            return request->texture_->state_ != StreamedTexture::State::Loading;
+        }), requests_.end());
+        tasks_.erase(std::remove_if(tasks_.begin(), tasks_.end(), [](const std::future<void>& task) { return utils::is_ready(task); }), tasks_.end());
+    }
+
+    void TextureStreamer::DecodeImage(UploadRequest& request)
+    {
+        const auto& filename = request.texture_->GetFilename();
+        // the file is read once, all stb_image calls work on memory.
+        std::ifstream ifs{ filename, std::ios::binary | std::ios::ate };
+        std::vector<stbi_uc> fileData;
+        if (ifs.is_open()) {
+            fileData.resize(static_cast<std::size_t>(ifs.tellg()));
+            ifs.seekg(0);
+            ifs.read(reinterpret_cast<char*>(fileData.data()), static_cast<std::streamsize>(fileData.size()));
+        }
+
+        auto imgWidth = 0, imgHeight = 0, imgChannels = 0;
+        if (!ifs || fileData.empty() || stbi_info_from_memory(fileData.data(), static_cast<int>(fileData.size()), &imgWidth, &imgHeight, &imgChannels) == 0) {
+            spdlog::warn("Failed to load texture ({}).", filename);
+            request.state_ = RequestState::Failed;
+            return;
+        }
+
+        auto imgForceChannels = imgChannels == 3 ? 4 : 0;
+        request.isHDR_ = stbi_is_hdr_from_memory(fileData.data(), static_cast<int>(fileData.size())) != 0;
+        if (request.isHDR_) request.pixels_ = stbi_loadf_from_memory(fileData.data(), static_cast<int>(fileData.size()), &imgWidth, &imgHeight, &imgChannels, imgForceChannels);
+        else request.pixels_ = stbi_load_from_memory(fileData.data(), static_cast<int>(fileData.size()), &imgWidth, &imgHeight, &imgChannels, imgForceChannels);
+        if (request.pixels_ == nullptr) {
+            spdlog::warn("Failed to load texture ({}).", filename);
+            request.state_ = RequestState::Failed;
+            return;
+        }
+
+        request.width_ = static_cast<unsigned int>(imgWidth);
+        request.height_ = static_cast<unsigned int>(imgHeight);
+        request.channels_ = imgForceChannels != 0 ? imgForceChannels : imgChannels;
+        request.type_ = request.isHDR_ ? GL_FLOAT : GL_UNSIGNED_BYTE;
+        switch (request.channels_) {
+        case 1: request.internalFormat_ = request.isHDR_ ? GL_R32F : GL_R8; request.format_ = GL_RED; break;
+        case 2: request.internalFormat_ = request.isHDR_ ? GL_RG32F : GL_RG8; request.format_ = GL_RG; break;
+        default: request.internalFormat_ = request.isHDR_ ? GL_RGBA32F : (request.sRGB_ ? GL_SRGB8_ALPHA8 : GL_RGBA8); request.format_ = GL_RGBA; break;
+        }
+        request.state_ = RequestState::Decoded;
+    }
+
+    void TextureStreamer::MapStagingBuffer(StagingBuffer& staging) const
+    {
+        if (persistent_) return;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer_);
+        staging.data_ = static_cast<std::uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(stagingBufferSize_),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    void TextureStreamer::RecycleStagingBuffers()
+    {
+        for (auto& staging : stagingBuffers_) {
+            if (staging->state_ != StagingState::InFlight) continue;
+
+            auto waitResult = glClientWaitSync(staging->fence_, 0, 0);
+            if (waitResult != GL_ALREADY_SIGNALED && waitResult != GL_CONDITION_SATISFIED) continue;
+            glDeleteSync(staging->fence_);
+            staging->fence_ = nullptr;
+            MapStagingBuffer(*staging);
+            staging->state_ = StagingState::Free;
+        }
+    }
+
+    void TextureStreamer::UploadFilledStagingBuffers()
+    {
+        for (auto& staging : stagingBuffers_) {
+            if (staging->state_ != StagingState::Filled) continue;
+
+            UploadSlice(*staging);
+            auto request = std::move(staging->request_);
+            request->uploadedRows_ += staging->numRows_;
+            if (request->uploadedRows_ < request->height_) continue;
+
+            // all rows are copied and uploaded, so the texture is complete.
+            glBindTexture(GL_TEXTURE_2D, request->texture_->textureId_);
+            if (request->options_.mipmaps_ != TextureMipmaps::None) {
+                glGenerateMipmap(GL_TEXTURE_2D);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            }
+            if (request->options_.maxAnisotropy_ > 1.0f && GetMaxTextureAnisotropy() > 1.0f) {
+                glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::min(request->options_.maxAnisotropy_, GetMaxTextureAnisotropy()));
+            }
+            glBindTexture(GL_TEXTURE_2D, 0);
+
+            stbi_image_free(request->pixels_);
+            request->pixels_ = nullptr;
+            request->texture_->state_ = StreamedTexture::State::Ready;
+        }
+    }
+
+    void TextureStreamer::FillStagingBuffers(std::size_t maxUploadBytes)
+    {
+        std::size_t handedBytes = 0;
+        auto nextStaging = stagingBuffers_.begin();
+        for (auto& request : requests_) {
+            if (handedBytes >= maxUploadBytes) return;
+            if (request->state_ != RequestState::Decoded || request->nextRow_ >= request->height_) continue;
+
+            auto rowSize = request->GetRowSize();
+            if (rowSize > stagingBufferSize_) {
+                spdlog::warn("Texture rows are larger than the staging buffers ({}).", request->texture_->GetFilename());
+                request->state_ = RequestState::Failed;
+                continue;
+            }
+            if (request->texture_->textureId_ == 0) CreateTexture(*request);
+
+            while (request->nextRow_ < request->height_ && handedBytes < maxUploadBytes) {
+                nextStaging = std::find_if(nextStaging, stagingBuffers_.end(), [](const std::unique_ptr<StagingBuffer>& staging) {
+                    return staging->state_ == StagingState::Free;
+                });
+                if (nextStaging == stagingBuffers_.end()) return;
+
+                // at least one row is handed out, so very large rows still make progress with a small budget.
+                auto budgetRows = std::max<std::size_t>((maxUploadBytes - handedBytes) / rowSize, 1);
+                auto numRows = std::min({ static_cast<std::size_t>(request->height_ - request->nextRow_), stagingBufferSize_ / rowSize, budgetRows });
+
+                auto staging = nextStaging->get();
+                staging->request_ = request;
+                staging->rowBegin_ = request->nextRow_;
+                staging->numRows_ = static_cast<unsigned int>(numRows);
+                staging->state_ = StagingState::Filling;
+                request->nextRow_ += staging->numRows_;
+                handedBytes += numRows * rowSize;
+
+                tasks_.emplace_back(threadPool_->Enqueue([staging]() {
+                    const auto& slice = *staging->request_;
+                    auto rowSize = slice.GetRowSize();
+                    auto pixels = static_cast<const std::uint8_t*>(slice.pixels_);
+                    if (!slice.flip_) utils::memcpyfaster(staging->data_, pixels + staging->rowBegin_ * rowSize, staging->numRows_ * rowSize);
+                    else for (std::size_t i = 0; i < staging->numRows_; ++i) {
+                        auto sourceRow = slice.height_ - 1 - (staging->rowBegin_ + i);
+                        memcpy(staging->data_ + i * rowSize, pixels + sourceRow * rowSize, rowSize);
+                    }
+                    staging->state_ = StagingState::Filled;
+                }));
+            }
+        }
+    }
+
+    void TextureStreamer::CreateTexture(UploadRequest& request)
+    {
+        auto& texture = *request.texture_;
+        texture.dimensions_ = glm::uvec2{ request.width_, request.height_ };
+        glGenTextures(1, &texture.textureId_);
+        glBindTexture(GL_TEXTURE_2D, texture.textureId_);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, request.internalFormat_, static_cast<GLsizei>(request.width_), static_cast<GLsizei>(request.height_),
+            0, request.format_, request.type_, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    void TextureStreamer::UploadSlice(StagingBuffer& staging) const
+    {
+        const auto& request = *staging.request_;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer_);
+        if (!persistent_) {
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            staging.data_ = nullptr;
+        }
+
+        glBindTexture(GL_TEXTURE_2D, request.texture_->textureId_);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, static_cast<GLint>(staging.rowBegin_), static_cast<GLsizei>(request.width_),
+            static_cast<GLsizei>(staging.numRows_), request.format_, request.type_, nullptr);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        staging.fence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        staging.state_ = StagingState::InFlight;
+    }
+}
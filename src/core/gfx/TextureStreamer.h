@@ -0,0 +1,237 @@
+/**
+ * @file   TextureStreamer.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.23
+ *
+ * @brief  Declaration of asynchronous texture uploads through pixel buffer objects.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "core/open_gl_fwd.h"
+#include "core/gfx/Texture.h"
+#include <atomic>
+#include <future>
+
+namespace viscom {
+
+    class ThreadPool;
+
+    /** A texture loaded by the TextureStreamer, it can be used once it is ready. */
+    class StreamedTexture final
+    {
+    public:
+        /** The loading state of a streamed texture. */
+        enum class State
+        {
+            /** The image is decoded or uploaded. */
+            Loading,
+            /** All data was uploaded, the texture can be used. */
+            Ready,
+            /** The image could not be loaded. */
+            Failed
+        };
+
+        /** Constructor, the OpenGL texture is created when the image is decoded. */
+        explicit StreamedTexture(std::string filename) : filename_{ std::move(filename) } {}
+        StreamedTexture(const StreamedTexture&) = delete;
+        StreamedTexture& operator=(const StreamedTexture&) = delete;
+        /** Destructor, needs to be called with the OpenGL context current. */
+        ~StreamedTexture();
+
+        /** Returns the filename of the image. */
+        const std::string& GetFilename() const noexcept { return filename_; }
+        /** Returns the loading state. */
+        State GetState() const noexcept { return state_; }
+        /** Checks if the texture can be used. */
+        bool IsReady() const noexcept { return state_ == State::Ready; }
+        /** Returns the OpenGL texture id (0 before the image is decoded). */
+        GLuint GetTextureId() const noexcept { return textureId_; }
+        /** Returns the size of the texture. */
+        glm::uvec2 GetDimensions() const noexcept { return dimensions_; }
+
+    private:
+        friend class TextureStreamer;
+
+        /** Holds the filename. */
+        std::string filename_;
+        /** Holds the loading state. */
+        State state_ = State::Loading;
+        /** Holds the OpenGL texture id. */
+        GLuint textureId_ = 0;
+        /** Holds the size of the texture. */
+        glm::uvec2 dimensions_ = glm::uvec2{ 0 };
+    };
+
+    /**
+     *  Loads textures without stalling the render thread. Images are decoded on a thread pool and copied by the
+     *  workers into a pool of mapped pixel buffer objects (persistently mapped with OpenGL 4.4). The render thread
+     *  only issues glTexSubImage2D from these buffers, in slices of rows limited by a per frame budget, and recycles
+     *  each buffer when its fence signals. All methods need to be called from the thread owning the OpenGL context.
+     */
+    class TextureStreamer final
+    {
+    public:
+        /**
+         *  Constructor, creates the staging buffers.
+         *  @param stagingBufferSize the size of each staging buffer in bytes (needs to hold at least one row of an image).
+         *  @param numStagingBuffers the number of staging buffers.
+         *  @param threadPool the thread pool for decoding (nullptr uses the default pool).
+         */
+        explicit TextureStreamer(std::size_t stagingBufferSize = 16 * 1024 * 1024, std::size_t numStagingBuffers = 4, ThreadPool* threadPool = nullptr);
+        TextureStreamer(const TextureStreamer&) = delete;
+        TextureStreamer& operator=(const TextureStreamer&) = delete;
+        /** Destructor, waits for running decode and copy tasks. */
+        ~TextureStreamer();
+
+        /**
+         *  Starts loading a texture.
+         *  @param filename the image file.
+         *  @param useSRGB defines if the texture uses the standard RGB color space.
+         *  @param flipTexture flips the texture on load.
+         *  @param options the mip map and sampling options (mip maps are generated on the GPU after the upload).
+         *  @return the texture that becomes ready after a number of calls to Update.
+         */
+        std::shared_ptr<StreamedTexture> LoadAsync(const std::string& filename, bool useSRGB = true, bool flipTexture = true,
+            const TextureOptions& options = TextureOptions{});
+
+        /**
+         *  Advances all uploads, this should be called once per frame.
+         *  @param maxUploadBytes the maximum number of bytes handed to the staging buffers in this call.
+         */
+        void Update(std::size_t maxUploadBytes = 16 * 1024 * 1024);
+
+        /** Returns the number of textures that are not ready yet. */
+        std::size_t GetNumberOfPendingTextures() const noexcept { return requests_.size(); }
+
+    private:
+        /** The states of a staging buffer. */
+        enum class StagingState
+        {
+            /** The buffer is mapped and can be used for the next slice. */
+            Free,
+            /** A worker copies a slice into the buffer. */
+            Filling,
+            /** The slice was copied and can be uploaded. */
+            Filled,
+            /** The GPU reads from the buffer until its fence signals. */
+            InFlight
+        };
+
+        struct UploadRequest;
+
+        /** A pixel buffer object used to upload slices of rows. */
+        struct StagingBuffer
+        {
+            /** Holds the OpenGL buffer. */
+            GLuint buffer_ = 0;
+            /** Holds the mapped memory (nullptr while unmapped). */
+            std::uint8_t* data_ = nullptr;
+            /** Holds the fence of the last upload. */
+            GLsync fence_ = nullptr;
+            /** Holds the state (written by the workers when a slice is filled). */
+            std::atomic<StagingState> state_{ StagingState::Free };
+            /** Holds the request of the current slice. */
+            std::shared_ptr<UploadRequest> request_;
+            /** Holds the first row of the current slice. */
+            unsigned int rowBegin_ = 0;
+            /** Holds the number of rows of the current slice. */
+            unsigned int numRows_ = 0;
+        };
+
+        /** The states of an upload request. */
+        enum class RequestState
+        {
+            /** The image is decoded. */
+            Decoding,
+            /** The image is decoded and waits for staging buffers. */
+            Decoded,
+            /** The image could not be decoded. */
+            Failed
+        };
+
+        /** A texture to load. */
+        struct UploadRequest
+        {
+            /** Holds the texture to load. */
+            std::shared_ptr<StreamedTexture> texture_;
+            /** Whether the texture uses the standard RGB color space. */
+            bool sRGB_ = true;
+            /** Whether the image is flipped. */
+            bool flip_ = true;
+            /** Holds the mip map and sampling options. */
+            TextureOptions options_;
+            /** Holds the state (written by the decoding worker). */
+            std::atomic<RequestState> state_{ RequestState::Decoding };
+            /** Holds the decoded pixels. */
+            void* pixels_ = nullptr;
+            /** Holds the width. */
+            unsigned int width_ = 0;
+            /** Holds the height. */
+            unsigned int height_ = 0;
+            /** Holds the number of channels. */
+            int channels_ = 0;
+            /** Whether the pixels are floats. */
+            bool isHDR_ = false;
+            /** Holds the internal format of the texture. */
+            GLint internalFormat_ = 0;
+            /** Holds the format of the pixels. */
+            GLenum format_ = 0;
+            /** Holds the type of the pixels. */
+            GLenum type_ = 0;
+            /** Holds the next row to hand to a staging buffer. */
+            unsigned int nextRow_ = 0;
+            /** Holds the number of rows that were uploaded. */
+            unsigned int uploadedRows_ = 0;
+
+            /** Destructor, frees the decoded pixels. */
+            ~UploadRequest();
+            /** Returns the size of a row in bytes. */
+            std::size_t GetRowSize() const noexcept { return static_cast<std::size_t>(width_) * channels_ * (isHDR_ ? sizeof(float) : sizeof(std::uint8_t)); }
+        };
+
+        /**
+         *  Decodes an image file on a worker thread.
+         *  @param request the upload request.
+         */
+        static void DecodeImage(UploadRequest& request);
+        /**
+         *  Maps a staging buffer if it is not persistently mapped.
+         *  @param staging the staging buffer.
+         */
+        void MapStagingBuffer(StagingBuffer& staging) const;
+        /** Returns staging buffers whose fences signaled to the pool. */
+        void RecycleStagingBuffers();
+        /** Uploads all filled staging buffers to their textures. */
+        void UploadFilledStagingBuffers();
+        /**
+         *  Hands slices of decoded images to free staging buffers.
+         *  @param maxUploadBytes the maximum number of bytes to hand out.
+         */
+        void FillStagingBuffers(std::size_t maxUploadBytes);
+        /**
+         *  Creates the OpenGL texture for a decoded image.
+         *  @param request the upload request.
+         */
+        static void CreateTexture(UploadRequest& request);
+        /**
+         *  Uploads a filled staging buffer.
+         *  @param staging the staging buffer.
+         */
+        void UploadSlice(StagingBuffer& staging) const;
+
+        /** Holds the thread pool. */
+        ThreadPool* threadPool_;
+        /** Holds the size of each staging buffer. */
+        std::size_t stagingBufferSize_;
+        /** Flag whether the staging buffers are mapped persistently. */
+        bool persistent_ = false;
+        /** Holds the staging buffers. */
+        std::vector<std::unique_ptr<StagingBuffer>> stagingBuffers_;
+        /** Holds the requests in the order they were made. */
+        std::vector<std::shared_ptr<UploadRequest>> requests_;
+        /** Holds the decode and copy tasks that may still run. */
+        std::vector<std::future<void>> tasks_;
+    };
+}
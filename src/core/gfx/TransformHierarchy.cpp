@@ -0,0 +1,147 @@
+/**
+ * @file   TransformHierarchy.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.19
+ *
+ * @brief  Implementation of a scene transform hierarchy with dirty flags and parallel world matrix updates.
+ */
+
+#include "TransformHierarchy.h"
+#include "core/open_gl.h"
+#include "core/gfx/mesh/Mesh.h"
+#include "core/gfx/mesh/MeshRenderable.h"
+#include "core/gfx/mesh/SceneMeshNode.h"
+#include "core/math/math.h"
+#include "core/math/transforms.h"
+#include "core/utils/ThreadPool.h"
+#include <glm/gtc/matrix_inverse.hpp>
+
+namespace viscom {
+
+    TransformHierarchy::TransformHierarchy(ThreadPool* threadPool) :
+        threadPool_{ threadPool != nullptr ? threadPool : &ThreadPool::GetDefault() }
+    {
+    }
+
+    std::uint32_t TransformHierarchy::AddNode(std::uint32_t parent, const glm::mat4& localTransform)
+    {
+        auto node = static_cast<std::uint32_t>(parents_.size());
+        assert(parent == NO_PARENT || parent < node);
+
+        std::uint32_t level = parent == NO_PARENT ? 0 : nodeLevels_[parent] + 1;
+        if (levels_.size() <= level) levels_.resize(level + 1);
+        levels_[level].push_back(node);
+        nodeLevels_.push_back(level);
+
+        parents_.push_back(parent);
+        localTransforms_.push_back(localTransform);
+        worldMatrices_.emplace_back(1.0f);
+        normalMatrices_.emplace_back(1.0f);
+        localBounds_.emplace_back();
+        worldBounds_.emplace_back();
+        hasBounds_.push_back(0);
+        dirty_.push_back(1);
+        changed_.push_back(0);
+        renderables_.push_back(nullptr);
+        hasDirtyNodes_ = true;
+        return node;
+    }
+
+    void TransformHierarchy::Clear()
+    {
+        parents_.clear();
+        localTransforms_.clear();
+        worldMatrices_.clear();
+        normalMatrices_.clear();
+        localBounds_.clear();
+        worldBounds_.clear();
+        hasBounds_.clear();
+        dirty_.clear();
+        changed_.clear();
+        renderables_.clear();
+        levels_.clear();
+        nodeLevels_.clear();
+        changedNodes_.clear();
+        hasDirtyNodes_ = false;
+    }
+
+    void TransformHierarchy::SetLocalTransform(std::uint32_t node, const glm::mat4& localTransform)
+    {
+        localTransforms_[node] = localTransform;
+        dirty_[node] = 1;
+        hasDirtyNodes_ = true;
+    }
+
+    void TransformHierarchy::SetLocalBounds(std::uint32_t node, const math::AABB3<float>& localBounds)
+    {
+        localBounds_[node] = localBounds;
+        hasBounds_[node] = 1;
+        dirty_[node] = 1;
+        hasDirtyNodes_ = true;
+    }
+
+    void TransformHierarchy::SetRenderable(std::uint32_t node, const MeshRenderable* renderable)
+    {
+        renderables_[node] = renderable;
+        if (renderable) SetLocalBounds(node, renderable->GetMesh()->GetRootNode()->GetBoundingBox());
+    }
+
+    void TransformHierarchy::Update()
+    {
+        changedNodes_.clear();
+        if (!hasDirtyNodes_) {
+            std::fill(changed_.begin(), changed_.end(), std::uint8_t{ 0 });
+            return;
+        }
+
+        // parents are always on the previous level, so their changed flags are final when a level is processed.
+        for (const auto& level : levels_) {
+            threadPool_->ParallelFor(0, level.size(), [this, &level](std::size_t begin, std::size_t end) {
+                for (auto i = begin; i < end; ++i) UpdateNode(level[i]);
+            }, MIN_NODES_PER_TASK);
+        }
+
+        for (std::uint32_t i = 0; i < changed_.size(); ++i) {
+            if (changed_[i] != 0) changedNodes_.push_back(i);
+        }
+        hasDirtyNodes_ = false;
+    }
+
+    void TransformHierarchy::UpdateNode(std::uint32_t node)
+    {
+        auto parent = parents_[node];
+        auto parentChanged = parent != NO_PARENT && changed_[parent] != 0;
+        changed_[node] = dirty_[node] != 0 || parentChanged ? 1 : 0;
+        dirty_[node] = 0;
+        if (changed_[node] == 0) return;
+
+        if (parent == NO_PARENT) worldMatrices_[node] = localTransforms_[node];
+        else worldMatrices_[node] = worldMatrices_[parent] * localTransforms_[node];
+        normalMatrices_[node] = glm::inverseTranspose(glm::mat3(worldMatrices_[node]));
+        if (hasBounds_[node] != 0) worldBounds_[node] = math::transformAABB(localBounds_[node], worldMatrices_[node]);
+    }
+
+    void TransformHierarchy::CollectVisibleNodes(const math::Frustum<float>& frustum, std::vector<std::uint32_t>& visibleNodes) const
+    {
+        visibleNodes.clear();
+        for (std::uint32_t i = 0; i < worldBounds_.size(); ++i) {
+            if (hasBounds_[i] != 0 && math::AABBInFrustumTest(frustum, worldBounds_[i])) visibleNodes.push_back(i);
+        }
+    }
+
+    void TransformHierarchy::Draw(const math::Frustum<float>& frustum, bool overrideBump) const
+    {
+        for (std::size_t i = 0; i < renderables_.size(); ++i) {
+            if (!renderables_[i] || !math::AABBInFrustumTest(frustum, worldBounds_[i])) continue;
+            renderables_[i]->Draw(worldMatrices_[i], frustum, overrideBump);
+        }
+    }
+
+    void TransformHierarchy::Enqueue(RenderQueue& queue, const math::Frustum<float>& frustum, bool overrideBump) const
+    {
+        for (std::size_t i = 0; i < renderables_.size(); ++i) {
+            if (!renderables_[i] || !math::AABBInFrustumTest(frustum, worldBounds_[i])) continue;
+            renderables_[i]->Enqueue(queue, worldMatrices_[i], frustum, overrideBump);
+        }
+    }
+}
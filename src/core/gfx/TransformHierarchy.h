@@ -0,0 +1,153 @@
+/**
+ * @file   TransformHierarchy.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.19
+ *
+ * @brief  Declaration of a scene transform hierarchy with dirty flags and parallel world matrix updates.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "core/math/aabb.h"
+#include "core/math/primitives.h"
+
+namespace viscom {
+
+    class MeshRenderable;
+    class RenderQueue;
+    class ThreadPool;
+
+    /**
+     *  Stores the transforms of scene nodes in contiguous arrays (structure of arrays). Nodes are referenced by their
+     *  index and are grouped by their depth in the hierarchy, so world matrices can be computed level by level with
+     *  all nodes of a level in parallel. Changing a local transform only marks the node dirty, Update recomputes the
+     *  world matrices and world bounds of dirty nodes and their sub trees only.
+     *  Nodes can optionally have a mesh renderable that is drawn or enqueued with the nodes world matrix.
+     */
+    class TransformHierarchy final
+    {
+    public:
+        /** Index used for nodes without a parent. */
+        static constexpr std::uint32_t NO_PARENT = std::numeric_limits<std::uint32_t>::max();
+
+        /**
+         *  Constructor.
+         *  @param threadPool the thread pool to use (nullptr uses the default pool).
+         */
+        explicit TransformHierarchy(ThreadPool* threadPool = nullptr);
+
+        /**
+         *  Adds a node to the hierarchy.
+         *  @param parent the index of the parent node (NO_PARENT for a root node).
+         *  @param localTransform the transform of the node relative to its parent.
+         *  @return the index of the new node.
+         */
+        std::uint32_t AddNode(std::uint32_t parent = NO_PARENT, const glm::mat4& localTransform = glm::mat4{ 1.0f });
+        /** Removes all nodes. */
+        void Clear();
+        /** Returns the number of nodes. */
+        std::size_t GetNumberOfNodes() const noexcept { return parents_.size(); }
+
+        /**
+         *  Sets the local transform of a node and marks it dirty.
+         *  @param node the node index.
+         *  @param localTransform the transform of the node relative to its parent.
+         */
+        void SetLocalTransform(std::uint32_t node, const glm::mat4& localTransform);
+        /**
+         *  Sets the bounding box of a node used for culling and marks it dirty.
+         *  @param node the node index.
+         *  @param localBounds the bounding box in the local space of the node.
+         */
+        void SetLocalBounds(std::uint32_t node, const math::AABB3<float>& localBounds);
+        /**
+         *  Sets the mesh renderable drawn at a node, the local bounds are set to the bounds of its mesh.
+         *  The hierarchy does not own the renderable.
+         *  @param node the node index.
+         *  @param renderable the mesh renderable (nullptr to remove it).
+         */
+        void SetRenderable(std::uint32_t node, const MeshRenderable* renderable);
+
+        /**
+         *  Recomputes the world matrices and bounds of all dirty nodes and their sub trees.
+         *  Levels with many nodes to update are distributed over the thread pool.
+         */
+        void Update();
+
+        /** Returns the parent index of each node. */
+        const std::vector<std::uint32_t>& GetParents() const noexcept { return parents_; }
+        /** Returns the local transform of each node. */
+        const std::vector<glm::mat4>& GetLocalTransforms() const noexcept { return localTransforms_; }
+        /** Returns the world matrix of each node (valid after Update). */
+        const std::vector<glm::mat4>& GetWorldMatrices() const noexcept { return worldMatrices_; }
+        /** Returns the normal matrix of each node (valid after Update). */
+        const std::vector<glm::mat3>& GetNormalMatrices() const noexcept { return normalMatrices_; }
+        /** Returns the world space bounding box of each node (valid after Update). */
+        const std::vector<math::AABB3<float>>& GetWorldBounds() const noexcept { return worldBounds_; }
+        /** Returns the nodes whose world matrix changed in the last Update (e.g. to update a math::BVH over the bounds). */
+        const std::vector<std::uint32_t>& GetChangedNodes() const noexcept { return changedNodes_; }
+
+        /**
+         *  Collects all nodes with bounds that intersect a frustum.
+         *  @param frustum the view frustum in world space.
+         *  @param visibleNodes the vector the visible nodes are written to.
+         */
+        void CollectVisibleNodes(const math::Frustum<float>& frustum, std::vector<std::uint32_t>& visibleNodes) const;
+        /**
+         *  Draws the renderables of all nodes inside a frustum with their world matrices.
+         *  @param frustum the view frustum in world space.
+         *  @param overrideBump flag for bumb map parameters.
+         */
+        void Draw(const math::Frustum<float>& frustum, bool overrideBump = false) const;
+        /**
+         *  Adds the renderables of all nodes inside a frustum to a render queue.
+         *  @param queue the render queue.
+         *  @param frustum the view frustum in world space.
+         *  @param overrideBump flag for bumb map parameters.
+         */
+        void Enqueue(RenderQueue& queue, const math::Frustum<float>& frustum, bool overrideBump = false) const;
+
+    private:
+        /** The minimum number of nodes updated by a single task. */
+        static constexpr std::size_t MIN_NODES_PER_TASK = 256;
+
+        /**
+         *  Updates the world matrix of a node if it or its parent changed.
+         *  @param node the node index.
+         */
+        void UpdateNode(std::uint32_t node);
+
+        /** Holds the thread pool. */
+        ThreadPool* threadPool_;
+
+        /** Holds the parent index of each node. */
+        std::vector<std::uint32_t> parents_;
+        /** Holds the local transform of each node. */
+        std::vector<glm::mat4> localTransforms_;
+        /** Holds the world matrix of each node. */
+        std::vector<glm::mat4> worldMatrices_;
+        /** Holds the normal matrix of each node. */
+        std::vector<glm::mat3> normalMatrices_;
+        /** Holds the bounding box of each node in local space. */
+        std::vector<math::AABB3<float>> localBounds_;
+        /** Holds the bounding box of each node in world space. */
+        std::vector<math::AABB3<float>> worldBounds_;
+        /** Holds a flag for each node whether it has bounds. */
+        std::vector<std::uint8_t> hasBounds_;
+        /** Holds a flag for each node whether its local transform or bounds changed. */
+        std::vector<std::uint8_t> dirty_;
+        /** Holds a flag for each node whether its world matrix changed in the last update. */
+        std::vector<std::uint8_t> changed_;
+        /** Holds the renderable of each node. */
+        std::vector<const MeshRenderable*> renderables_;
+        /** Holds the node indices of each level of the hierarchy. */
+        std::vector<std::vector<std::uint32_t>> levels_;
+        /** Holds the level of each node. */
+        std::vector<std::uint32_t> nodeLevels_;
+        /** Holds the nodes whose world matrix changed in the last update. */
+        std::vector<std::uint32_t> changedNodes_;
+        /** Flag whether any node is dirty. */
+        bool hasDirtyNodes_ = false;
+    };
+}
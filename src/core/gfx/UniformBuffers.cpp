@@ -0,0 +1,170 @@
+/**
+ * @file   UniformBuffers.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.13
+ *
+ * @brief  Implementation of the framework managed uniform buffers for frame, material and draw data.
+ */
+
+#include "UniformBuffers.h"
+#include "core/open_gl.h"
+#include "core/CameraHelper.h"
+#include "core/gfx/Material.h"
+#include <algorithm>
+#include <cstring>
+
+namespace viscom {
+
+    static_assert(sizeof(FrameUniforms) % 16 == 0, "Uniform blocks need to be a multiple of 16 bytes for std140.");
+    static_assert(sizeof(MaterialUniforms) == 4 * sizeof(glm::vec4), "Materials need to be tightly packed for std140 arrays.");
+    static_assert(sizeof(MaterialTextureUniforms) == 3 * sizeof(glm::vec4), "Material textures need to be tightly packed for std140 arrays.");
+    static_assert(sizeof(DrawUniforms) % 16 == 0, "Uniform blocks need to be a multiple of 16 bytes for std140.");
+
+    namespace {
+        std::size_t QueryUniformBufferOffsetAlignment()
+        {
+            GLint alignment = 0;
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+            return static_cast<std::size_t>(std::max(alignment, 16));
+        }
+
+        std::size_t AlignSize(std::size_t size, std::size_t alignment)
+        {
+            return (size + alignment - 1) / alignment * alignment;
+        }
+    }
+
+    UniformBuffers::UniformBuffers(std::size_t maxDrawsPerFrame, std::size_t maxViewsPerFrame) :
+        offsetAlignment_{ QueryUniformBufferOffsetAlignment() },
+        buffer_{ GL_UNIFORM_BUFFER, maxViewsPerFrame * AlignSize(sizeof(FrameUniforms), offsetAlignment_)
+            + maxDrawsPerFrame * AlignSize(sizeof(DrawUniforms), offsetAlignment_) }
+    {
+    }
+
+    void UniformBuffers::BeginFrame()
+    {
+        buffer_.BeginFrame();
+        hasFrameData_ = false;
+    }
+
+    bool UniformBuffers::SetFrameData(const CameraHelper& camera)
+    {
+        FrameUniforms frame;
+        frame.projectionMatrix_ = camera.GetPerspectiveMatrix();
+        frame.viewProjectionMatrix_ = camera.GetViewPerspectiveMatrix();
+        frame.viewMatrix_ = glm::inverse(frame.projectionMatrix_) * frame.viewProjectionMatrix_;
+        frame.cameraPosition_ = glm::vec4{ camera.GetPosition() + camera.GetUserPosition(), 1.0f };
+        if (!WriteBlock(FRAME_BINDING, &frame, sizeof(FrameUniforms))) return false;
+        frameData_ = frame;
+        hasFrameData_ = true;
+        return true;
+    }
+
+    bool UniformBuffers::SetDrawData(const glm::mat4& modelMatrix, const glm::mat3& normalMatrix, std::uint32_t materialIndex, float bumpMultiplier)
+    {
+        // the material block in the shader has MAX_MATERIALS entries, larger indices would be read out of bounds.
+        if (materialIndex >= MAX_MATERIALS) {
+            if (!materialIndexReported_) spdlog::warn("Material index {} does not fit into a material block, using loose uniforms.", materialIndex);
+            materialIndexReported_ = true;
+            return false;
+        }
+
+        DrawUniforms draw;
+        draw.modelMatrix_ = modelMatrix;
+        draw.normalMatrix_ = glm::mat4{ normalMatrix };
+        draw.materialIndex_ = materialIndex;
+        draw.bumpMultiplier_ = bumpMultiplier;
+        draw.padding_[0] = draw.padding_[1] = 0;
+        return WriteBlock(DRAW_BINDING, &draw, sizeof(DrawUniforms));
+    }
+
+    void UniformBuffers::EndFrame()
+    {
+        buffer_.EndFrame();
+    }
+
+    bool UniformBuffers::WriteBlock(GLuint binding, const void* data, std::size_t size)
+    {
+        auto allocation = buffer_.Allocate(size, offsetAlignment_);
+        if (allocation.data_ == nullptr && buffer_.GetUsedSize() > 0) {
+            GrowBuffer();
+            allocation = buffer_.Allocate(size, offsetAlignment_);
+        }
+        if (allocation.data_ == nullptr) return false;
+
+        std::memcpy(allocation.data_, data, size);
+        // draws may follow right away, so the block is uploaded before it is bound.
+        buffer_.Flush();
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer_.GetBuffer(), static_cast<GLintptr>(allocation.offset_), static_cast<GLsizeiptr>(size));
+        return true;
+    }
+
+    void UniformBuffers::GrowBuffer()
+    {
+        spdlog::warn("Uniform blocks of a frame do not fit into {} KB, growing the uniform buffer.", buffer_.GetFrameSize() / 1024);
+        // deleting the old buffer unbinds it, draws issued before still use its data.
+        buffer_ = StreamingBuffer{ GL_UNIFORM_BUFFER, 2 * buffer_.GetFrameSize() };
+        buffer_.BeginFrame();
+        if (hasFrameData_) WriteBlock(FRAME_BINDING, &frameData_, sizeof(FrameUniforms));
+    }
+
+    GLuint UniformBuffers::CreateMaterialBuffer(const std::vector<Material>& materials)
+    {
+        if (materials.size() > MAX_MATERIALS) spdlog::warn("Only the first {} of {} materials fit into a material block.", MAX_MATERIALS, materials.size());
+
+        std::vector<MaterialUniforms> blockData(std::min(materials.size(), MAX_MATERIALS));
+        for (std::size_t i = 0; i < blockData.size(); ++i) {
+            const auto& material = materials[i];
+            blockData[i].ambientAlpha_ = glm::vec4{ material.ambient, material.alpha };
+            blockData[i].diffuseExponent_ = glm::vec4{ material.diffuse, material.specularExponent };
+            blockData[i].specularRefraction_ = glm::vec4{ material.specular, material.refraction };
+            blockData[i].bumpMultiplier_ = glm::vec4{ material.bumpMultiplier, 0.0f, 0.0f, 0.0f };
+        }
+
+        // the block in the shader has a fixed size, so the buffer always has room for all materials.
+        GLuint buffer = 0;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, MAX_MATERIALS * sizeof(MaterialUniforms), nullptr, GL_STATIC_DRAW);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, blockData.size() * sizeof(MaterialUniforms), blockData.data());
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        return buffer;
+    }
+
+    GLuint UniformBuffers::CreateMaterialTextureBuffer(const std::vector<MaterialTextures>& materialTextures)
+    {
+        std::vector<MaterialTextureUniforms> blockData(std::min(materialTextures.size(), MAX_MATERIALS));
+        for (std::size_t i = 0; i < blockData.size(); ++i) {
+            const auto& matTex = materialTextures[i];
+            blockData[i].diffuseScaleOffset_ = matTex.diffusePacked.uvScaleOffset;
+            blockData[i].bumpScaleOffset_ = matTex.bumpPacked.uvScaleOffset;
+            blockData[i].layers_ = glm::vec4{ static_cast<float>(matTex.diffusePacked.layer), static_cast<float>(matTex.bumpPacked.layer), 0.0f, 0.0f };
+        }
+
+        GLuint buffer = 0;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, MAX_MATERIALS * sizeof(MaterialTextureUniforms), nullptr, GL_STATIC_DRAW);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, blockData.size() * sizeof(MaterialTextureUniforms), blockData.data());
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        return buffer;
+    }
+
+    void UniformBuffers::BindMaterialBuffer(GLuint materialBuffer, GLuint materialTextureBuffer)
+    {
+        glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BINDING, materialBuffer);
+        if (materialTextureBuffer != 0) glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_TEXTURE_BINDING, materialTextureBuffer);
+    }
+
+    void UniformBuffers::BindUniformBlocks(GLuint program)
+    {
+        auto bindBlock = [program](const char* name, GLuint binding) {
+            auto blockIndex = glGetUniformBlockIndex(program, name);
+            if (blockIndex != GL_INVALID_INDEX) glUniformBlockBinding(program, blockIndex, binding);
+        };
+        bindBlock("FrameBlock", FRAME_BINDING);
+        bindBlock("MaterialBlock", MATERIAL_BINDING);
+        bindBlock("DrawBlock", DRAW_BINDING);
+        bindBlock("MaterialTextureBlock", MATERIAL_TEXTURE_BINDING);
+    }
+}
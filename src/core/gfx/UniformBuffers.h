@@ -0,0 +1,168 @@
+/**
+ * @file   UniformBuffers.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.13
+ *
+ * @brief  Declaration of the framework managed uniform buffers for frame, material and draw data.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "core/open_gl_fwd.h"
+#include "core/gfx/StreamingBuffer.h"
+
+namespace viscom {
+
+    class CameraHelper;
+    struct Material;
+    struct MaterialTextures;
+
+    /** The per frame uniform block with std140 layout (see uniformBlocks.glsl). */
+    struct FrameUniforms
+    {
+        /** The view matrix. */
+        glm::mat4 viewMatrix_;
+        /** The projection matrix. */
+        glm::mat4 projectionMatrix_;
+        /** The combined view and projection matrix. */
+        glm::mat4 viewProjectionMatrix_;
+        /** The camera position in world space (w is 1). */
+        glm::vec4 cameraPosition_;
+    };
+
+    /** A material in the material uniform block with std140 layout. */
+    struct MaterialUniforms
+    {
+        /** The ambient color (rgb) and alpha (a). */
+        glm::vec4 ambientAlpha_;
+        /** The diffuse albedo (rgb) and specular exponent (a). */
+        glm::vec4 diffuseExponent_;
+        /** The specular albedo (rgb) and index of refraction (a). */
+        glm::vec4 specularRefraction_;
+        /** The bump multiplier (x), the other components are unused. */
+        glm::vec4 bumpMultiplier_;
+    };
+
+    /** The packed textures of a material in the material texture block with std140 layout (see packedTextures.glsl). */
+    struct MaterialTextureUniforms
+    {
+        /** The scale (xy) and offset (zw) of the diffuse texture coordinates. */
+        glm::vec4 diffuseScaleOffset_;
+        /** The scale (xy) and offset (zw) of the bump texture coordinates. */
+        glm::vec4 bumpScaleOffset_;
+        /** The layers of the diffuse (x) and bump (y) texture, the other components are unused. */
+        glm::vec4 layers_;
+    };
+
+    /** The per draw uniform block with std140 layout. */
+    struct DrawUniforms
+    {
+        /** The model matrix. */
+        glm::mat4 modelMatrix_;
+        /** The normal matrix (padded to 4x4). */
+        glm::mat4 normalMatrix_;
+        /** The material index. */
+        std::uint32_t materialIndex_;
+        /** The bump multiplier (negative if the bumpMultiplier uniform is set by the application). */
+        float bumpMultiplier_;
+        /** Padding to 16 bytes. */
+        std::uint32_t padding_[2];
+    };
+
+    /**
+     *  Manages the per frame and per draw uniform blocks, both are written to a streaming buffer that is
+     *  persistently mapped if possible and synchronized with fences. If a frame has more draws than the buffer was
+     *  created for, it is replaced by one twice as large. The per material blocks are static buffers
+     *  created for each mesh (see CreateMaterialBuffer). Shaders include uniformBlocks.glsl and need their
+     *  blocks bound with BindUniformBlocks.
+     */
+    class UniformBuffers final
+    {
+    public:
+        /** The binding point of the frame block. */
+        static constexpr GLuint FRAME_BINDING = 0;
+        /** The binding point of the material block. */
+        static constexpr GLuint MATERIAL_BINDING = 1;
+        /** The binding point of the draw block. */
+        static constexpr GLuint DRAW_BINDING = 2;
+        /** The binding point of the material texture block. */
+        static constexpr GLuint MATERIAL_TEXTURE_BINDING = 3;
+        /** The maximum number of materials in a material block (16KB is the minimum block size). */
+        static constexpr std::size_t MAX_MATERIALS = 256;
+
+        /**
+         *  Constructor, creates the streaming buffer.
+         *  @param maxDrawsPerFrame the maximum number of draws per frame using the draw block.
+         *  @param maxViewsPerFrame the maximum number of windows or viewports per frame.
+         */
+        explicit UniformBuffers(std::size_t maxDrawsPerFrame = 8192, std::size_t maxViewsPerFrame = 4);
+
+        /** Starts a new frame, waits for the GPU if it still uses the region of the frame. */
+        void BeginFrame();
+        /**
+         *  Writes the frame block from a camera and binds it.
+         *  Needs to be called once per window or viewport as the camera matrices differ.
+         *  @param camera the camera to get the matrices from.
+         *  @return whether the frame block was set (false if no frame was started).
+         */
+        bool SetFrameData(const CameraHelper& camera);
+        /**
+         *  Writes the draw block for the next draw and binds it.
+         *  @param modelMatrix the model matrix.
+         *  @param normalMatrix the normal matrix.
+         *  @param materialIndex the material index.
+         *  @param bumpMultiplier the bump multiplier (negative if set by the application).
+         *  @return whether the draw block was set (false if no frame was started or the material index is not below MAX_MATERIALS).
+         */
+        bool SetDrawData(const glm::mat4& modelMatrix, const glm::mat3& normalMatrix, std::uint32_t materialIndex, float bumpMultiplier);
+        /** Finishes the frame, all draws using the blocks need to be issued before. */
+        void EndFrame();
+
+        /**
+         *  Creates a static uniform buffer holding a material block.
+         *  @param materials the materials to put into the buffer (at most MAX_MATERIALS are used).
+         *  @return the OpenGL buffer, the caller is responsible for deleting it.
+         */
+        static GLuint CreateMaterialBuffer(const std::vector<Material>& materials);
+        /**
+         *  Creates a static uniform buffer holding the material texture block of textures packed by the TexturePacker.
+         *  @param materialTextures the material textures to put into the buffer (at most MAX_MATERIALS are used).
+         *  @return the OpenGL buffer, the caller is responsible for deleting it.
+         */
+        static GLuint CreateMaterialTextureBuffer(const std::vector<MaterialTextures>& materialTextures);
+        /**
+         *  Binds the material block of a mesh.
+         *  @param materialBuffer the buffer created with CreateMaterialBuffer.
+         *  @param materialTextureBuffer the buffer created with CreateMaterialTextureBuffer (0 if the mesh has none).
+         */
+        static void BindMaterialBuffer(GLuint materialBuffer, GLuint materialTextureBuffer = 0);
+        /**
+         *  Binds the uniform blocks a program uses to the binding points.
+         *  @param program the program.
+         */
+        static void BindUniformBlocks(GLuint program);
+
+    private:
+        /**
+         *  Allocates a block in the streaming buffer and binds it.
+         *  @param binding the binding point.
+         *  @param data the block data.
+         *  @param size the size of the block.
+         */
+        bool WriteBlock(GLuint binding, const void* data, std::size_t size);
+        /** Replaces the streaming buffer with one twice as large and writes the current frame block to it. */
+        void GrowBuffer();
+
+        /** Holds the alignment needed for binding ranges of uniform buffers. */
+        std::size_t offsetAlignment_;
+        /** Holds the streaming buffer for frame and draw blocks. */
+        StreamingBuffer buffer_;
+        /** Holds the frame block that is currently bound. */
+        FrameUniforms frameData_;
+        /** Flag whether a frame block was written in the current frame. */
+        bool hasFrameData_ = false;
+        /** Flag whether an invalid material index was reported. */
+        bool materialIndexReported_ = false;
+    };
+}
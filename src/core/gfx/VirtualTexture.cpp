@@ -0,0 +1,536 @@
+/**
+ * @file   VirtualTexture.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.24
+ *
+ * @brief  Implementation of virtual textures streaming tiles of very large images from disk.
+ */
+
+#include "VirtualTexture.h"
+#include "core/open_gl.h"
+#include "GPUProgram.h"
+#include "MipmapGenerator.h"
+#include "core/utils/ThreadPool.h"
+
+#ifdef __APPLE_CC__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#endif
+#include <stb_image.h>
+#ifdef __APPLE_CC__
+#pragma clang diagnostic pop
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace viscom {
+
+    namespace {
+        /** The identifier at the start of virtual texture files. */
+        constexpr std::array<char, 4> VT_MAGIC = { 'V', 'T', 'E', 'X' };
+        /** The version of the virtual texture file format. */
+        constexpr std::uint32_t VT_VERSION = 1;
+        /** The number of bytes per texel of a tile. */
+        constexpr std::size_t VT_BYTES_PER_TEXEL = 4;
+        /** The maximum number of tiles read from disk at the same time. */
+        constexpr std::size_t MAX_PENDING_TILES = 64;
+        /** The bits used for each tile coordinate in the feedback buffer (see virtualTexture.glsl). */
+        constexpr unsigned int FEEDBACK_COORDINATE_BITS = 13;
+
+        /** The header of a virtual texture file, followed by the tile offsets of each level and the tiles. */
+        struct VirtualTextureHeader
+        {
+            std::array<char, 4> magic_ = VT_MAGIC;
+            std::uint32_t version_ = VT_VERSION;
+            std::uint32_t width_ = 0;
+            std::uint32_t height_ = 0;
+            std::uint32_t tileSize_ = 0;
+            std::uint32_t border_ = 0;
+            std::uint32_t numLevels_ = 0;
+            std::uint32_t sRGB_ = 0;
+        };
+
+        /** Copies a tile with its border from a level, texels outside the level repeat its edge. */
+        void ExtractTile(const std::uint8_t* level, unsigned int levelWidth, unsigned int levelHeight, unsigned int tileSize, unsigned int border,
+            unsigned int tileX, unsigned int tileY, std::uint8_t* tile)
+        {
+            auto paddedSize = tileSize + 2 * border;
+            for (unsigned int py = 0; py < paddedSize; ++py) {
+                auto sy = std::clamp(static_cast<int>(tileY * tileSize + py) - static_cast<int>(border), 0, static_cast<int>(levelHeight) - 1);
+                auto srcRow = level + static_cast<std::size_t>(sy) * levelWidth * VT_BYTES_PER_TEXEL;
+                auto dstRow = tile + static_cast<std::size_t>(py) * paddedSize * VT_BYTES_PER_TEXEL;
+                for (unsigned int px = 0; px < paddedSize; ++px) {
+                    auto sx = std::clamp(static_cast<int>(tileX * tileSize + px) - static_cast<int>(border), 0, static_cast<int>(levelWidth) - 1);
+                    memcpy(dstRow + px * VT_BYTES_PER_TEXEL, srcRow + static_cast<std::size_t>(sx) * VT_BYTES_PER_TEXEL, VT_BYTES_PER_TEXEL);
+                }
+            }
+        }
+    }
+
+    bool CreateVirtualTextureFile(const std::string& imageFilename, const std::string& vtFilename, unsigned int tileSize,
+        unsigned int border, bool useSRGB, bool flipTexture, ThreadPool* threadPool)
+    {
+        auto& pool = threadPool != nullptr ? *threadPool : ThreadPool::GetDefault();
+
+        auto imgWidth = 0, imgHeight = 0, imgChannels = 0;
+        auto image = stbi_load(imageFilename.c_str(), &imgWidth, &imgHeight, &imgChannels, static_cast<int>(VT_BYTES_PER_TEXEL));
+        if (image == nullptr) {
+            spdlog::warn("Failed to load image for virtual texture ({}).", imageFilename);
+            return false;
+        }
+        auto width = static_cast<unsigned int>(imgWidth);
+        auto height = static_cast<unsigned int>(imgHeight);
+        if (flipTexture) utils::flipImageVertically(image, width * VT_BYTES_PER_TEXEL, height);
+
+        // the pyramid is a square of tiles, so each level has exactly half the tiles per side.
+        unsigned int numLevels = 1;
+        while ((tileSize << (numLevels - 1)) < std::max(width, height)) ++numLevels;
+        auto mipLevels = GenerateMipLevels(image, width, height, static_cast<unsigned int>(VT_BYTES_PER_TEXEL), false, useSRGB, &pool);
+
+        std::ofstream ofs{ vtFilename, std::ios::binary };
+        if (!ofs.is_open()) {
+            spdlog::warn("Could not write virtual texture ({}).", vtFilename);
+            stbi_image_free(image);
+            return false;
+        }
+
+        VirtualTextureHeader header;
+        header.width_ = width;
+        header.height_ = height;
+        header.tileSize_ = tileSize;
+        header.border_ = border;
+        header.numLevels_ = numLevels;
+        header.sRGB_ = useSRGB ? 1 : 0;
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        // the offset tables are written after the tiles are.
+        std::vector<std::vector<std::uint64_t>> tileOffsets(numLevels);
+        auto tableOffset = static_cast<std::uint64_t>(ofs.tellp());
+        for (unsigned int l = 0; l < numLevels; ++l) {
+            auto tilesPerSide = std::size_t{ 1 } << (numLevels - 1 - l);
+            tileOffsets[l].resize(tilesPerSide * tilesPerSide, 0);
+            ofs.write(reinterpret_cast<const char*>(tileOffsets[l].data()), static_cast<std::streamsize>(tileOffsets[l].size() * sizeof(std::uint64_t)));
+        }
+
+        auto paddedSize = tileSize + 2 * border;
+        auto tileDataSize = static_cast<std::size_t>(paddedSize) * paddedSize * VT_BYTES_PER_TEXEL;
+        for (unsigned int l = 0; l < numLevels; ++l) {
+            const auto levelData = l == 0 ? image : mipLevels[l - 1].data_.data();
+            auto levelWidth = l == 0 ? width : mipLevels[l - 1].width_;
+            auto levelHeight = l == 0 ? height : mipLevels[l - 1].height_;
+            auto tilesPerSide = 1U << (numLevels - 1 - l);
+            auto tilesX = std::min((levelWidth + tileSize - 1) / tileSize, tilesPerSide);
+            auto tilesY = std::min((levelHeight + tileSize - 1) / tileSize, tilesPerSide);
+
+            std::vector<std::uint8_t> tileRow(tilesX * tileDataSize);
+            for (unsigned int ty = 0; ty < tilesY; ++ty) {
+                pool.ParallelFor(0, tilesX, [&](std::size_t tileBegin, std::size_t tileEnd) {
+                    for (auto tx = tileBegin; tx < tileEnd; ++tx) {
+                        ExtractTile(levelData, levelWidth, levelHeight, tileSize, border, static_cast<unsigned int>(tx), ty, &tileRow[tx * tileDataSize]);
+                    }
+                }, 1);
+
+                for (unsigned int tx = 0; tx < tilesX; ++tx) tileOffsets[l][static_cast<std::size_t>(ty) * tilesPerSide + tx] = static_cast<std::uint64_t>(ofs.tellp()) + tx * tileDataSize;
+                ofs.write(reinterpret_cast<const char*>(tileRow.data()), static_cast<std::streamsize>(tileRow.size()));
+            }
+        }
+        stbi_image_free(image);
+
+        ofs.seekp(static_cast<std::streamoff>(tableOffset));
+        for (const auto& levelOffsets : tileOffsets) {
+            ofs.write(reinterpret_cast<const char*>(levelOffsets.data()), static_cast<std::streamsize>(levelOffsets.size() * sizeof(std::uint64_t)));
+        }
+        return static_cast<bool>(ofs);
+    }
+
+    VirtualTexture::VirtualTexture(const std::string& filename, unsigned int physicalTilesPerSide, unsigned int feedbackDivisor, ThreadPool* threadPool) :
+        threadPool_{ threadPool != nullptr ? threadPool : &ThreadPool::GetDefault() },
+        file_{ filename, std::ios::binary },
+        // slots are stored in 8 bit page table entries.
+        physicalTilesPerSide_{ std::clamp(physicalTilesPerSide, 1U, 256U) },
+        feedbackDivisor_{ std::max(feedbackDivisor, 1U) }
+    {
+        VirtualTextureHeader header;
+        file_.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!file_ || header.magic_ != VT_MAGIC || header.version_ != VT_VERSION || header.numLevels_ == 0) {
+            spdlog::warn("Could not open virtual texture ({}).", filename);
+            return;
+        }
+
+        tileOffsets_.resize(header.numLevels_);
+        residentSlots_.resize(header.numLevels_);
+        for (unsigned int l = 0; l < header.numLevels_; ++l) {
+            auto tilesPerSide = std::size_t{ 1 } << (header.numLevels_ - 1 - l);
+            tileOffsets_[l].resize(tilesPerSide * tilesPerSide);
+            residentSlots_[l].resize(tilesPerSide * tilesPerSide, -1);
+            file_.read(reinterpret_cast<char*>(tileOffsets_[l].data()), static_cast<std::streamsize>(tileOffsets_[l].size() * sizeof(std::uint64_t)));
+        }
+        if (!file_) {
+            spdlog::warn("Could not open virtual texture ({}).", filename);
+            return;
+        }
+
+        imageSize_ = glm::uvec2{ header.width_, header.height_ };
+        tileSize_ = header.tileSize_;
+        border_ = header.border_;
+        sRGB_ = header.sRGB_ != 0;
+        numLevels_ = header.numLevels_;
+
+        auto physicalSize = static_cast<GLsizei>(physicalTilesPerSide_ * (tileSize_ + 2 * border_));
+        glGenTextures(1, &physicalTexture_);
+        glBindTexture(GL_TEXTURE_2D, physicalTexture_);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, sRGB_ ? GL_SRGB8_ALPHA8 : GL_RGBA8, physicalSize, physicalSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+        glGenTextures(1, &pageTable_);
+        glBindTexture(GL_TEXTURE_2D, pageTable_);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(numLevels_ - 1));
+        for (unsigned int l = 0; l < numLevels_; ++l) {
+            auto tilesPerSide = static_cast<GLsizei>(GetTilesPerSide(l));
+            glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(l), GL_RGBA8UI, tilesPerSide, tilesPerSide, 0, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        auto numSlots = static_cast<std::size_t>(physicalTilesPerSide_) * physicalTilesPerSide_;
+        slotTiles_.resize(numSlots, 0);
+        slotUsed_.resize(numSlots, false);
+        slotLastUsed_.resize(numSlots, 0);
+        lruPositions_.resize(numSlots, lru_.end());
+        for (std::size_t i = 1; i < numSlots; ++i) lruPositions_[i] = lru_.insert(lru_.end(), static_cast<std::int32_t>(i));
+
+        // the coarsest tile stays in slot 0, so every tile has a resident fallback.
+        auto coarsestKey = GetTileKey(numLevels_ - 1, 0, 0);
+        CopyTileToSlot(0, ReadTile(coarsestKey));
+        slotTiles_[0] = coarsestKey;
+        slotUsed_[0] = true;
+        residentSlots_[numLevels_ - 1][0] = 0;
+        statistics_.residentTiles_ = 1;
+        UpdatePageTable();
+    }
+
+    VirtualTexture::~VirtualTexture()
+    {
+        for (auto& task : tasks_) task.wait();
+
+        for (std::size_t i = 0; i < feedbackPBOs_.size(); ++i) {
+            if (feedbackFences_[i] != nullptr) glDeleteSync(feedbackFences_[i]);
+        }
+        glDeleteBuffers(static_cast<GLsizei>(feedbackPBOs_.size()), feedbackPBOs_.data());
+        if (feedbackFBO_ != 0) glDeleteFramebuffers(1, &feedbackFBO_);
+        if (feedbackTexture_ != 0) glDeleteTextures(1, &feedbackTexture_);
+        if (feedbackDepth_ != 0) glDeleteRenderbuffers(1, &feedbackDepth_);
+        if (pageTable_ != 0) glDeleteTextures(1, &pageTable_);
+        if (physicalTexture_ != 0) glDeleteTextures(1, &physicalTexture_);
+    }
+
+    void VirtualTexture::BeginFeedback(const Viewport& viewport)
+    {
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFBO_);
+        glGetIntegerv(GL_VIEWPORT, previousViewport_.data());
+
+        auto size = glm::max((viewport.size_ + glm::uvec2{ feedbackDivisor_ - 1 }) / feedbackDivisor_, glm::uvec2{ 1 });
+        if (size != feedbackSize_) {
+            if (feedbackFBO_ == 0) {
+                glGenFramebuffers(1, &feedbackFBO_);
+                glGenTextures(1, &feedbackTexture_);
+                glGenRenderbuffers(1, &feedbackDepth_);
+            }
+            feedbackSize_ = size;
+
+            glBindTexture(GL_TEXTURE_2D, feedbackTexture_);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, static_cast<GLsizei>(size.x), static_cast<GLsizei>(size.y), 0, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            glBindRenderbuffer(GL_RENDERBUFFER, feedbackDepth_);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, static_cast<GLsizei>(size.x), static_cast<GLsizei>(size.y));
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, feedbackFBO_);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, feedbackTexture_, 0);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedbackDepth_);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) spdlog::warn("Virtual texture feedback buffer is incomplete.");
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, feedbackFBO_);
+        glViewport(0, 0, static_cast<GLsizei>(feedbackSize_.x), static_cast<GLsizei>(feedbackSize_.y));
+        // 0 marks texels without a virtual texture.
+        const std::array<GLuint, 4> noTile = { 0, 0, 0, 0 };
+        const GLfloat farDepth = 1.0f;
+        glClearBufferuiv(GL_COLOR, 0, noTile.data());
+        glClearBufferfv(GL_DEPTH, 0, &farDepth);
+    }
+
+    void VirtualTexture::EndFeedback()
+    {
+        // if the read back of two frames ago is still running, this frames feedback is dropped.
+        auto pboIndex = nextFeedbackPBO_;
+        if (feedbackFences_[pboIndex] == nullptr) {
+            if (feedbackPBOs_[pboIndex] == 0) glGenBuffers(1, &feedbackPBOs_[pboIndex]);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackPBOs_[pboIndex]);
+            glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(static_cast<std::size_t>(feedbackSize_.x) * feedbackSize_.y * sizeof(GLuint)), nullptr, GL_STREAM_READ);
+            glReadBuffer(GL_COLOR_ATTACHMENT0);
+            glPixelStorei(GL_PACK_ALIGNMENT, 4);
+            glReadPixels(0, 0, static_cast<GLsizei>(feedbackSize_.x), static_cast<GLsizei>(feedbackSize_.y), GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            feedbackFences_[pboIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            feedbackReadSizes_[pboIndex] = feedbackSize_;
+            nextFeedbackPBO_ = (pboIndex + 1) % feedbackPBOs_.size();
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previousFBO_));
+        glViewport(previousViewport_[0], previousViewport_[1], previousViewport_[2], previousViewport_[3]);
+    }
+
+    void VirtualTexture::RequestRegion(const glm::vec2& uvMin, const glm::vec2& uvMax, unsigned int level)
+    {
+        if (!IsValid()) return;
+        level = std::min(level, numLevels_ - 1);
+
+        auto tilesPerSide = GetTilesPerSide(level);
+        auto virtualSize = static_cast<float>(tileSize_ << (numLevels_ - 1));
+        auto imageScale = glm::vec2{ imageSize_ } / virtualSize;
+        auto toTile = [imageScale, tilesPerSide](const glm::vec2& uv) {
+            auto tile = glm::clamp(uv, glm::vec2{ 0.0f }, glm::vec2{ 1.0f }) * imageScale * static_cast<float>(tilesPerSide);
+            return glm::min(glm::uvec2{ tile }, glm::uvec2{ tilesPerSide - 1 });
+        };
+
+        auto tileMin = toTile(glm::min(uvMin, uvMax));
+        auto tileMax = toTile(glm::max(uvMin, uvMax));
+        for (auto y = tileMin.y; y <= tileMax.y; ++y) {
+            for (auto x = tileMin.x; x <= tileMax.x; ++x) RequestTile(level, x, y);
+        }
+    }
+
+    void VirtualTexture::Update(std::size_t maxUploadsPerFrame)
+    {
+        if (!IsValid()) return;
+
+        ProcessFeedback();
+        StartLoads();
+
+        std::vector<LoadedTile> tiles;
+        {
+            std::lock_guard<std::mutex> lock{ loadedMutex_ };
+            auto numTiles = std::min(maxUploadsPerFrame, loadedTiles_.size());
+            tiles.insert(tiles.end(), std::make_move_iterator(loadedTiles_.begin()), std::make_move_iterator(loadedTiles_.begin() + static_cast<std::ptrdiff_t>(numTiles)));
+            loadedTiles_.erase(loadedTiles_.begin(), loadedTiles_.begin() + static_cast<std::ptrdiff_t>(numTiles));
+        }
+        for (const auto& tile : tiles) {
+            pendingTiles_.erase(std::find(pendingTiles_.begin(), pendingTiles_.end(), tile.key_));
+            if (!tile.data_.empty()) UploadTile(tile);
+        }
+        if (pageTableDirty_) UpdatePageTable();
+
+        statistics_.pendingTiles_ = pendingTiles_.size();
+        tasks_.erase(std::remove_if(tasks_.begin(), tasks_.end(), [](const std::future<void>& task) { return utils::is_ready(task); }), tasks_.end());
+        requests_.clear();
+        ++frame_;
+    }
+
+    void VirtualTexture::SetUniforms(const GPUProgram& program, GLint pageTableUnit, GLint physicalUnit) const
+    {
+        glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(pageTableUnit));
+        glBindTexture(GL_TEXTURE_2D, pageTable_);
+        glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(physicalUnit));
+        glBindTexture(GL_TEXTURE_2D, physicalTexture_);
+        glActiveTexture(GL_TEXTURE0);
+
+        auto virtualSize = static_cast<float>(tileSize_ << (numLevels_ - 1));
+        auto paddedSize = static_cast<float>(tileSize_ + 2 * border_);
+        auto imageScale = glm::vec2{ imageSize_ } / virtualSize;
+        glUniform1i(program.getUniformLocation("vtPageTable"), pageTableUnit);
+        glUniform1i(program.getUniformLocation("vtPhysicalTexture"), physicalUnit);
+        glUniform2f(program.getUniformLocation("vtImageScale"), imageScale.x, imageScale.y);
+        glUniform1f(program.getUniformLocation("vtVirtualSize"), virtualSize);
+        glUniform1i(program.getUniformLocation("vtNumLevels"), static_cast<GLint>(numLevels_));
+        glUniform3f(program.getUniformLocation("vtTileParameters"), static_cast<float>(tileSize_), static_cast<float>(border_), paddedSize);
+        glUniform1f(program.getUniformLocation("vtPhysicalSize"), paddedSize * static_cast<float>(physicalTilesPerSide_));
+        glUniform1f(program.getUniformLocation("vtFeedbackLodBias"), -std::log2(static_cast<float>(feedbackDivisor_)));
+    }
+
+    std::uint64_t VirtualTexture::GetTileKey(unsigned int level, unsigned int x, unsigned int y) noexcept
+    {
+        return (static_cast<std::uint64_t>(level) << 48) | (static_cast<std::uint64_t>(y) << 24) | static_cast<std::uint64_t>(x);
+    }
+
+    std::size_t VirtualTexture::GetTileDataSize() const noexcept
+    {
+        auto paddedSize = static_cast<std::size_t>(tileSize_ + 2 * border_);
+        return paddedSize * paddedSize * VT_BYTES_PER_TEXEL;
+    }
+
+    std::vector<std::uint8_t> VirtualTexture::ReadTile(std::uint64_t key)
+    {
+        auto level = static_cast<unsigned int>(key >> 48);
+        auto y = static_cast<std::size_t>((key >> 24) & 0xFFFFFF);
+        auto x = static_cast<std::size_t>(key & 0xFFFFFF);
+
+        std::vector<std::uint8_t> data;
+        std::lock_guard<std::mutex> lock{ fileMutex_ };
+        auto offset = tileOffsets_[level][y * GetTilesPerSide(level) + x];
+        if (offset == 0) return data;
+
+        data.resize(GetTileDataSize());
+        file_.clear();
+        file_.seekg(static_cast<std::streamoff>(offset));
+        file_.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!file_) {
+            spdlog::warn("Could not read virtual texture tile (level {}, {}, {}).", level, x, y);
+            data.clear();
+        }
+        return data;
+    }
+
+    void VirtualTexture::RequestTile(unsigned int level, unsigned int x, unsigned int y)
+    {
+        for (auto l = level; l < numLevels_; ++l, x /= 2, y /= 2) {
+            auto index = static_cast<std::size_t>(y) * GetTilesPerSide(l) + x;
+            auto slot = residentSlots_[l][index];
+            if (slot < 0) {
+                if (tileOffsets_[l][index] != 0) requests_.push_back(GetTileKey(l, x, y));
+                continue;
+            }
+
+            // the ancestors of a tile used before in this frame are already handled.
+            if (slotLastUsed_[static_cast<std::size_t>(slot)] == frame_ && slot != 0) return;
+            slotLastUsed_[static_cast<std::size_t>(slot)] = frame_;
+            if (slot != 0) lru_.splice(lru_.begin(), lru_, lruPositions_[static_cast<std::size_t>(slot)]);
+        }
+    }
+
+    void VirtualTexture::ProcessFeedback()
+    {
+        constexpr std::uint32_t coordinateMask = (1U << FEEDBACK_COORDINATE_BITS) - 1;
+        for (std::size_t i = 0; i < feedbackPBOs_.size(); ++i) {
+            if (feedbackFences_[i] == nullptr) continue;
+            auto waitResult = glClientWaitSync(feedbackFences_[i], 0, 0);
+            if (waitResult != GL_ALREADY_SIGNALED && waitResult != GL_CONDITION_SATISFIED) continue;
+            glDeleteSync(feedbackFences_[i]);
+            feedbackFences_[i] = nullptr;
+
+            auto numTexels = static_cast<std::size_t>(feedbackReadSizes_[i].x) * feedbackReadSizes_[i].y;
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackPBOs_[i]);
+            auto feedback = static_cast<const GLuint*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(numTexels * sizeof(GLuint)), GL_MAP_READ_BIT));
+            if (feedback != nullptr) {
+                GLuint lastValue = 0;
+                for (std::size_t t = 0; t < numTexels; ++t) {
+                    // neighbouring texels mostly need the same tile.
+                    if (feedback[t] == 0 || feedback[t] == lastValue) continue;
+                    lastValue = feedback[t];
+                    auto value = lastValue - 1;
+                    auto level = std::min(value >> (2 * FEEDBACK_COORDINATE_BITS), numLevels_ - 1);
+                    auto tilesPerSide = GetTilesPerSide(level);
+                    auto y = std::min((value >> FEEDBACK_COORDINATE_BITS) & coordinateMask, tilesPerSide - 1);
+                    auto x = std::min(value & coordinateMask, tilesPerSide - 1);
+                    RequestTile(level, x, y);
+                }
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+    }
+
+    void VirtualTexture::StartLoads()
+    {
+        // coarse tiles have larger keys and are loaded first, as they are fallbacks for more tiles.
+        std::sort(requests_.begin(), requests_.end(), std::greater<>());
+        requests_.erase(std::unique(requests_.begin(), requests_.end()), requests_.end());
+        statistics_.requestedTiles_ = requests_.size();
+
+        for (auto key : requests_) {
+            if (pendingTiles_.size() >= MAX_PENDING_TILES) break;
+            if (std::find(pendingTiles_.begin(), pendingTiles_.end(), key) != pendingTiles_.end()) continue;
+
+            pendingTiles_.push_back(key);
+            tasks_.emplace_back(threadPool_->Enqueue([this, key]() {
+                LoadedTile tile{ key, ReadTile(key) };
+                std::lock_guard<std::mutex> lock{ loadedMutex_ };
+                loadedTiles_.emplace_back(std::move(tile));
+            }));
+        }
+    }
+
+    void VirtualTexture::CopyTileToSlot(std::int32_t slot, const std::vector<std::uint8_t>& data) const
+    {
+        if (data.empty()) return;
+
+        auto paddedSize = static_cast<GLint>(tileSize_ + 2 * border_);
+        auto slotX = static_cast<GLint>(static_cast<unsigned int>(slot) % physicalTilesPerSide_);
+        auto slotY = static_cast<GLint>(static_cast<unsigned int>(slot) / physicalTilesPerSide_);
+        glBindTexture(GL_TEXTURE_2D, physicalTexture_);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, slotX * paddedSize, slotY * paddedSize, paddedSize, paddedSize, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    void VirtualTexture::UploadTile(const LoadedTile& tile)
+    {
+        auto level = static_cast<unsigned int>(tile.key_ >> 48);
+        auto y = static_cast<std::size_t>((tile.key_ >> 24) & 0xFFFFFF);
+        auto x = static_cast<std::size_t>(tile.key_ & 0xFFFFFF);
+        auto index = y * GetTilesPerSide(level) + x;
+        if (residentSlots_[level][index] >= 0 || lru_.empty()) return;
+
+        // if all slots were used in this frame the tile is dropped and requested again later.
+        auto slot = lru_.back();
+        auto slotIndex = static_cast<std::size_t>(slot);
+        if (slotUsed_[slotIndex] && slotLastUsed_[slotIndex] == frame_) return;
+
+        if (slotUsed_[slotIndex]) {
+            auto evictedKey = slotTiles_[slotIndex];
+            auto evictedLevel = static_cast<unsigned int>(evictedKey >> 48);
+            auto evictedY = static_cast<std::size_t>((evictedKey >> 24) & 0xFFFFFF);
+            auto evictedX = static_cast<std::size_t>(evictedKey & 0xFFFFFF);
+            residentSlots_[evictedLevel][evictedY * GetTilesPerSide(evictedLevel) + evictedX] = -1;
+            statistics_.evictedTiles_ += 1;
+            statistics_.residentTiles_ -= 1;
+        }
+
+        CopyTileToSlot(slot, tile.data_);
+        slotTiles_[slotIndex] = tile.key_;
+        slotUsed_[slotIndex] = true;
+        slotLastUsed_[slotIndex] = frame_;
+        lru_.splice(lru_.begin(), lru_, lruPositions_[slotIndex]);
+        residentSlots_[level][index] = slot;
+        pageTableDirty_ = true;
+        statistics_.uploadedTiles_ += 1;
+        statistics_.residentTiles_ += 1;
+    }
+
+    void VirtualTexture::UpdatePageTable()
+    {
+        // each entry holds the slot and level of the finest resident tile covering it, starting at the coarsest level.
+        std::vector<glm::u8vec4> parentEntries;
+        std::vector<glm::u8vec4> entries;
+        glBindTexture(GL_TEXTURE_2D, pageTable_);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (auto l = static_cast<int>(numLevels_) - 1; l >= 0; --l) {
+            auto level = static_cast<unsigned int>(l);
+            auto tilesPerSide = static_cast<std::size_t>(GetTilesPerSide(level));
+            entries.assign(tilesPerSide * tilesPerSide, glm::u8vec4{ 0 });
+            for (std::size_t y = 0; y < tilesPerSide; ++y) {
+                for (std::size_t x = 0; x < tilesPerSide; ++x) {
+                    auto slot = residentSlots_[level][y * tilesPerSide + x];
+                    if (slot >= 0) {
+                        auto slotIndex = static_cast<unsigned int>(slot);
+                        entries[y * tilesPerSide + x] = glm::u8vec4{ slotIndex % physicalTilesPerSide_, slotIndex / physicalTilesPerSide_, level, 255 };
+                    }
+                    else if (!parentEntries.empty()) entries[y * tilesPerSide + x] = parentEntries[(y / 2) * (tilesPerSide / 2) + x / 2];
+                }
+            }
+            glTexSubImage2D(GL_TEXTURE_2D, l, 0, 0, static_cast<GLsizei>(tilesPerSide), static_cast<GLsizei>(tilesPerSide), GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, entries.data());
+            std::swap(parentEntries, entries);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        pageTableDirty_ = false;
+    }
+}
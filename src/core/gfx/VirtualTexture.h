@@ -0,0 +1,248 @@
+/**
+ * @file   VirtualTexture.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.24
+ *
+ * @brief  Declaration of virtual textures streaming tiles of very large images from disk.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "core/open_gl_fwd.h"
+#include "core/gfx/FrameBuffer.h"
+#include <array>
+#include <fstream>
+#include <future>
+#include <list>
+#include <mutex>
+
+namespace viscom {
+
+    class GPUProgram;
+    class ThreadPool;
+
+    /**
+     *  Splits an image into a virtual texture file holding a mip pyramid of tiles (offline step).
+     *  The pyramid is padded to a square of tileSize * 2^n texels, tiles completely outside the image are not stored.
+     *  Each tile is stored with a border of neighbouring texels for bilinear filtering as uncompressed RGBA8.
+     *  The whole image is decoded in memory, so this should run in a separate tool and not on the cluster nodes.
+     *  @param imageFilename the source image.
+     *  @param vtFilename the virtual texture file to write.
+     *  @param tileSize the size of a tile without border in texels.
+     *  @param border the size of the border around each tile in texels.
+     *  @param useSRGB whether the image is sRGB encoded (used for filtering the mip levels).
+     *  @param flipTexture flips the image so that the first row is at the bottom (as Texture does).
+     *  @param threadPool the thread pool to use (nullptr uses the default pool).
+     *  @return whether the file could be written.
+     */
+    bool CreateVirtualTextureFile(const std::string& imageFilename, const std::string& vtFilename, unsigned int tileSize = 128,
+        unsigned int border = 4, bool useSRGB = true, bool flipTexture = true, ThreadPool* threadPool = nullptr);
+
+    /** Counters of a virtual texture. */
+    struct VirtualTextureStatistics
+    {
+        /** The number of tiles resident in the physical texture. */
+        std::size_t residentTiles_ = 0;
+        /** The number of tiles requested by the last feedback. */
+        std::size_t requestedTiles_ = 0;
+        /** The number of tiles currently read from disk. */
+        std::size_t pendingTiles_ = 0;
+        /** The number of tiles uploaded in total. */
+        std::size_t uploadedTiles_ = 0;
+        /** The number of tiles evicted in total. */
+        std::size_t evictedTiles_ = 0;
+    };
+
+    /**
+     *  A texture too large for the GPU that is streamed in tiles. A page table texture maps each tile of the mip pyramid
+     *  to a slot in a physical texture caching the resident tiles, tiles that are not resident fall back to the finest
+     *  resident tile covering them. A feedback pass renders the tiles needed by the current view into a small integer
+     *  buffer that is read back asynchronously; the missing tiles are read from disk on a thread pool and the least
+     *  recently used tiles are replaced. As every node renders the feedback pass for its own viewport only, each cluster
+     *  node loads just the tiles it displays. Shaders use the functions in shader/virtualTexture.glsl.
+     *  All methods need to be called from the thread owning the OpenGL context.
+     */
+    class VirtualTexture final
+    {
+    public:
+        /**
+         *  Constructor, opens the virtual texture file and loads the coarsest tile.
+         *  @param filename the virtual texture file (see CreateVirtualTextureFile).
+         *  @param physicalTilesPerSide the number of tiles in each dimension of the physical texture.
+         *  @param feedbackDivisor the factor the feedback buffer is smaller than the viewport.
+         *  @param threadPool the thread pool for reading tiles (nullptr uses the default pool).
+         */
+        explicit VirtualTexture(const std::string& filename, unsigned int physicalTilesPerSide = 32, unsigned int feedbackDivisor = 8,
+            ThreadPool* threadPool = nullptr);
+        VirtualTexture(const VirtualTexture&) = delete;
+        VirtualTexture& operator=(const VirtualTexture&) = delete;
+        /** Destructor, waits for running reads. */
+        ~VirtualTexture();
+
+        /** Checks if the file could be opened. */
+        bool IsValid() const noexcept { return numLevels_ > 0; }
+        /** Returns the size of the image in texels. */
+        const glm::uvec2& GetDimensions() const noexcept { return imageSize_; }
+        /** Returns the number of levels of the mip pyramid. */
+        unsigned int GetNumberOfLevels() const noexcept { return numLevels_; }
+        /** Returns the statistics. */
+        const VirtualTextureStatistics& GetStatistics() const noexcept { return statistics_; }
+
+        /**
+         *  Binds the feedback buffer, the scene needs to be drawn with the feedback functions of virtualTexture.glsl.
+         *  @param viewport the viewport of the current node (e.g. GetViewportScreen(windowId)).
+         */
+        void BeginFeedback(const Viewport& viewport);
+        /** Starts reading back the feedback buffer and restores the previous frame buffer and viewport. */
+        void EndFeedback();
+        /**
+         *  Requests all tiles of a level overlapping a region, e.g. the part of the image a node displays.
+         *  @param uvMin the lower left corner of the region in texture coordinates.
+         *  @param uvMax the upper right corner of the region in texture coordinates.
+         *  @param level the mip level.
+         */
+        void RequestRegion(const glm::vec2& uvMin, const glm::vec2& uvMax, unsigned int level);
+
+        /**
+         *  Processes finished feedback read backs, starts reading missing tiles and uploads loaded tiles.
+         *  Should be called once per frame.
+         *  @param maxUploadsPerFrame the maximum number of tiles uploaded in this call.
+         */
+        void Update(std::size_t maxUploadsPerFrame = 16);
+
+        /**
+         *  Binds the page table and physical texture and sets the uniforms of virtualTexture.glsl.
+         *  @param program the program in use.
+         *  @param pageTableUnit the texture unit for the page table.
+         *  @param physicalUnit the texture unit for the physical texture.
+         */
+        void SetUniforms(const GPUProgram& program, GLint pageTableUnit, GLint physicalUnit) const;
+
+    private:
+        /** A tile read from disk. */
+        struct LoadedTile
+        {
+            /** The key of the tile. */
+            std::uint64_t key_ = 0;
+            /** The texels of the tile including its border. */
+            std::vector<std::uint8_t> data_;
+        };
+
+        /** Creates a key from the level and coordinates of a tile. */
+        static std::uint64_t GetTileKey(unsigned int level, unsigned int x, unsigned int y) noexcept;
+        /** Returns the number of tiles per side of a level. */
+        unsigned int GetTilesPerSide(unsigned int level) const noexcept { return 1U << (numLevels_ - 1 - level); }
+        /** Returns the size of a tile including its border in bytes. */
+        std::size_t GetTileDataSize() const noexcept;
+
+        /**
+         *  Reads a tile from disk, can be called from worker threads.
+         *  @param key the key of the tile.
+         *  @return the tile data or an empty vector if the tile is not stored.
+         */
+        std::vector<std::uint8_t> ReadTile(std::uint64_t key);
+        /**
+         *  Requests a tile and all of its ancestors and marks them as used in this frame.
+         *  @param level the mip level.
+         *  @param x the horizontal tile coordinate.
+         *  @param y the vertical tile coordinate.
+         */
+        void RequestTile(unsigned int level, unsigned int x, unsigned int y);
+        /** Maps finished feedback read backs and requests their tiles. */
+        void ProcessFeedback();
+        /** Starts reading requested tiles that are not resident. */
+        void StartLoads();
+        /**
+         *  Copies the texels of a tile to a slot of the physical texture.
+         *  @param slot the slot.
+         *  @param data the texels of the tile including its border.
+         */
+        void CopyTileToSlot(std::int32_t slot, const std::vector<std::uint8_t>& data) const;
+        /**
+         *  Copies a loaded tile to a slot of the physical texture, replacing the least recently used tile.
+         *  @param tile the loaded tile.
+         */
+        void UploadTile(const LoadedTile& tile);
+        /** Rebuilds and uploads the page table. */
+        void UpdatePageTable();
+
+        /** Holds the thread pool. */
+        ThreadPool* threadPool_;
+        /** Holds the virtual texture file. */
+        std::ifstream file_;
+        /** Protects the file from concurrent reads. */
+        std::mutex fileMutex_;
+        /** Holds the size of the image. */
+        glm::uvec2 imageSize_ = glm::uvec2{ 0 };
+        /** Holds the tile size without border. */
+        unsigned int tileSize_ = 0;
+        /** Holds the border size. */
+        unsigned int border_ = 0;
+        /** Holds the number of levels. */
+        unsigned int numLevels_ = 0;
+        /** Whether the tiles are sRGB encoded. */
+        bool sRGB_ = false;
+        /** Holds the file offsets of the tiles for each level (0 if not stored). */
+        std::vector<std::vector<std::uint64_t>> tileOffsets_;
+
+        /** Holds the number of slots in each dimension of the physical texture. */
+        unsigned int physicalTilesPerSide_;
+        /** Holds the physical texture. */
+        GLuint physicalTexture_ = 0;
+        /** Holds the page table texture. */
+        GLuint pageTable_ = 0;
+        /** Holds the slot of each resident tile for each level (-1 if not resident). */
+        std::vector<std::vector<std::int32_t>> residentSlots_;
+        /** Holds the key of the tile in each slot. */
+        std::vector<std::uint64_t> slotTiles_;
+        /** Whether a slot holds a tile. */
+        std::vector<bool> slotUsed_;
+        /** Holds the frame each slot was last used in. */
+        std::vector<std::uint64_t> slotLastUsed_;
+        /** Holds the slots from most to least recently used (the slot of the coarsest tile is never included). */
+        std::list<std::int32_t> lru_;
+        /** Holds the position of each slot in the LRU list. */
+        std::vector<std::list<std::int32_t>::iterator> lruPositions_;
+        /** Flag whether the page table needs to be rebuilt. */
+        bool pageTableDirty_ = true;
+
+        /** Holds the factor the feedback buffer is smaller than the viewport. */
+        unsigned int feedbackDivisor_;
+        /** Holds the size of the feedback buffer. */
+        glm::uvec2 feedbackSize_ = glm::uvec2{ 0 };
+        /** Holds the feedback frame buffer. */
+        GLuint feedbackFBO_ = 0;
+        /** Holds the feedback color texture. */
+        GLuint feedbackTexture_ = 0;
+        /** Holds the feedback depth buffer. */
+        GLuint feedbackDepth_ = 0;
+        /** Holds the pixel buffers the feedback is read into. */
+        std::array<GLuint, 2> feedbackPBOs_ = { 0, 0 };
+        /** Holds the fences of the feedback read backs. */
+        std::array<GLsync, 2> feedbackFences_ = { nullptr, nullptr };
+        /** Holds the sizes of the feedback read backs. */
+        std::array<glm::uvec2, 2> feedbackReadSizes_;
+        /** Holds the pixel buffer of the next read back. */
+        std::size_t nextFeedbackPBO_ = 0;
+        /** Holds the frame buffer bound before the feedback pass. */
+        GLint previousFBO_ = 0;
+        /** Holds the viewport set before the feedback pass. */
+        std::array<GLint, 4> previousViewport_ = { 0, 0, 0, 0 };
+
+        /** Holds the current frame (starts at 1 as 0 marks slots that were never used). */
+        std::uint64_t frame_ = 1;
+        /** Holds the keys of tiles requested in this frame that are not resident. */
+        std::vector<std::uint64_t> requests_;
+        /** Holds the keys of tiles read from disk. */
+        std::vector<std::uint64_t> pendingTiles_;
+        /** Holds the tiles read from disk that wait for the upload. */
+        std::vector<LoadedTile> loadedTiles_;
+        /** Protects the loaded tiles. */
+        std::mutex loadedMutex_;
+        /** Holds the read tasks that may still run. */
+        std::vector<std::future<void>> tasks_;
+        /** Holds the statistics. */
+        VirtualTextureStatistics statistics_;
+    };
+}
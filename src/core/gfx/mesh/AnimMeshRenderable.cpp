@@ -8,8 +8,7 @@
 
 
 #include "core/open_gl.h"
-#include "SceneMeshNode.h"
-#include "SubMesh.h"
+#include "SkinningBuffer.h"
 #include "core/gfx/Material.h"
 #include "core/gfx/Texture.h"
 #include <glm/gtc/matrix_inverse.hpp>
@@ -18,6 +17,7 @@
 #include <cmath>
 
 #include "AnimMeshRenderable.h"
+#include "SceneMeshNode.h"
 
 namespace viscom {
 
@@ -30,7 +30,8 @@ namespace viscom {
         mesh_(renderMesh),
         vbo_(vBuffer),
         vao_(0),
-        drawProgram_(program)
+        drawProgram_(program),
+        drawList_(renderMesh)
     {
     }
 
@@ -54,7 +55,9 @@ namespace viscom {
         vbo_(orig.vbo_),
         vao_(orig.vao_),
         drawProgram_(orig.drawProgram_),
-        uniformLocations_(std::move(orig.uniformLocations_))
+        uniformLocations_(std::move(orig.uniformLocations_)),
+        uniformBuffers_(orig.uniformBuffers_),
+        drawList_(std::move(orig.drawList_))
     {
         orig.mesh_ = nullptr;
         orig.vbo_ = 0;
@@ -75,6 +78,8 @@ namespace viscom {
             vao_ = orig.vao_;
             drawProgram_ = orig.drawProgram_;
             uniformLocations_ = std::move(orig.uniformLocations_);
+            uniformBuffers_ = orig.uniformBuffers_;
+            drawList_ = std::move(orig.drawList_);
             orig.mesh_ = nullptr;
             orig.vbo_ = 0;
             orig.vao_ = 0;
@@ -90,51 +95,100 @@ namespace viscom {
         glBindVertexArray(vao_);
         glBindBuffer(GL_ARRAY_BUFFER, vbo_);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh_->GetIndexBuffer());
+        if (uniformBuffers_) UniformBuffers::BindMaterialBuffer(mesh_->GetMaterialBuffer(), mesh_->GetMaterialTextureBuffer());
         glUniformMatrix4fv(uniformLocations_[5], static_cast<GLsizei>(skinningMatrices.size()), GL_FALSE, glm::value_ptr(*skinningMatrices.data()));
-        DrawNodeAnimated(modelMatrix, animState, mesh_->GetRootNode(), overrideBump);
+        DrawListAnimated(modelMatrix, animState, overrideBump);
         glBindVertexArray(0);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
     }
 
-    void AnimMeshRenderable::DrawNodeAnimated(const glm::mat4& modelMatrix, const AnimationState& animState, const SceneMeshNode* node, bool overrideBump) const
+    void AnimMeshRenderable::DrawAnimated(const glm::mat4& modelMatrix, const AnimationState& animState, const SkinningBuffer& skinningBuffer,
+        std::size_t paletteOffset, bool overrideBump) const
     {
-        if (!node->HasMeshes()) return;
-
-        auto nodeGlobalMatrix = animState.GetGlobalBonePose(node->GetNodeIndex());
-        auto localMatrix = modelMatrix * nodeGlobalMatrix;
-
-        for (std::size_t i = 0; i < node->GetNumberOfSubMeshes(); ++i) {
-            const auto* submesh = &mesh_->GetSubMeshes()[node->GetSubMeshID(i)];
-            DrawSubMeshAnimated(localMatrix, nodeGlobalMatrix, submesh, overrideBump);
+        if (paletteOffset == SkinningBuffer::INVALID_OFFSET) {
+            DrawAnimated(modelMatrix, animState, overrideBump);
+            return;
         }
 
-        for (std::size_t i = 0; i < node->GetNumberOfNodes(); ++i) DrawNodeAnimated(modelMatrix, animState, node->GetChild(i), overrideBump);
+        glUseProgram(drawProgram_->getProgramId());
+        glBindVertexArray(vao_);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh_->GetIndexBuffer());
+        if (uniformBuffers_) UniformBuffers::BindMaterialBuffer(mesh_->GetMaterialBuffer(), mesh_->GetMaterialTextureBuffer());
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_BUFFER, skinningBuffer.GetTexture());
+        glUniform1i(uniformLocations_[7], 2);
+        glUniform1i(uniformLocations_[8], static_cast<GLint>(paletteOffset));
+        glUniform1i(uniformLocations_[9], static_cast<GLint>(skinningBuffer.GetEncoding()));
+        DrawListAnimated(modelMatrix, animState, overrideBump);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void AnimMeshRenderable::DrawNodeAnimated(const glm::mat4& modelMatrix, const AnimationState& animState, const SceneMeshNode* node, bool overrideBump) const
+    {
+        if (uniformBuffers_) UniformBuffers::BindMaterialBuffer(mesh_->GetMaterialBuffer(), mesh_->GetMaterialTextureBuffer());
+        DrawListAnimated(modelMatrix, animState, overrideBump, node);
     }
 
-    void AnimMeshRenderable::DrawSubMeshAnimated(const glm::mat4& modelMatrix, const glm::mat4& nodePose_, const SubMesh* subMesh, bool overrideBump) const
+    void AnimMeshRenderable::DrawListAnimated(const glm::mat4& modelMatrix, const AnimationState& animState, bool overrideBump, const SceneMeshNode* node) const
     {
-        if (subMesh->GetNumberOfIndices() == 0) return;
+        const auto& nodes = drawList_.GetNodes();
+        const auto& draws = drawList_.GetDraws();
+        // the global poses of the nodes are in mesh space already.
+        const auto& nodePoses = animState.GetGlobalBonePoses();
+        drawList_.UpdateWorldTransforms(modelMatrix, nodePoses);
+
+        std::size_t firstNode = node ? node->GetNodeIndex() : 0;
+        std::size_t endNode = node ? nodes[firstNode].subTreeEnd_ : nodes.size();
+        for (auto i = firstNode; i < endNode;) {
+            const auto& record = nodes[i];
+            if (!record.hasMeshes_) {
+                i = record.subTreeEnd_;
+                continue;
+            }
+
+            if (record.numDraws_ > 0) {
+                // computed once per node instead of per sub mesh.
+                auto invNodeMatrix = glm::inverse(nodePoses[i]);
+                for (auto d = record.firstDraw_; d < record.firstDraw_ + record.numDraws_; ++d) DrawSubMeshAnimated(draws[d], invNodeMatrix, overrideBump);
+            }
+            ++i;
+        }
+    }
 
-        glUniformMatrix4fv(uniformLocations_[0], 1, GL_FALSE, glm::value_ptr(modelMatrix));
-        glUniformMatrix3fv(uniformLocations_[1], 1, GL_FALSE, glm::value_ptr(glm::inverseTranspose(glm::mat3(modelMatrix))));
-        glUniformMatrix4fv(uniformLocations_[6], 1, GL_FALSE, glm::value_ptr(glm::inverse(nodePose_)));
+    void AnimMeshRenderable::DrawSubMeshAnimated(const MeshDrawList::DrawRecord& draw, const glm::mat4& invNodePose, bool overrideBump) const
+    {
+        auto mat = mesh_->GetMaterial(draw.materialIndex_);
+        const auto& worldMatrix = drawList_.GetWorldMatrices()[draw.nodeIndex_];
+        const auto& normalMatrix = drawList_.GetNormalMatrices()[draw.nodeIndex_];
+        // falls back to the loose uniforms if there are no uniform buffers or the material does not fit into them.
+        if (!uniformBuffers_ || !uniformBuffers_->SetDrawData(worldMatrix, normalMatrix, draw.materialIndex_, overrideBump ? -1.0f : mat->bumpMultiplier)) {
+            // programs reading only the draw block would use the block of the previous draw.
+            if (uniformBuffers_ && uniformLocations_[0] < 0) return;
+            glUniformMatrix4fv(uniformLocations_[0], 1, GL_FALSE, glm::value_ptr(worldMatrix));
+            glUniformMatrix3fv(uniformLocations_[1], 1, GL_FALSE, glm::value_ptr(normalMatrix));
+        }
+        glUniformMatrix4fv(uniformLocations_[6], 1, GL_FALSE, glm::value_ptr(invNodePose));
 
-        auto mat = mesh_->GetMaterial(subMesh->GetMaterialIndex());
-        auto matTex = mesh_->GetMaterialTexture(subMesh->GetMaterialIndex());
+        auto matTex = mesh_->GetMaterialTexture(draw.materialIndex_);
         if (matTex->diffuseTex && uniformLocations_.size() > 2) {
             glActiveTexture(GL_TEXTURE0);
             glBindTexture(GL_TEXTURE_2D, matTex->diffuseTex->getTextureId());
+            matTex->diffuseTex->MarkUsed();
             glUniform1i(uniformLocations_[2], 0);
         }
         if (matTex->bumpTex && uniformLocations_.size() > 3) {
             glActiveTexture(GL_TEXTURE1);
             glBindTexture(GL_TEXTURE_2D, matTex->bumpTex->getTextureId());
+            matTex->bumpTex->MarkUsed();
             glUniform1i(uniformLocations_[3], 1);
             if (!overrideBump) glUniform1f(uniformLocations_[4], mat->bumpMultiplier);
         }
 
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(subMesh->GetNumberOfIndices()), GL_UNSIGNED_INT,
-            reinterpret_cast<char*>(static_cast<std::size_t>(subMesh->GetIndexOffset()) * sizeof(unsigned int)));
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(draw.numIndices_), GL_UNSIGNED_INT,
+            reinterpret_cast<char*>(static_cast<std::size_t>(draw.indexOffset_) * sizeof(unsigned int)));
     }
 }
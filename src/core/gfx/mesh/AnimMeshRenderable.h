@@ -10,7 +10,9 @@
 
 #include "core/main.h"
 #include "Mesh.h"
+#include "MeshDrawList.h"
 #include "core/gfx/GPUProgram.h"
+#include "core/gfx/UniformBuffers.h"
 
 #include <vector>
 #include "AnimationState.h"
@@ -18,6 +20,7 @@
 namespace viscom {
 
     class Mesh;
+    class SkinningBuffer;
 
     /**
      *  This class renders a mesh with a specific shader. The shader is assumed to have fixed uniform names:
@@ -26,9 +29,15 @@ namespace viscom {
      *  diffuseTexture: the diffuse texture.
      *  bumpTexture: a bump map.
      *  bumpMultiplier: the bump multiplier.
+     *  skinningMatrices: the skinning matrices (if no skinning buffer is used).
+     *  invNodeMatrix: the inverse of the nodes global pose.
+     *  skinningPalette, skinningOffset, skinningEncoding: the skinning buffer (see skinning.glsl).
      *
      *  NOT ALL UNIFORM LOCATIONS NEED TO BE USED!
      *
+     *  If uniform buffers are set, the model and normal matrix and the bump multiplier are written to the draw
+     *  block and the materials of the mesh to the material block instead (see uniformBlocks.glsl).
+     *
      *  The attribute names are determined by the vertex structure.
      */
     class AnimMeshRenderable
@@ -54,6 +63,22 @@ namespace viscom {
         *  @param overrideBump flag for bump map parameters.
         */
         void DrawAnimated(const glm::mat4& modelMatrix, const AnimationState& animState, bool overrideBump = false) const;
+        /**
+         *  Draws the mesh of the mesh renderable using a skinning palette from a skinning buffer.
+         *  @param modelMatrix the model matrix to draw the mesh with.
+         *  @param animState the current state of the animation.
+         *  @param skinningBuffer the skinning buffer holding the palette.
+         *  @param paletteOffset the offset of the palette returned by SkinningBuffer::AddPalette.
+         *  @param overrideBump flag for bump map parameters.
+         */
+        void DrawAnimated(const glm::mat4& modelMatrix, const AnimationState& animState, const SkinningBuffer& skinningBuffer,
+            std::size_t paletteOffset, bool overrideBump = false) const;
+
+        /**
+         *  Sets the uniform buffers to write the per draw and material data to.
+         *  @param uniformBuffers the uniform buffers (nullptr to use loose uniforms).
+         */
+        void SetUniformBuffers(UniformBuffers* uniformBuffers) noexcept { uniformBuffers_ = uniformBuffers; }
 
         /**
          *  Gets the standard uniform locations when a mesh renderable is created.
@@ -70,9 +95,9 @@ namespace viscom {
         AnimMeshRenderable(const Mesh* renderMesh, GLuint vBuffer, GPUProgram* program);
 
         /**
-         *  Draws a node and all its child nodes of the mesh.
+         *  Draws a node and all its child nodes of the mesh with the bound program, vertex array and skinning palette.
          *  @param modelMatrix the model matrix to draw the mesh with.
-        *  @param animState the current state of the animation.
+         *  @param animState the current state of the animation.
          *  @param node the node to draw.
          *  @param overrideBump flag for bump map parameters.
          */
@@ -89,14 +114,27 @@ namespace viscom {
         GPUProgram* drawProgram_;
         /** Holds the standard uniform bindings. */
         std::vector<GLint> uniformLocations_;
+        /** Holds the uniform buffers (optional). */
+        UniformBuffers* uniformBuffers_ = nullptr;
+        /** Holds the compiled node tree (world matrices are updated while drawing). */
+        mutable MeshDrawList drawList_;
+
+        /**
+         *  Draws all nodes of the compiled draw list in a single linear pass.
+         *  @param modelMatrix the model matrix to draw the mesh with.
+         *  @param animState the current state of the animation.
+         *  @param overrideBump flag for bump map parameters.
+         *  @param node the node whose sub tree is drawn (nullptr for the whole mesh).
+         */
+        void DrawListAnimated(const glm::mat4& modelMatrix, const AnimationState& animState, bool overrideBump, const SceneMeshNode* node = nullptr) const;
 
         /**
          *  Draws a sub mesh of the mesh renderable.
-         *  @param modelMatrix the model matrix to draw the sub mesh with.
-         *  @param subMesh the sub mesh to be drawn.
+         *  @param draw the draw record of the sub mesh.
+         *  @param invNodePose the inverse of the nodes global pose.
          *  @param overrideBump flag for bump map parameters.
          */
-        void DrawSubMeshAnimated(const glm::mat4& modelMatrix, const glm::mat4& bonePose_, const SubMesh* subMesh, bool overrideBump = false) const;
+        void DrawSubMeshAnimated(const MeshDrawList::DrawRecord& draw, const glm::mat4& invNodePose, bool overrideBump = false) const;
     };
 
     template <class VTX>
@@ -118,6 +156,8 @@ namespace viscom {
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-        uniformLocations_ = program->GetUniformLocations({ "modelMatrix", "normalMatrix", "diffuseTexture", "bumpTexture", "bumpMultiplier", "skinningMatrices", "invNodeMatrix" });
+        uniformLocations_ = program->GetUniformLocations({ "modelMatrix", "normalMatrix", "diffuseTexture", "bumpTexture", "bumpMultiplier", "skinningMatrices", "invNodeMatrix",
+            "skinningPalette", "skinningOffset", "skinningEncoding" });
+        UniformBuffers::BindUniformBlocks(program->getProgramId());
     }
 }
@@ -14,6 +14,7 @@
 #include <utility>
 
 #include "animation_convert_helpers.h"
+#include "LocalPose.h"
 
 #include "core/main.h"
 
@@ -148,6 +149,28 @@ namespace viscom {
      *  @return true if there is an animation.
      */
     bool Animation::ComputePoseAtTime(std::size_t id, Time time, glm::mat4& pose) const
+    {
+        glm::vec3 translation{ 0.0f };
+        glm::quat rotation = { 1.0f, 0.0f, 0.0f, 0.0f };
+        glm::vec3 scale{ 1.0f };
+
+        if (!ComputeLocalPoseAtTime(id, time, translation, rotation, scale)) return false;
+        pose = ComposeLocalPose(translation, rotation, scale);
+        return true;
+    }
+
+    /**
+     *  Computes the translation, rotation and scaling of a given bone/node, at a given time.
+     *
+     *  @param id Index of the bone/node
+     *  @param time Desired time
+     *  @param translation Translation of this bone/node.
+     *  @param rotation Rotation of this bone/node.
+     *  @param scale Scaling of this bone/node.
+     *
+     *  @return true if there is an animation.
+     */
+    bool Animation::ComputeLocalPoseAtTime(std::size_t id, Time time, glm::vec3& translation, glm::quat& rotation, glm::vec3& scale) const
     {
         time = glm::clamp(time, 0.0f, duration_);
 
@@ -157,10 +180,6 @@ namespace viscom {
         const auto& rotationFrames = channel.rotationFrames_;
         const auto& scalingFrames = channel.scalingFrames_;
 
-        glm::quat rotation = { 0.0f, 0.0f, 0.0f, 1.0f };
-        glm::vec3 translation{ 0.0f };
-        glm::vec3 scale{ 1.0f };
-
         if (positionFrames.empty() || rotationFrames.empty() || scalingFrames.empty()) return false;
 
         // There is just one frame
@@ -198,15 +217,20 @@ namespace viscom {
             scale = InterpolateFrames(scalingFrames[frameIndex], scalingFrames[nextFrameIndex], time).second;
         }
 
-
-        pose = glm::mat4_cast(rotation);
-        pose[0] *= scale.x;
-        pose[1] *= scale.y;
-        pose[2] *= scale.z;
-        pose[3] = glm::vec4(translation, 1);
         return true;
     }
 
+    /**
+     *  Checks whether a bone/node is animated.
+     *  @param id Index of the bone/node
+     */
+    bool Animation::HasChannel(std::size_t id) const
+    {
+        if (id >= channels_.size()) return false;
+        const auto& channel = channels_[id];
+        return !channel.positionFrames_.empty() && !channel.rotationFrames_.empty() && !channel.scalingFrames_.empty();
+    }
+
     void Animation::Write(std::ostream& ofs) const
     {
         VersionableSerializerType::writeHeader(ofs);
@@ -130,6 +130,8 @@ namespace viscom {
         Animation GetSubSequence(const std::string& name, Time start, Time end) const;
 
         bool ComputePoseAtTime(std::size_t id, Time time, glm::mat4& pose) const;
+        bool ComputeLocalPoseAtTime(std::size_t id, Time time, glm::vec3& translation, glm::quat& rotation, glm::vec3& scale) const;
+        bool HasChannel(std::size_t id) const;
 
         /**
          *  Writes the channels of the animation to a stream.
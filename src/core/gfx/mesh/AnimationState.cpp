@@ -9,9 +9,62 @@
 #include "AnimationState.h"
 #include "Mesh.h"
 #include "SceneMeshNode.h"
+#include "core/math/transforms.h"
+#include <algorithm>
 
 namespace viscom {
 
+    namespace {
+        /**
+         *  Sets the weight of a node and all its children in a bone mask.
+         *  @param node the root of the sub tree.
+         *  @param weight the weight to set.
+         *  @param boneMask the mask (indexed by node index).
+         */
+        void SetSubTreeWeight(const SceneMeshNode* node, float weight, std::vector<float>& boneMask)
+        {
+            boneMask[node->GetNodeIndex()] = weight;
+            for (std::size_t i = 0; i < node->GetNumberOfNodes(); ++i) SetSubTreeWeight(node->GetChild(i), weight, boneMask);
+        }
+
+        /**
+         *  Decomposes a local transform into translation, rotation and scale.
+         *  Zero scaled axes are rebuilt from the other axes and mirroring is moved into the scale of the x axis.
+         *  @param localPose the local transform.
+         *  @param translation the translation.
+         *  @param rotation the rotation.
+         *  @param scale the scale.
+         */
+        void DecomposeLocalPose(const glm::mat4& localPose, glm::vec3& translation, glm::quat& rotation, glm::vec3& scale)
+        {
+            constexpr float minScale = 1e-8f;
+            glm::mat3 axes{ localPose };
+            translation = glm::vec3(localPose[3]);
+            scale = glm::vec3{ glm::length(axes[0]), glm::length(axes[1]), glm::length(axes[2]) };
+
+            auto numDegenerate = 0;
+            for (auto c = 0; c < 3; ++c) {
+                if (scale[c] > minScale) axes[c] /= scale[c];
+                else ++numDegenerate;
+            }
+            if (numDegenerate > 1) {
+                rotation = glm::quat{ 1.0f, 0.0f, 0.0f, 0.0f };
+                return;
+            }
+            for (auto c = 0; c < 3; ++c) {
+                if (scale[c] > minScale) continue;
+                axes[c] = glm::normalize(glm::cross(axes[(c + 1) % 3], axes[(c + 2) % 3]));
+                scale[c] = 0.0f;
+            }
+
+            if (glm::determinant(axes) < 0.0f) {
+                scale.x = -scale.x;
+                axes[0] = -axes[0];
+            }
+            rotation = glm::normalize(glm::quat_cast(axes));
+        }
+    }
+
     /**
      *  Constructor of AnimationState.
      *  @param mesh the mesh containing animation data.
@@ -33,11 +86,22 @@ namespace viscom {
             animationPlaybackSpeed_.emplace_back(mapping.playbackSpeed_);
         }
 
-        localBonePoses_.resize(mesh_->GetNodes().size());
-        globalBonePoses_.resize(mesh_->GetNodes().size());
-        for (auto i = 0U; i < localBonePoses_.size(); ++i)
-            localBonePoses_[i] = mesh_->GetNodes()[i]->GetLocalTransform();
+        const auto& nodes = mesh_->GetNodes();
+        localBonePoses_.resize(nodes.size());
+        globalBonePoses_.resize(nodes.size());
+        isNodeAnimated_.resize(nodes.size(), 0);
+        bindPose_.Resize(nodes.size());
+        blendedPose_.Resize(nodes.size());
+        layerPose_.Resize(nodes.size());
+        blendWeights_.resize(nodes.size(), 0.0f);
+        for (auto i = 0U; i < localBonePoses_.size(); ++i) {
+            localBonePoses_[i] = nodes[i]->GetLocalTransform();
+            useAffineKernel_ = useAffineKernel_ && math::isAffine(localBonePoses_[i]);
+
+            DecomposeLocalPose(localBonePoses_[i], bindPose_.translations_[i], bindPose_.rotations_[i], bindPose_.scales_[i]);
 
+            for (const auto& animation : animations_) if (animation.HasChannel(i)) isNodeAnimated_[i] = 1;
+        }
     }
 
     /**
@@ -50,6 +114,94 @@ namespace viscom {
         if (pauseTime_ != 0.0f) startTime_ += static_cast<float>(currentTime) - pauseTime_;
         else startTime_ = static_cast<float>(currentTime);
         pauseTime_ = 0.0f;
+        lastUpdateTime_ = static_cast<float>(currentTime);
+    }
+
+    /**
+     *  Cross-fades from the current animation to another one.
+     *  @param animationIndex the index of the animation to fade to.
+     *  @param fadeDuration the duration of the fade in seconds (0 switches instantly).
+     *  @param currentTime the current timestamp.
+     */
+    void AnimationState::CrossFade(std::size_t animationIndex, float fadeDuration, double currentTime)
+    {
+        fadeAnimationIndex_ = animationIndex_;
+        fadePlayTime_ = currentPlayTime_;
+        fadeTime_ = 0.0f;
+        fadeDuration_ = glm::max(fadeDuration, 0.0f);
+        fadeWeight_ = fadeDuration_ > 0.0f ? 0.0f : 1.0f;
+
+        animationIndex_ = animationIndex;
+        currentPlayTime_ = 0.0f;
+        startTime_ = static_cast<float>(currentTime);
+        if (!isPlaying_) pauseTime_ = static_cast<float>(currentTime);
+    }
+
+    /**
+     *  Adds an animation layer on top of the base animation. Layers are applied in the order they were added.
+     *  @param animationIndex the index of the layers animation.
+     *  @param mode the blend mode of the layer.
+     *  @param weight the weight of the layer.
+     *  @param isRepeating whether the layers animation should be repeating.
+     *  @return the index of the new layer.
+     */
+    std::size_t AnimationState::AddLayer(std::size_t animationIndex, AnimationBlendMode mode, float weight, bool isRepeating)
+    {
+        assert(animationIndex < animations_.size() && "there is no mapping for the layers animation");
+
+        AnimationLayer layer;
+        layer.animationIndex_ = animationIndex;
+        layer.mode_ = mode;
+        layer.weight_ = weight;
+        layer.isRepeating_ = isRepeating;
+        if (mode == AnimationBlendMode::Additive) {
+            layer.referencePose_ = bindPose_;
+            EvaluateAnimation(animationIndex, 0.0f, layer.referencePose_);
+        }
+        layers_.emplace_back(std::move(layer));
+        return layers_.size() - 1;
+    }
+
+    /**
+     *  Removes an animation layer (the indices of all following layers are decremented).
+     *  @param layerIndex the index of the layer.
+     */
+    void AnimationState::RemoveLayer(std::size_t layerIndex)
+    {
+        layers_.erase(layers_.begin() + static_cast<std::ptrdiff_t>(layerIndex));
+    }
+
+    /**
+     *  Sets the per node weights of a layer.
+     *  @param layerIndex the index of the layer.
+     *  @param nodeWeights the weight for each node (indexed by node index).
+     */
+    void AnimationState::SetLayerBoneMask(std::size_t layerIndex, const std::vector<float>& nodeWeights)
+    {
+        assert(nodeWeights.size() == localBonePoses_.size() && "the bone mask needs a weight for each node.");
+        layers_[layerIndex].boneMask_ = nodeWeights;
+    }
+
+    /**
+     *  Restricts a layer to a node and all its children.
+     *  @param layerIndex the index of the layer.
+     *  @param node the root node of the sub tree the layer is applied to.
+     *  @param weight the weight of the nodes in the sub tree.
+     */
+    void AnimationState::SetLayerBoneMask(std::size_t layerIndex, const SceneMeshNode* node, float weight)
+    {
+        auto& boneMask = layers_[layerIndex].boneMask_;
+        boneMask.assign(localBonePoses_.size(), 0.0f);
+        SetSubTreeWeight(node, weight, boneMask);
+    }
+
+    /**
+     *  Applies a layer to all nodes again.
+     *  @param layerIndex the index of the layer.
+     */
+    void AnimationState::ClearLayerBoneMask(std::size_t layerIndex)
+    {
+        layers_[layerIndex].boneMask_.clear();
     }
 
     /**
@@ -60,6 +212,16 @@ namespace viscom {
     {
         if (!isPlaying_) return false;
 
+        auto elapsedTime = static_cast<float>(currentTime) - lastUpdateTime_;
+        lastUpdateTime_ = static_cast<float>(currentTime);
+        if (fadeDuration_ > 0.0f) {
+            fadePlayTime_ = AdvancePlayTime(fadeAnimationIndex_, fadePlayTime_, elapsedTime, isRepeating_);
+            fadeTime_ += elapsedTime;
+            fadeWeight_ = glm::clamp(fadeTime_ / fadeDuration_, 0.0f, 1.0f);
+            if (fadeWeight_ >= 1.0f) fadeDuration_ = 0.0f;
+        }
+        for (auto& layer : layers_) layer.playTime_ = AdvancePlayTime(layer.animationIndex_, layer.playTime_, elapsedTime, layer.isRepeating_);
+
         // Advance time
         currentPlayTime_ = (static_cast<float>(currentTime) - startTime_) * GetFramesPerSecond() * GetSpeed();
 
@@ -90,20 +252,85 @@ namespace viscom {
         return didAnimationStopOrRepeat;
     }
 
+    /**
+     *  Advances the play time of an animation that is not the base animation.
+     *  @param animationIndex the index of the animation.
+     *  @param playTime the current play time.
+     *  @param elapsedTime the time elapsed since the last update.
+     *  @param isRepeating whether the animation is repeating.
+     *  @return the new play time.
+     */
+    float AnimationState::AdvancePlayTime(std::size_t animationIndex, float playTime, float elapsedTime, bool isRepeating) const
+    {
+        const auto& animation = animations_[animationIndex];
+        auto duration = animation.GetDuration();
+        playTime += elapsedTime * animation.GetFramesPerSecond() * animationPlaybackSpeed_[animationIndex];
+        if (!isRepeating || duration <= 0.0f) return glm::clamp(playTime, 0.0f, glm::max(duration, 0.0f));
+        return playTime - glm::floor(playTime / duration) * duration;
+    }
+
+    /**
+     *  Evaluates an animation at a given time. Nodes not changed by the animation keep their values.
+     *  @param animationIndex the index of the animation.
+     *  @param playTime the play time of the animation.
+     *  @param pose the local pose to write to.
+     */
+    void AnimationState::EvaluateAnimation(std::size_t animationIndex, float playTime, LocalPoseBuffer& pose) const
+    {
+        const auto& animation = animations_[animationIndex];
+        for (std::size_t i = 0; i < pose.size(); ++i) {
+            animation.ComputeLocalPoseAtTime(i, playTime, pose.translations_[i], pose.rotations_[i], pose.scales_[i]);
+        }
+    }
+
+    /**
+     *  Computes the blend weight for each node of a layer.
+     *  @param animation the layers animation.
+     *  @param weight the layers weight.
+     *  @param boneMask the layers bone mask (may be empty).
+     */
+    void AnimationState::ComputeLayerWeights(const Animation& animation, float weight, const std::vector<float>& boneMask)
+    {
+        for (std::size_t i = 0; i < blendWeights_.size(); ++i) {
+            auto nodeWeight = boneMask.empty() ? weight : weight * boneMask[i];
+            blendWeights_[i] = animation.HasChannel(i) ? nodeWeight : 0.0f;
+        }
+    }
+
     /**
      *  Computes the final bone poses for an animation.
+     *  The base animation (cross-faded if needed) is evaluated first, then all layers are blended on top of it.
+     *  All buffers are allocated on construction so no memory is allocated here.
      */
     void AnimationState::ComputeAnimationsFinalBonePoses()
     {
-        const auto& currentAnimation = animations_[animationIndex_];
         const auto& invBindPoseMatrices = mesh_->GetInverseBindPoseMatrices();
 
-        for (auto i = 0U; i < mesh_->GetNodes().size(); ++i) {
-            glm::mat4 pose;
-            if (currentAnimation.ComputePoseAtTime(i, currentPlayTime_, pose)) localBonePoses_[i] = pose;
+        blendedPose_ = bindPose_;
+        EvaluateAnimation(animationIndex_, currentPlayTime_, blendedPose_);
+
+        if (fadeDuration_ > 0.0f) {
+            layerPose_ = bindPose_;
+            EvaluateAnimation(fadeAnimationIndex_, fadePlayTime_, layerPose_);
+            std::fill(blendWeights_.begin(), blendWeights_.end(), fadeWeight_);
+            BlendPoses(layerPose_, blendedPose_, blendWeights_.data());
+            std::swap(blendedPose_, layerPose_);
         }
 
-        ComputeGlobalBonePose(mesh_->GetRootNode());
+        for (const auto& layer : layers_) {
+            if (layer.weight_ <= 0.0f) continue;
+
+            EvaluateAnimation(layer.animationIndex_, layer.playTime_, layerPose_);
+            ComputeLayerWeights(animations_[layer.animationIndex_], layer.weight_, layer.boneMask_);
+            if (layer.mode_ == AnimationBlendMode::Additive) AddPoses(blendedPose_, layerPose_, layer.referencePose_, blendWeights_.data());
+            else BlendPoses(blendedPose_, layerPose_, blendWeights_.data());
+        }
+
+        for (std::size_t i = 0; i < localBonePoses_.size(); ++i) {
+            if (isNodeAnimated_[i]) localBonePoses_[i] = ComposeLocalPose(blendedPose_.translations_[i], blendedPose_.rotations_[i], blendedPose_.scales_[i]);
+        }
+
+        ComputeGlobalBonePoses();
 
         for (const auto& node : mesh_->GetNodes()) {
             if (node->GetBoneIndex() == -1) {
@@ -113,16 +340,22 @@ namespace viscom {
         }
     }
 
-    void AnimationState::ComputeGlobalBonePose(const SceneMeshNode* node)
+    /** Computes the global poses of all nodes from the local poses. */
+    void AnimationState::ComputeGlobalBonePoses()
     {
-        auto nodeParent = node->GetParent();
-        while (nodeParent && node->GetBoneIndex() != -1 && (nodeParent->GetName().empty())) nodeParent = nodeParent->GetParent();
-
-        if (!nodeParent) globalBonePoses_[node->GetNodeIndex()] = localBonePoses_[node->GetNodeIndex()];
-        else globalBonePoses_[node->GetNodeIndex()] = globalBonePoses_[nodeParent->GetNodeIndex()] * localBonePoses_[node->GetNodeIndex()];
-
-        for (auto i = 0U; i < node->GetNumberOfNodes(); ++i) {
-            ComputeGlobalBonePose(node->GetChild(i));
+        // parents always come before their children, so a single forward pass suffices.
+        const auto& parentIndices = mesh_->GetNodeParentIndices();
+        if (useAffineKernel_) {
+            for (std::size_t i = 0; i < parentIndices.size(); ++i) {
+                if (parentIndices[i] == -1) globalBonePoses_[i] = localBonePoses_[i];
+                else math::multiplyAffine(globalBonePoses_[static_cast<std::size_t>(parentIndices[i])], localBonePoses_[i], globalBonePoses_[i]);
+            }
+        }
+        else {
+            for (std::size_t i = 0; i < parentIndices.size(); ++i) {
+                if (parentIndices[i] == -1) globalBonePoses_[i] = localBonePoses_[i];
+                else globalBonePoses_[i] = globalBonePoses_[static_cast<std::size_t>(parentIndices[i])] * localBonePoses_[i];
+            }
         }
     }
 }
@@ -8,9 +8,11 @@
 
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <glm/mat4x4.hpp>
 #include "Animation.h"
+#include "LocalPose.h"
 
 namespace viscom {
 
@@ -56,6 +58,9 @@ namespace viscom {
         void SetCurrentFrameRelative(float relativeFrame) { currentPlayTime_ = relativeFrame * GetDuration(); }
         void ComputeAnimationsFinalBonePoses();
 
+        /** Returns the mesh this animation state belongs to. */
+        const Mesh* GetMesh() const { return mesh_; }
+
         /**
          *  Sets the current animation speed.
          *  @param speed the new animation speed.
@@ -77,16 +82,63 @@ namespace viscom {
          *  @param animationIndex the new current animation index.
          */
         void SetCurrentAnimationIndex(std::size_t animationIndex) { animationIndex_ = animationIndex; }
+        void CrossFade(std::size_t animationIndex, float fadeDuration, double currentTime);
+        /** Checks whether a cross-fade is in progress. */
+        bool IsCrossFading() const { return fadeDuration_ > 0.0f; }
+
+        std::size_t AddLayer(std::size_t animationIndex, AnimationBlendMode mode, float weight = 1.0f, bool isRepeating = true);
+        void RemoveLayer(std::size_t layerIndex);
+        /** Returns the number of layers on top of the base animation. */
+        std::size_t GetNumberOfLayers() const { return layers_.size(); }
+        /**
+         *  Sets the weight of a layer.
+         *  @param layerIndex the index of the layer.
+         *  @param weight the new weight.
+         */
+        void SetLayerWeight(std::size_t layerIndex, float weight) { layers_[layerIndex].weight_ = weight; }
+        /**
+         *  Returns the weight of a layer.
+         *  @param layerIndex the index of the layer.
+         */
+        float GetLayerWeight(std::size_t layerIndex) const { return layers_[layerIndex].weight_; }
+        void SetLayerBoneMask(std::size_t layerIndex, const std::vector<float>& nodeWeights);
+        void SetLayerBoneMask(std::size_t layerIndex, const SceneMeshNode* node, float weight = 1.0f);
+        void ClearLayerBoneMask(std::size_t layerIndex);
 
         /** Returns the global bone pose for a node. */
         const glm::mat4& GetGlobalBonePose(std::size_t index) const { return globalBonePoses_[index]; }
+        /** Returns the global bone poses of all nodes. */
+        const std::vector<glm::mat4>& GetGlobalBonePoses() const { return globalBonePoses_; }
         /** Returns the local bone pose for a node. */
         const glm::mat4& GetLocalBonePose(std::size_t index) const { return localBonePoses_[index]; }
         /** Returns the skinning matrices. */
         const std::vector<glm::mat4>& GetSkinningMatrices() const { return skinned_; }
 
     private:
-        void ComputeGlobalBonePose(const SceneMeshNode* node);
+        /** An animation blended on top of the base animation. */
+        struct AnimationLayer
+        {
+            /** The animation index of the layer. */
+            std::size_t animationIndex_ = 0;
+            /** The blend mode of the layer. */
+            AnimationBlendMode mode_ = AnimationBlendMode::Override;
+            /** The weight of the layer. */
+            float weight_ = 1.0f;
+            /** Is the layers animation repeating. */
+            bool isRepeating_ = true;
+            /** The current play time of the layers animation. */
+            float playTime_ = 0.0f;
+            /** The weight for each node (empty if all nodes are used). */
+            std::vector<float> boneMask_;
+            /** The reference pose for additive layers (the first frame of the animation). */
+            LocalPoseBuffer referencePose_;
+        };
+
+        float AdvancePlayTime(std::size_t animationIndex, float playTime, float elapsedTime, bool isRepeating) const;
+        void EvaluateAnimation(std::size_t animationIndex, float playTime, LocalPoseBuffer& pose) const;
+        void ComputeLayerWeights(const Animation& animation, float weight, const std::vector<float>& boneMask);
+        /** Computes the global poses of all nodes in a single pass over the flattened hierarchy. */
+        void ComputeGlobalBonePoses();
 
         /** Holds the mesh to render. */
         const Mesh* mesh_;
@@ -110,7 +162,35 @@ namespace viscom {
         float pauseTime_ = 0.0f;
         /** The starting playback time of the animation. */
         float currentPlayTime_ = 0.0f;
-
+        /** The timestamp of the last time update. */
+        float lastUpdateTime_ = 0.0f;
+
+        /** The animation index faded out during a cross-fade. */
+        std::size_t fadeAnimationIndex_ = 0;
+        /** The play time of the animation faded out. */
+        float fadePlayTime_ = 0.0f;
+        /** The time elapsed since the cross-fade started. */
+        float fadeTime_ = 0.0f;
+        /** The duration of the cross-fade (0 if there is none). */
+        float fadeDuration_ = 0.0f;
+        /** The current weight of the faded in animation. */
+        float fadeWeight_ = 1.0f;
+
+        /** The layers blended on top of the base animation. */
+        std::vector<AnimationLayer> layers_;
+        /** Flag for each node whether any of the animations changes it. */
+        std::vector<std::uint8_t> isNodeAnimated_;
+        /** The bind (non animated) local pose. */
+        LocalPoseBuffer bindPose_;
+        /** The blended local pose. */
+        LocalPoseBuffer blendedPose_;
+        /** The pose of the animation currently blended in. */
+        LocalPoseBuffer layerPose_;
+        /** The blend weight for each node of the animation currently blended in. */
+        std::vector<float> blendWeights_;
+
+        /** Are all node transforms affine, so the cheaper 3x4 matrix product can be used. */
+        bool useAffineKernel_ = true;
         /** The local bone poses. */
         std::vector<glm::mat4> localBonePoses_;
         /** The global bone poses. */
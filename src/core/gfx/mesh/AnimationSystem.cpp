@@ -0,0 +1,40 @@
+/**
+ * @file   AnimationSystem.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.02
+ *
+ * @brief  Implementation of a system updating many animation states in parallel.
+ */
+
+#include "AnimationSystem.h"
+#include "AnimationState.h"
+#include "core/utils/ThreadPool.h"
+#include <algorithm>
+
+namespace viscom {
+
+    AnimationSystem::AnimationSystem(ThreadPool* threadPool) :
+        threadPool_{ threadPool != nullptr ? threadPool : &ThreadPool::GetDefault() }
+    {
+    }
+
+    void AnimationSystem::Register(AnimationState* animState)
+    {
+        if (std::find(animStates_.begin(), animStates_.end(), animState) == animStates_.end()) animStates_.push_back(animState);
+    }
+
+    void AnimationSystem::Unregister(AnimationState* animState)
+    {
+        animStates_.erase(std::remove(animStates_.begin(), animStates_.end(), animState), animStates_.end());
+    }
+
+    void AnimationSystem::Update(double currentTime)
+    {
+        threadPool_->ParallelFor(0, animStates_.size(), [this, currentTime](std::size_t begin, std::size_t end) {
+            for (auto i = begin; i < end; ++i) {
+                animStates_[i]->UpdateTime(currentTime);
+                animStates_[i]->ComputeAnimationsFinalBonePoses();
+            }
+        }, MIN_STATES_PER_TASK);
+    }
+}
@@ -0,0 +1,60 @@
+/**
+ * @file   AnimationSystem.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.02
+ *
+ * @brief  Declaration of a system updating many animation states in parallel.
+ */
+
+#pragma once
+
+#include <vector>
+
+namespace viscom {
+
+    class AnimationState;
+    class ThreadPool;
+
+    /**
+     *  Updates all registered animation states once per frame. The states are distributed over the workers of a
+     *  thread pool, each state evaluates its pose with a linear pass over the flattened node hierarchy.
+     *  The system does not own the animation states, they need to be unregistered before they are destroyed.
+     */
+    class AnimationSystem final
+    {
+    public:
+        /**
+         *  Constructor.
+         *  @param threadPool the thread pool to use (nullptr uses the default pool).
+         */
+        explicit AnimationSystem(ThreadPool* threadPool = nullptr);
+
+        /**
+         *  Registers an animation state to be updated by the system.
+         *  @param animState the animation state.
+         */
+        void Register(AnimationState* animState);
+        /**
+         *  Removes an animation state from the system.
+         *  @param animState the animation state.
+         */
+        void Unregister(AnimationState* animState);
+        /** Returns the number of registered animation states. */
+        std::size_t GetNumberOfAnimationStates() const noexcept { return animStates_.size(); }
+
+        /**
+         *  Advances the time of all registered animation states and computes their final bone poses.
+         *  @param currentTime the current timestamp.
+         */
+        void Update(double currentTime);
+
+    private:
+        /** The minimum number of animation states processed by a single task. */
+        static constexpr std::size_t MIN_STATES_PER_TASK = 4;
+
+        /** Holds the thread pool. */
+        ThreadPool* threadPool_;
+        /** Holds the registered animation states. */
+        std::vector<AnimationState*> animStates_;
+    };
+}
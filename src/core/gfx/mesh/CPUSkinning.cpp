@@ -0,0 +1,96 @@
+/**
+ * @file   CPUSkinning.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.06
+ *
+ * @brief  Implementation of a class skinning meshes on the CPU.
+ */
+
+#include "CPUSkinning.h"
+#include "AnimationState.h"
+#include "Mesh.h"
+#include "SceneMeshNode.h"
+#include "core/math/transforms.h"
+#include "core/utils/ThreadPool.h"
+
+namespace viscom {
+
+    CPUSkinning::CPUSkinning(const Mesh* mesh, ThreadPool* threadPool) :
+        mesh_{ mesh },
+        threadPool_{ threadPool != nullptr ? threadPool : &ThreadPool::GetDefault() },
+        boneBoundingBoxes_(mesh->GetBoneBoundingBoxes()),
+        boundingBox_{ mesh->GetRootNode()->GetBoundingBox() }
+    {
+        const auto& vertices = mesh_->GetVertices();
+        const auto& boneWeights = mesh_->GetBoneWeights();
+        if (boneWeights.size() != vertices.size()) return;
+
+        for (std::size_t i = 0; i < vertices.size(); ++i) {
+            const auto& weights = boneWeights[i];
+            if (weights.x + weights.y + weights.z + weights.w <= 0.0f) unweightedBoundingBox_.AddPoint(vertices[i]);
+        }
+    }
+
+    void CPUSkinning::Update(const AnimationState& animState, bool skinVertices)
+    {
+        const auto& skinningMatrices = animState.GetSkinningMatrices();
+        const auto& bindBoneBoxes = mesh_->GetBoneBoundingBoxes();
+
+        // each skinned vertex is a convex combination of its bones transformations, so it lies inside the union
+        // of the transformed boxes of its bones. Vertices without bones stay in the bind pose.
+        boundingBox_ = unweightedBoundingBox_;
+        for (std::size_t i = 0; i < bindBoneBoxes.size(); ++i) {
+            if (glm::any(glm::greaterThan(bindBoneBoxes[i].minmax_[0], bindBoneBoxes[i].minmax_[1]))) continue;
+            boneBoundingBoxes_[i] = math::transformAABB(bindBoneBoxes[i], skinningMatrices[i]);
+            boundingBox_ = boundingBox_.Union(boneBoundingBoxes_[i]);
+        }
+        if (bindBoneBoxes.empty()) boundingBox_ = mesh_->GetRootNode()->GetBoundingBox();
+
+        if (!skinVertices) return;
+
+        const auto& vertices = mesh_->GetVertices();
+        const auto& normals = mesh_->GetNormals();
+        const auto& boneIndices = mesh_->GetBoneIndices();
+        const auto& boneWeights = mesh_->GetBoneWeights();
+        if (boneIndices.size() != vertices.size() || boneWeights.size() != vertices.size()) return;
+
+        const auto hasNormals = normals.size() == vertices.size();
+        skinnedVertices_.resize(vertices.size());
+        skinnedNormals_.resize(hasNormals ? normals.size() : 0);
+        threadPool_->ParallelFor(0, vertices.size(), [&](std::size_t begin, std::size_t end) {
+            SkinVertices(skinningMatrices.data(), vertices.data(), hasNormals ? normals.data() : nullptr, boneIndices.data(),
+                boneWeights.data(), begin, end, skinnedVertices_.data(), hasNormals ? skinnedNormals_.data() : nullptr);
+        }, MIN_VERTICES_PER_TASK);
+    }
+
+    void CPUSkinning::SkinVertices(const glm::mat4* skinningMatrices, const glm::vec3* positions, const glm::vec3* normals,
+        const glm::uvec4* boneIndices, const glm::vec4* boneWeights, std::size_t begin, std::size_t end,
+        glm::vec3* skinnedPositions, glm::vec3* skinnedNormals)
+    {
+        for (auto i = begin; i < end; ++i) {
+            const auto& weights = boneWeights[i];
+            const auto& indices = boneIndices[i];
+            if (weights.x + weights.y + weights.z + weights.w <= 0.0f) {
+                // vertices without bones are not transformed (as in the bind pose).
+                skinnedPositions[i] = positions[i];
+                if (skinnedNormals) skinnedNormals[i] = normals[i];
+                continue;
+            }
+
+            // blend only the upper 3x4 part, skinning matrices are affine.
+            glm::mat4 skinning{ 0.0f };
+            for (auto b = 0; b < 4; ++b) {
+                if (weights[b] <= 0.0f) continue;
+                const auto& m = skinningMatrices[indices[b]];
+                for (auto c = 0; c < 4; ++c) skinning[c] += m[c] * weights[b];
+            }
+
+            const auto& p = positions[i];
+            skinnedPositions[i] = glm::vec3(skinning[0]) * p.x + glm::vec3(skinning[1]) * p.y + glm::vec3(skinning[2]) * p.z + glm::vec3(skinning[3]);
+            if (skinnedNormals) {
+                const auto& n = normals[i];
+                skinnedNormals[i] = glm::normalize(glm::vec3(skinning[0]) * n.x + glm::vec3(skinning[1]) * n.y + glm::vec3(skinning[2]) * n.z);
+            }
+        }
+    }
+}
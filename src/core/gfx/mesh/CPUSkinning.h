@@ -0,0 +1,86 @@
+/**
+ * @file   CPUSkinning.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.06
+ *
+ * @brief  Declaration of a class skinning meshes on the CPU.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "core/math/aabb.h"
+
+namespace viscom {
+
+    class AnimationState;
+    class Mesh;
+    class ThreadPool;
+
+    /**
+     *  Skins the vertices of a mesh on the CPU (e.g. for collision detection and picking) and computes animated
+     *  bounding boxes from the bind pose bounding boxes of the bones and of the vertices without bones.
+     *  All results are in the space of the meshes root node (the model matrix is not applied).
+     */
+    class CPUSkinning final
+    {
+    public:
+        /**
+         *  Constructor.
+         *  @param mesh the mesh to skin.
+         *  @param threadPool the thread pool to use (nullptr uses the default pool).
+         */
+        explicit CPUSkinning(const Mesh* mesh, ThreadPool* threadPool = nullptr);
+
+        /**
+         *  Updates the animated bounding boxes and optionally the skinned vertices.
+         *  @param animState the animation state holding the current skinning matrices.
+         *  @param skinVertices whether the vertices should be skinned or only the bounding boxes updated.
+         */
+        void Update(const AnimationState& animState, bool skinVertices = true);
+
+        /** Returns the skinned vertex positions. */
+        const std::vector<glm::vec3>& GetSkinnedVertices() const noexcept { return skinnedVertices_; }
+        /** Returns the skinned vertex normals. */
+        const std::vector<glm::vec3>& GetSkinnedNormals() const noexcept { return skinnedNormals_; }
+        /** Returns the animated bounding box of each bone. */
+        const std::vector<math::AABB3<float>>& GetBoneBoundingBoxes() const noexcept { return boneBoundingBoxes_; }
+        /** Returns the animated bounding box of the whole mesh. */
+        const math::AABB3<float>& GetBoundingBox() const noexcept { return boundingBox_; }
+
+        /**
+         *  Skins a range of vertices with up to four bones each.
+         *  @param skinningMatrices the skinning matrix of each bone.
+         *  @param positions the bind pose vertex positions.
+         *  @param normals the bind pose vertex normals (may be nullptr).
+         *  @param boneIndices the bone indices of each vertex.
+         *  @param boneWeights the bone weights of each vertex.
+         *  @param begin the first vertex to skin.
+         *  @param end the vertex after the last vertex to skin.
+         *  @param skinnedPositions the skinned vertex positions.
+         *  @param skinnedNormals the skinned vertex normals (may be nullptr).
+         */
+        static void SkinVertices(const glm::mat4* skinningMatrices, const glm::vec3* positions, const glm::vec3* normals,
+            const glm::uvec4* boneIndices, const glm::vec4* boneWeights, std::size_t begin, std::size_t end,
+            glm::vec3* skinnedPositions, glm::vec3* skinnedNormals);
+
+    private:
+        /** The minimum number of vertices skinned by a single task. */
+        static constexpr std::size_t MIN_VERTICES_PER_TASK = 4096;
+
+        /** Holds the mesh. */
+        const Mesh* mesh_;
+        /** Holds the thread pool. */
+        ThreadPool* threadPool_;
+        /** Holds the skinned vertex positions. */
+        std::vector<glm::vec3> skinnedVertices_;
+        /** Holds the skinned vertex normals. */
+        std::vector<glm::vec3> skinnedNormals_;
+        /** Holds the animated bounding box of each bone. */
+        std::vector<math::AABB3<float>> boneBoundingBoxes_;
+        /** Holds the animated bounding box of the whole mesh. */
+        math::AABB3<float> boundingBox_;
+        /** Holds the bounding box of all vertices without bone weights (they keep their bind pose). */
+        math::AABB3<float> unweightedBoundingBox_;
+    };
+}
@@ -0,0 +1,165 @@
+/**
+ * @file   IndirectDrawBuffer.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.12
+ *
+ * @brief  Implementation of the OpenGL buffers for multi draw indirect submission.
+ */
+
+#include "IndirectDrawBuffer.h"
+#include "IndirectDrawList.h"
+#include "core/open_gl.h"
+#include "core/gfx/GLStateCache.h"
+#include "core/gfx/OpenGLCapabilities.h"
+#include "core/gfx/UniformBuffers.h"
+#include <numeric>
+
+namespace viscom {
+
+    IndirectDrawBuffer::IndirectDrawBuffer()
+    {
+        glGenBuffers(1, &commandBuffer_);
+        glGenBuffers(1, &drawDataBuffer_);
+        glGenBuffers(1, &drawIdBuffer_);
+    }
+
+    IndirectDrawBuffer::~IndirectDrawBuffer()
+    {
+        if (commandBuffer_ != 0) glDeleteBuffers(1, &commandBuffer_);
+        commandBuffer_ = 0;
+        if (drawDataBuffer_ != 0) glDeleteBuffers(1, &drawDataBuffer_);
+        drawDataBuffer_ = 0;
+        if (drawIdBuffer_ != 0) glDeleteBuffers(1, &drawIdBuffer_);
+        drawIdBuffer_ = 0;
+    }
+
+    IndirectDrawBuffer::IndirectDrawBuffer(IndirectDrawBuffer&& rhs) noexcept :
+        commandBuffer_(rhs.commandBuffer_),
+        drawDataBuffer_(rhs.drawDataBuffer_),
+        commandBufferSize_(rhs.commandBufferSize_),
+        drawDataBufferSize_(rhs.drawDataBufferSize_),
+        drawIdBuffer_(rhs.drawIdBuffer_),
+        drawIdCount_(rhs.drawIdCount_),
+        programLocations_(std::move(rhs.programLocations_))
+    {
+        rhs.commandBuffer_ = 0;
+        rhs.drawDataBuffer_ = 0;
+        rhs.commandBufferSize_ = 0;
+        rhs.drawDataBufferSize_ = 0;
+        rhs.drawIdBuffer_ = 0;
+        rhs.drawIdCount_ = 0;
+    }
+
+    IndirectDrawBuffer& IndirectDrawBuffer::operator=(IndirectDrawBuffer&& rhs) noexcept
+    {
+        if (this != &rhs) {
+            this->~IndirectDrawBuffer();
+            commandBuffer_ = rhs.commandBuffer_;
+            drawDataBuffer_ = rhs.drawDataBuffer_;
+            commandBufferSize_ = rhs.commandBufferSize_;
+            drawDataBufferSize_ = rhs.drawDataBufferSize_;
+            drawIdBuffer_ = rhs.drawIdBuffer_;
+            drawIdCount_ = rhs.drawIdCount_;
+            programLocations_ = std::move(rhs.programLocations_);
+            rhs.commandBuffer_ = 0;
+            rhs.drawDataBuffer_ = 0;
+            rhs.commandBufferSize_ = 0;
+            rhs.drawDataBufferSize_ = 0;
+            rhs.drawIdBuffer_ = 0;
+            rhs.drawIdCount_ = 0;
+        }
+        return *this;
+    }
+
+    bool IndirectDrawBuffer::IsSupported()
+    {
+        return IsOpenGLVersionSupported(4, 3);
+    }
+
+    void IndirectDrawBuffer::Submit(const IndirectDrawList& drawList, GLStateCache& stateCache)
+    {
+        const auto& commands = drawList.GetCommands();
+        if (commands.empty()) return;
+
+        const auto& drawData = drawList.GetDrawData();
+        Upload(GL_DRAW_INDIRECT_BUFFER, commandBuffer_, commandBufferSize_, commands.data(), commands.size() * sizeof(IndirectDrawList::DrawCommand));
+        Upload(GL_SHADER_STORAGE_BUFFER, drawDataBuffer_, drawDataBufferSize_, drawData.data(), drawData.size() * sizeof(IndirectDrawList::DrawData));
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, drawDataBuffer_);
+        stateCache.CountIssuedCalls(5);
+        if (drawIdCount_ < commands.size()) {
+            std::vector<std::uint32_t> drawIds(commands.size());
+            std::iota(drawIds.begin(), drawIds.end(), 0U);
+            glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer_);
+            glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(drawIds.size() * sizeof(std::uint32_t)), drawIds.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            drawIdCount_ = drawIds.size();
+        }
+
+        GLuint boundMaterialBuffer = 0;
+        for (const auto& batch : drawList.GetBatches()) {
+            const auto& locations = GetProgramLocations(batch.program_);
+            stateCache.UseProgram(batch.program_);
+            stateCache.BindVertexArray(batch.vao_);
+            // the material indices of the draw data refer to the materials of the mesh the batch belongs to.
+            if (batch.materialBuffer_ != 0 && batch.materialBuffer_ != boundMaterialBuffer) {
+                UniformBuffers::BindMaterialBuffer(batch.materialBuffer_, batch.materialTextureBuffer_);
+                boundMaterialBuffer = batch.materialBuffer_;
+                stateCache.CountIssuedCalls(batch.materialTextureBuffer_ != 0 ? 2 : 1);
+            }
+            // gl_DrawID starts at 0 for every call, so the shader adds the offset of the batch.
+            stateCache.Uniform(locations.drawDataOffset_, static_cast<GLint>(batch.firstCommand_));
+            if (locations.usesDrawId_) {
+                // vertex arrays may be recreated with the same name, so the attribute is set for every batch.
+                glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer_);
+                glEnableVertexAttribArray(DRAW_ID_ATTRIBUTE);
+                glVertexAttribIPointer(DRAW_ID_ATTRIBUTE, 1, GL_UNSIGNED_INT, 0, nullptr);
+                glVertexAttribDivisor(DRAW_ID_ATTRIBUTE, 1);
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+                stateCache.CountIssuedCalls(5);
+            }
+
+            if (batch.diffuseTexture_ != 0) {
+                stateCache.BindTexture(0, batch.diffuseTexture_, batch.textureArrays_);
+                stateCache.Uniform(batch.uniformLocations_[2], 0);
+            }
+            if (batch.bumpTexture_ != 0) {
+                stateCache.BindTexture(1, batch.bumpTexture_, batch.textureArrays_);
+                stateCache.Uniform(batch.uniformLocations_[3], 1);
+            }
+
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                reinterpret_cast<const void*>(static_cast<std::size_t>(batch.firstCommand_) * sizeof(IndirectDrawList::DrawCommand)),
+                static_cast<GLsizei>(batch.numCommands_), 0);
+            stateCache.CountIssuedCalls();
+
+            if (locations.usesDrawId_) {
+                // the vertex array belongs to the renderable and is used for regular draws as well.
+                glVertexAttribDivisor(DRAW_ID_ATTRIBUTE, 0);
+                glDisableVertexAttribArray(DRAW_ID_ATTRIBUTE);
+                stateCache.CountIssuedCalls(2);
+            }
+        }
+
+        stateCache.BindVertexArray(0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    void IndirectDrawBuffer::Upload(GLenum target, GLuint buffer, std::size_t& bufferSize, const void* data, std::size_t dataSize)
+    {
+        bufferSize = std::max(bufferSize, dataSize);
+        glBindBuffer(target, buffer);
+        glBufferData(target, static_cast<GLsizeiptr>(bufferSize), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(target, 0, static_cast<GLsizeiptr>(dataSize), data);
+    }
+
+    const IndirectDrawBuffer::ProgramLocations& IndirectDrawBuffer::GetProgramLocations(GLuint program)
+    {
+        auto it = programLocations_.find(program);
+        if (it != programLocations_.end()) return it->second;
+
+        ProgramLocations locations;
+        locations.drawDataOffset_ = glGetUniformLocation(program, "drawDataOffset");
+        locations.usesDrawId_ = glGetAttribLocation(program, "drawId") == static_cast<GLint>(DRAW_ID_ATTRIBUTE);
+        return programLocations_.emplace(program, locations).first->second;
+    }
+}
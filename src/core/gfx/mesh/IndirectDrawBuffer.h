@@ -0,0 +1,94 @@
+/**
+ * @file   IndirectDrawBuffer.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.12
+ *
+ * @brief  Declaration of the OpenGL buffers for multi draw indirect submission.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "core/open_gl_fwd.h"
+
+#include <unordered_map>
+
+namespace viscom {
+
+    class GLStateCache;
+    class IndirectDrawList;
+
+    /**
+     *  Holds the indirect command buffer and the per draw data storage buffer and submits an IndirectDrawList
+     *  with one glMultiDrawElementsIndirect per batch. Needs OpenGL 4.3 (see IsSupported), the shaders need to
+     *  include multiDraw.glsl and fetch their transforms with GetDrawData() instead of the modelMatrix and normalMatrix uniforms.
+     *  Without GL_ARB_shader_draw_parameters the shaders read the index of the draw from the instanced drawId attribute,
+     *  at location DRAW_ID_ATTRIBUTE, which is enabled in the vertex arrays of the batches only for their indirect call. The base instance of each command
+     *  is its index, so the programs cannot use other instanced attributes.
+     */
+    class IndirectDrawBuffer final
+    {
+    public:
+        /** The binding point of the per draw data storage buffer. */
+        static constexpr GLuint DRAW_DATA_BINDING = 0;
+        /** The location of the drawId attribute used without GL_ARB_shader_draw_parameters (see multiDraw.glsl). */
+        static constexpr GLuint DRAW_ID_ATTRIBUTE = 15;
+
+        IndirectDrawBuffer();
+        ~IndirectDrawBuffer();
+        IndirectDrawBuffer(const IndirectDrawBuffer&) = delete;
+        IndirectDrawBuffer& operator=(const IndirectDrawBuffer&) = delete;
+        IndirectDrawBuffer(IndirectDrawBuffer&&) noexcept;
+        IndirectDrawBuffer& operator=(IndirectDrawBuffer&&) noexcept;
+
+        /** Checks if the current context supports multi draw indirect. */
+        static bool IsSupported();
+
+        /**
+         *  Uploads the commands and draw data and submits all batches.
+         *  @param drawList the draw list to submit.
+         *  @param stateCache the state cache used for binding.
+         */
+        void Submit(const IndirectDrawList& drawList, GLStateCache& stateCache);
+
+    private:
+        /**
+         *  Uploads data to a buffer, orphaning the old storage.
+         *  @param target the buffer target.
+         *  @param buffer the buffer.
+         *  @param bufferSize the current size of the buffer, updated if it grows.
+         *  @param data the data to upload.
+         *  @param dataSize the size of the data in bytes.
+         */
+        static void Upload(GLenum target, GLuint buffer, std::size_t& bufferSize, const void* data, std::size_t dataSize);
+        /** The locations of a program used for multi draw indirect. */
+        struct ProgramLocations
+        {
+            /** The location of the drawDataOffset uniform. */
+            GLint drawDataOffset_ = -1;
+            /** Flag whether the program uses the drawId attribute instead of gl_DrawIDARB. */
+            bool usesDrawId_ = false;
+        };
+
+        /**
+         *  Returns the locations of the draw data uniform and attribute of a program.
+         *  @param program the program.
+         */
+        const ProgramLocations& GetProgramLocations(GLuint program);
+
+        /** Holds the indirect command buffer. */
+        GLuint commandBuffer_ = 0;
+        /** Holds the per draw data buffer. */
+        GLuint drawDataBuffer_ = 0;
+        /** Holds the size of the command buffer in bytes. */
+        std::size_t commandBufferSize_ = 0;
+        /** Holds the size of the per draw data buffer in bytes. */
+        std::size_t drawDataBufferSize_ = 0;
+        /** Holds the buffer of draw indices for the drawId attribute. */
+        GLuint drawIdBuffer_ = 0;
+        /** Holds the number of draw indices in the draw index buffer. */
+        std::size_t drawIdCount_ = 0;
+        /** Holds the locations per program. */
+        std::unordered_map<GLuint, ProgramLocations> programLocations_;
+    };
+}
@@ -0,0 +1,67 @@
+/**
+ * @file   IndirectDrawList.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.12
+ *
+ * @brief  Implementation of the CPU side generation of indirect draw commands.
+ */
+
+#include "IndirectDrawList.h"
+#include <algorithm>
+#include <numeric>
+
+namespace viscom {
+
+    static_assert(sizeof(IndirectDrawList::DrawCommand) == 5 * sizeof(std::uint32_t), "Draw commands need to be tightly packed.");
+    static_assert(sizeof(IndirectDrawList::DrawData) % 16 == 0, "Draw data needs to be a multiple of 16 bytes for std430.");
+
+    void IndirectDrawList::Build(const std::vector<RenderQueue::DrawItem>& items)
+    {
+        commands_.clear();
+        drawData_.clear();
+        batches_.clear();
+
+        order_.resize(items.size());
+        std::iota(order_.begin(), order_.end(), 0U);
+        std::stable_sort(order_.begin(), order_.end(), [&items](std::uint32_t lhs, std::uint32_t rhs) { return items[lhs].sortKey_ < items[rhs].sortKey_; });
+
+        commands_.reserve(items.size());
+        drawData_.reserve(items.size());
+        for (auto index : order_) {
+            const auto& item = items[index];
+            auto newBatch = batches_.empty() || batches_.back().program_ != item.program_ || batches_.back().vao_ != item.vao_
+                || batches_.back().diffuseTexture_ != item.diffuseTexture_ || batches_.back().bumpTexture_ != item.bumpTexture_
+                || batches_.back().textureArrays_ != item.textureArrays_ || batches_.back().materialBuffer_ != item.materialBuffer_
+                || batches_.back().materialTextureBuffer_ != item.materialTextureBuffer_;
+            if (newBatch) {
+                Batch batch;
+                batch.program_ = item.program_;
+                batch.vao_ = item.vao_;
+                batch.diffuseTexture_ = item.diffuseTexture_;
+                batch.bumpTexture_ = item.bumpTexture_;
+                batch.textureArrays_ = item.textureArrays_;
+                batch.materialBuffer_ = item.materialBuffer_;
+                batch.materialTextureBuffer_ = item.materialTextureBuffer_;
+                batch.uniformLocations_ = item.uniformLocations_;
+                batch.firstCommand_ = static_cast<std::uint32_t>(commands_.size());
+                batches_.push_back(batch);
+            }
+
+            DrawCommand command;
+            command.count_ = item.numIndices_;
+            command.firstIndex_ = item.indexOffset_;
+            // the base instance is used to find the draw data if gl_DrawIDARB is not supported.
+            command.baseInstance_ = static_cast<std::uint32_t>(commands_.size());
+            commands_.push_back(command);
+
+            DrawData data;
+            data.modelMatrix_ = item.modelMatrix_;
+            data.normalMatrix_ = glm::mat4{ item.normalMatrix_ };
+            data.materialIndex_ = item.materialIndex_;
+            data.bumpMultiplier_ = item.setBumpMultiplier_ ? item.bumpMultiplier_ : -1.0f;
+            drawData_.push_back(data);
+
+            ++batches_.back().numCommands_;
+        }
+    }
+}
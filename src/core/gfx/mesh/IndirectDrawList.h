@@ -0,0 +1,107 @@
+/**
+ * @file   IndirectDrawList.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.12
+ *
+ * @brief  Declaration of the CPU side generation of indirect draw commands.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "RenderQueue.h"
+
+namespace viscom {
+
+    /**
+     *  Builds the draw commands and per draw data for glMultiDrawElementsIndirect from render queue items.
+     *  Draws sharing program, vertex array, textures and material buffers are combined into batches, each batch is one indirect call.
+     *  This class does not use OpenGL, uploading and submitting is done by IndirectDrawBuffer.
+     */
+    class IndirectDrawList final
+    {
+    public:
+        /** A draw command with the layout OpenGL expects for glMultiDrawElementsIndirect. */
+        struct DrawCommand
+        {
+            /** The number of indices. */
+            std::uint32_t count_ = 0;
+            /** The number of instances. */
+            std::uint32_t instanceCount_ = 1;
+            /** The first index in the index buffer. */
+            std::uint32_t firstIndex_ = 0;
+            /** The value added to each index. */
+            std::int32_t baseVertex_ = 0;
+            /** The first instance. */
+            std::uint32_t baseInstance_ = 0;
+        };
+
+        /** The per draw data with std430 layout (see multiDraw.glsl). */
+        struct DrawData
+        {
+            /** The model matrix. */
+            glm::mat4 modelMatrix_ = glm::mat4{ 1.0f };
+            /** The normal matrix (padded to 4x4 for std430). */
+            glm::mat4 normalMatrix_ = glm::mat4{ 1.0f };
+            /** The material index. */
+            std::uint32_t materialIndex_ = 0;
+            /** The bump multiplier (negative if the bumpMultiplier uniform is set by the application). */
+            float bumpMultiplier_ = 1.0f;
+            /** Padding to 16 bytes. */
+            std::uint32_t padding_[2] = { 0, 0 };
+        };
+
+        /** A range of draw commands submitted with a single indirect call. */
+        struct Batch
+        {
+            /** The program to draw with. */
+            GLuint program_ = 0;
+            /** The vertex array object to draw with. */
+            GLuint vao_ = 0;
+            /** The diffuse texture (0 if none). */
+            GLuint diffuseTexture_ = 0;
+            /** The bump texture (0 if none). */
+            GLuint bumpTexture_ = 0;
+            /** Flag whether the textures are texture arrays packed by the TexturePacker. */
+            bool textureArrays_ = false;
+            /** The material uniform buffer of the mesh (0 if uniform buffers are not used). */
+            GLuint materialBuffer_ = 0;
+            /** The material texture uniform buffer of the mesh (0 if none). */
+            GLuint materialTextureBuffer_ = 0;
+            /** The uniform locations copied from the draw items (diffuseTexture and bumpTexture are used). */
+            std::array<GLint, 5> uniformLocations_ = { -1, -1, -1, -1, -1 };
+            /** The first command (and draw data) of the batch. */
+            std::uint32_t firstCommand_ = 0;
+            /** The number of commands in the batch. */
+            std::uint32_t numCommands_ = 0;
+        };
+
+        /**
+         *  Builds the commands from the items of a render queue.
+         *  @param queue the render queue to build the commands from.
+         */
+        void Build(const RenderQueue& queue) { Build(queue.GetDrawItems()); }
+        /**
+         *  Builds the commands from render queue items, all previous commands are removed.
+         *  @param items the draw items.
+         */
+        void Build(const std::vector<RenderQueue::DrawItem>& items);
+
+        /** Returns the draw commands. */
+        const std::vector<DrawCommand>& GetCommands() const noexcept { return commands_; }
+        /** Returns the per draw data, the i-th entry belongs to the i-th command. */
+        const std::vector<DrawData>& GetDrawData() const noexcept { return drawData_; }
+        /** Returns the batches. */
+        const std::vector<Batch>& GetBatches() const noexcept { return batches_; }
+
+    private:
+        /** Holds the draw commands. */
+        std::vector<DrawCommand> commands_;
+        /** Holds the per draw data. */
+        std::vector<DrawData> drawData_;
+        /** Holds the batches. */
+        std::vector<Batch> batches_;
+        /** Holds the sorted item order. */
+        std::vector<std::uint32_t> order_;
+    };
+}
@@ -0,0 +1,113 @@
+/**
+ * @file   LocalPose.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.04
+ *
+ * @brief  Definition of local pose buffers and the kernels for blending them.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+namespace viscom {
+
+    /** Blend mode of an animation layer. */
+    enum class AnimationBlendMode {
+        /** The layer replaces the pose below it (weighted). */
+        Override,
+        /** The difference of the layer to its reference pose is added to the pose below it (weighted). */
+        Additive
+    };
+
+    /**
+     *  Local (parent relative) poses of all nodes of a mesh.
+     *  The components are stored as separate arrays so the blending loops run over contiguous memory.
+     */
+    struct LocalPoseBuffer
+    {
+        /**
+         *  Resizes the buffer.
+         *  @param numNodes the number of nodes.
+         */
+        void Resize(std::size_t numNodes)
+        {
+            translations_.resize(numNodes, glm::vec3{ 0.0f });
+            rotations_.resize(numNodes, glm::quat{ 1.0f, 0.0f, 0.0f, 0.0f });
+            scales_.resize(numNodes, glm::vec3{ 1.0f });
+        }
+
+        /** Returns the number of nodes in the buffer. */
+        std::size_t size() const noexcept { return translations_.size(); }
+
+        /** Holds the translation of each node. */
+        std::vector<glm::vec3> translations_;
+        /** Holds the rotation of each node. */
+        std::vector<glm::quat> rotations_;
+        /** Holds the scaling of each node. */
+        std::vector<glm::vec3> scales_;
+    };
+
+    /**
+     *  Blends a pose into another one: dst = mix(dst, src, weights[i]).
+     *  Rotations are blended by normalized linear interpolation in the same hemisphere.
+     *  @param dst the pose blended into.
+     *  @param src the pose to blend.
+     *  @param weights the blend weight for each node.
+     */
+    inline void BlendPoses(LocalPoseBuffer& dst, const LocalPoseBuffer& src, const float* weights)
+    {
+        const auto n = dst.size();
+        for (std::size_t i = 0; i < n; ++i) dst.translations_[i] += (src.translations_[i] - dst.translations_[i]) * weights[i];
+        for (std::size_t i = 0; i < n; ++i) dst.scales_[i] += (src.scales_[i] - dst.scales_[i]) * weights[i];
+        for (std::size_t i = 0; i < n; ++i) {
+            const auto& a = dst.rotations_[i];
+            const auto& b = src.rotations_[i];
+            auto w = glm::dot(a, b) < 0.0f ? -weights[i] : weights[i];
+            glm::quat r{ a.w * (1.0f - weights[i]) + b.w * w, a.x * (1.0f - weights[i]) + b.x * w,
+                a.y * (1.0f - weights[i]) + b.y * w, a.z * (1.0f - weights[i]) + b.z * w };
+            dst.rotations_[i] = r * (1.0f / glm::sqrt(glm::dot(r, r)));
+        }
+    }
+
+    /**
+     *  Adds the difference of a pose to a reference pose to another pose (weighted).
+     *  @param dst the pose added to.
+     *  @param src the additive pose.
+     *  @param reference the reference pose of the additive pose.
+     *  @param weights the blend weight for each node.
+     */
+    inline void AddPoses(LocalPoseBuffer& dst, const LocalPoseBuffer& src, const LocalPoseBuffer& reference, const float* weights)
+    {
+        const auto n = dst.size();
+        for (std::size_t i = 0; i < n; ++i) dst.translations_[i] += (src.translations_[i] - reference.translations_[i]) * weights[i];
+        for (std::size_t i = 0; i < n; ++i) dst.scales_[i] *= glm::vec3{ 1.0f } + (src.scales_[i] / reference.scales_[i] - glm::vec3{ 1.0f }) * weights[i];
+        for (std::size_t i = 0; i < n; ++i) {
+            auto delta = src.rotations_[i] * glm::conjugate(reference.rotations_[i]);
+            if (delta.w < 0.0f) delta = -delta;
+            glm::quat r{ 1.0f + (delta.w - 1.0f) * weights[i], delta.x * weights[i], delta.y * weights[i], delta.z * weights[i] };
+            dst.rotations_[i] = (r * (1.0f / glm::sqrt(glm::dot(r, r)))) * dst.rotations_[i];
+        }
+    }
+
+    /**
+     *  Composes a transformation matrix from translation, rotation and scaling.
+     *  @param translation the translation.
+     *  @param rotation the rotation.
+     *  @param scale the scaling.
+     */
+    inline glm::mat4 ComposeLocalPose(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+    {
+        auto pose = glm::mat4_cast(rotation);
+        pose[0] *= scale.x;
+        pose[1] *= scale.y;
+        pose[2] *= scale.z;
+        pose[3] = glm::vec4(translation, 1.0f);
+        return pose;
+    }
+}
@@ -12,6 +12,7 @@
 #include "assimp_convert_helpers.h"
 #include "core/FrameworkInternal.h"
 #include "core/gfx/Material.h"
+#include "core/gfx/UniformBuffers.h"
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
@@ -64,6 +65,16 @@ namespace viscom {
     {
         if (indexBuffer_ != 0) glDeleteBuffers(1, &indexBuffer_);
         indexBuffer_ = 0;
+        if (materialBuffer_ != 0) glDeleteBuffers(1, &materialBuffer_);
+        materialBuffer_ = 0;
+        if (materialTextureBuffer_ != 0) glDeleteBuffers(1, &materialTextureBuffer_);
+        materialTextureBuffer_ = 0;
+    }
+
+    void Mesh::UpdateMaterialTextureBuffer()
+    {
+        if (materialTextureBuffer_ != 0) glDeleteBuffers(1, &materialTextureBuffer_);
+        materialTextureBuffer_ = UniformBuffers::CreateMaterialTextureBuffer(materialTextures_);
     }
 
     void Mesh::Initialize(bool forceGenNormals, bool flipTextures)
@@ -81,11 +92,15 @@ namespace viscom {
         if (!Load(filename, binFilename, GetAppNode())) LoadAssimpMeshFromFile(filename, binFilename, GetAppNode());
 
         FlattenHierarchies();
+        // the hierarchy is rebuilt in memory only if it could not be read from the binary file.
+        if (triangleBVH_) triangleBVH_->UpdatePositions(*this);
+        else triangleBVH_ = std::make_unique<TriangleBVH>(*this);
 
         glGenBuffers(1, &indexBuffer_);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer_);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices_.size() * sizeof(unsigned int), indices_.data(), GL_STATIC_DRAW);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        materialBuffer_ = UniformBuffers::CreateMaterialBuffer(materials_);
 
         if (data.has_value()) {
             data->clear();
@@ -134,6 +149,11 @@ namespace viscom {
         auto scene = loader.ReadFile(fullFilename, forceGenNormals_ ? ASSIMP_FLAGS_FORCEGEN : ASSIMP_FLAGS);
 
         LoadAssimpMesh(scene, node);
+        // the triangle hierarchy needs the flattened nodes and is stored together with the mesh. Only the node tree is
+        // flattened here, as animations are written by channel name and flattening them clears their channel map.
+        nodes_.clear();
+        rootNode_->FlattenNodeTree(nodes_);
+        triangleBVH_ = std::make_unique<TriangleBVH>(*this);
         Save(binFilename);
     }
 
@@ -395,6 +415,10 @@ namespace viscom {
         for (const auto& animation : animations_) animation.Write(ofs);
 
         rootNode_->Write(ofs);
+
+        // meshes loaded from memory have no triangle hierarchy until it is first used (see GetTriangleBVH).
+        serializeHelper::write(ofs, triangleBVH_ != nullptr);
+        if (triangleBVH_) triangleBVH_->Write(ofs);
     }
 
 #ifdef VISCOM_NO_FILESYSTEM
@@ -468,9 +492,36 @@ namespace viscom {
         nodeMap[0] = nullptr;
         if (!rootNode_->Read(ifs, nodeMap)) return false;
 
+        bool hasTriangleBVH = false;
+        serializeHelper::read(ifs, hasTriangleBVH);
+        if (hasTriangleBVH) {
+            triangleBVH_ = std::make_unique<TriangleBVH>();
+            if (!triangleBVH_->Read(ifs)) triangleBVH_.reset();
+        }
+
         return true;
     }
 
+    const TriangleBVH& Mesh::GetTriangleBVH() const
+    {
+        std::lock_guard<std::mutex> lock{ triangleBVHMutex_ };
+        // only meshes loaded from memory get here without a hierarchy, it is never written to disk from here.
+        if (!triangleBVH_) triangleBVH_ = std::make_unique<TriangleBVH>(*this);
+        return *triangleBVH_;
+    }
+
+    MeshRayHit Mesh::IntersectRay(const math::Line3<float>& ray, const glm::mat4& modelMatrix) const
+    {
+        auto invModelMatrix = glm::inverse(modelMatrix);
+        math::Line3<float> meshRay{ glm::vec3(invModelMatrix * glm::vec4(ray[0], 1.0f)), glm::vec3(invModelMatrix * glm::vec4(ray[1], 1.0f)) };
+        auto result = GetTriangleBVH().IntersectRay(meshRay);
+        if (result.hit_) {
+            result.position_ = glm::vec3(modelMatrix * glm::vec4(result.position_, 1.0f));
+            result.distance_ = glm::length(result.position_ - ray[0]);
+        }
+        return result;
+    }
+
     /**
      *  This function walks the hierarchy of bones and does two things:
      *  - set the parent of each bone into `boneParent_`
@@ -536,12 +587,22 @@ namespace viscom {
 
     void Mesh::FlattenHierarchies()
     {
+        nodes_.clear();
         rootNode_->FlattenNodeTree(nodes_);
         std::map<std::string, std::size_t> nodeIndexMap;
         for (const auto& node : nodes_) {
             nodeIndexMap[node->GetName()] = node->GetNodeIndex();
         }
 
+        // The nodes are in depth first order so parents are always before their children.
+        // Bones skip their unnamed parents (e.g. pivot nodes created by assimp).
+        nodeParents_.resize(nodes_.size());
+        for (std::size_t i = 0; i < nodes_.size(); ++i) {
+            auto nodeParent = nodes_[i]->GetParent();
+            while (nodeParent && nodes_[i]->GetBoneIndex() != -1 && nodeParent->GetName().empty()) nodeParent = nodeParent->GetParent();
+            nodeParents_[i] = nodeParent ? static_cast<int>(nodeParent->GetNodeIndex()) : -1;
+        }
+
         for (auto& animation : animations_) animation.FlattenHierarchy(nodes_.size(), nodeIndexMap);
     }
 
@@ -10,6 +10,7 @@
 
 #include "Animation.h"
 #include "SubMesh.h"
+#include "TriangleBVH.h"
 #include "core/gfx/Material.h"
 #include "core/main.h"
 #include "core/math/aabb.h"
@@ -17,6 +18,8 @@
 #include "core/resources/Resource.h"
 #include "core/utils/serializationHelper.h"
 
+#include <mutex>
+
 struct aiNode;
 
 namespace viscom {
@@ -59,6 +62,11 @@ namespace viscom {
         const std::vector<const SceneMeshNode*>& GetNodes() const noexcept { return nodes_; }
         /** Returns the root node of the mesh. */
         const SceneMeshNode* GetRootNode() const noexcept { return rootNode_.get(); }
+        /**
+         *  Returns the index of the parent node used for pose computation for each node (-1 for the root).
+         *  Nodes are sorted topologically, i.e. a parent index is always smaller than the node index.
+         */
+        const std::vector<int>& GetNodeParentIndices() const noexcept { return nodeParents_; }
 
         /** Returns the vertices used by the mesh and all sub-meshes. */
         const std::vector<glm::vec3>& GetVertices() const noexcept { return vertices_; }
@@ -85,6 +93,12 @@ namespace viscom {
         const std::vector<unsigned int>& GetIndices() const noexcept { return indices_; }
         /** Returns the OpenGL index buffer. */
         GLuint GetIndexBuffer() const noexcept { return indexBuffer_; }
+        /** Returns the OpenGL uniform buffer holding the material block (see UniformBuffers). */
+        GLuint GetMaterialBuffer() const noexcept { return materialBuffer_; }
+        /** Returns the OpenGL uniform buffer holding the material texture block (0 if no textures are packed). */
+        GLuint GetMaterialTextureBuffer() const noexcept { return materialTextureBuffer_; }
+        /** Writes the packed texture references of the material textures to the material texture block. */
+        void UpdateMaterialTextureBuffer();
 
         /** Returns the number of animations this mesh has. */
         std::size_t GetNumAnimations() const { return animations_.size(); }
@@ -93,6 +107,8 @@ namespace viscom {
          *  @param animationIndex index of the animation to return.
          */
         const Animation* GetAnimation(std::size_t animationIndex = 0) const { return &animations_[animationIndex]; }
+        /** Returns the number of materials of the mesh. */
+        std::size_t GetNumMaterials() const noexcept { return materials_.size(); }
         /**
          *  Returns a material of the mesh.
          *  @param materialIndex index of the material to return.
@@ -124,6 +140,20 @@ namespace viscom {
         /** Returns the global inverse matrix of the mesh. */
         glm::mat4 GetGlobalInverse() const { return globalInverse_; }
 
+        /** Returns the triangle hierarchy of the mesh, it is built when the mesh is converted and stored in the binary mesh file. */
+        const TriangleBVH& GetTriangleBVH() const;
+        /**
+         *  Finds the closest triangle hit by a ray.
+         *  @param ray the ray in mesh space given by its origin and a second point.
+         */
+        MeshRayHit IntersectRay(const math::Line3<float>& ray) const { return GetTriangleBVH().IntersectRay(ray); }
+        /**
+         *  Finds the closest triangle hit by a ray in world space (e.g. from CameraHelper::GetPickRay).
+         *  @param ray the ray in world space given by its origin and a second point.
+         *  @param modelMatrix the model matrix the mesh is drawn with.
+         */
+        MeshRayHit IntersectRay(const math::Line3<float>& ray, const glm::mat4& modelMatrix) const;
+
         /** Returns the meshes filename (and path). */
         std::string GetFilename() const;
 
@@ -142,7 +172,7 @@ namespace viscom {
 
     private:
         /** Defines the type of the VersionableSerializer for the mesh class. */
-        using VersionableSerializerType = serializeHelper::VersionableSerializer<'V', 'M', 'E', 'S', 1000>;
+        using VersionableSerializerType = serializeHelper::VersionableSerializer<'V', 'M', 'E', 'S', 1001>;
 
         /**
          *  Loads a texture from the texture manager.
@@ -238,6 +268,8 @@ namespace viscom {
         std::vector<SubMesh> subMeshes_;
         /** Nodes in this mesh. */
         std::vector<const SceneMeshNode*> nodes_;
+        /** Parent node indices for pose computation (unnamed parents of bones are skipped). */
+        std::vector<int> nodeParents_;
         /** Animations of this mesh */
         std::vector<Animation> animations_;
 
@@ -250,6 +282,14 @@ namespace viscom {
 
         /** Holds the OpenGL index buffer. */
         GLuint indexBuffer_;
+        /** Holds the OpenGL uniform buffer for the material block. */
+        GLuint materialBuffer_ = 0;
+        /** Holds the OpenGL uniform buffer for the material texture block. */
+        GLuint materialTextureBuffer_ = 0;
+        /** Holds the triangle hierarchy (built on first use). */
+        mutable std::unique_ptr<TriangleBVH> triangleBVH_;
+        /** Holds the mutex for building the triangle hierarchy. */
+        mutable std::mutex triangleBVHMutex_;
         /** Flip the textures on load. */
         bool flipTextures_ = true;
     };
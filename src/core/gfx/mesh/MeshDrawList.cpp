@@ -0,0 +1,89 @@
+/**
+ * @file   MeshDrawList.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.09
+ *
+ * @brief  Implementation of a flat list of draw records compiled from the node tree of a mesh.
+ */
+
+#include "MeshDrawList.h"
+#include "Mesh.h"
+#include "SceneMeshNode.h"
+#include "core/math/transforms.h"
+#include <glm/gtc/matrix_inverse.hpp>
+
+namespace viscom {
+
+    MeshDrawList::MeshDrawList(const Mesh* mesh)
+    {
+        const auto& meshNodes = mesh->GetNodes();
+        nodes_.resize(meshNodes.size());
+        nodeTransforms_.resize(meshNodes.size());
+        worldMatrices_.resize(meshNodes.size());
+        normalMatrices_.resize(meshNodes.size());
+
+        // nodes are in depth first order, so parents are handled before their children.
+        for (std::size_t i = 0; i < meshNodes.size(); ++i) {
+            const auto* node = meshNodes[i];
+            auto& record = nodes_[i];
+            glm::mat4 parentTransform{ 1.0f };
+            if (node->GetParent()) parentTransform = nodeTransforms_[node->GetParent()->GetNodeIndex()];
+            nodeTransforms_[i] = parentTransform * node->GetLocalTransform();
+
+            // the bounding boxes of a node are in the space of its parent.
+            record.hasMeshes_ = node->HasMeshes();
+            record.bounds_ = math::transformAABB(node->GetBoundingBox(), parentTransform);
+            record.firstDraw_ = static_cast<std::uint32_t>(draws_.size());
+            for (std::size_t j = 0; j < node->GetNumberOfSubMeshes(); ++j) {
+                const auto& subMesh = mesh->GetSubMeshes()[node->GetSubMeshID(j)];
+                if (subMesh.GetNumberOfIndices() == 0) continue;
+
+                DrawRecord draw;
+                draw.nodeIndex_ = static_cast<std::uint32_t>(i);
+                draw.indexOffset_ = subMesh.GetIndexOffset();
+                draw.numIndices_ = subMesh.GetNumberOfIndices();
+                draw.materialIndex_ = static_cast<std::uint32_t>(subMesh.GetMaterialIndex());
+                draw.bounds_ = math::transformAABB(node->GetSubMeshBoundingBoxes()[j], parentTransform);
+                draws_.push_back(draw);
+            }
+            record.numDraws_ = static_cast<std::uint32_t>(draws_.size()) - record.firstDraw_;
+        }
+
+        // sub tree sizes are accumulated bottom up.
+        std::vector<std::uint32_t> subTreeSizes(meshNodes.size(), 1);
+        for (auto i = meshNodes.size(); i-- > 0;) {
+            nodes_[i].subTreeEnd_ = static_cast<std::uint32_t>(i) + subTreeSizes[i];
+            if (meshNodes[i]->GetParent()) subTreeSizes[meshNodes[i]->GetParent()->GetNodeIndex()] += subTreeSizes[i];
+        }
+    }
+
+    void MeshDrawList::UpdateWorldTransforms(const glm::mat4& modelMatrix)
+    {
+        if (hasStaticWorldTransforms_ && cachedModelMatrix_ == modelMatrix) return;
+
+        for (std::size_t i = 0; i < nodes_.size(); ++i) {
+            if (nodes_[i].numDraws_ == 0) continue;
+            worldMatrices_[i] = modelMatrix * nodeTransforms_[i];
+            normalMatrices_[i] = glm::inverseTranspose(glm::mat3(worldMatrices_[i]));
+        }
+        cachedModelMatrix_ = modelMatrix;
+        hasStaticWorldTransforms_ = true;
+    }
+
+    void MeshDrawList::UpdateWorldTransforms(const glm::mat4& modelMatrix, const std::vector<glm::mat4>& nodePoses)
+    {
+        for (std::size_t i = 0; i < nodes_.size(); ++i) {
+            if (nodes_[i].numDraws_ == 0) continue;
+            worldMatrices_[i] = modelMatrix * nodePoses[i];
+            normalMatrices_[i] = glm::inverseTranspose(glm::mat3(worldMatrices_[i]));
+        }
+        hasStaticWorldTransforms_ = false;
+    }
+
+    void MeshDrawList::SetWorldTransform(std::size_t nodeIndex, const glm::mat4& worldMatrix)
+    {
+        worldMatrices_[nodeIndex] = worldMatrix;
+        normalMatrices_[nodeIndex] = glm::inverseTranspose(glm::mat3(worldMatrix));
+        hasStaticWorldTransforms_ = false;
+    }
+}
@@ -0,0 +1,108 @@
+/**
+ * @file   MeshDrawList.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.09
+ *
+ * @brief  Declaration of a flat list of draw records compiled from the node tree of a mesh.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "core/math/aabb.h"
+
+namespace viscom {
+
+    class Mesh;
+
+    /**
+     *  The node tree of a mesh compiled into contiguous arrays, so drawing is a linear loop.
+     *  Nodes are stored in the meshes (depth first) node order, the sub tree of a node is the range
+     *  [node index, subTreeEnd_). World and normal matrices are cached and only updated if the model matrix changes.
+     */
+    class MeshDrawList final
+    {
+    public:
+        /** A node of the compiled mesh. */
+        struct NodeRecord
+        {
+            /** The first draw record of the node. */
+            std::uint32_t firstDraw_ = 0;
+            /** The number of draw records of the node. */
+            std::uint32_t numDraws_ = 0;
+            /** The index after the last node in the sub tree of this node. */
+            std::uint32_t subTreeEnd_ = 0;
+            /** Flag whether the sub tree of the node has meshes. */
+            bool hasMeshes_ = false;
+            /** The bounding box of the sub tree in mesh space. */
+            math::AABB3<float> bounds_;
+        };
+
+        /** A single draw of a sub mesh. */
+        struct DrawRecord
+        {
+            /** The index of the node (and its transforms). */
+            std::uint32_t nodeIndex_ = 0;
+            /** The first index of the sub mesh in the index buffer. */
+            std::uint32_t indexOffset_ = 0;
+            /** The number of indices of the sub mesh. */
+            std::uint32_t numIndices_ = 0;
+            /** The material index of the sub mesh. */
+            std::uint32_t materialIndex_ = 0;
+            /** The bounding box of the sub mesh in mesh space. */
+            math::AABB3<float> bounds_;
+        };
+
+        /**
+         *  Constructor, compiles the node tree of a mesh.
+         *  @param mesh the mesh to compile.
+         */
+        explicit MeshDrawList(const Mesh* mesh);
+
+        /** Returns the node records. */
+        const std::vector<NodeRecord>& GetNodes() const noexcept { return nodes_; }
+        /** Returns the draw records. */
+        const std::vector<DrawRecord>& GetDraws() const noexcept { return draws_; }
+        /** Returns the (static) transform of each node into mesh space. */
+        const std::vector<glm::mat4>& GetNodeTransforms() const noexcept { return nodeTransforms_; }
+
+        /**
+         *  Updates the world and normal matrices for the static node transforms if the model matrix changed.
+         *  @param modelMatrix the model matrix.
+         */
+        void UpdateWorldTransforms(const glm::mat4& modelMatrix);
+        /**
+         *  Updates the world and normal matrices for animated node transforms.
+         *  @param modelMatrix the model matrix.
+         *  @param nodePoses the transform of each node into mesh space.
+         */
+        void UpdateWorldTransforms(const glm::mat4& modelMatrix, const std::vector<glm::mat4>& nodePoses);
+        /**
+         *  Sets the world and normal matrix of a single node, the cached static transforms become invalid.
+         *  @param nodeIndex the index of the node.
+         *  @param worldMatrix the world matrix of the node.
+         */
+        void SetWorldTransform(std::size_t nodeIndex, const glm::mat4& worldMatrix);
+        /** Returns the world matrix of each node. */
+        const std::vector<glm::mat4>& GetWorldMatrices() const noexcept { return worldMatrices_; }
+        /** Returns the normal matrix of each node. */
+        const std::vector<glm::mat3>& GetNormalMatrices() const noexcept { return normalMatrices_; }
+
+    private:
+        /** Holds the node records. */
+        std::vector<NodeRecord> nodes_;
+        /** Holds the draw records. */
+        std::vector<DrawRecord> draws_;
+        /** Holds the transform of each node into mesh space. */
+        std::vector<glm::mat4> nodeTransforms_;
+
+        /** Holds the model matrix the world matrices were computed with. */
+        glm::mat4 cachedModelMatrix_ = glm::mat4{ 1.0f };
+        /** Flag whether the cached world matrices belong to the static node transforms. */
+        bool hasStaticWorldTransforms_ = false;
+        /** Holds the world matrix of each node. */
+        std::vector<glm::mat4> worldMatrices_;
+        /** Holds the normal matrix of each node. */
+        std::vector<glm::mat3> normalMatrices_;
+    };
+}
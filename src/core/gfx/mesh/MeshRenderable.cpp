@@ -8,14 +8,19 @@
 
 
 #include "core/open_gl.h"
-#include "SceneMeshNode.h"
-#include "SubMesh.h"
+#include "core/math/math.h"
+#include "core/math/transforms.h"
 #include "core/gfx/Material.h"
 #include "core/gfx/Texture.h"
+#include "core/gfx/OcclusionCuller.h"
 #include <glm/gtc/matrix_inverse.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cstddef>
 
 #include "MeshRenderable.h"
+#include "RenderQueue.h"
+#include "SceneMeshNode.h"
 
 namespace viscom {
 
@@ -28,7 +33,8 @@ namespace viscom {
         mesh_(renderMesh),
         vbo_(vBuffer),
         vao_(0),
-        drawProgram_(program)
+        drawProgram_(program),
+        drawList_(renderMesh)
     {
     }
 
@@ -41,6 +47,8 @@ namespace viscom {
         vbo_ = 0;
         if (vao_ != 0) glDeleteVertexArrays(1, &vao_);
         vao_ = 0;
+        if (instanceBuffer_ != 0) glDeleteBuffers(1, &instanceBuffer_);
+        instanceBuffer_ = 0;
     }
 
     /**
@@ -51,12 +59,21 @@ namespace viscom {
         mesh_(orig.mesh_),
         vbo_(orig.vbo_),
         vao_(orig.vao_),
+        instanceBuffer_(orig.instanceBuffer_),
+        instanceBufferSize_(orig.instanceBufferSize_),
+        instanceData_(std::move(orig.instanceData_)),
         drawProgram_(orig.drawProgram_),
-        uniformLocations_(std::move(orig.uniformLocations_))
+        uniformLocations_(std::move(orig.uniformLocations_)),
+        uniformBuffers_(orig.uniformBuffers_),
+        drawList_(std::move(orig.drawList_)),
+        frustumCulling_(orig.frustumCulling_),
+        cullingStatistics_(orig.cullingStatistics_)
     {
         orig.mesh_ = nullptr;
         orig.vbo_ = 0;
         orig.vao_ = 0;
+        orig.instanceBuffer_ = 0;
+        orig.instanceBufferSize_ = 0;
         orig.drawProgram_ = nullptr;
     }
 
@@ -71,11 +88,20 @@ namespace viscom {
             mesh_ = orig.mesh_;
             vbo_ = orig.vbo_;
             vao_ = orig.vao_;
+            instanceBuffer_ = orig.instanceBuffer_;
+            instanceBufferSize_ = orig.instanceBufferSize_;
+            instanceData_ = std::move(orig.instanceData_);
             drawProgram_ = orig.drawProgram_;
             uniformLocations_ = std::move(orig.uniformLocations_);
+            uniformBuffers_ = orig.uniformBuffers_;
+            drawList_ = std::move(orig.drawList_);
+            frustumCulling_ = orig.frustumCulling_;
+            cullingStatistics_ = orig.cullingStatistics_;
             orig.mesh_ = nullptr;
             orig.vbo_ = 0;
             orig.vao_ = 0;
+            orig.instanceBuffer_ = 0;
+            orig.instanceBufferSize_ = 0;
             orig.drawProgram_ = nullptr;
         }
         return *this;
@@ -87,46 +113,280 @@ namespace viscom {
         glBindVertexArray(vao_);
         glBindBuffer(GL_ARRAY_BUFFER, vbo_);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh_->GetIndexBuffer());
-        DrawNode(modelMatrix, mesh_->GetRootNode(), overrideBump);
+        if (uniformBuffers_) UniformBuffers::BindMaterialBuffer(mesh_->GetMaterialBuffer(), mesh_->GetMaterialTextureBuffer());
+        VisitDrawList(modelMatrix, nullptr, [this, overrideBump](const MeshDrawList::DrawRecord& draw) { DrawSubMesh(draw, overrideBump); });
         glBindVertexArray(0);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
     }
 
-    void MeshRenderable::DrawNode(const glm::mat4& modelMatrix, const SceneMeshNode* node, bool overrideBump) const
+    void MeshRenderable::Draw(const glm::mat4& modelMatrix, const math::Frustum<float>& frustum, bool overrideBump) const
+    {
+        glUseProgram(drawProgram_->getProgramId());
+        glBindVertexArray(vao_);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh_->GetIndexBuffer());
+        if (uniformBuffers_) UniformBuffers::BindMaterialBuffer(mesh_->GetMaterialBuffer(), mesh_->GetMaterialTextureBuffer());
+        VisitDrawList(modelMatrix, frustumCulling_ ? &frustum : nullptr,
+            [this, overrideBump](const MeshDrawList::DrawRecord& draw) { DrawSubMesh(draw, overrideBump); });
+        glBindVertexArray(0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void MeshRenderable::DrawNode(const glm::mat4& modelMatrix, const SceneMeshNode* node, bool overrideBump, const math::Frustum<float>* frustum) const
+    {
+        if (uniformBuffers_) UniformBuffers::BindMaterialBuffer(mesh_->GetMaterialBuffer(), mesh_->GetMaterialTextureBuffer());
+        DrawSubTree(modelMatrix, node, overrideBump, frustum);
+    }
+
+    void MeshRenderable::DrawSubTree(const glm::mat4& modelMatrix, const SceneMeshNode* node, bool overrideBump, const math::Frustum<float>* frustum) const
     {
         if (!node->HasMeshes()) return;
 
+        // the bounding boxes of a node are in the space of its parent.
+        if (frustum && node->IsBoundingBoxValid()) {
+            if (!math::AABBInFrustumTest(*frustum, math::transformAABB(node->GetBoundingBox(), modelMatrix))) {
+                ++cullingStatistics_.culledNodes_;
+                return;
+            }
+            if (occlusionCuller_ && !occlusionCuller_->IsVisible(node->GetBoundingBox(), modelMatrix)) {
+                ++cullingStatistics_.occludedNodes_;
+                return;
+            }
+        }
+
         auto localMatrix = modelMatrix * node->GetLocalTransform();
+        drawList_.SetWorldTransform(node->GetNodeIndex(), localMatrix);
+        const auto& record = drawList_.GetNodes()[node->GetNodeIndex()];
+        auto draw = drawList_.GetDraws().begin() + record.firstDraw_;
         for (std::size_t i = 0; i < node->GetNumberOfSubMeshes(); ++i) {
-            const auto* submesh = &mesh_->GetSubMeshes()[node->GetSubMeshID(i)];
-            DrawSubMesh(localMatrix, submesh, overrideBump);
+            // sub meshes without indices have no draw record.
+            if (mesh_->GetSubMeshes()[node->GetSubMeshID(i)].GetNumberOfIndices() == 0) continue;
+            const auto& drawRecord = *draw++;
+            if (frustum && node->IsBoundingBoxValid()
+                && !math::AABBInFrustumTest(*frustum, math::transformAABB(node->GetSubMeshBoundingBoxes()[i], modelMatrix))) {
+                ++cullingStatistics_.culledSubMeshes_;
+                continue;
+            }
+            DrawSubMesh(drawRecord, overrideBump);
+            ++cullingStatistics_.drawnSubMeshes_;
         }
-        for (std::size_t i = 0; i < node->GetNumberOfNodes(); ++i) DrawNode(localMatrix, node->GetChild(i), overrideBump);
+
+        for (std::size_t i = 0; i < node->GetNumberOfNodes(); ++i) DrawSubTree(localMatrix, node->GetChild(i), overrideBump, frustum);
     }
 
-    void MeshRenderable::DrawSubMesh(const glm::mat4& modelMatrix, const SubMesh* subMesh, bool overrideBump) const
+    void MeshRenderable::DrawInstanced(const glm::mat4* instanceMatrices, std::size_t numInstances, bool overrideBump) const
     {
-        if (subMesh->GetNumberOfIndices() == 0) return;
+        instanceData_.resize(numInstances);
+        for (std::size_t i = 0; i < numInstances; ++i) {
+            instanceData_[i].modelMatrix_ = instanceMatrices[i];
+            instanceData_[i].normalMatrix_ = glm::inverseTranspose(glm::mat3(instanceMatrices[i]));
+        }
+        DrawInstanceData(overrideBump);
+    }
 
-        glUniformMatrix4fv(uniformLocations_[0], 1, GL_FALSE, glm::value_ptr(modelMatrix));
-        glUniformMatrix3fv(uniformLocations_[1], 1, GL_FALSE, glm::value_ptr(glm::inverseTranspose(glm::mat3(modelMatrix))));
+    void MeshRenderable::DrawInstanced(const glm::mat4* instanceMatrices, std::size_t numInstances, const math::Frustum<float>& frustum, bool overrideBump) const
+    {
+        if (!frustumCulling_) {
+            DrawInstanced(instanceMatrices, numInstances, overrideBump);
+            return;
+        }
 
-        auto mat = mesh_->GetMaterial(subMesh->GetMaterialIndex());
-        auto matTex = mesh_->GetMaterialTexture(subMesh->GetMaterialIndex());
-        if (matTex->diffuseTex && uniformLocations_.size() > 2) {
+        instanceData_.clear();
+        const auto& meshBounds = mesh_->GetRootNode()->GetBoundingBox();
+        for (std::size_t i = 0; i < numInstances; ++i) {
+            if (!math::AABBInFrustumTest(frustum, math::transformAABB(meshBounds, instanceMatrices[i]))) {
+                ++cullingStatistics_.culledInstances_;
+                continue;
+            }
+            instanceData_.push_back(InstanceData{ instanceMatrices[i], glm::inverseTranspose(glm::mat3(instanceMatrices[i])) });
+        }
+        DrawInstanceData(overrideBump);
+    }
+
+    void MeshRenderable::DrawInstanceData(bool overrideBump) const
+    {
+        if (instanceData_.empty()) return;
+
+        // the buffer is orphaned every time, so the driver does not need to wait for earlier draws.
+        auto dataSize = instanceData_.size() * sizeof(InstanceData);
+        instanceBufferSize_ = std::max(instanceBufferSize_, dataSize);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer_);
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(instanceBufferSize_), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(dataSize), instanceData_.data());
+
+        glUseProgram(drawProgram_->getProgramId());
+        glBindVertexArray(vao_);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh_->GetIndexBuffer());
+        if (uniformBuffers_) UniformBuffers::BindMaterialBuffer(mesh_->GetMaterialBuffer(), mesh_->GetMaterialTextureBuffer());
+        // the node transforms are used as model matrices, the instance transforms are applied in the shader.
+        auto numInstances = static_cast<GLsizei>(instanceData_.size());
+        VisitDrawList(glm::mat4{ 1.0f }, nullptr,
+            [this, overrideBump, numInstances](const MeshDrawList::DrawRecord& draw) { DrawSubMesh(draw, overrideBump, numInstances); });
+        glBindVertexArray(0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void MeshRenderable::SetInstanceAttributes(const GPUProgram* program)
+    {
+        if (instanceBuffer_ == 0) glGenBuffers(1, &instanceBuffer_);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer_);
+
+        auto locations = program->GetAttributeLocations({ "instanceModelMatrix", "instanceNormalMatrix" });
+        // matrix attributes use one location per column.
+        if (locations[0] >= 0) {
+            for (GLuint c = 0; c < 4; ++c) {
+                auto location = static_cast<GLuint>(locations[0]) + c;
+                glEnableVertexAttribArray(location);
+                glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                    reinterpret_cast<GLvoid*>(offsetof(InstanceData, modelMatrix_) + c * sizeof(glm::vec4)));
+                glVertexAttribDivisor(location, 1);
+            }
+        }
+        if (locations[1] >= 0) {
+            for (GLuint c = 0; c < 3; ++c) {
+                auto location = static_cast<GLuint>(locations[1]) + c;
+                glEnableVertexAttribArray(location);
+                glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                    reinterpret_cast<GLvoid*>(offsetof(InstanceData, normalMatrix_) + c * sizeof(glm::vec3)));
+                glVertexAttribDivisor(location, 1);
+            }
+        }
+    }
+
+    void MeshRenderable::Enqueue(RenderQueue& queue, const glm::mat4& modelMatrix, bool overrideBump) const
+    {
+        VisitDrawList(modelMatrix, nullptr,
+            [this, &queue, overrideBump](const MeshDrawList::DrawRecord& draw) { EnqueueSubMesh(queue, draw, overrideBump); });
+    }
+
+    void MeshRenderable::Enqueue(RenderQueue& queue, const glm::mat4& modelMatrix, const math::Frustum<float>& frustum, bool overrideBump) const
+    {
+        VisitDrawList(modelMatrix, frustumCulling_ ? &frustum : nullptr,
+            [this, &queue, overrideBump](const MeshDrawList::DrawRecord& draw) { EnqueueSubMesh(queue, draw, overrideBump); });
+    }
+
+    void MeshRenderable::VisitDrawList(const glm::mat4& modelMatrix, const math::Frustum<float>* frustum,
+        function_view<void(const MeshDrawList::DrawRecord&)> visit) const
+    {
+        drawList_.UpdateWorldTransforms(modelMatrix);
+
+        // all bounds are in mesh space, so the frustum is moved there once.
+        math::Frustum<float> meshFrustum;
+        if (frustum) meshFrustum = math::transformFrustum(*frustum, modelMatrix);
+
+        const auto& nodes = drawList_.GetNodes();
+        const auto& draws = drawList_.GetDraws();
+        for (std::size_t i = 0; i < nodes.size();) {
+            const auto& record = nodes[i];
+            if (!record.hasMeshes_) {
+                i = record.subTreeEnd_;
+                continue;
+            }
+            if (frustum && !math::AABBInFrustumTest(meshFrustum, record.bounds_)) {
+                ++cullingStatistics_.culledNodes_;
+                i = record.subTreeEnd_;
+                continue;
+            }
+            if (frustum && occlusionCuller_ && !occlusionCuller_->IsVisible(record.bounds_, modelMatrix)) {
+                ++cullingStatistics_.occludedNodes_;
+                i = record.subTreeEnd_;
+                continue;
+            }
+
+            for (auto d = record.firstDraw_; d < record.firstDraw_ + record.numDraws_; ++d) {
+                if (frustum && !math::AABBInFrustumTest(meshFrustum, draws[d].bounds_)) {
+                    ++cullingStatistics_.culledSubMeshes_;
+                    continue;
+                }
+                visit(draws[d]);
+                ++cullingStatistics_.drawnSubMeshes_;
+            }
+            ++i;
+        }
+    }
+
+    void MeshRenderable::DrawSubMesh(const MeshDrawList::DrawRecord& draw, bool overrideBump, GLsizei numInstances) const
+    {
+        auto mat = mesh_->GetMaterial(draw.materialIndex_);
+        const auto& worldMatrix = drawList_.GetWorldMatrices()[draw.nodeIndex_];
+        const auto& normalMatrix = drawList_.GetNormalMatrices()[draw.nodeIndex_];
+        // falls back to the loose uniforms if there are no uniform buffers or the material does not fit into them.
+        if (!uniformBuffers_ || !uniformBuffers_->SetDrawData(worldMatrix, normalMatrix, draw.materialIndex_, overrideBump ? -1.0f : mat->bumpMultiplier)) {
+            // programs reading only the draw block would use the block of the previous draw.
+            if (uniformBuffers_ && uniformLocations_[0] < 0) return;
+            glUniformMatrix4fv(uniformLocations_[0], 1, GL_FALSE, glm::value_ptr(worldMatrix));
+            glUniformMatrix3fv(uniformLocations_[1], 1, GL_FALSE, glm::value_ptr(normalMatrix));
+        }
+        auto matTex = mesh_->GetMaterialTexture(draw.materialIndex_);
+        // packed textures are sampled with the layers and coordinate transforms of the material texture block.
+        if (matTex->diffusePacked.textureArray != 0 && uniformLocations_.size() > 2) {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, matTex->diffusePacked.textureArray);
+            glUniform1i(uniformLocations_[2], 0);
+        }
+        else if (matTex->diffuseTex && uniformLocations_.size() > 2) {
             glActiveTexture(GL_TEXTURE0);
             glBindTexture(GL_TEXTURE_2D, matTex->diffuseTex->getTextureId());
+            matTex->diffuseTex->MarkUsed();
             glUniform1i(uniformLocations_[2], 0);
         }
-        if (matTex->bumpTex && uniformLocations_.size() > 3) {
+        if ((matTex->bumpPacked.textureArray != 0 || matTex->bumpTex) && uniformLocations_.size() > 3) {
             glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, matTex->bumpTex->getTextureId());
+            if (matTex->bumpPacked.textureArray != 0) glBindTexture(GL_TEXTURE_2D_ARRAY, matTex->bumpPacked.textureArray);
+            else {
+                glBindTexture(GL_TEXTURE_2D, matTex->bumpTex->getTextureId());
+                matTex->bumpTex->MarkUsed();
+            }
             glUniform1i(uniformLocations_[3], 1);
             if (!overrideBump) glUniform1f(uniformLocations_[4], mat->bumpMultiplier);
         }
 
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(subMesh->GetNumberOfIndices()), GL_UNSIGNED_INT,
-            reinterpret_cast<char*>(static_cast<std::size_t>(subMesh->GetIndexOffset()) * sizeof(unsigned int)));
+        auto indices = reinterpret_cast<char*>(static_cast<std::size_t>(draw.indexOffset_) * sizeof(unsigned int));
+        if (numInstances > 0) glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(draw.numIndices_), GL_UNSIGNED_INT, indices, numInstances);
+        else glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(draw.numIndices_), GL_UNSIGNED_INT, indices);
+    }
+
+    void MeshRenderable::EnqueueSubMesh(RenderQueue& queue, const MeshDrawList::DrawRecord& draw, bool overrideBump) const
+    {
+        RenderQueue::DrawItem item;
+        item.program_ = drawProgram_->getProgramId();
+        item.vao_ = vao_;
+        std::copy_n(uniformLocations_.begin(), std::min(uniformLocations_.size(), item.uniformLocations_.size()), item.uniformLocations_.begin());
+        item.modelMatrix_ = drawList_.GetWorldMatrices()[draw.nodeIndex_];
+        item.normalMatrix_ = drawList_.GetNormalMatrices()[draw.nodeIndex_];
+        item.indexOffset_ = draw.indexOffset_;
+        item.numIndices_ = draw.numIndices_;
+        item.materialIndex_ = draw.materialIndex_;
+        if (uniformBuffers_) {
+            item.materialBuffer_ = mesh_->GetMaterialBuffer();
+            item.materialTextureBuffer_ = mesh_->GetMaterialTextureBuffer();
+        }
+
+        auto mat = mesh_->GetMaterial(draw.materialIndex_);
+        auto matTex = mesh_->GetMaterialTexture(draw.materialIndex_);
+        if (matTex->diffuseTex && uniformLocations_.size() > 2) {
+            item.diffuseTexture_ = matTex->diffuseTex->getTextureId();
+            matTex->diffuseTex->MarkUsed();
+        }
+        if (matTex->bumpTex && uniformLocations_.size() > 3) {
+            item.bumpTexture_ = matTex->bumpTex->getTextureId();
+            matTex->bumpTex->MarkUsed();
+        }
+        // draws of all sub meshes sharing the texture arrays end up in the same batch.
+        if (matTex->diffusePacked.textureArray != 0 && uniformLocations_.size() > 2) {
+            item.diffuseTexture_ = matTex->diffusePacked.textureArray;
+            item.textureArrays_ = true;
+        }
+        if (matTex->bumpPacked.textureArray != 0 && uniformLocations_.size() > 3) {
+            item.bumpTexture_ = matTex->bumpPacked.textureArray;
+            item.textureArrays_ = true;
+        }
+        item.bumpMultiplier_ = mat->bumpMultiplier;
+        item.setBumpMultiplier_ = !overrideBump;
+        queue.Add(item);
     }
 }
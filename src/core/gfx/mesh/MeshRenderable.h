@@ -10,11 +10,32 @@
 
 #include "core/main.h"
 #include "Mesh.h"
+#include "MeshDrawList.h"
 #include "core/gfx/GPUProgram.h"
+#include "core/gfx/UniformBuffers.h"
+#include "core/math/primitives.h"
+#include "core/utils/function_view.h"
 
 namespace viscom {
 
     class Mesh;
+    class RenderQueue;
+    class OcclusionCuller;
+
+    /** Counters of the culling tests done while drawing. */
+    struct CullingStatistics
+    {
+        /** The number of sub meshes drawn. */
+        std::size_t drawnSubMeshes_ = 0;
+        /** The number of sub meshes culled individually. */
+        std::size_t culledSubMeshes_ = 0;
+        /** The number of nodes culled with their whole sub tree. */
+        std::size_t culledNodes_ = 0;
+        /** The number of instances culled when drawing instanced. */
+        std::size_t culledInstances_ = 0;
+        /** The number of nodes culled with their whole sub tree because they were occluded. */
+        std::size_t occludedNodes_ = 0;
+    };
 
     /**
      *  This class renders a mesh with a specific shader. The shader is assumed to have fixed uniform names:
@@ -26,7 +47,12 @@ namespace viscom {
      *
      *  NOT ALL UNIFORM LOCATIONS NEED TO BE USED!
      *
-     *  The attribute names are determined by the vertex structure.
+     *  If uniform buffers are set, the model and normal matrix and the bump multiplier are written to the draw
+     *  block and the materials of the mesh to the material block instead (see uniformBlocks.glsl).
+     *
+     *  The attribute names are determined by the vertex structure. For instanced drawing the shader
+     *  additionally needs the per instance attributes instanceModelMatrix (mat4) and instanceNormalMatrix (mat3),
+     *  the modelMatrix and normalMatrix uniforms then hold the node transforms and are applied before them.
      */
     class MeshRenderable
     {
@@ -50,6 +76,78 @@ namespace viscom {
          *  @param overrideBump flag for bumb map parameters.
          */
         void Draw(const glm::mat4& modelMatrix, bool overrideBump = false) const;
+        /**
+         *  Draws the mesh of the mesh renderable, skipping nodes and sub meshes outside a frustum if culling is enabled.
+         *  With multiple windows or viewports this needs to be called with the frustum of each (see CameraHelper::GetViewFrustum).
+         *  @param modelMatrix the model matrix to draw the mesh with.
+         *  @param frustum the view frustum in world space.
+         *  @param overrideBump flag for bumb map parameters.
+         */
+        void Draw(const glm::mat4& modelMatrix, const math::Frustum<float>& frustum, bool overrideBump = false) const;
+        /**
+         *  Draws multiple instances of the mesh with one instanced draw call per sub mesh.
+         *  @param instanceMatrices the model matrices of the instances.
+         *  @param numInstances the number of instances.
+         *  @param overrideBump flag for bumb map parameters.
+         */
+        void DrawInstanced(const glm::mat4* instanceMatrices, std::size_t numInstances, bool overrideBump = false) const;
+        /**
+         *  Draws multiple instances of the mesh, skipping instances outside a frustum if culling is enabled.
+         *  @param instanceMatrices the model matrices of the instances.
+         *  @param numInstances the number of instances.
+         *  @param frustum the view frustum in world space.
+         *  @param overrideBump flag for bumb map parameters.
+         */
+        void DrawInstanced(const glm::mat4* instanceMatrices, std::size_t numInstances, const math::Frustum<float>& frustum, bool overrideBump = false) const;
+        /**
+         *  Draws multiple instances of the mesh.
+         *  @param instanceMatrices the model matrices of the instances.
+         *  @param overrideBump flag for bumb map parameters.
+         */
+        void DrawInstanced(const std::vector<glm::mat4>& instanceMatrices, bool overrideBump = false) const { DrawInstanced(instanceMatrices.data(), instanceMatrices.size(), overrideBump); }
+
+        /**
+         *  Adds the sub meshes of the mesh renderable to a render queue instead of drawing them directly.
+         *  @param queue the render queue to add the sub meshes to.
+         *  @param modelMatrix the model matrix to draw the mesh with.
+         *  @param overrideBump flag for bumb map parameters.
+         */
+        void Enqueue(RenderQueue& queue, const glm::mat4& modelMatrix, bool overrideBump = false) const;
+        /**
+         *  Adds the sub meshes inside a frustum to a render queue (if culling is enabled).
+         *  @param queue the render queue to add the sub meshes to.
+         *  @param modelMatrix the model matrix to draw the mesh with.
+         *  @param frustum the view frustum in world space.
+         *  @param overrideBump flag for bumb map parameters.
+         */
+        void Enqueue(RenderQueue& queue, const glm::mat4& modelMatrix, const math::Frustum<float>& frustum, bool overrideBump = false) const;
+
+        /**
+         *  Enables or disables frustum culling.
+         *  @param enable whether frustum culling should be used.
+         */
+        void SetFrustumCulling(bool enable) noexcept { frustumCulling_ = enable; }
+        /** Checks whether frustum culling is enabled. */
+        bool IsFrustumCulling() const noexcept { return frustumCulling_; }
+        /**
+         *  Sets an occlusion culler whose depth buffer nodes are tested against after frustum culling (if enabled).
+         *  The culler needs to be filled with the occluders of the current view before drawing.
+         *  @param occlusionCuller the occlusion culler (nullptr disables occlusion culling).
+         */
+        void SetOcclusionCuller(const OcclusionCuller* occlusionCuller) noexcept { occlusionCuller_ = occlusionCuller; }
+        /** Returns the culling statistics accumulated since the last reset. */
+        const CullingStatistics& GetCullingStatistics() const noexcept { return cullingStatistics_; }
+        /** Resets the culling statistics, this should be called once per frame. */
+        void ResetCullingStatistics() const noexcept { cullingStatistics_ = CullingStatistics{}; }
+
+        /** Returns the mesh rendered. */
+        const Mesh* GetMesh() const noexcept { return mesh_; }
+
+        /**
+         *  Sets the uniform buffers to write the per draw and material data to.
+         *  @param uniformBuffers the uniform buffers (nullptr to use loose uniforms).
+         */
+        void SetUniformBuffers(UniformBuffers* uniformBuffers) noexcept { uniformBuffers_ = uniformBuffers; }
 
         /**
          *  Gets the standart uniform locations when a mesh renderable is created.
@@ -66,32 +164,93 @@ namespace viscom {
         MeshRenderable(const Mesh* renderMesh, GLuint vBuffer, GPUProgram* program);
 
         /**
-         *  Draws a node and all its child nodes of the mesh.
-         *  @param modelMatrix the model matrix to draw the mesh with.
+         *  Draws a node and all its child nodes of the mesh with the bound program and vertex array.
+         *  @param modelMatrix the model matrix of the nodes parent.
          *  @param node the node to draw.
          *  @param overrideBump flag for bumb map parameters.
+         *  @param frustum the view frustum in world space (nullptr disables culling).
          */
-        void DrawNode(const glm::mat4& modelMatrix, const SceneMeshNode* node, bool overrideBump = false) const;
+        void DrawNode(const glm::mat4& modelMatrix, const SceneMeshNode* node, bool overrideBump = false,
+            const math::Frustum<float>* frustum = nullptr) const;
 
     private:
+        /** The per instance data in the instance buffer. */
+        struct InstanceData
+        {
+            /** The model matrix of the instance. */
+            glm::mat4 modelMatrix_;
+            /** The normal matrix of the instance. */
+            glm::mat3 normalMatrix_;
+        };
+
         /** Holds the mesh to render. */
         const Mesh* mesh_;
         /** Holds the vertex buffer. */
         GLuint vbo_;
         /** Holds the vertex array object. */
         GLuint vao_;
+        /** Holds the instance buffer. */
+        GLuint instanceBuffer_ = 0;
+        /** Holds the size of the instance buffer in bytes. */
+        mutable std::size_t instanceBufferSize_ = 0;
+        /** Holds the instance data before uploading. */
+        mutable std::vector<InstanceData> instanceData_;
         /** Holds the rendering GPU program for drawing. */
         GPUProgram* drawProgram_;
         /** Holds the standard uniform bindings. */
         std::vector<GLint> uniformLocations_;
+        /** Holds the uniform buffers (optional). */
+        UniformBuffers* uniformBuffers_ = nullptr;
+        /** Holds the compiled node tree (world matrices are cached while drawing). */
+        mutable MeshDrawList drawList_;
+        /** Flag whether frustum culling is enabled. */
+        bool frustumCulling_ = false;
+        /** Holds the occlusion culler (optional). */
+        const OcclusionCuller* occlusionCuller_ = nullptr;
+        /** Holds the culling statistics. */
+        mutable CullingStatistics cullingStatistics_;
+
+        /**
+         *  Sets the per instance vertex attributes for the instance buffer in the current vertex array object.
+         *  @param program the GPU program to get the attribute locations from.
+         */
+        void SetInstanceAttributes(const GPUProgram* program);
+        /**
+         *  Uploads the instance data and draws all sub meshes instanced.
+         *  @param overrideBump flag for bumb map parameters.
+         */
+        void DrawInstanceData(bool overrideBump) const;
 
+        /**
+         *  Visits all visible sub meshes of the compiled draw list in a single linear pass.
+         *  @param modelMatrix the model matrix to draw the mesh with.
+         *  @param frustum the view frustum in world space (nullptr disables frustum and occlusion culling).
+         *  @param visit the function called for each visible sub mesh.
+         */
+        void VisitDrawList(const glm::mat4& modelMatrix, const math::Frustum<float>* frustum,
+            function_view<void(const MeshDrawList::DrawRecord&)> visit) const;
+        /**
+         *  Draws a node and its children recursively, each node passes its accumulated matrix to its children.
+         *  @param modelMatrix the model matrix of the nodes parent.
+         *  @param node the node to draw.
+         *  @param overrideBump flag for bumb map parameters.
+         *  @param frustum the view frustum in world space (nullptr disables culling).
+         */
+        void DrawSubTree(const glm::mat4& modelMatrix, const SceneMeshNode* node, bool overrideBump, const math::Frustum<float>* frustum) const;
+        /**
+         *  Adds a sub mesh to a render queue.
+         *  @param queue the render queue to add the sub mesh to.
+         *  @param draw the draw record of the sub mesh.
+         *  @param overrideBump flag for bumb map parameters.
+         */
+        void EnqueueSubMesh(RenderQueue& queue, const MeshDrawList::DrawRecord& draw, bool overrideBump) const;
         /**
          *  Draws a sub mesh of the mesh renderable.
-         *  @param modelMatrix the model matrix to draw the sub mesh with.
-         *  @param subMesh the sub mesh to be drawn.
+         *  @param draw the draw record of the sub mesh.
          *  @param overrideBump flag for bumb map parameters.
+         *  @param numInstances the number of instances to draw (0 for a non instanced draw).
          */
-        void DrawSubMesh(const glm::mat4& modelMatrix, const SubMesh* subMesh, bool overrideBump = false) const;
+        void DrawSubMesh(const MeshDrawList::DrawRecord& draw, bool overrideBump = false, GLsizei numInstances = 0) const;
     };
 
     template <class VTX>
@@ -109,10 +268,12 @@ namespace viscom {
         glBindBuffer(GL_ARRAY_BUFFER, vbo_);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh_->GetIndexBuffer());
         VTX::SetVertexAttributes(program);
+        SetInstanceAttributes(program);
         glBindVertexArray(0);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
         uniformLocations_ = program->GetUniformLocations({ "modelMatrix", "normalMatrix", "diffuseTexture", "bumpTexture", "bumpMultiplier" });
+        UniformBuffers::BindUniformBlocks(program->getProgramId());
     }
 }
@@ -0,0 +1,90 @@
+/**
+ * @file   RenderQueue.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.10
+ *
+ * @brief  Implementation of a queue collecting, sorting and submitting draws of many renderables.
+ */
+
+#include "RenderQueue.h"
+#include "core/gfx/GLStateCache.h"
+#include "core/gfx/UniformBuffers.h"
+#include "core/open_gl.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <numeric>
+
+namespace viscom {
+
+    void RenderQueue::Clear()
+    {
+        items_.clear();
+        programIndices_.clear();
+        vaoIndices_.clear();
+        textureIndices_.clear();
+        materialIndices_.clear();
+    }
+
+    void RenderQueue::Add(const DrawItem& item)
+    {
+        items_.push_back(item);
+        items_.back().sortKey_ = ComputeSortKey(item);
+    }
+
+    std::uint64_t RenderQueue::ComputeSortKey(const DrawItem& item)
+    {
+        auto material = (static_cast<std::uint64_t>(item.materialBuffer_) << 32) | item.materialIndex_;
+        return (GetObjectIndex(programIndices_, item.program_, 0xfffu) << 52)
+            | (GetObjectIndex(vaoIndices_, item.vao_, 0xffffu) << 36)
+            | (GetObjectIndex(textureIndices_, item.diffuseTexture_, 0xffffu) << 20)
+            | (GetObjectIndex(textureIndices_, item.bumpTexture_, 0xfffu) << 8)
+            | GetObjectIndex(materialIndices_, material, 0xffu);
+    }
+
+    std::uint64_t RenderQueue::GetObjectIndex(std::unordered_map<std::uint64_t, std::uint64_t>& indices, std::uint64_t object, std::uint64_t maxIndex)
+    {
+        auto index = indices.emplace(object, static_cast<std::uint64_t>(indices.size())).first->second;
+        // objects beyond the range only lose the grouping, the draws are still correct.
+        return std::min(index, maxIndex);
+    }
+
+    void RenderQueue::Submit(GLStateCache& stateCache)
+    {
+        order_.resize(items_.size());
+        std::iota(order_.begin(), order_.end(), 0U);
+        std::sort(order_.begin(), order_.end(), [this](std::uint32_t lhs, std::uint32_t rhs) { return items_[lhs].sortKey_ < items_[rhs].sortKey_; });
+
+        GLuint boundMaterialBuffer = 0;
+        for (auto index : order_) {
+            const auto& item = items_[index];
+            const auto& locations = item.uniformLocations_;
+            stateCache.UseProgram(item.program_);
+            stateCache.BindVertexArray(item.vao_);
+            if (item.materialBuffer_ != 0 && item.materialBuffer_ != boundMaterialBuffer) {
+                UniformBuffers::BindMaterialBuffer(item.materialBuffer_, item.materialTextureBuffer_);
+                boundMaterialBuffer = item.materialBuffer_;
+                stateCache.CountIssuedCalls(item.materialTextureBuffer_ != 0 ? 2 : 1);
+            }
+
+            glUniformMatrix4fv(locations[0], 1, GL_FALSE, glm::value_ptr(item.modelMatrix_));
+            glUniformMatrix3fv(locations[1], 1, GL_FALSE, glm::value_ptr(item.normalMatrix_));
+            stateCache.CountIssuedCalls(2);
+
+            if (item.diffuseTexture_ != 0) {
+                stateCache.BindTexture(0, item.diffuseTexture_, item.textureArrays_);
+                stateCache.Uniform(locations[2], 0);
+            }
+            if (item.bumpTexture_ != 0) {
+                stateCache.BindTexture(1, item.bumpTexture_, item.textureArrays_);
+                stateCache.Uniform(locations[3], 1);
+                if (item.setBumpMultiplier_) stateCache.Uniform(locations[4], item.bumpMultiplier_);
+            }
+
+            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(item.numIndices_), GL_UNSIGNED_INT,
+                reinterpret_cast<char*>(static_cast<std::size_t>(item.indexOffset_) * sizeof(unsigned int)));
+            stateCache.CountIssuedCalls();
+        }
+
+        stateCache.BindVertexArray(0);
+    }
+}
@@ -0,0 +1,111 @@
+/**
+ * @file   RenderQueue.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.10
+ *
+ * @brief  Declaration of a queue collecting, sorting and submitting draws of many renderables.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "core/open_gl_fwd.h"
+#include <array>
+#include <unordered_map>
+
+namespace viscom {
+
+    class GLStateCache;
+
+    /**
+     *  Collects the sub mesh draws of many renderables for a frame, sorts them by a key built from program,
+     *  vertex array, textures and material and submits them through a GLStateCache.
+     *  The uniform names are the same as for the MeshRenderable.
+     */
+    class RenderQueue final
+    {
+    public:
+        /** A single sub mesh draw. */
+        struct DrawItem
+        {
+            /** The sort key of the draw, computed by RenderQueue::Add. */
+            std::uint64_t sortKey_ = 0;
+            /** The program to draw with. */
+            GLuint program_ = 0;
+            /** The vertex array object to draw with. */
+            GLuint vao_ = 0;
+            /** The diffuse texture (0 if none). */
+            GLuint diffuseTexture_ = 0;
+            /** The bump texture (0 if none). */
+            GLuint bumpTexture_ = 0;
+            /** Flag whether the textures are texture arrays packed by the TexturePacker. */
+            bool textureArrays_ = false;
+            /** The material uniform buffer of the mesh (0 if uniform buffers are not used). */
+            GLuint materialBuffer_ = 0;
+            /** The material texture uniform buffer of the mesh (0 if none). */
+            GLuint materialTextureBuffer_ = 0;
+            /** The uniform locations (modelMatrix, normalMatrix, diffuseTexture, bumpTexture, bumpMultiplier), copied so items outlive shader recompiles. */
+            std::array<GLint, 5> uniformLocations_ = { -1, -1, -1, -1, -1 };
+            /** The model matrix. */
+            glm::mat4 modelMatrix_ = glm::mat4{ 1.0f };
+            /** The normal matrix. */
+            glm::mat3 normalMatrix_ = glm::mat3{ 1.0f };
+            /** The material index of the sub mesh. */
+            std::uint32_t materialIndex_ = 0;
+            /** The bump multiplier. */
+            float bumpMultiplier_ = 1.0f;
+            /** Flag whether the bump multiplier is set by the material. */
+            bool setBumpMultiplier_ = true;
+            /** The first index of the sub mesh in the index buffer. */
+            std::uint32_t indexOffset_ = 0;
+            /** The number of indices of the sub mesh. */
+            std::uint32_t numIndices_ = 0;
+        };
+
+        /** Removes all draws and the object indices used for the sort keys. */
+        void Clear();
+        /**
+         *  Adds a draw to the queue and computes its sort key.
+         *  @param item the draw to add.
+         */
+        void Add(const DrawItem& item);
+        /** Returns the draws in the order they were added. */
+        const std::vector<DrawItem>& GetDrawItems() const noexcept { return items_; }
+        /** Returns the number of draws in the queue. */
+        std::size_t GetNumberOfDraws() const noexcept { return items_.size(); }
+
+        /**
+         *  Sorts all draws and submits them.
+         *  @param stateCache the state cache used for binding.
+         */
+        void Submit(GLStateCache& stateCache);
+
+    private:
+        /**
+         *  Computes a sort key, draws are sorted by program first and material last.
+         *  The objects are replaced by indices in the order they were first added, so they fit into the bits of the key.
+         *  @param item the draw to compute the key for.
+         */
+        std::uint64_t ComputeSortKey(const DrawItem& item);
+        /**
+         *  Returns the index of an object, new objects get the next free index.
+         *  @param indices the indices of the objects seen since the last Clear.
+         *  @param object the object.
+         *  @param maxIndex the largest index that fits into the key, later objects share it.
+         */
+        static std::uint64_t GetObjectIndex(std::unordered_map<std::uint64_t, std::uint64_t>& indices, std::uint64_t object, std::uint64_t maxIndex);
+
+        /** Holds the draws. */
+        std::vector<DrawItem> items_;
+        /** Holds the indices of the programs. */
+        std::unordered_map<std::uint64_t, std::uint64_t> programIndices_;
+        /** Holds the indices of the vertex arrays. */
+        std::unordered_map<std::uint64_t, std::uint64_t> vaoIndices_;
+        /** Holds the indices of the textures. */
+        std::unordered_map<std::uint64_t, std::uint64_t> textureIndices_;
+        /** Holds the indices of the materials (material buffer and material index). */
+        std::unordered_map<std::uint64_t, std::uint64_t> materialIndices_;
+        /** Holds the sorted draw order. */
+        std::vector<std::uint32_t> order_;
+    };
+}
@@ -110,6 +110,12 @@ namespace viscom {
         aabb = math::transformAABB(aabb_, transform);
     }
 
+    MeshRayHit SceneMeshNode::IntersectRay(const Mesh& mesh, const math::Line3<float>& ray) const
+    {
+        // nodes are in depth first order, so the sub tree is a contiguous range.
+        return mesh.GetTriangleBVH().IntersectRay(ray, nodeIndex_, GetSubTreeEnd());
+    }
+
     void SceneMeshNode::FlattenNodeTree(std::vector<const SceneMeshNode*>& nodes)
     {
         FlattenNodeTreeInternal(nodes);
@@ -12,6 +12,7 @@
 #include "core/main.h"
 #include "core/utils/serializationHelper.h"
 #include <core/math/math.h>
+#include "TriangleBVH.h"
 #include <unordered_map>
 #include <map>
 
@@ -89,6 +90,13 @@ namespace viscom {
         /** Returns if the subtree of this node has meshes. */
         bool HasMeshes() const noexcept { return hasMeshes_; }
 
+        /**
+         *  Finds the closest triangle of the sub tree of this node hit by a ray.
+         *  @param mesh the mesh the node belongs to.
+         *  @param ray the ray in mesh space given by its origin and a second point.
+         */
+        MeshRayHit IntersectRay(const Mesh& mesh, const math::Line3<float>& ray) const;
+
         /**
          *  Flattens the tree of the node and its child nodes to a vector.
          *  @param nodes list of nodes that will contain the flattened tree.
@@ -130,6 +138,8 @@ namespace viscom {
          *  @return whether the subtree has meshes.
          */
         bool FlattenNodeTreeInternal(std::vector<const SceneMeshNode*>& nodes);
+        /** Returns the index after the last node of the sub tree of this node. */
+        unsigned int GetSubTreeEnd() const noexcept { return children_.empty() ? nodeIndex_ + 1 : children_.back()->GetSubTreeEnd(); }
 
         /** The nodes name. */
         std::string nodeName_;
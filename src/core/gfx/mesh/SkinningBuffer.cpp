@@ -0,0 +1,87 @@
+/**
+ * @file   SkinningBuffer.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.05
+ *
+ * @brief  Implementation of a buffer holding the skinning palettes of all animated objects of a frame.
+ */
+
+#include "SkinningBuffer.h"
+#include "AnimationState.h"
+#include "core/open_gl.h"
+#include <glm/gtc/quaternion.hpp>
+
+namespace viscom {
+
+    SkinningBuffer::SkinningBuffer(std::size_t maxBonesPerFrame, SkinningEncoding encoding, std::size_t numFrames) :
+        encoding_{ encoding },
+        buffer_{ GL_TEXTURE_BUFFER, maxBonesPerFrame * GetTexelsPerBone(encoding) * sizeof(glm::vec4), numFrames }
+    {
+        glGenTextures(1, &texture_);
+        glBindTexture(GL_TEXTURE_BUFFER, texture_);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer_.GetBuffer());
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    SkinningBuffer::~SkinningBuffer()
+    {
+        if (texture_ != 0) glDeleteTextures(1, &texture_);
+        texture_ = 0;
+    }
+
+    std::size_t SkinningBuffer::AddPalette(const std::vector<glm::mat4>& skinningMatrices)
+    {
+        auto numTexels = skinningMatrices.size() * GetTexelsPerBone(encoding_);
+        auto allocation = buffer_.Allocate(numTexels * sizeof(glm::vec4), sizeof(glm::vec4));
+        if (allocation.data_ == nullptr) {
+            spdlog::warn("Skinning buffer is full, palette with {} bones is not added.", skinningMatrices.size());
+            return INVALID_OFFSET;
+        }
+
+        EncodePalette(encoding_, skinningMatrices.data(), skinningMatrices.size(), static_cast<glm::vec4*>(allocation.data_));
+        return allocation.offset_ / sizeof(glm::vec4);
+    }
+
+    std::size_t SkinningBuffer::AddPalette(const AnimationState& animState)
+    {
+        return AddPalette(animState.GetSkinningMatrices());
+    }
+
+    std::size_t SkinningBuffer::GetTexelsPerBone(SkinningEncoding encoding)
+    {
+        switch (encoding) {
+        case SkinningEncoding::Matrix4x4: return 4;
+        case SkinningEncoding::Affine3x4: return 3;
+        case SkinningEncoding::DualQuaternion: return 2;
+        }
+        return 4;
+    }
+
+    void SkinningBuffer::EncodePalette(SkinningEncoding encoding, const glm::mat4* skinningMatrices, std::size_t numBones, glm::vec4* palette)
+    {
+        switch (encoding) {
+        case SkinningEncoding::Matrix4x4:
+            for (std::size_t i = 0; i < numBones; ++i) {
+                for (auto c = 0; c < 4; ++c) palette[4 * i + static_cast<std::size_t>(c)] = skinningMatrices[i][c];
+            }
+            break;
+        case SkinningEncoding::Affine3x4:
+            for (std::size_t i = 0; i < numBones; ++i) {
+                const auto& m = skinningMatrices[i];
+                for (auto r = 0; r < 3; ++r) palette[3 * i + static_cast<std::size_t>(r)] = glm::vec4{ m[0][r], m[1][r], m[2][r], m[3][r] };
+            }
+            break;
+        case SkinningEncoding::DualQuaternion:
+            for (std::size_t i = 0; i < numBones; ++i) {
+                const auto& m = skinningMatrices[i];
+                // scaling cannot be represented, so only the rotation of the normalized axes is used.
+                glm::mat3 rotation{ glm::normalize(glm::vec3(m[0])), glm::normalize(glm::vec3(m[1])), glm::normalize(glm::vec3(m[2])) };
+                auto real = glm::normalize(glm::quat_cast(rotation));
+                auto dual = (glm::quat{ 0.0f, m[3].x, m[3].y, m[3].z } * real) * 0.5f;
+                palette[2 * i] = glm::vec4{ real.x, real.y, real.z, real.w };
+                palette[2 * i + 1] = glm::vec4{ dual.x, dual.y, dual.z, dual.w };
+            }
+            break;
+        }
+    }
+}
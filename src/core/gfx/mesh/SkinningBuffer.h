@@ -0,0 +1,99 @@
+/**
+ * @file   SkinningBuffer.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.05
+ *
+ * @brief  Declaration of a buffer holding the skinning palettes of all animated objects of a frame.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "core/gfx/StreamingBuffer.h"
+
+#include <limits>
+
+namespace viscom {
+
+    class AnimationState;
+
+    /** Encoding of the skinning matrices in the skinning buffer. */
+    enum class SkinningEncoding {
+        /** Full 4x4 matrices (4 texels per bone). */
+        Matrix4x4 = 0,
+        /** Rows of the upper 3x4 part of affine matrices (3 texels per bone). */
+        Affine3x4 = 1,
+        /** Dual quaternions, real part first (2 texels per bone, rigid transformations only). */
+        DualQuaternion = 2
+    };
+
+    /**
+     *  Holds the skinning palettes of all animated objects in a frame in a single streaming buffer.
+     *  The buffer is accessed in shaders as a texture buffer (RGBA32F), each palette is identified by its offset
+     *  in texels. The shader include "skinning.glsl" contains the matching decoding functions.
+     *  The encoding functions do not need an OpenGL context.
+     */
+    class SkinningBuffer final
+    {
+    public:
+        /** Offset returned when a palette does not fit into the buffer. */
+        static constexpr std::size_t INVALID_OFFSET = std::numeric_limits<std::size_t>::max();
+
+        /**
+         *  Constructor, creates the buffer.
+         *  @param maxBonesPerFrame the maximum number of bones of all palettes in a single frame.
+         *  @param encoding the encoding of the skinning matrices.
+         *  @param numFrames the number of frames in flight.
+         */
+        SkinningBuffer(std::size_t maxBonesPerFrame, SkinningEncoding encoding = SkinningEncoding::Affine3x4, std::size_t numFrames = 3);
+        SkinningBuffer(const SkinningBuffer&) = delete;
+        SkinningBuffer& operator=(const SkinningBuffer&) = delete;
+        SkinningBuffer(SkinningBuffer&&) = delete;
+        SkinningBuffer& operator=(SkinningBuffer&&) = delete;
+        ~SkinningBuffer();
+
+        /** Starts a new frame, all palettes of the last frame become invalid. */
+        void BeginFrame() { buffer_.BeginFrame(); }
+        /**
+         *  Adds a skinning palette to the current frame.
+         *  @param skinningMatrices the skinning matrices.
+         *  @return the offset of the palette in texels or INVALID_OFFSET if the buffer is full.
+         */
+        std::size_t AddPalette(const std::vector<glm::mat4>& skinningMatrices);
+        /**
+         *  Adds the skinning palette of an animation state to the current frame.
+         *  @param animState the animation state.
+         *  @return the offset of the palette in texels or INVALID_OFFSET if the buffer is full.
+         */
+        std::size_t AddPalette(const AnimationState& animState);
+        /** Finishes the current frame, the palettes can be used for drawing afterwards. */
+        void EndFrame() { buffer_.EndFrame(); }
+
+        /** Returns the texture buffer object. */
+        GLuint GetTexture() const noexcept { return texture_; }
+        /** Returns the encoding of the skinning matrices. */
+        SkinningEncoding GetEncoding() const noexcept { return encoding_; }
+
+        /**
+         *  Returns the number of texels (vec4) needed per bone.
+         *  @param encoding the encoding of the skinning matrices.
+         */
+        static std::size_t GetTexelsPerBone(SkinningEncoding encoding);
+        /**
+         *  Encodes skinning matrices.
+         *  @param encoding the encoding to use.
+         *  @param skinningMatrices the skinning matrices.
+         *  @param numBones the number of skinning matrices.
+         *  @param palette the encoded palette (needs GetTexelsPerBone(encoding) * numBones elements).
+         */
+        static void EncodePalette(SkinningEncoding encoding, const glm::mat4* skinningMatrices, std::size_t numBones, glm::vec4* palette);
+
+    private:
+        /** Holds the encoding of the skinning matrices. */
+        SkinningEncoding encoding_;
+        /** Holds the streaming buffer. */
+        StreamingBuffer buffer_;
+        /** Holds the texture buffer object. */
+        GLuint texture_ = 0;
+    };
+}
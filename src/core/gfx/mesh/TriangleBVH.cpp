@@ -0,0 +1,117 @@
+/**
+ * @file   TriangleBVH.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.17
+ *
+ * @brief  Implementation of a bounding volume hierarchy over the triangles of a mesh used for picking.
+ */
+
+#include "TriangleBVH.h"
+#include "Mesh.h"
+#include "SceneMeshNode.h"
+#include "core/math/math.h"
+
+namespace viscom {
+
+    TriangleBVH::TriangleBVH(const Mesh& mesh)
+    {
+        CollectTriangles(mesh);
+
+        std::vector<math::AABB3<float>> triangleBounds(triangles_.size());
+        for (std::size_t i = 0; i < triangles_.size(); ++i) {
+            const auto& v0 = positions_[3 * i];
+            triangleBounds[i].AddPoint(v0);
+            triangleBounds[i].AddPoint(v0 + positions_[3 * i + 1]);
+            triangleBounds[i].AddPoint(v0 + positions_[3 * i + 2]);
+        }
+        bvh_.Build(triangleBounds);
+    }
+
+    void TriangleBVH::CollectTriangles(const Mesh& mesh)
+    {
+        triangles_.clear();
+        const auto& nodes = mesh.GetNodes();
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            for (std::size_t j = 0; j < nodes[i]->GetNumberOfSubMeshes(); ++j) {
+                auto subMeshIndex = nodes[i]->GetSubMeshID(j);
+                auto numTriangles = mesh.GetSubMeshes()[subMeshIndex].GetNumberOfIndices() / 3;
+                for (std::size_t t = 0; t < numTriangles; ++t) {
+                    triangles_.push_back(TriangleRecord{ static_cast<std::uint32_t>(i), static_cast<std::uint32_t>(subMeshIndex), static_cast<std::uint32_t>(t) });
+                }
+            }
+        }
+        UpdatePositions(mesh);
+    }
+
+    void TriangleBVH::UpdatePositions(const Mesh& mesh)
+    {
+        // nodes are in depth first order, so parents are handled before their children.
+        const auto& nodes = mesh.GetNodes();
+        std::vector<glm::mat4> nodeTransforms(nodes.size());
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            glm::mat4 parentTransform{ 1.0f };
+            if (nodes[i]->GetParent()) parentTransform = nodeTransforms[nodes[i]->GetParent()->GetNodeIndex()];
+            nodeTransforms[i] = parentTransform * nodes[i]->GetLocalTransform();
+        }
+
+        const auto& vertices = mesh.GetVertices();
+        const auto& indices = mesh.GetIndices();
+        positions_.resize(3 * triangles_.size());
+        for (std::size_t i = 0; i < triangles_.size(); ++i) {
+            const auto& triangle = triangles_[i];
+            const auto& transform = nodeTransforms[triangle.nodeIndex_];
+            auto firstIndex = mesh.GetSubMeshes()[triangle.subMeshIndex_].GetIndexOffset() + 3 * triangle.triangleIndex_;
+            auto v0 = glm::vec3(transform * glm::vec4(vertices[indices[firstIndex]], 1.0f));
+            auto v1 = glm::vec3(transform * glm::vec4(vertices[indices[firstIndex + 1]], 1.0f));
+            auto v2 = glm::vec3(transform * glm::vec4(vertices[indices[firstIndex + 2]], 1.0f));
+            positions_[3 * i] = v0;
+            positions_[3 * i + 1] = v1 - v0;
+            positions_[3 * i + 2] = v2 - v0;
+        }
+    }
+
+    MeshRayHit TriangleBVH::IntersectRay(const math::Line3<float>& ray, std::size_t nodeBegin, std::size_t nodeEnd) const
+    {
+        auto direction = ray[1] - ray[0];
+        MeshRayHit result;
+        glm::vec2 barycentrics;
+        auto hit = bvh_.FindClosestHit(ray, [this, &ray, &direction, &result, &barycentrics, nodeBegin, nodeEnd](std::size_t triangleIndex) {
+            const auto& triangle = triangles_[triangleIndex];
+            if (triangle.nodeIndex_ < nodeBegin || triangle.nodeIndex_ >= nodeEnd) return std::numeric_limits<float>::infinity();
+
+            float t;
+            if (!math::rayTriangleIntersectionTest(ray[0], direction, positions_[3 * triangleIndex], positions_[3 * triangleIndex + 1],
+                positions_[3 * triangleIndex + 2], t, barycentrics)) return std::numeric_limits<float>::infinity();
+
+            // the hierarchy only keeps hits closer than the current one, so the barycentrics are stored the same way.
+            if (t < result.distance_) {
+                result.distance_ = t;
+                result.barycentrics_ = barycentrics;
+            }
+            return t;
+        });
+
+        if (hit.instance_ == math::BVH::INVALID_INSTANCE) return MeshRayHit{};
+
+        const auto& triangle = triangles_[hit.instance_];
+        result.hit_ = true;
+        result.nodeIndex_ = triangle.nodeIndex_;
+        result.subMeshIndex_ = triangle.subMeshIndex_;
+        result.triangleIndex_ = triangle.triangleIndex_;
+        result.position_ = ray[0] + hit.t_ * direction;
+        result.distance_ = hit.t_ * glm::length(direction);
+        return result;
+    }
+
+    void TriangleBVH::Write(std::ostream& ofs) const
+    {
+        serializeHelper::writeV(ofs, triangles_);
+        bvh_.Write(ofs);
+    }
+
+    bool TriangleBVH::Read(std::istream& ifs)
+    {
+        serializeHelper::readV(ifs, triangles_);
+        return bvh_.Read(ifs);
+    }
+}
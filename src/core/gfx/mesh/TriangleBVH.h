@@ -0,0 +1,103 @@
+/**
+ * @file   TriangleBVH.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.17
+ *
+ * @brief  Declaration of a bounding volume hierarchy over the triangles of a mesh used for picking.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "core/math/bvh.h"
+
+namespace viscom {
+
+    class Mesh;
+
+    /** The result of a ray intersection with a mesh. */
+    struct MeshRayHit
+    {
+        /** Flag whether the mesh was hit at all. */
+        bool hit_ = false;
+        /** The index of the node the triangle belongs to. */
+        std::size_t nodeIndex_ = 0;
+        /** The index of the sub mesh the triangle belongs to. */
+        std::size_t subMeshIndex_ = 0;
+        /** The index of the triangle in the sub mesh. */
+        std::size_t triangleIndex_ = 0;
+        /** The barycentric coordinates of the second and third triangle vertex at the hit. */
+        glm::vec2 barycentrics_ = glm::vec2{ 0.0f };
+        /** The distance from the ray origin to the hit. */
+        float distance_ = std::numeric_limits<float>::infinity();
+        /** The position of the hit (in the space of the ray). */
+        glm::vec3 position_ = glm::vec3{ 0.0f };
+    };
+
+    /**
+     *  A BVH over all triangles of a mesh in mesh space (bind pose for skinned meshes).
+     *  The hierarchy is stored in the binary mesh file, the triangle positions are recomputed after loading.
+     */
+    class TriangleBVH final
+    {
+    public:
+        /** Constructor, creates an empty hierarchy to be read from a stream. */
+        TriangleBVH() = default;
+        /**
+         *  Constructor, builds the hierarchy for a mesh.
+         *  @param mesh the mesh to build the hierarchy for.
+         */
+        explicit TriangleBVH(const Mesh& mesh);
+
+        /**
+         *  Computes the mesh space triangle positions after the hierarchy was read.
+         *  @param mesh the mesh the hierarchy belongs to.
+         */
+        void UpdatePositions(const Mesh& mesh);
+
+        /**
+         *  Finds the closest triangle hit by a ray.
+         *  @param ray the ray in mesh space given by its origin and a second point.
+         *  @param nodeBegin the first node whose triangles are tested.
+         *  @param nodeEnd the node after the last node whose triangles are tested.
+         */
+        MeshRayHit IntersectRay(const math::Line3<float>& ray, std::size_t nodeBegin = 0,
+            std::size_t nodeEnd = std::numeric_limits<std::size_t>::max()) const;
+
+        /**
+         *  Writes the hierarchy to a stream.
+         *  @param ofs the stream to write to.
+         */
+        void Write(std::ostream& ofs) const;
+        /**
+         *  Reads the hierarchy from a stream, UpdatePositions needs to be called before the first query.
+         *  @param ifs the stream to read from.
+         */
+        bool Read(std::istream& ifs);
+
+    private:
+        /** Reference of a triangle to its node and sub mesh. */
+        struct TriangleRecord
+        {
+            /** The node index. */
+            std::uint32_t nodeIndex_;
+            /** The sub mesh index. */
+            std::uint32_t subMeshIndex_;
+            /** The index of the triangle in the sub mesh. */
+            std::uint32_t triangleIndex_;
+        };
+
+        /**
+         *  Collects all triangles of a mesh.
+         *  @param mesh the mesh.
+         */
+        void CollectTriangles(const Mesh& mesh);
+
+        /** Holds the hierarchy over the triangles. */
+        math::BVH bvh_;
+        /** Holds the triangle records. */
+        std::vector<TriangleRecord> triangles_;
+        /** Holds the first vertex and both edges of each triangle in mesh space. */
+        std::vector<glm::vec3> positions_;
+    };
+}
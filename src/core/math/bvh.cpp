@@ -0,0 +1,376 @@
+/**
+ * @file   bvh.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.16
+ *
+ * @brief  Implementation of a bounding volume hierarchy over axis aligned bounding boxes.
+ */
+
+#include "bvh.h"
+#include "math.h"
+#include "core/utils/ThreadPool.h"
+#include "core/utils/serializationHelper.h"
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+namespace viscom::math {
+
+    namespace {
+        /** Marks a node without parent. */
+        constexpr std::uint32_t NO_PARENT = std::numeric_limits<std::uint32_t>::max();
+
+        float HalfSurfaceArea(const AABB3<float>& box)
+        {
+            auto d = box.GetMax() - box.GetMin();
+            return d.x * d.y + d.y * d.z + d.z * d.x;
+        }
+    }
+
+    void BVH::Build(const std::vector<AABB3<float>>& instanceBounds, bool parallel)
+    {
+        instanceBounds_ = instanceBounds;
+        centroids_.resize(instanceBounds_.size());
+        for (std::size_t i = 0; i < instanceBounds_.size(); ++i) centroids_[i] = 0.5f * (instanceBounds_[i].GetMin() + instanceBounds_[i].GetMax());
+        instanceRefs_.resize(instanceBounds_.size());
+        std::iota(instanceRefs_.begin(), instanceRefs_.end(), 0U);
+
+        nodes_.clear();
+        if (!instanceBounds_.empty()) {
+            nodes_.reserve(2 * instanceBounds_.size() / MAX_LEAF_SIZE + 1);
+            Node root;
+            root.count_ = static_cast<std::uint32_t>(instanceBounds_.size());
+            nodes_.push_back(root);
+
+            auto& threadPool = ThreadPool::GetDefault();
+            if (!parallel || instanceBounds_.size() < 2 * MIN_PARALLEL_SUBTREE_SIZE) BuildSubtree(nodes_, 0, 0, nullptr);
+            else {
+                // the top of the tree is built serially until there are enough sub trees for all threads.
+                auto deferSize = std::max(MIN_PARALLEL_SUBTREE_SIZE, instanceBounds_.size() / (4 * (threadPool.GetNumberOfThreads() + 1)));
+                std::vector<std::uint32_t> deferred;
+                BuildSubtree(nodes_, 0, deferSize, &deferred);
+
+                // sub trees work on disjoint ranges of instance references, so they can be built independently.
+                std::vector<std::vector<Node>> subtrees(deferred.size());
+                threadPool.ParallelFor(0, deferred.size(), [this, &deferred, &subtrees](std::size_t begin, std::size_t end) {
+                    for (auto i = begin; i < end; ++i) {
+                        subtrees[i].push_back(nodes_[deferred[i]]);
+                        BuildSubtree(subtrees[i], 0, 0, nullptr);
+                    }
+                });
+
+                for (std::size_t i = 0; i < deferred.size(); ++i) {
+                    // local node k > 0 is appended at base + k - 1, children stay behind their parents.
+                    auto base = static_cast<std::uint32_t>(nodes_.size());
+                    for (std::size_t k = 0; k < subtrees[i].size(); ++k) {
+                        auto node = subtrees[i][k];
+                        if (!node.IsLeaf()) node.first_ = base + node.first_ - 1;
+                        if (k == 0) nodes_[deferred[i]] = node;
+                        else nodes_.push_back(node);
+                    }
+                }
+            }
+        }
+
+        ComputeTopology();
+    }
+
+    void BVH::Write(std::ostream& ofs) const
+    {
+        VersionableSerializerType::writeHeader(ofs);
+        serializeHelper::writeV(ofs, nodes_);
+        serializeHelper::writeV(ofs, instanceRefs_);
+        serializeHelper::writeV(ofs, instanceBounds_);
+    }
+
+    bool BVH::Read(std::istream& ifs)
+    {
+        bool correctHeader;
+        unsigned int actualVersion;
+        std::tie(correctHeader, actualVersion) = VersionableSerializerType::checkHeader(ifs);
+        if (!correctHeader) return false;
+
+        serializeHelper::readV(ifs, nodes_);
+        serializeHelper::readV(ifs, instanceRefs_);
+        serializeHelper::readV(ifs, instanceBounds_);
+        if (!ifs) return false;
+        ComputeTopology();
+        return true;
+    }
+
+    void BVH::BuildSubtree(std::vector<Node>& nodes, std::uint32_t rootIndex, std::size_t deferSize, std::vector<std::uint32_t>* deferred)
+    {
+        std::vector<std::uint32_t> stack{ rootIndex };
+        while (!stack.empty()) {
+            auto index = stack.back();
+            stack.pop_back();
+
+            nodes[index].bounds_ = ComputeLeafBounds(nodes[index]);
+            auto node = nodes[index];
+            if (node.count_ <= MAX_LEAF_SIZE) continue;
+            if (deferred && node.count_ < deferSize) {
+                deferred->push_back(index);
+                continue;
+            }
+
+            auto leftCount = static_cast<std::uint32_t>(SplitNode(node));
+            if (leftCount == 0) continue;
+
+            Node left, right;
+            left.first_ = node.first_;
+            left.count_ = leftCount;
+            right.first_ = node.first_ + leftCount;
+            right.count_ = node.count_ - leftCount;
+
+            auto childIndex = static_cast<std::uint32_t>(nodes.size());
+            nodes[index].first_ = childIndex;
+            nodes[index].count_ = 0;
+            nodes.push_back(left);
+            nodes.push_back(right);
+            stack.push_back(childIndex + 1);
+            stack.push_back(childIndex);
+        }
+    }
+
+    std::size_t BVH::SplitNode(const Node& node)
+    {
+        auto refsBegin = instanceRefs_.begin() + node.first_;
+        auto refsEnd = refsBegin + node.count_;
+
+        AABB3<float> centroidBounds;
+        for (auto it = refsBegin; it != refsEnd; ++it) centroidBounds.AddPoint(centroids_[*it]);
+        auto extent = centroidBounds.GetMax() - centroidBounds.GetMin();
+
+        struct Bin
+        {
+            AABB3<float> bounds_;
+            std::size_t count_ = 0;
+        };
+
+        // split cost relative to intersecting all instances of the node, traversal is assumed to cost one intersection.
+        auto bestCost = std::numeric_limits<float>::max();
+        auto bestAxis = -1;
+        std::size_t bestSplit = 0;
+        auto invNodeArea = 1.0f / std::max(HalfSurfaceArea(node.bounds_), std::numeric_limits<float>::min());
+        for (int axis = 0; axis < 3; ++axis) {
+            if (extent[axis] <= 0.0f) continue;
+
+            std::array<Bin, NUM_SAH_BINS> bins;
+            auto scale = static_cast<float>(NUM_SAH_BINS) / extent[axis];
+            for (auto it = refsBegin; it != refsEnd; ++it) {
+                auto bin = std::min(NUM_SAH_BINS - 1, static_cast<std::size_t>((centroids_[*it][axis] - centroidBounds.GetMin()[axis]) * scale));
+                bins[bin].bounds_ = bins[bin].bounds_.Union(instanceBounds_[*it]);
+                ++bins[bin].count_;
+            }
+
+            std::array<float, NUM_SAH_BINS> leftCosts;
+            AABB3<float> leftBounds;
+            std::size_t leftCount = 0;
+            for (std::size_t i = 0; i < NUM_SAH_BINS - 1; ++i) {
+                leftBounds = leftBounds.Union(bins[i].bounds_);
+                leftCount += bins[i].count_;
+                leftCosts[i] = leftCount == 0 ? 0.0f : HalfSurfaceArea(leftBounds) * static_cast<float>(leftCount);
+            }
+
+            AABB3<float> rightBounds;
+            std::size_t rightCount = 0;
+            for (auto i = NUM_SAH_BINS - 1; i > 0; --i) {
+                rightBounds = rightBounds.Union(bins[i].bounds_);
+                rightCount += bins[i].count_;
+                if (rightCount == 0 || rightCount == node.count_) continue;
+
+                auto cost = 1.0f + (leftCosts[i - 1] + HalfSurfaceArea(rightBounds) * static_cast<float>(rightCount)) * invNodeArea;
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = i;
+                }
+            }
+        }
+
+        if (bestAxis >= 0) {
+            auto scale = static_cast<float>(NUM_SAH_BINS) / extent[bestAxis];
+            auto axisMin = centroidBounds.GetMin()[bestAxis];
+            auto mid = std::partition(refsBegin, refsEnd, [this, bestAxis, bestSplit, scale, axisMin](std::uint32_t ref) {
+                return std::min(NUM_SAH_BINS - 1, static_cast<std::size_t>((centroids_[ref][bestAxis] - axisMin) * scale)) < bestSplit;
+            });
+            auto leftCount = static_cast<std::size_t>(mid - refsBegin);
+            if (leftCount > 0 && leftCount < node.count_) return leftCount;
+        }
+
+        // all centroids are (nearly) equal, so the instances are just split in half.
+        return node.count_ / 2;
+    }
+
+    void BVH::ComputeTopology()
+    {
+        parents_.assign(nodes_.size(), NO_PARENT);
+        instanceLeaves_.resize(instanceBounds_.size());
+        for (std::size_t i = 0; i < nodes_.size(); ++i) {
+            const auto& node = nodes_[i];
+            if (node.IsLeaf()) {
+                for (auto r = node.first_; r < node.first_ + node.count_; ++r) instanceLeaves_[instanceRefs_[r]] = static_cast<std::uint32_t>(i);
+            } else {
+                parents_[node.first_] = static_cast<std::uint32_t>(i);
+                parents_[node.first_ + 1] = static_cast<std::uint32_t>(i);
+            }
+        }
+        dirtyNodes_.assign(nodes_.size(), 0);
+        hasDirtyNodes_ = false;
+        centroids_.clear();
+        centroids_.shrink_to_fit();
+    }
+
+    AABB3<float> BVH::ComputeLeafBounds(const Node& node) const
+    {
+        AABB3<float> bounds;
+        for (auto r = node.first_; r < node.first_ + node.count_; ++r) bounds = bounds.Union(instanceBounds_[instanceRefs_[r]]);
+        return bounds;
+    }
+
+    void BVH::UpdateInstance(std::size_t instance, const AABB3<float>& bounds)
+    {
+        instanceBounds_[instance] = bounds;
+        dirtyNodes_[instanceLeaves_[instance]] = 1;
+        hasDirtyNodes_ = true;
+    }
+
+    void BVH::Refit()
+    {
+        if (!hasDirtyNodes_) return;
+
+        // children are always stored after their parents, so a reverse pass updates bottom up.
+        for (auto i = nodes_.size(); i-- > 0;) {
+            if (!dirtyNodes_[i]) continue;
+            auto& node = nodes_[i];
+            if (node.IsLeaf()) node.bounds_ = ComputeLeafBounds(node);
+            else node.bounds_ = nodes_[node.first_].bounds_.Union(nodes_[node.first_ + 1].bounds_);
+            if (parents_[i] != NO_PARENT) dirtyNodes_[parents_[i]] = 1;
+            dirtyNodes_[i] = 0;
+        }
+        hasDirtyNodes_ = false;
+    }
+
+    void BVH::Refit(const std::vector<AABB3<float>>& instanceBounds)
+    {
+        instanceBounds_ = instanceBounds;
+        std::fill(dirtyNodes_.begin(), dirtyNodes_.end(), 1);
+        hasDirtyNodes_ = true;
+        Refit();
+    }
+
+    void BVH::QueryFrustum(const Frustum<float>& frustum, function_view<void(std::size_t)> visit) const
+    {
+        if (nodes_.empty()) return;
+
+        std::vector<std::uint32_t> stack{ 0 };
+        while (!stack.empty()) {
+            const auto& node = nodes_[stack.back()];
+            stack.pop_back();
+            if (!AABBInFrustumTest(frustum, node.bounds_)) continue;
+
+            if (node.IsLeaf()) {
+                for (auto r = node.first_; r < node.first_ + node.count_; ++r) {
+                    if (AABBInFrustumTest(frustum, instanceBounds_[instanceRefs_[r]])) visit(instanceRefs_[r]);
+                }
+            } else {
+                stack.push_back(node.first_ + 1);
+                stack.push_back(node.first_);
+            }
+        }
+    }
+
+    void BVH::QueryAABB(const AABB3<float>& box, function_view<void(std::size_t)> visit) const
+    {
+        if (nodes_.empty()) return;
+
+        std::vector<std::uint32_t> stack{ 0 };
+        while (!stack.empty()) {
+            const auto& node = nodes_[stack.back()];
+            stack.pop_back();
+            if (!intersectAABB3Test(box, node.bounds_)) continue;
+
+            if (node.IsLeaf()) {
+                for (auto r = node.first_; r < node.first_ + node.count_; ++r) {
+                    if (intersectAABB3Test(box, instanceBounds_[instanceRefs_[r]])) visit(instanceRefs_[r]);
+                }
+            } else {
+                stack.push_back(node.first_ + 1);
+                stack.push_back(node.first_);
+            }
+        }
+    }
+
+    void BVH::QueryRay(const Line3<float>& ray, function_view<void(std::size_t, float)> visit) const
+    {
+        if (nodes_.empty()) return;
+
+        auto invDirection = 1.0f / (ray[1] - ray[0]);
+        auto tMax = std::numeric_limits<float>::infinity();
+        std::vector<std::uint32_t> stack{ 0 };
+        while (!stack.empty()) {
+            const auto& node = nodes_[stack.back()];
+            stack.pop_back();
+            float tNear;
+            if (!rayAABBIntersectionTest(ray[0], invDirection, node.bounds_, tMax, tNear)) continue;
+
+            if (node.IsLeaf()) {
+                for (auto r = node.first_; r < node.first_ + node.count_; ++r) {
+                    if (rayAABBIntersectionTest(ray[0], invDirection, instanceBounds_[instanceRefs_[r]], tMax, tNear)) visit(instanceRefs_[r], tNear);
+                }
+            } else {
+                stack.push_back(node.first_ + 1);
+                stack.push_back(node.first_);
+            }
+        }
+    }
+
+    BVH::RayHit BVH::FindClosestHit(const Line3<float>& ray, function_view<float(std::size_t)> intersect) const
+    {
+        RayHit result;
+        if (nodes_.empty()) return result;
+
+        auto invDirection = 1.0f / (ray[1] - ray[0]);
+        float tRoot;
+        if (!rayAABBIntersectionTest(ray[0], invDirection, nodes_[0].bounds_, result.t_, tRoot)) return result;
+
+        std::vector<std::pair<std::uint32_t, float>> stack{ { 0, tRoot } };
+        while (!stack.empty()) {
+            auto [index, tNode] = stack.back();
+            stack.pop_back();
+            if (tNode > result.t_) continue;
+
+            const auto& node = nodes_[index];
+            if (node.IsLeaf()) {
+                for (auto r = node.first_; r < node.first_ + node.count_; ++r) {
+                    float tBox;
+                    auto instance = instanceRefs_[r];
+                    if (!rayAABBIntersectionTest(ray[0], invDirection, instanceBounds_[instance], result.t_, tBox)) continue;
+                    auto t = intersect(instance);
+                    if (t < result.t_) {
+                        result.t_ = t;
+                        result.instance_ = instance;
+                    }
+                }
+                continue;
+            }
+
+            // the nearer child is pushed last, so it is visited first.
+            float t0, t1;
+            auto hit0 = rayAABBIntersectionTest(ray[0], invDirection, nodes_[node.first_].bounds_, result.t_, t0);
+            auto hit1 = rayAABBIntersectionTest(ray[0], invDirection, nodes_[node.first_ + 1].bounds_, result.t_, t1);
+            if (hit0 && hit1) {
+                if (t0 <= t1) {
+                    stack.emplace_back(node.first_ + 1, t1);
+                    stack.emplace_back(node.first_, t0);
+                } else {
+                    stack.emplace_back(node.first_, t0);
+                    stack.emplace_back(node.first_ + 1, t1);
+                }
+            }
+            else if (hit0) stack.emplace_back(node.first_, t0);
+            else if (hit1) stack.emplace_back(node.first_ + 1, t1);
+        }
+        return result;
+    }
+}
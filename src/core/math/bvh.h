@@ -0,0 +1,166 @@
+/**
+ * @file   bvh.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.16
+ *
+ * @brief  Declaration of a bounding volume hierarchy over axis aligned bounding boxes.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "primitives.h"
+#include "core/utils/function_view.h"
+#include "core/utils/serializationHelper.h"
+
+namespace viscom::math {
+
+    /**
+     *  A binary bounding volume hierarchy over AABBs (e.g. the world space bounds of scene instances) built with
+     *  the binned surface area heuristic. Moving instances can be updated with UpdateInstance and Refit, which
+     *  keeps the tree structure, so it should be rebuilt if the instances moved a lot.
+     */
+    class BVH final
+    {
+    public:
+        /** A node of the hierarchy. */
+        struct Node
+        {
+            /** The bounds of all instances below the node. */
+            AABB3<float> bounds_;
+            /** The first child (the second one follows directly) for inner nodes, the first instance reference for leaves. */
+            std::uint32_t first_ = 0;
+            /** The number of instances in a leaf (0 for inner nodes). */
+            std::uint32_t count_ = 0;
+
+            /** Checks if the node is a leaf. */
+            bool IsLeaf() const noexcept { return count_ > 0; }
+        };
+
+        /** The result of a closest hit ray query. */
+        struct RayHit
+        {
+            /** The instance hit (INVALID_INSTANCE if there was no hit). */
+            std::size_t instance_ = INVALID_INSTANCE;
+            /** The ray parameter of the hit. */
+            float t_ = std::numeric_limits<float>::infinity();
+        };
+
+        /** Marks an invalid instance. */
+        static constexpr std::size_t INVALID_INSTANCE = std::numeric_limits<std::size_t>::max();
+        /** The maximum number of instances in a leaf. */
+        static constexpr std::size_t MAX_LEAF_SIZE = 4;
+        /** The number of bins used to evaluate the surface area heuristic. */
+        static constexpr std::size_t NUM_SAH_BINS = 16;
+        /** The minimum number of instances of a sub tree to be built by its own task. */
+        static constexpr std::size_t MIN_PARALLEL_SUBTREE_SIZE = 1024;
+
+        /**
+         *  Builds the hierarchy.
+         *  @param instanceBounds the bounds of all instances, instances are referenced by their index.
+         *  @param parallel whether sub trees should be built in parallel using the default thread pool.
+         */
+        void Build(const std::vector<AABB3<float>>& instanceBounds, bool parallel = true);
+        /**
+         *  Sets the bounds of a single instance, the hierarchy is updated with the next call to Refit().
+         *  @param instance the instance to update.
+         *  @param bounds the new bounds of the instance.
+         */
+        void UpdateInstance(std::size_t instance, const AABB3<float>& bounds);
+        /** Updates the bounds of all nodes above instances changed with UpdateInstance(). */
+        void Refit();
+        /**
+         *  Sets the bounds of all instances and updates the bounds of all nodes.
+         *  @param instanceBounds the bounds of all instances (same number of instances as in Build()).
+         */
+        void Refit(const std::vector<AABB3<float>>& instanceBounds);
+
+        /**
+         *  Visits all instances intersecting a frustum.
+         *  @param frustum the frustum.
+         *  @param visit the function called with each instance.
+         */
+        void QueryFrustum(const Frustum<float>& frustum, function_view<void(std::size_t)> visit) const;
+        /**
+         *  Visits all instances overlapping an AABB.
+         *  @param box the box.
+         *  @param visit the function called with each instance.
+         */
+        void QueryAABB(const AABB3<float>& box, function_view<void(std::size_t)> visit) const;
+        /**
+         *  Visits all instances whose bounds are intersected by a ray.
+         *  @param ray the ray given by its origin and a second point (as returned by CameraHelper::GetPickRay).
+         *  @param visit the function called with each instance and the ray parameter where its bounds are entered.
+         */
+        void QueryRay(const Line3<float>& ray, function_view<void(std::size_t, float)> visit) const;
+        /**
+         *  Finds the closest instance hit by a ray, nodes further away than the closest hit so far are skipped.
+         *  Ray parameters are relative to the vector between the two points of the ray.
+         *  @param ray the ray given by its origin and a second point (as returned by CameraHelper::GetPickRay).
+         *  @param intersect the function intersecting an instance exactly, it returns the ray parameter of
+         *                   the hit or infinity if the instance is missed.
+         */
+        RayHit FindClosestHit(const Line3<float>& ray, function_view<float(std::size_t)> intersect) const;
+
+        /**
+         *  Writes the hierarchy to a stream.
+         *  @param ofs the stream to write to.
+         */
+        void Write(std::ostream& ofs) const;
+        /**
+         *  Reads a hierarchy written with Write() from a stream.
+         *  @param ifs the stream to read from.
+         */
+        bool Read(std::istream& ifs);
+
+        /** Returns the nodes, the root is the first node. */
+        const std::vector<Node>& GetNodes() const noexcept { return nodes_; }
+        /** Returns the instance references of the leaves. */
+        const std::vector<std::uint32_t>& GetInstanceReferences() const noexcept { return instanceRefs_; }
+        /** Returns the bounds of all instances. */
+        const std::vector<AABB3<float>>& GetInstanceBounds() const noexcept { return instanceBounds_; }
+
+    private:
+        /** Defines the type of the VersionableSerializer for the BVH class. */
+        using VersionableSerializerType = serializeHelper::VersionableSerializer<'V', 'B', 'V', 'H', 1000>;
+
+        /**
+         *  Splits nodes until they are leaves.
+         *  @param nodes the node array to build into.
+         *  @param rootIndex the index of the node to start with.
+         *  @param deferSize nodes with fewer instances are not split but added to deferred (0 splits all nodes).
+         *  @param deferred the nodes to build later.
+         */
+        void BuildSubtree(std::vector<Node>& nodes, std::uint32_t rootIndex, std::size_t deferSize, std::vector<std::uint32_t>* deferred);
+        /**
+         *  Splits a node into two children using the surface area heuristic.
+         *  @param node the node to split, its bounds need to be set.
+         *  @return the number of instances in the first child (0 if the node should stay a leaf).
+         */
+        std::size_t SplitNode(const Node& node);
+        /** Computes parents and the leaf of each instance after building. */
+        void ComputeTopology();
+        /** Computes the bounds of the instances of a leaf. */
+        AABB3<float> ComputeLeafBounds(const Node& node) const;
+
+        /** Holds the nodes. */
+        std::vector<Node> nodes_;
+        /** Holds the parent of each node. */
+        std::vector<std::uint32_t> parents_;
+        /** Holds the instance references of the leaves. */
+        std::vector<std::uint32_t> instanceRefs_;
+        /** Holds the bounds of each instance. */
+        std::vector<AABB3<float>> instanceBounds_;
+        /** Holds the centroid of each instance (used while building). */
+        std::vector<glm::vec3> centroids_;
+        /** Holds the leaf of each instance. */
+        std::vector<std::uint32_t> instanceLeaves_;
+        /** Holds the flags of nodes that need to be refit. */
+        std::vector<std::uint8_t> dirtyNodes_;
+        /** Flag whether any node needs to be refit. */
+        bool hasDirtyNodes_ = false;
+    };
+}
@@ -98,7 +98,7 @@ namespace viscom { namespace math {
      *  @param p the point.
      */
     template<typename real> bool pointInAABB2Test(const AABB2<real>& b, const glm::tvec2<real, glm::highp>& p) {
-        return (p.x >= b.minmax[0].x && p.y >= b.minmax[0].y && p.x <= b.minmax[1].x && p.y <= b.minmax[1].y);
+        return (p.x >= b.minmax_[0].x && p.y >= b.minmax_[0].y && p.x <= b.minmax_[1].x && p.y <= b.minmax_[1].y);
     }
 
     /**
@@ -108,7 +108,7 @@ namespace viscom { namespace math {
      *  @param p the point.
      */
     template<typename real> bool pointInAABB3Test(const AABB3<real>& b, const glm::tvec3<real, glm::highp>& p) {
-        auto& bmin = b.minmax[0]; auto& bmax = b.minmax[1];
+        auto& bmin = b.minmax_[0]; auto& bmax = b.minmax_[1];
         return (p.x >= bmin.x && p.y >= bmin.y && p.z >= bmin.z
             && p.x <= bmax.x && p.y <= bmax.y && p.z <= bmax.z);
     }
@@ -120,7 +120,7 @@ namespace viscom { namespace math {
      *  @param b1 the second box.
      */
     template<typename real> bool overlapAABB2Test(const AABB2<real>& b0, const AABB2<real>& b1) {
-        return (pointInAABB2Test(b0, b1.minmax[0]) || pointInAABB2Test(b0, b1.minmax[1]));
+        return (pointInAABB2Test(b0, b1.minmax_[0]) || pointInAABB2Test(b0, b1.minmax_[1]));
     }
 
     /**
@@ -130,7 +130,19 @@ namespace viscom { namespace math {
      *  @param b1 the second box.
      */
     template<typename real> bool overlapAABB3Test(const AABB3<real>& b0, const AABB3<real>& b1) {
-        return (pointInAABB3Test(b0, b1.minmax[0]) || pointInAABB3Test(b0, b1.minmax[1]));
+        return (pointInAABB3Test(b0, b1.minmax_[0]) || pointInAABB3Test(b0, b1.minmax_[1]));
+    }
+
+    /**
+     *  Tests if two AABB3 intersect, i.e., their intervals overlap on all axes (touching boxes intersect).
+     *  Unlike overlapAABB3Test this also finds boxes that contain each other or cross without a corner inside the other.
+     *  @tparam real the floating point type used.
+     *  @param b0 the first box.
+     *  @param b1 the second box.
+     */
+    template<typename real> bool intersectAABB3Test(const AABB3<real>& b0, const AABB3<real>& b1) {
+        return (b0.minmax_[0].x <= b1.minmax_[1].x && b0.minmax_[0].y <= b1.minmax_[1].y && b0.minmax_[0].z <= b1.minmax_[1].z
+            && b1.minmax_[0].x <= b0.minmax_[1].x && b1.minmax_[0].y <= b0.minmax_[1].y && b1.minmax_[0].z <= b0.minmax_[1].z);
     }
 
     /**
@@ -140,7 +152,7 @@ namespace viscom { namespace math {
      *  @param b1 the second box.
      */
     template<typename real> bool containAABB2Test(const AABB2<real>& b0, const AABB2<real>& b1) {
-        return (pointInAABB2Test(b0, b1.minmax[0]) && pointInAABB2Test(b0, b1.minmax[1]));
+        return (pointInAABB2Test(b0, b1.minmax_[0]) && pointInAABB2Test(b0, b1.minmax_[1]));
     }
 
     /**
@@ -150,7 +162,28 @@ namespace viscom { namespace math {
      *  @param b1 the second box.
      */
     template<typename real> bool containAABB3Test(const AABB3<real>& b0, const AABB3<real>& b1) {
-        return (pointInAABB3Test(b0, b1.minmax[0]) && pointInAABB3Test(b0, b1.minmax[1]));
+        return (pointInAABB3Test(b0, b1.minmax_[0]) && pointInAABB3Test(b0, b1.minmax_[1]));
+    }
+
+    /**
+     *  Extracts the frustum planes from a (view-)projection matrix. The plane normals point inside the frustum.
+     *  @tparam real the floating point type used.
+     *  @param m the (view-)projection matrix using OpenGL clip space conventions.
+     */
+    template<typename real> Frustum<real> frustumFromMatrix(const glm::tmat4x4<real, glm::highp>& m) {
+        using vec4 = glm::tvec4<real, glm::highp>;
+        std::array<vec4, 4> rows;
+        for (int i = 0; i < 4; ++i) rows[static_cast<std::size_t>(i)] = vec4{ m[0][i], m[1][i], m[2][i], m[3][i] };
+
+        Frustum<real> result;
+        result.left() = rows[3] + rows[0];
+        result.right() = rows[3] - rows[0];
+        result.top() = rows[3] - rows[1];
+        result.bttm() = rows[3] + rows[1];
+        result.near() = rows[3] + rows[2];
+        result.far() = rows[3] - rows[2];
+        for (auto& plane : result.planes) plane /= glm::length(glm::tvec3<real, glm::highp>(plane));
+        return result;
     }
 
     /**
@@ -160,10 +193,10 @@ namespace viscom { namespace math {
      *  @param b the box.
      */
     template<typename real> bool AABBInFrustumTest(const Frustum<real>& f, const AABB3<real>& b) {
-        auto& bmax = b.minmax[1];
+        auto& bmax = b.minmax_[1];
         for (unsigned int i = 0; i < 6; ++i) {
             auto& plane = f.planes[i];
-            glm::vec3 p{ b.minmax[0] };
+            glm::vec3 p{ b.minmax_[0] };
             if (plane.x >= 0) p.x = bmax.x;
             if (plane.y >= 0) p.y = bmax.y;
             if (plane.z >= 0) p.z = bmax.z;
@@ -173,6 +206,60 @@ namespace viscom { namespace math {
         }
         return true;
     }
+
+    /**
+     *  Intersects a ray with a AABB3 using the slab test.
+     *  @tparam real the floating point type used.
+     *  @param origin the origin of the ray.
+     *  @param invDirection the component wise inverse of the rays direction.
+     *  @param b the box.
+     *  @param tMax the maximum ray parameter to look for intersections.
+     *  @param tNear the ray parameter where the ray enters the box (0 if the origin is inside).
+     *  @return <code>true</code> if the ray intersects the box in [0, tMax].
+     */
+    template<typename real> bool rayAABBIntersectionTest(const glm::tvec3<real, glm::highp>& origin, const glm::tvec3<real, glm::highp>& invDirection,
+        const AABB3<real>& b, real tMax, real& tNear) {
+        auto t0 = (b.minmax_[0] - origin) * invDirection;
+        auto t1 = (b.minmax_[1] - origin) * invDirection;
+        auto tMin = glm::min(t0, t1);
+        auto tFarVec = glm::max(t0, t1);
+        tNear = glm::max(glm::max(tMin.x, tMin.y), glm::max(tMin.z, static_cast<real>(0)));
+        auto tFar = glm::min(glm::min(tFarVec.x, tFarVec.y), glm::min(tFarVec.z, tMax));
+        return tNear <= tFar;
+    }
+
+    /**
+     *  Intersects a ray with a triangle (Moeller-Trumbore), both sides of the triangle are hit.
+     *  @tparam real the floating point type used.
+     *  @param origin the origin of the ray.
+     *  @param direction the direction of the ray.
+     *  @param v0 the first vertex of the triangle.
+     *  @param e1 the edge from the first to the second vertex.
+     *  @param e2 the edge from the first to the third vertex.
+     *  @param t the ray parameter of the intersection.
+     *  @param barycentrics the barycentric coordinates of the second and third vertex at the intersection.
+     *  @return <code>true</code> if the ray hits the triangle at a non negative ray parameter.
+     */
+    template<typename real> bool rayTriangleIntersectionTest(const glm::tvec3<real, glm::highp>& origin, const glm::tvec3<real, glm::highp>& direction,
+        const glm::tvec3<real, glm::highp>& v0, const glm::tvec3<real, glm::highp>& e1, const glm::tvec3<real, glm::highp>& e2,
+        real& t, glm::tvec2<real, glm::highp>& barycentrics) {
+        auto p = glm::cross(direction, e2);
+        auto det = glm::dot(e1, p);
+        // only exactly parallel rays are rejected, the barycentric tests below need no epsilon.
+        if (det == static_cast<real>(0)) return false;
+
+        auto invDet = static_cast<real>(1) / det;
+        auto s = origin - v0;
+        barycentrics.x = glm::dot(s, p) * invDet;
+        if (barycentrics.x < static_cast<real>(0) || barycentrics.x > static_cast<real>(1)) return false;
+
+        auto q = glm::cross(s, e1);
+        barycentrics.y = glm::dot(direction, q) * invDet;
+        if (barycentrics.y < static_cast<real>(0) || barycentrics.x + barycentrics.y > static_cast<real>(1)) return false;
+
+        t = glm::dot(e2, q) * invDet;
+        return t >= static_cast<real>(0);
+    }
 }}
 
 // ReSharper restore CppDoxygenUnresolvedReference
@@ -29,4 +29,42 @@ namespace viscom {
         }
         return result;
     }
+
+    /**
+     *  Transforms a frustum into the local space of a transformation, i.e. a point p is inside the resulting frustum
+     *  if m * p is inside the original one. The planes are not normalized afterwards.
+     *  @param f the frustum to be transformed.
+     *  @param m the transformation matrix from local space to the space of the frustum.
+     */
+    template<class T> Frustum<T> transformFrustum(const Frustum<T>& f, const glm::tmat4x4<T, glm::highp>& m)
+    {
+        Frustum<T> result;
+        for (std::size_t i = 0; i < 6; ++i) result.planes[i] = f.planes[i] * m;
+        return result;
+    }
+
+    /**
+     *  Checks if a matrix is an affine transformation (i.e. its last row is (0, 0, 0, 1)).
+     *  @param m the matrix to check.
+     */
+    inline bool isAffine(const glm::mat4& m)
+    {
+        return m[0][3] == 0.0f && m[1][3] == 0.0f && m[2][3] == 0.0f && m[3][3] == 1.0f;
+    }
+
+    /**
+     *  Multiplies two affine matrices (result = a * b) only computing the upper 3x4 part.
+     *  This needs 36 instead of 64 multiplications and the loops can be vectorized by the compiler.
+     *  @param a the left hand side affine matrix.
+     *  @param b the right hand side affine matrix.
+     *  @param result the resulting matrix (must not alias a or b).
+     */
+    inline void multiplyAffine(const glm::mat4& a, const glm::mat4& b, glm::mat4& result)
+    {
+        for (auto c = 0; c < 4; ++c) {
+            for (auto r = 0; r < 3; ++r) result[c][r] = a[0][r] * b[c][0] + a[1][r] * b[c][1] + a[2][r] * b[c][2];
+        }
+        for (auto r = 0; r < 3; ++r) result[3][r] += a[3][r];
+        result[0][3] = 0.0f; result[1][3] = 0.0f; result[2][3] = 0.0f; result[3][3] = 1.0f;
+    }
 }}
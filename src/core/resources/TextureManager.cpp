@@ -7,6 +7,9 @@
  */
 
 #include "TextureManager.h"
+#include "core/utils/ThreadPool.h"
+#include <algorithm>
+#include <chrono>
 
 namespace viscom {
 
@@ -25,16 +28,241 @@ namespace viscom {
     TextureManager& TextureManager::operator=(const TextureManager&) = default;
 
     /** Default move constructor. */
-    TextureManager::TextureManager(TextureManager&& rhs) noexcept : ResourceManagerBase(std::move(rhs)) {}
+    TextureManager::TextureManager(TextureManager&& rhs) noexcept :
+        ResourceManagerBase(std::move(rhs)),
+        contentHashes_{ std::move(rhs.contentHashes_) },
+        aliases_{ std::move(rhs.aliases_) },
+        sharingStatistics_{ rhs.sharingStatistics_ },
+        residency_{ std::move(rhs.residency_) },
+        residentTextures_{ std::move(rhs.residentTextures_) },
+        pendingUploads_{ std::move(rhs.pendingUploads_) },
+        simulateResidency_{ rhs.simulateResidency_ }
+    {
+        rhs.pendingUploads_.clear();
+    }
 
     /** Default move assignment operator. */
     TextureManager& TextureManager::operator=(TextureManager&& rhs) noexcept
     {
         ResourceManagerBase* tResMan = this;
         *tResMan = static_cast<ResourceManagerBase&&>(std::move(rhs));
+        contentHashes_ = std::move(rhs.contentHashes_);
+        aliases_ = std::move(rhs.aliases_);
+        sharingStatistics_ = rhs.sharingStatistics_;
+        residency_ = std::move(rhs.residency_);
+        residentTextures_ = std::move(rhs.residentTextures_);
+        pendingUploads_ = std::move(rhs.pendingUploads_);
+        rhs.pendingUploads_.clear();
+        simulateResidency_ = rhs.simulateResidency_;
         return *this;
     }
 
-    /** Default destructor. */
-    TextureManager::~TextureManager() = default;
+    /** Destructor, waits for the textures that are decoded in the background. */
+    TextureManager::~TextureManager()
+    {
+        for (const auto& upload : pendingUploads_) if (upload.decodeTask_.valid()) upload.decodeTask_.wait();
+    }
+
+    std::shared_ptr<Texture> TextureManager::GetResource(const std::string& resId, bool useSRGB, bool flipTexture, TextureOptions options)
+    {
+        std::lock_guard<std::mutex> accessLock{ mtx_ };
+        auto texture = GetResourceInternal(resId, false, useSRGB, flipTexture, options);
+        if (!texture->IsLoaded()) {
+            texture->DecodeImage();
+            LoadOrShareTexture(texture);
+        }
+        return texture;
+    }
+
+    std::vector<std::shared_ptr<Texture>> TextureManager::GetResources(const std::vector<std::string>& resIds, bool useSRGB, bool flipTexture,
+        const TextureOptions& options, ThreadPool* threadPool)
+    {
+        auto& pool = threadPool != nullptr ? *threadPool : ThreadPool::GetDefault();
+        std::lock_guard<std::mutex> accessLock{ mtx_ };
+
+        std::vector<std::shared_ptr<Texture>> textures;
+        std::vector<std::shared_ptr<Texture>> texturesToLoad;
+        for (const auto& resId : resIds) {
+            auto texture = GetResourceInternal(resId, false, useSRGB, flipTexture, options);
+            if (!texture->IsLoaded() && std::find(texturesToLoad.begin(), texturesToLoad.end(), texture) == texturesToLoad.end()) texturesToLoad.push_back(texture);
+            textures.emplace_back(std::move(texture));
+        }
+
+        std::vector<std::future<void>> decodeTasks;
+        decodeTasks.reserve(texturesToLoad.size());
+        for (const auto& texture : texturesToLoad) {
+            decodeTasks.emplace_back(pool.Enqueue([texture = texture.get()]() {
+                // errors are reported when the texture is loaded, as Load decodes images that were not decoded here.
+                try {
+                    texture->DecodeImage();
+                }
+                catch (const resource_loading_error&) {}
+            }));
+        }
+
+        // textures are uploaded in order while the following ones are still decoded.
+        try {
+            for (std::size_t i = 0; i < texturesToLoad.size(); ++i) {
+                decodeTasks[i].wait();
+                auto texture = texturesToLoad[i];
+                // images that failed to decode are decoded again to report the error.
+                if (texture->GetContentHash() == 0) texture->DecodeImage();
+                LoadOrShareTexture(texture);
+                if (texture != texturesToLoad[i]) std::replace(textures.begin(), textures.end(), texturesToLoad[i], texture);
+            }
+        }
+        catch (...) {
+            // the workers still use the textures.
+            for (auto& task : decodeTasks) task.wait();
+            throw;
+        }
+        return textures;
+    }
+
+    std::string TextureManager::GetSharedResourceId(const std::string& resId) const
+    {
+        std::lock_guard<std::mutex> accessLock{ mtx_ };
+        auto it = aliases_.find(resId);
+        return it != aliases_.end() ? it->second : resId;
+    }
+
+    TextureSharingStatistics TextureManager::GetSharingStatistics() const
+    {
+        std::lock_guard<std::mutex> accessLock{ mtx_ };
+        return sharingStatistics_;
+    }
+
+    void TextureManager::SetMemoryBudget(std::size_t budget, bool simulate)
+    {
+        std::lock_guard<std::mutex> accessLock{ mtx_ };
+        residency_.SetBudget(budget);
+        simulateResidency_ = simulate;
+    }
+
+    void TextureManager::UpdateResidency(ThreadPool* threadPool)
+    {
+        auto& pool = threadPool != nullptr ? *threadPool : ThreadPool::GetDefault();
+        std::lock_guard<std::mutex> accessLock{ mtx_ };
+
+        residency_.NextFrame();
+        for (auto it = residentTextures_.begin(); it != residentTextures_.end();) {
+            auto texture = it->second.texture_.lock();
+            if (!texture) {
+                residency_.RemoveTexture(it->first);
+                it = residentTextures_.erase(it);
+                continue;
+            }
+            if (texture->GetUseCount() != it->second.lastUseCount_) {
+                residency_.MarkUsed(it->first);
+                it->second.lastUseCount_ = texture->GetUseCount();
+            }
+            ++it;
+        }
+
+        // each upload belongs to a different texture, so they are finished in the order they are decoded.
+        for (auto it = pendingUploads_.begin(); it != pendingUploads_.end();) {
+            if (it->decodeTask_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                ++it;
+                continue;
+            }
+            FinishUpload(*it);
+            it = pendingUploads_.erase(it);
+        }
+        // while textures are decoded again, they are counted with their new levels, so no levels are dropped or restored until they are uploaded.
+        if (!pendingUploads_.empty()) return;
+
+        auto drops = residency_.SelectDrops();
+        for (const auto& drop : drops) {
+            auto texture = residentTextures_[drop.first].texture_.lock();
+            spdlog::debug("Dropping {} mip levels of texture \"{}\".", drop.second, texture->GetId());
+            // levels that cannot be copied on the GPU are dropped by uploading the decoded image again without them.
+            if (!simulateResidency_ && !texture->DropMipLevels(drop.second)) StartUpload(pool, drop.first, *texture, texture->GetDroppedMipLevels() + drop.second);
+        }
+        const auto& statistics = residency_.GetStatistics();
+        if (!drops.empty()) {
+            spdlog::info("Dropped mip levels of {} textures{} ({:.2f} of {:.2f} MB resident, {:.2f} MB dropped).", drops.size(), simulateResidency_ ? " (simulated)" : "",
+                static_cast<double>(statistics.residentBytes_) / (1024.0 * 1024.0), static_cast<double>(statistics.budgetBytes_) / (1024.0 * 1024.0),
+                static_cast<double>(statistics.droppedBytes_) / (1024.0 * 1024.0));
+            return;
+        }
+
+        auto restore = residency_.SelectRestore();
+        if (!restore.has_value()) return;
+        auto texture = residentTextures_[*restore].texture_.lock();
+        spdlog::debug("Restoring mip levels of texture \"{}\".", texture->GetId());
+        // levels that were only dropped in a simulation do not need to be restored.
+        if (texture->GetDroppedMipLevels() == 0) return;
+        StartUpload(pool, *restore, *texture, 0);
+    }
+
+    TextureResidencyStatistics TextureManager::GetResidencyStatistics() const
+    {
+        std::lock_guard<std::mutex> accessLock{ mtx_ };
+        return residency_.GetStatistics();
+    }
+
+    void TextureManager::StartUpload(ThreadPool& pool, TextureResidencyTracker::Handle handle, Texture& texture, unsigned int droppedLevels)
+    {
+        PendingUpload upload;
+        upload.handle_ = handle;
+        upload.copy_ = texture.CreateUnloadedCopy(droppedLevels);
+        upload.droppedLevels_ = droppedLevels;
+        upload.decodeTask_ = pool.Enqueue([copy = upload.copy_.get()]() {
+            // failed decodes leave the content hash at 0 and are handled when the upload is finished.
+            try {
+                copy->DecodeImage();
+            }
+            catch (const resource_loading_error&) {}
+        }).share();
+        pendingUploads_.emplace_back(std::move(upload));
+    }
+
+    void TextureManager::FinishUpload(PendingUpload& upload)
+    {
+        auto it = residentTextures_.find(upload.handle_);
+        auto texture = it != residentTextures_.end() ? it->second.texture_.lock() : nullptr;
+        if (!texture) return;
+
+        // the image file may have changed since the texture was loaded, it is only uploaded again if the content is the same.
+        if (!upload.copy_->HasSameContent(*texture)) {
+            spdlog::warn("Could not {} the mip levels of texture \"{}\".", upload.droppedLevels_ == 0 ? "restore" : "drop", texture->GetId());
+            if (upload.droppedLevels_ == 0) residency_.RestoreFailed(upload.handle_, texture->GetDroppedMipLevels());
+            else residency_.DropFailed(upload.handle_, texture->GetDroppedMipLevels());
+            return;
+        }
+
+        upload.copy_->LoadResource();
+        texture->SwapTextureObject(*upload.copy_);
+        // levels generated on the GPU cannot be skipped when the image is uploaded.
+        if (texture->GetDroppedMipLevels() != upload.droppedLevels_) residency_.DropFailed(upload.handle_, texture->GetDroppedMipLevels());
+    }
+
+    void TextureManager::LoadOrShareTexture(std::shared_ptr<Texture>& texture)
+    {
+        auto hash = texture->GetContentHash();
+        auto it = contentHashes_.find(hash);
+        std::shared_ptr<Texture> sharedTexture;
+        if (it != contentHashes_.end()) sharedTexture = it->second.lock();
+        // a different image with the same hash is loaded on its own, the first texture keeps the hash.
+        auto isHashCollision = sharedTexture && !texture->HasSameContent(*sharedTexture);
+        if (isHashCollision) spdlog::warn("Texture \"{}\" has the same content hash as \"{}\" but a different image, it is not shared.", texture->GetId(), sharedTexture->GetId());
+
+        if (!sharedTexture || isHashCollision) {
+            texture->LoadResource();
+            auto handle = residency_.AddTexture(texture->getDescriptor(), texture->getDimensions(), texture->GetNumMipLevels());
+            residentTextures_.emplace(handle, ResidentTexture{ texture, texture->GetUseCount() });
+            if (!isHashCollision) contentHashes_[hash] = texture;
+            aliases_.erase(texture->GetId());
+            return;
+        }
+
+        // the alias id maps to the shared texture, the decoded texture is released without being uploaded.
+        aliases_[texture->GetId()] = sharedTexture->GetId();
+        sharingStatistics_.sharedTextures_ += 1;
+        sharingStatistics_.bytesSaved_ += texture->GetContentSize();
+        spdlog::info("Texture \"{}\" is identical to \"{}\", sharing it ({} textures shared, {:.2f} MB saved).", texture->GetId(), sharedTexture->GetId(),
+            sharingStatistics_.sharedTextures_, static_cast<double>(sharingStatistics_.bytesSaved_) / (1024.0 * 1024.0));
+        SetResource(texture->GetId(), std::shared_ptr<Texture>{ sharedTexture });
+        texture = std::move(sharedTexture);
+    }
 }
@@ -10,10 +10,31 @@
 
 #include "ResourceManager.h"
 #include "core/gfx/Texture.h"
+#include "TextureResidency.h"
+#include <future>
 
 namespace viscom {
 
-    /** Manager for handling all texture objects. */
+    class ThreadPool;
+
+    /** Counters of textures shared because their decoded images are identical. */
+    struct TextureSharingStatistics
+    {
+        /** The number of texture ids that share the texture of another id. */
+        std::size_t sharedTextures_ = 0;
+        /** The number of bytes of image data that were not uploaded again. */
+        std::size_t bytesSaved_ = 0;
+    };
+
+    /**
+     *  Manager for handling all texture objects.
+     *  Decoded images are hashed together with their format, an id whose image is identical to a loaded texture
+     *  becomes an alias of that texture instead of uploading it again.
+     *  With a memory budget the estimated video memory of loaded textures is tracked, when it exceeds the budget the top
+     *  mip levels of the least recently used textures are dropped and later restored in the background.
+     *  Synchronized textures (GetSynchronizedResource) are transferred to the other nodes as file data and are neither
+     *  shared nor tracked for the memory budget.
+     */
     class TextureManager final : public ResourceManager<Texture>
     {
     public:
@@ -23,5 +44,115 @@ namespace viscom {
         TextureManager(TextureManager&&) noexcept;
         TextureManager& operator=(TextureManager&&) noexcept;
         virtual ~TextureManager() override;
+
+        /** The generic GetResource of the base class, it neither shares textures nor tracks them for the memory budget. */
+        using ResourceManagerBase::GetResource;
+        /**
+         *  Gets a texture, loading it if necessary. Identical images share one texture.
+         *  The options are taken by value, so calls with these arguments are not resolved to the template of the base class.
+         *  @param resId the texture id.
+         *  @param useSRGB defines if the texture uses the standard RGB color space.
+         *  @param flipTexture flips the texture on load.
+         *  @param options the mip map and sampling options.
+         *  @return the texture (its id is the id of the texture shared if the image was loaded before).
+         */
+        std::shared_ptr<Texture> GetResource(const std::string& resId, bool useSRGB = true, bool flipTexture = true,
+            TextureOptions options = TextureOptions{});
+        /**
+         *  Gets a list of textures, images that are not loaded yet are read and decoded in parallel on a thread pool
+         *  and uploaded on the calling thread as soon as they are decoded.
+         *  @param resIds the texture ids.
+         *  @param useSRGB defines if the textures use the standard RGB color space.
+         *  @param flipTexture flips the textures on load.
+         *  @param options the mip map and sampling options.
+         *  @param threadPool the thread pool to decode on (nullptr uses the default pool).
+         *  @return the textures in the order of their ids.
+         */
+        std::vector<std::shared_ptr<Texture>> GetResources(const std::vector<std::string>& resIds, bool useSRGB = true, bool flipTexture = true,
+            const TextureOptions& options = TextureOptions{}, ThreadPool* threadPool = nullptr);
+
+        /**
+         *  Returns the id of the texture an id shares.
+         *  @param resId the texture id.
+         *  @return the id of the shared texture or the id itself if it is no alias.
+         */
+        std::string GetSharedResourceId(const std::string& resId) const;
+        /** Returns the statistics of shared textures. */
+        TextureSharingStatistics GetSharingStatistics() const;
+
+        /**
+         *  Sets the video memory budget for the textures loaded by GetResource and GetResources.
+         *  @param budget the budget in bytes (0 disables dropping mip levels).
+         *  @param simulate only tracks and logs which mip levels would be dropped without changing the textures.
+         */
+        void SetMemoryBudget(std::size_t budget, bool simulate = false);
+        /**
+         *  Updates the residency of the textures, should be called once per frame on the OpenGL thread.
+         *  Textures count as used when they were marked as used (Texture::MarkUsed) since the last update. Dropping and
+         *  restoring levels changes the texture ids, so renderers should request them each frame instead of storing them
+         *  and invalidate their GLStateCache after the update.
+         *  @param threadPool the thread pool to decode restored textures on (nullptr uses the default pool).
+         */
+        void UpdateResidency(ThreadPool* threadPool = nullptr);
+        /** Returns the statistics of the texture residency. */
+        TextureResidencyStatistics GetResidencyStatistics() const;
+
+    private:
+        /** A texture tracked for the memory budget. */
+        struct ResidentTexture
+        {
+            /** The texture. */
+            std::weak_ptr<Texture> texture_;
+            /** The use count of the texture at the last update. */
+            std::uint64_t lastUseCount_ = 0;
+        };
+
+        /** A texture that is decoded again to restore its dropped mip levels or to drop levels that cannot be copied on the GPU. */
+        struct PendingUpload
+        {
+            /** The handle of the texture. */
+            TextureResidencyTracker::Handle handle_ = 0;
+            /** The copy of the texture that is decoded in the background. */
+            std::shared_ptr<Texture> copy_;
+            /** The decoding task. */
+            std::shared_future<void> decodeTask_;
+            /** The number of top levels the copy drops (0 if the levels are restored). */
+            unsigned int droppedLevels_ = 0;
+        };
+
+
+        /**
+         *  Loads a decoded texture or replaces it with a loaded texture with the same content. Needs the lock of the manager.
+         *  @param texture the texture to load, replaced by the shared texture.
+         */
+        void LoadOrShareTexture(std::shared_ptr<Texture>& texture);
+        /**
+         *  Starts decoding a copy of a texture in the background. Needs the lock of the manager.
+         *  @param pool the thread pool to decode on.
+         *  @param handle the handle of the texture.
+         *  @param texture the texture.
+         *  @param droppedLevels the number of top levels the copy drops (0 to restore all levels).
+         */
+        void StartUpload(ThreadPool& pool, TextureResidencyTracker::Handle handle, Texture& texture, unsigned int droppedLevels);
+        /**
+         *  Uploads the decoded copy of a texture and swaps it with the texture. Needs the lock of the manager.
+         *  @param upload the decoded copy.
+         */
+        void FinishUpload(PendingUpload& upload);
+
+        /** Holds the loaded textures by the hash of their content. */
+        std::unordered_map<std::uint64_t, std::weak_ptr<Texture>> contentHashes_;
+        /** Holds the ids of the shared textures by their alias ids. */
+        std::unordered_map<std::string, std::string> aliases_;
+        /** Holds the statistics of shared textures. */
+        TextureSharingStatistics sharingStatistics_;
+        /** Holds the tracking of the texture memory. */
+        TextureResidencyTracker residency_;
+        /** Holds the textures tracked for the memory budget by their handle. */
+        std::unordered_map<TextureResidencyTracker::Handle, ResidentTexture> residentTextures_;
+        /** Holds the textures that are currently decoded again. */
+        std::vector<PendingUpload> pendingUploads_;
+        /** Only tracks the memory budget without dropping mip levels. */
+        bool simulateResidency_ = false;
     };
 }
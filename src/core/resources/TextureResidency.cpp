@@ -0,0 +1,154 @@
+/**
+ * @file   TextureResidency.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.28
+ *
+ * @brief  Implementation of the tracking of texture memory against a budget.
+ */
+
+#include "TextureResidency.h"
+#include "core/gfx/TextureCompression.h"
+#include <algorithm>
+#include <limits>
+
+namespace viscom {
+
+    TextureResidencyTracker::TextureResidencyTracker(std::size_t budget, float restoreThreshold) :
+        restoreThreshold_{ restoreThreshold }
+    {
+        statistics_.budgetBytes_ = budget;
+    }
+
+    std::size_t TextureResidencyTracker::EstimateMemory(const TextureDescriptor& descriptor, const glm::uvec2& size, unsigned int firstLevel, unsigned int numLevels) noexcept
+    {
+        std::optional<BlockCompression> compression;
+        if (descriptor.bytesPP_ == 0) {
+            compression = BlockCompression::BC7;
+            for (auto format : { BlockCompression::BC1, BlockCompression::BC3, BlockCompression::BC4, BlockCompression::BC5, BlockCompression::BC7 }) {
+                auto internalFormat = static_cast<GLenum>(descriptor.internalFormat_);
+                if (internalFormat == GetCompressedInternalFormat(format, false) || internalFormat == GetCompressedInternalFormat(format, true)) compression = format;
+            }
+        }
+
+        std::size_t memory = 0;
+        for (auto level = firstLevel; level < numLevels; ++level) {
+            auto levelWidth = std::max(size.x >> level, 1U);
+            auto levelHeight = std::max(size.y >> level, 1U);
+            if (compression.has_value()) memory += GetCompressedSize(*compression, levelWidth, levelHeight);
+            else memory += static_cast<std::size_t>(levelWidth) * levelHeight * descriptor.bytesPP_;
+        }
+        return memory;
+    }
+
+    void TextureResidencyTracker::SetBudget(std::size_t budget) noexcept
+    {
+        statistics_.budgetBytes_ = budget;
+    }
+
+    TextureResidencyTracker::Handle TextureResidencyTracker::AddTexture(const TextureDescriptor& descriptor, const glm::uvec2& size, unsigned int numLevels)
+    {
+        auto handle = nextHandle_++;
+        textures_.emplace(handle, TrackedTexture{ descriptor, size, std::max(numLevels, 1U), 0, frame_ });
+        statistics_.trackedTextures_ += 1;
+        statistics_.residentBytes_ += EstimateMemory(descriptor, size, 0, std::max(numLevels, 1U));
+        return handle;
+    }
+
+    void TextureResidencyTracker::RemoveTexture(Handle handle)
+    {
+        auto it = textures_.find(handle);
+        if (it == textures_.end()) return;
+
+        SetDroppedLevels(it->second, 0);
+        statistics_.residentBytes_ -= EstimateMemory(it->second.descriptor_, it->second.size_, 0, it->second.numLevels_);
+        statistics_.trackedTextures_ -= 1;
+        textures_.erase(it);
+    }
+
+    void TextureResidencyTracker::MarkUsed(Handle handle)
+    {
+        auto it = textures_.find(handle);
+        if (it != textures_.end()) it->second.lastUsed_ = frame_;
+    }
+
+    std::vector<std::pair<TextureResidencyTracker::Handle, unsigned int>> TextureResidencyTracker::SelectDrops()
+    {
+        std::vector<std::pair<Handle, unsigned int>> drops;
+        auto budget = statistics_.budgetBytes_;
+        if (budget == 0 || statistics_.residentBytes_ <= budget) return drops;
+
+        std::vector<std::pair<Handle, TrackedTexture*>> candidates;
+        for (auto& texture : textures_) candidates.emplace_back(texture.first, &texture.second);
+        std::sort(candidates.begin(), candidates.end(), [](const auto& lhs, const auto& rhs) { return lhs.second->lastUsed_ < rhs.second->lastUsed_; });
+
+        // each pass drops a single level of the least recently used textures, so recently used ones keep their detail if possible.
+        std::vector<unsigned int> droppedLevels(candidates.size(), 0);
+        for (auto dropped = true; dropped && statistics_.residentBytes_ > budget;) {
+            dropped = false;
+            for (std::size_t i = 0; i < candidates.size() && statistics_.residentBytes_ > budget; ++i) {
+                auto& texture = *candidates[i].second;
+                if (!texture.droppable_ || texture.droppedLevels_ + 1 >= texture.numLevels_) continue;
+                SetDroppedLevels(texture, texture.droppedLevels_ + 1);
+                droppedLevels[i] += 1;
+                dropped = true;
+            }
+        }
+
+        for (std::size_t i = 0; i < candidates.size(); ++i) {
+            if (droppedLevels[i] != 0) drops.emplace_back(candidates[i].first, droppedLevels[i]);
+        }
+        statistics_.dropOperations_ += drops.size();
+        if (statistics_.residentBytes_ > budget) spdlog::warn("Textures exceed the memory budget with all mip levels dropped ({} of {} MB).",
+            statistics_.residentBytes_ / (1024 * 1024), budget / (1024 * 1024));
+        return drops;
+    }
+
+    std::optional<TextureResidencyTracker::Handle> TextureResidencyTracker::SelectRestore()
+    {
+        auto limit = statistics_.budgetBytes_ == 0 ? std::numeric_limits<std::size_t>::max()
+            : static_cast<std::size_t>(static_cast<double>(statistics_.budgetBytes_) * restoreThreshold_);
+
+        std::pair<Handle, TrackedTexture*> restore{ 0, nullptr };
+        for (auto& texture : textures_) {
+            const auto& tracked = texture.second;
+            if (tracked.droppedLevels_ == 0 || !tracked.restorable_ || (restore.second != nullptr && restore.second->lastUsed_ >= tracked.lastUsed_)) continue;
+
+            auto restoredBytes = EstimateMemory(tracked.descriptor_, tracked.size_, 0, tracked.droppedLevels_);
+            if (statistics_.residentBytes_ + restoredBytes <= limit) restore = std::make_pair(texture.first, &texture.second);
+        }
+        if (restore.second == nullptr) return std::nullopt;
+
+        SetDroppedLevels(*restore.second, 0);
+        statistics_.restoreOperations_ += 1;
+        return restore.first;
+    }
+
+    void TextureResidencyTracker::RestoreFailed(Handle handle, unsigned int droppedLevels)
+    {
+        auto it = textures_.find(handle);
+        if (it == textures_.end()) return;
+
+        SetDroppedLevels(it->second, droppedLevels);
+        it->second.restorable_ = false;
+    }
+
+    void TextureResidencyTracker::DropFailed(Handle handle, unsigned int droppedLevels)
+    {
+        auto it = textures_.find(handle);
+        if (it == textures_.end()) return;
+
+        SetDroppedLevels(it->second, droppedLevels);
+        it->second.droppable_ = false;
+    }
+
+    void TextureResidencyTracker::SetDroppedLevels(TrackedTexture& texture, unsigned int droppedLevels)
+    {
+        auto droppedBytes = [&texture](unsigned int levels) { return EstimateMemory(texture.descriptor_, texture.size_, 0, levels); };
+        if (texture.droppedLevels_ == 0 && droppedLevels != 0) statistics_.reducedTextures_ += 1;
+        if (texture.droppedLevels_ != 0 && droppedLevels == 0) statistics_.reducedTextures_ -= 1;
+
+        statistics_.residentBytes_ = statistics_.residentBytes_ + droppedBytes(texture.droppedLevels_) - droppedBytes(droppedLevels);
+        statistics_.droppedBytes_ = statistics_.droppedBytes_ - droppedBytes(texture.droppedLevels_) + droppedBytes(droppedLevels);
+        texture.droppedLevels_ = droppedLevels;
+    }
+}
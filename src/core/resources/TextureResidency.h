@@ -0,0 +1,156 @@
+/**
+ * @file   TextureResidency.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.28
+ *
+ * @brief  Declaration of the tracking of texture memory against a budget.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "core/gfx/Texture.h"
+#include <optional>
+#include <unordered_map>
+
+namespace viscom {
+
+    /** Counters of the texture residency. */
+    struct TextureResidencyStatistics
+    {
+        /** The number of tracked textures. */
+        std::size_t trackedTextures_ = 0;
+        /** The estimated memory of all tracked textures with their resident levels in bytes. */
+        std::size_t residentBytes_ = 0;
+        /** The memory budget in bytes (0 if there is none). */
+        std::size_t budgetBytes_ = 0;
+        /** The number of textures with dropped mip levels. */
+        std::size_t reducedTextures_ = 0;
+        /** The memory saved by dropped mip levels in bytes. */
+        std::size_t droppedBytes_ = 0;
+        /** The number of times mip levels were dropped. */
+        std::size_t dropOperations_ = 0;
+        /** The number of times restoring all levels of a texture was started. */
+        std::size_t restoreOperations_ = 0;
+    };
+
+    /**
+     *  Tracks the estimated video memory of textures and decides which ones should drop or restore their top mip levels
+     *  to stay within a budget. Textures are described by their format and size only, so the tracker does not need
+     *  OpenGL and can simulate budgets for a list of textures without a GPU. TextureManager applies its decisions.
+     */
+    class TextureResidencyTracker final
+    {
+    public:
+        /** The handle of a tracked texture. */
+        using Handle = std::uint64_t;
+
+        /**
+         *  Constructor.
+         *  @param budget the memory budget in bytes (0 disables dropping mip levels).
+         *  @param restoreThreshold the fraction of the budget that may be used after a texture is restored.
+         */
+        explicit TextureResidencyTracker(std::size_t budget = 0, float restoreThreshold = 0.9f);
+
+        /**
+         *  Estimates the memory of a texture.
+         *  @param descriptor the format of the texture.
+         *  @param size the size of the base level.
+         *  @param firstLevel the first resident level.
+         *  @param numLevels the number of levels of the texture.
+         */
+        static std::size_t EstimateMemory(const TextureDescriptor& descriptor, const glm::uvec2& size, unsigned int firstLevel, unsigned int numLevels) noexcept;
+
+        /**
+         *  Sets the memory budget.
+         *  @param budget the memory budget in bytes (0 disables dropping mip levels).
+         */
+        void SetBudget(std::size_t budget) noexcept;
+        /**
+         *  Adds a texture with all of its levels resident.
+         *  @param descriptor the format of the texture.
+         *  @param size the size of the base level.
+         *  @param numLevels the number of mip levels.
+         *  @return the handle of the texture.
+         */
+        Handle AddTexture(const TextureDescriptor& descriptor, const glm::uvec2& size, unsigned int numLevels);
+        /**
+         *  Removes a texture.
+         *  @param handle the handle of the texture.
+         */
+        void RemoveTexture(Handle handle);
+        /**
+         *  Marks a texture as used in the current frame.
+         *  @param handle the handle of the texture.
+         */
+        void MarkUsed(Handle handle);
+        /** Starts a new frame. */
+        void NextFrame() noexcept { ++frame_; }
+
+        /**
+         *  Selects the top mip levels to drop until the budget is kept, starting with the least recently used textures.
+         *  Each texture keeps at least its last level. The dropped levels are counted as not resident right away.
+         *  @return the textures and the number of their levels to drop.
+         */
+        std::vector<std::pair<Handle, unsigned int>> SelectDrops();
+        /**
+         *  Selects the most recently used texture with dropped levels that fits the budget with all levels restored.
+         *  The restored levels are counted as resident right away.
+         *  @return the texture to restore or an empty optional if none fits.
+         */
+        std::optional<Handle> SelectRestore();
+        /**
+         *  Marks a restore that failed, so the levels are counted as dropped again and the texture is not restored again.
+         *  @param handle the handle of the texture.
+         *  @param droppedLevels the number of levels still dropped.
+         */
+        void RestoreFailed(Handle handle, unsigned int droppedLevels);
+        /**
+         *  Marks a drop that failed, so only the levels that are actually dropped are counted and no more levels of the texture are dropped.
+         *  @param handle the handle of the texture.
+         *  @param droppedLevels the number of levels dropped.
+         */
+        void DropFailed(Handle handle, unsigned int droppedLevels);
+
+        /** Returns the statistics. */
+        const TextureResidencyStatistics& GetStatistics() const noexcept { return statistics_; }
+
+    private:
+        /** A tracked texture. */
+        struct TrackedTexture
+        {
+            /** The format of the texture. */
+            TextureDescriptor descriptor_;
+            /** The size of the base level. */
+            glm::uvec2 size_;
+            /** The number of mip levels. */
+            unsigned int numLevels_;
+            /** The number of dropped top levels. */
+            unsigned int droppedLevels_ = 0;
+            /** The frame the texture was last used in. */
+            std::uint64_t lastUsed_ = 0;
+            /** Can the dropped levels be restored. */
+            bool restorable_ = true;
+            /** Can more levels be dropped. */
+            bool droppable_ = true;
+        };
+
+        /**
+         *  Changes the number of dropped levels of a texture and updates the statistics.
+         *  @param texture the texture.
+         *  @param droppedLevels the new number of dropped levels.
+         */
+        void SetDroppedLevels(TrackedTexture& texture, unsigned int droppedLevels);
+
+        /** Holds the tracked textures. */
+        std::unordered_map<Handle, TrackedTexture> textures_;
+        /** Holds the next handle. */
+        Handle nextHandle_ = 1;
+        /** Holds the current frame. */
+        std::uint64_t frame_ = 1;
+        /** Holds the fraction of the budget that may be used after a texture is restored. */
+        float restoreThreshold_;
+        /** Holds the statistics. */
+        TextureResidencyStatistics statistics_;
+    };
+}
@@ -0,0 +1,152 @@
+/**
+ * @file   ThreadPool.cpp
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.02
+ *
+ * @brief  Implementation of a simple pool of worker threads.
+ */
+
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace viscom {
+
+    namespace {
+        /** The pool the calling thread is a worker of (nullptr for other threads). */
+        thread_local const ThreadPool* currentWorkerPool = nullptr;
+
+        /** The chunks of a single ParallelFor call shared by the calling thread and the workers. */
+        struct ParallelForBatch
+        {
+            /** The function called for each chunk. */
+            const std::function<void(std::size_t, std::size_t)>* fn_ = nullptr;
+            /** The first index. */
+            std::size_t begin_ = 0;
+            /** The index after the last index. */
+            std::size_t end_ = 0;
+            /** The number of indices per chunk. */
+            std::size_t chunkSize_ = 0;
+            /** The number of chunks. */
+            std::size_t numChunks_ = 0;
+            /** The next chunk that was not taken yet. */
+            std::atomic<std::size_t> nextChunk_{ 0 };
+            /** The mutex for the finished chunks and the error. */
+            std::mutex mutex_;
+            /** Notified when all chunks are finished. */
+            std::condition_variable finished_;
+            /** The number of finished chunks. */
+            std::size_t numFinishedChunks_ = 0;
+            /** The first exception thrown by a chunk. */
+            std::exception_ptr error_;
+        };
+
+        /** Takes and executes chunks of a batch until all of them are taken, the function is not used once all are taken. */
+        void RunChunks(ParallelForBatch& batch)
+        {
+            for (auto chunk = batch.nextChunk_++; chunk < batch.numChunks_; chunk = batch.nextChunk_++) {
+                auto chunkBegin = batch.begin_ + chunk * batch.chunkSize_;
+                std::exception_ptr error;
+                try {
+                    (*batch.fn_)(chunkBegin, std::min(chunkBegin + batch.chunkSize_, batch.end_));
+                }
+                catch (...) {
+                    error = std::current_exception();
+                }
+
+                std::lock_guard<std::mutex> lock{ batch.mutex_ };
+                if (error && !batch.error_) batch.error_ = error;
+                if (++batch.numFinishedChunks_ == batch.numChunks_) batch.finished_.notify_all();
+            }
+        }
+    }
+
+    ThreadPool::ThreadPool(std::size_t numThreads)
+    {
+        if (numThreads == 0) numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+        workers_.reserve(numThreads);
+        for (std::size_t i = 0; i < numThreads; ++i) workers_.emplace_back([this]() { WorkerLoop(); });
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock{ queueMutex_ };
+            stop_ = true;
+        }
+        queueCondition_.notify_all();
+        for (auto& worker : workers_) worker.join();
+    }
+
+    ThreadPool& ThreadPool::GetDefault()
+    {
+        static ThreadPool defaultPool;
+        return defaultPool;
+    }
+
+    bool ThreadPool::IsWorkerThread() const noexcept
+    {
+        return currentWorkerPool == this;
+    }
+
+    std::future<void> ThreadPool::Enqueue(std::function<void()> task)
+    {
+        std::packaged_task<void()> packagedTask{ std::move(task) };
+        auto result = packagedTask.get_future();
+        {
+            std::lock_guard<std::mutex> lock{ queueMutex_ };
+            tasks_.emplace(std::move(packagedTask));
+        }
+        queueCondition_.notify_one();
+        return result;
+    }
+
+    void ThreadPool::ParallelFor(std::size_t begin, std::size_t end, const std::function<void(std::size_t, std::size_t)>& fn,
+        std::size_t minChunkSize)
+    {
+        if (begin >= end) return;
+
+        auto count = end - begin;
+        auto numChunks = std::min(workers_.size() + 1, (count + minChunkSize - 1) / std::max(minChunkSize, std::size_t{ 1 }));
+        if (numChunks <= 1) {
+            fn(begin, end);
+            return;
+        }
+
+        // tasks of the workers may still run after all chunks are done, so they share the batch.
+        auto batch = std::make_shared<ParallelForBatch>();
+        batch->fn_ = &fn;
+        batch->begin_ = begin;
+        batch->end_ = end;
+        batch->chunkSize_ = (count + numChunks - 1) / numChunks;
+        batch->numChunks_ = (count + batch->chunkSize_ - 1) / batch->chunkSize_;
+        for (std::size_t i = 1; i < batch->numChunks_; ++i) Enqueue([batch]() { RunChunks(*batch); });
+
+        RunChunks(*batch);
+        std::exception_ptr error;
+        {
+            std::unique_lock<std::mutex> lock{ batch->mutex_ };
+            batch->finished_.wait(lock, [&batch]() { return batch->numFinishedChunks_ == batch->numChunks_; });
+            error = std::move(batch->error_);
+        }
+        if (error) std::rethrow_exception(error);
+    }
+
+    void ThreadPool::WorkerLoop()
+    {
+        currentWorkerPool = this;
+        while (true) {
+            std::packaged_task<void()> task;
+            {
+                std::unique_lock<std::mutex> lock{ queueMutex_ };
+                queueCondition_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+                if (stop_ && tasks_.empty()) return;
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+            task();
+        }
+    }
+}
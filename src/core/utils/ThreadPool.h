@@ -0,0 +1,81 @@
+/**
+ * @file   ThreadPool.h
+ * @author Sebastian Maisch <sebastian.maisch@uni-ulm.de>
+ * @date   2020.11.02
+ *
+ * @brief  Declaration of a simple pool of worker threads.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace viscom {
+
+    /** Pool of persistent worker threads for data parallel work (e.g. per frame updates). */
+    class ThreadPool final
+    {
+    public:
+        /**
+         *  Constructor, starts the worker threads.
+         *  @param numThreads the number of worker threads (0 uses the number of hardware threads).
+         */
+        explicit ThreadPool(std::size_t numThreads = 0);
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        ThreadPool(ThreadPool&&) = delete;
+        ThreadPool& operator=(ThreadPool&&) = delete;
+        ~ThreadPool();
+
+        /** Returns the pool shared by all framework systems. */
+        static ThreadPool& GetDefault();
+
+        /** Returns the number of worker threads. */
+        std::size_t GetNumberOfThreads() const noexcept { return workers_.size(); }
+        /** Returns whether the calling thread is one of the workers of this pool. */
+        bool IsWorkerThread() const noexcept;
+
+        /**
+         *  Enqueues a task to be executed by one of the workers.
+         *  @param task the task to execute.
+         *  @return a future that becomes ready when the task has been executed.
+         */
+        std::future<void> Enqueue(std::function<void()> task);
+
+        /**
+         *  Executes a function for all indices in [begin, end) and blocks until all are done.
+         *  The range is split into contiguous chunks that are taken by the workers and the calling thread. The calling
+         *  thread only works on chunks of this call and then blocks until the chunks taken by workers are done, so it
+         *  never runs other queued tasks and it can be called from tasks running on the pool.
+         *  If a chunk throws, all chunks are finished before the exception is rethrown.
+         *  @param begin the first index.
+         *  @param end the index after the last index.
+         *  @param fn the function called with a sub range [chunkBegin, chunkEnd).
+         *  @param minChunkSize the minimum number of indices per chunk.
+         */
+        void ParallelFor(std::size_t begin, std::size_t end, const std::function<void(std::size_t, std::size_t)>& fn,
+            std::size_t minChunkSize = 1);
+
+    private:
+        /** The function run by each worker thread. */
+        void WorkerLoop();
+
+        /** Holds the worker threads. */
+        std::vector<std::thread> workers_;
+        /** Holds the queued tasks. */
+        std::queue<std::packaged_task<void()>> tasks_;
+        /** Holds the mutex for the task queue. */
+        std::mutex queueMutex_;
+        /** Holds the condition variable to notify workers of new tasks. */
+        std::condition_variable queueCondition_;
+        /** Flag whether the pool is shutting down. */
+        bool stop_ = false;
+    };
+}
@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <cstring>
 #include <string>
 #include <sstream>
@@ -121,5 +122,56 @@ namespace viscom {
                 offset += stride;
             }
         }
+
+        /**
+         *  Flips an image vertically in place.
+         *  @param data the pointer to the image data.
+         *  @param rowSize the size of a single row in bytes.
+         *  @param height the number of rows.
+         */
+        static void flipImageVertically(void* data, std::size_t rowSize, std::size_t height) {
+            std::vector<char> tmpRow(rowSize);
+            auto rows = reinterpret_cast<char*>(data);
+            for (std::size_t y = 0; y < height / 2; ++y) {
+                auto row0 = rows + y * rowSize;
+                auto row1 = rows + (height - 1 - y) * rowSize;
+                memcpy(tmpRow.data(), row0, rowSize);
+                memcpy(row0, row1, rowSize);
+                memcpy(row1, tmpRow.data(), rowSize);
+            }
+        }
+
+        /**
+         *  Computes a fast 64-bit (non cryptographic) hash of a block of memory.
+         *  Four independent lanes are mixed per 32 bytes, hashes of consecutive blocks can be chained through the seed.
+         *  @param data the pointer to the data.
+         *  @param size the size of the data in bytes.
+         *  @param seed the seed (e.g. the hash of the preceding data).
+         */
+        static std::uint64_t hashData(const void* data, std::size_t size, std::uint64_t seed = 0) {
+            constexpr std::uint64_t prime0 = 0x9E3779B185EBCA87ULL;
+            constexpr std::uint64_t prime1 = 0xC2B2AE3D27D4EB4FULL;
+            auto rotl = [](std::uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+            auto round = [rotl](std::uint64_t acc, std::uint64_t word) { return rotl(acc + word * prime1, 31) * prime0; };
+            auto readWord = [](const std::uint8_t* p) { std::uint64_t word; memcpy(&word, p, sizeof(word)); return word; };
+
+            auto bytes = reinterpret_cast<const std::uint8_t*>(data);
+            std::uint64_t lanes[4] = { seed + prime0 + prime1, seed + prime1, seed, seed - prime0 };
+            std::size_t offset = 0;
+            for (; offset + 32 <= size; offset += 32) {
+                for (std::size_t l = 0; l < 4; ++l) lanes[l] = round(lanes[l], readWord(bytes + offset + 8 * l));
+            }
+
+            auto hash = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18) + static_cast<std::uint64_t>(size);
+            for (; offset + 8 <= size; offset += 8) hash = rotl(hash ^ round(0, readWord(bytes + offset)), 27) * prime0 + prime1;
+            for (; offset < size; ++offset) hash = rotl(hash ^ (bytes[offset] * prime0), 11) * prime1;
+
+            hash ^= hash >> 33;
+            hash *= prime1;
+            hash ^= hash >> 29;
+            hash *= prime0;
+            hash ^= hash >> 32;
+            return hash;
+        }
     }
 }
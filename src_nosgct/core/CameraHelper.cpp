@@ -7,6 +7,7 @@
  */
 
 #include "CameraHelper.h"
+#include "core/math/math.h"
 #include "core/open_gl.h"
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -57,6 +58,11 @@ namespace viscom {
         return GetViewPerspectiveMatrix();
     }
 
+    math::Frustum<float> CameraHelper::GetViewFrustum() const
+    {
+        return math::frustumFromMatrix(GetViewPerspectiveMatrix());
+    }
+
     math::Line3<float> CameraHelper::GetPickRay(const glm::vec2& globalScreenCoords) const
     {
         math::Line3<float> result;
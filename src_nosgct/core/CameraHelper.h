@@ -67,6 +67,8 @@ namespace viscom {
         glm::mat4 GetCentralPerspectiveMatrix() const;
         /** Returns the cameras eye independent view-projection matrix. */
         glm::mat4 GetCentralViewPerspectiveMatrix() const;
+        /** Returns the view frustum (in world space) of the window and eye currently rendered. */
+        math::Frustum<float> GetViewFrustum() const;
 
         /**
          *  Returns a ray for picking.
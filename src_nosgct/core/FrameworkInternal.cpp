@@ -57,6 +57,8 @@ namespace viscom {
         if constexpr (DEBUG_MODE)glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
         glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 
+        textureManager_.SetMemoryBudget(config_.textureMemoryBudget_ * 1024 * 1024, config_.simulateTextureMemoryBudget_);
+
         glfwSetErrorCallback(FrameworkInternal::ErrorCallbackStatic);
         window_ = glfwCreateWindow(static_cast<int>(config_.virtualScreenSize_.x), static_cast<int>(config_.virtualScreenSize_.y), "VISCOM Framework", nullptr, nullptr);
         if (window_ == nullptr) {
@@ -181,6 +183,7 @@ POP_WARNINGS
         pickMatrix = glm::inverse(camHelper_.GetCentralViewPerspectiveMatrix()) * pickMatrix;
         camHelper_.SetPickMatrix(pickMatrix);
 
+        textureManager_.UpdateResidency();
         appNodeInternal_->PostSync();
     }
 
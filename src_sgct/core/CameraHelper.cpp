@@ -8,6 +8,7 @@
 
 #include <sgct.h>
 #include "CameraHelper.h"
+#include "core/math/math.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <sgct_wrapper.h>
@@ -58,6 +59,11 @@ namespace viscom {
             * sgct_core::ClusterManager::instance()->getSceneTransform() * result;
     }
 
+    math::Frustum<float> CameraHelper::GetViewFrustum() const
+    {
+        return math::frustumFromMatrix(GetViewPerspectiveMatrix());
+    }
+
     math::Line3<float> CameraHelper::GetPickRay(const glm::vec2& globalScreenCoords) const
     {
         math::Line3<float> result;
@@ -51,6 +51,7 @@ namespace viscom {
 #ifndef VISCOM_LOCAL_ONLY
         loadProperties();
 #endif
+        textureManager_.SetMemoryBudget(config_.textureMemoryBudget_ * 1024 * 1024, config_.simulateTextureMemoryBudget_);
         engine_->setPreWindowFunction([app = this]() { app->BasePreWindow(); });
         engine_->setInitOGLFunction([app = this]() { app->BaseInitOpenGL(); });
         engine_->setPreSyncFunction([app = this](){ app->BasePreSync(); });
@@ -205,6 +206,7 @@ POP_WARNINGS
 
     void FrameworkInternal::PostSyncFunction()
     {
+        textureManager_.UpdateResidency();
         appNodeInternal_->PostSync();
     }
 
@@ -38,8 +38,7 @@ namespace viscom {
         if (vboProjectorQuads_ != 0) glDeleteBuffers(0, &vboProjectorQuads_);
         vboProjectorQuads_ = 0;
 
-        if (!alphaTextures_.empty()) glDeleteTextures(static_cast<GLsizei>(alphaTextures_.size()), alphaTextures_.data());
-        alphaTextures_.clear();
+        alphaMasks_.clear();
     }
 
     void WorkerNodeCalibratedInternal::InitOffscreenBuffers()
@@ -47,7 +46,10 @@ namespace viscom {
         spdlog::debug("Initializing calibration data.");
         // init shaders
         calibrationProgram_ = GetFramework().GetGPUProgramManager().GetResource("calibrationRendering", std::vector<std::string>{ "calibrationRendering.vert", "calibrationRendering.frag" });
-        calibrationAlphaTexLoc_ = calibrationProgram_->getUniformLocation("alphaTex");
+        calibrationAlphaTileTableLoc_ = calibrationProgram_->getUniformLocation("alphaTileTable");
+        calibrationAlphaTileAtlasLoc_ = calibrationProgram_->getUniformLocation("alphaTileAtlas");
+        calibrationAlphaMaskSizeLoc_ = calibrationProgram_->getUniformLocation("alphaMaskSize");
+        calibrationAlphaTileSizeLoc_ = calibrationProgram_->getUniformLocation("alphaTileSize");
         calibrationSceneTexLoc_ = calibrationProgram_->getUniformLocation("tex");
 
         spdlog::debug("Loading projector data.");
@@ -66,9 +68,7 @@ namespace viscom {
         auto numWindows = sgct_core::ClusterManager::instance()->getThisNodePtr()->getNumberOfWindows();
         projectorViewport_.resize(numWindows);
         sceneFBOs_.reserve(numWindows);
-        alphaTextures_.resize(numWindows, 0);
-
-        glGenTextures(static_cast<GLsizei>(numWindows), alphaTextures_.data());
+        alphaMasks_.resize(numWindows);
 
         for (auto i = 0U; i < numWindows; ++i) {
             spdlog::debug("Initializing viewport: {}", i);
@@ -174,19 +174,14 @@ namespace viscom {
 
     void WorkerNodeCalibratedInternal::LoadAlphaTexture(std::size_t window, const std::filesystem::path& file, const glm::uvec2& projectorSize, bool isRGB)
     {
+        auto use8Bit = GetFramework().GetConfig().alphaMask8Bit_;
         if (isRGB) {
             int textureSizeX = 0, textureSizeY = 0, textureComp = 0;
             float* data = stbi_loadf(file.string().c_str(), &textureSizeX, &textureSizeY, &textureComp, 0);
 
             assert(textureSizeX == projectorSize.x && textureSizeY == projectorSize.y && textureComp == 3);
 
-            glBindTexture(GL_TEXTURE_2D, alphaTextures_[window]);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, static_cast<int>(projectorSize.x), static_cast<int>(projectorSize.y), 0, GL_RGB, GL_FLOAT, data);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            alphaMasks_[window] = std::make_unique<SparseAlphaMask>(data, projectorSize, 3, use8Bit);
             stbi_image_free(data);
         }
         else {
@@ -198,14 +193,12 @@ namespace viscom {
             assert(textureSize.x == projectorSize.x && textureSize.y == projectorSize.y);
             texAlphaFile.read(reinterpret_cast<char*>(texAlphaData.data()), static_cast<std::streamsize>(sizeof(float) * texAlphaData.size()));
 
-            glBindTexture(GL_TEXTURE_2D, alphaTextures_[window]);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, static_cast<int>(projectorSize.x), static_cast<int>(projectorSize.y), 0, GL_RED, GL_FLOAT, texAlphaData.data());
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            alphaMasks_[window] = std::make_unique<SparseAlphaMask>(texAlphaData.data(), projectorSize, 1, use8Bit);
         }
+
+        const auto& statistics = alphaMasks_[window]->GetStatistics();
+        spdlog::info("Alpha mask {}: {} of {} tiles constant, {} KB instead of {} KB.", window, statistics.constantTiles_, statistics.tiles_,
+            statistics.textureBytes_ / 1024, statistics.fullTextureBytes_ / 1024);
     }
 
 
@@ -243,10 +236,16 @@ namespace viscom {
                 glActiveTexture(GL_TEXTURE0);
                 glBindTexture(GL_TEXTURE_2D, sceneFBOs_[windowId].GetTextures()[0]);
                 glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_2D, alphaTextures_[windowId]);
+                glBindTexture(GL_TEXTURE_2D, alphaMasks_[windowId]->GetTileTable());
+                glActiveTexture(GL_TEXTURE2);
+                glBindTexture(GL_TEXTURE_2D, alphaMasks_[windowId]->GetTileAtlas());
 
                 glUniform1i(calibrationSceneTexLoc_, 0);
-                glUniform1i(calibrationAlphaTexLoc_, 1);
+                glUniform1i(calibrationAlphaTileTableLoc_, 1);
+                glUniform1i(calibrationAlphaTileAtlasLoc_, 2);
+                const auto& alphaMaskSize = alphaMasks_[windowId]->GetSize();
+                glUniform2f(calibrationAlphaMaskSizeLoc_, static_cast<float>(alphaMaskSize.x), static_cast<float>(alphaMaskSize.y));
+                glUniform1f(calibrationAlphaTileSizeLoc_, static_cast<float>(alphaMasks_[windowId]->GetTileSize()));
 
                 glBindVertexArray(vaoProjectorQuads_);
                 glDrawArrays(GL_TRIANGLE_FAN, 4 * static_cast<int>(windowId), 4);
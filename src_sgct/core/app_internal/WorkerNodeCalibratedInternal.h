@@ -10,6 +10,7 @@
 
 #include "core/app_internal/WorkerNodeLocalInternal.h"
 #include "core/CalibrationVertices.h"
+#include "core/gfx/SparseAlphaMask.h"
 
 namespace viscom {
 
@@ -36,8 +37,14 @@ namespace viscom {
 
         /** Holds the shader program for applying the calibration to a rendered scene. */
         std::shared_ptr<GPUProgram> calibrationProgram_;
-        /** Holds the location of the use alpha test flag. */
-        GLint calibrationAlphaTexLoc_ = -1;
+        /** Holds the location of the alpha mask tile table. */
+        GLint calibrationAlphaTileTableLoc_ = -1;
+        /** Holds the location of the alpha mask tile atlas. */
+        GLint calibrationAlphaTileAtlasLoc_ = -1;
+        /** Holds the location of the alpha mask size. */
+        GLint calibrationAlphaMaskSizeLoc_ = -1;
+        /** Holds the location of the alpha mask tile size. */
+        GLint calibrationAlphaTileSizeLoc_ = -1;
         /** Holds the location of the use alpha test flag. */
         GLint calibrationSceneTexLoc_ = -1;
 
@@ -47,7 +54,7 @@ namespace viscom {
         GLuint vaoProjectorQuads_ = 0;
         /** Holds the frame buffers for rendering the scene into. */
         std::vector<FrameBuffer> sceneFBOs_;
-        /** Holds the alpha textures. */
-        std::vector<GLuint> alphaTextures_;
+        /** Holds the alpha masks. */
+        std::vector<std::unique_ptr<SparseAlphaMask>> alphaMasks_;
     };
 }